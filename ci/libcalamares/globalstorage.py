@@ -19,6 +19,8 @@ def value(key):
         return list()
     return ""
 
+def view(key): return value(key)
+
 def insert(key, value): pass
 
 def remove(_): pass
@@ -0,0 +1,172 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "UnattendedInstall.h"
+
+#include "CalamaresVersionX.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "Settings.h"
+#include "modulesystem/Module.h"
+#include "modulesystem/ModuleManager.h"
+#include "utils/Logger.h"
+#include "utils/System.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <iostream>
+
+UnattendedInstall::UnattendedInstall( const QString& answersFile, QObject* parent )
+    : QObject( parent )
+    , m_answersFile( answersFile )
+{
+}
+
+UnattendedInstall::~UnattendedInstall() {}
+
+bool
+UnattendedInstall::init()
+{
+    Logger::setupLogfile();
+    cDebug() << "Calamares version:" << CALAMARES_VERSION << "(unattended)";
+    cDebug() << Logger::SubEntry << "Using settings:" << Calamares::Settings::instance()->path();
+    cDebug() << Logger::SubEntry << "Using answers:" << m_answersFile;
+    cDebug() << Logger::SubEntry << "Using log file:" << Logger::logFile();
+
+    auto* jobQueue = new Calamares::JobQueue( this );
+    new Calamares::System( Calamares::Settings::instance()->doChroot(), this );
+
+    auto* gs = jobQueue->globalStorage();
+    if ( !gs->loadYaml( m_answersFile ) )
+    {
+        cError() << "Could not load answers file" << m_answersFile;
+        report( QStringLiteral( "failed" ),
+                { { QStringLiteral( "message" ), QStringLiteral( "Could not load answers file." ) },
+                  { QStringLiteral( "details" ), m_answersFile } } );
+        return false;
+    }
+    cDebug() << Logger::SubEntry << "Answers provide" << gs->count() << "keys" << gs->keys();
+
+    connect( jobQueue, &Calamares::JobQueue::progress, this, &UnattendedInstall::onProgress );
+    connect( jobQueue, &Calamares::JobQueue::failed, this, &UnattendedInstall::onFailed );
+    connect( jobQueue, &Calamares::JobQueue::finished, this, &UnattendedInstall::onFinished );
+
+    m_moduleManager = new Calamares::ModuleManager( Calamares::Settings::instance()->modulesSearchPaths(), this );
+    connect( m_moduleManager,
+             &Calamares::ModuleManager::initDone,
+             m_moduleManager,
+             &Calamares::ModuleManager::loadModules );
+    connect( m_moduleManager, &Calamares::ModuleManager::modulesLoaded, this, &UnattendedInstall::startInstall );
+    connect( m_moduleManager, &Calamares::ModuleManager::modulesFailed, this, &UnattendedInstall::initFailed );
+    m_moduleManager->init();
+
+    cDebug() << "STARTUP: unattended module init started";
+    return true;
+}
+
+void
+UnattendedInstall::startInstall()
+{
+    cDebug() << "STARTUP: loadModules for exec modules done";
+
+    const auto instanceDescriptors = Calamares::Settings::instance()->moduleInstances();
+    auto* queue = Calamares::JobQueue::instance();
+
+    // This follows ExecutionViewStep::onActivate(), for all the exec phases at once.
+    for ( const auto& modulePhase : Calamares::Settings::instance()->modulesSequence() )
+    {
+        if ( modulePhase.first != Calamares::ModuleSystem::Action::Exec )
+        {
+            continue;
+        }
+        for ( const auto& instanceKey : modulePhase.second )
+        {
+            const auto moduleDescriptor = m_moduleManager->moduleDescriptor( instanceKey );
+            Calamares::Module* module = m_moduleManager->moduleInstance( instanceKey );
+            if ( !module )
+            {
+                continue;
+            }
+
+            const auto instanceDescriptor
+                = std::find_if( instanceDescriptors.constBegin(),
+                                instanceDescriptors.constEnd(),
+                                [ = ]( const Calamares::InstanceDescription& d ) { return d.key() == instanceKey; } );
+            int weight = moduleDescriptor.weight();
+            if ( instanceDescriptor != instanceDescriptors.constEnd() && instanceDescriptor->explicitWeight() )
+            {
+                weight = instanceDescriptor->weight();
+            }
+            weight = qBound( 1, weight, 100 );
+
+            auto jl = module->jobs();
+            for ( auto& j : jl )
+            {
+                j->setModule( instanceKey.toString() );
+                if ( module->isEmergency() )
+                {
+                    j->setEmergency( true );
+                }
+            }
+            report( QStringLiteral( "module" ),
+                    { { QStringLiteral( "module" ), instanceKey.toString() },
+                      { QStringLiteral( "jobs" ), static_cast< int >( jl.count() ) },
+                      { QStringLiteral( "weight" ), weight } } );
+            queue->enqueue( weight, jl );
+        }
+    }
+
+    queue->start();
+}
+
+void
+UnattendedInstall::initFailed( const QStringList& l )
+{
+    cError() << "STARTUP: failed modules are" << l;
+    report( QStringLiteral( "failed" ),
+            { { QStringLiteral( "message" ), QStringLiteral( "Modules failed to load." ) },
+              { QStringLiteral( "details" ), l.join( ' ' ) } } );
+    QCoreApplication::exit( 1 );
+}
+
+void
+UnattendedInstall::onProgress( qreal percent, const QString& status )
+{
+    report( QStringLiteral( "progress" ),
+            { { QStringLiteral( "percent" ), qRound( percent * 1000 ) / 10.0 },
+              { QStringLiteral( "status" ), status } } );
+}
+
+void
+UnattendedInstall::onFailed( const QString& message, const QString& details )
+{
+    m_failed = true;
+    cError() << "Installation failed:" << message;
+    report( QStringLiteral( "failed" ),
+            { { QStringLiteral( "message" ), message }, { QStringLiteral( "details" ), details } } );
+}
+
+void
+UnattendedInstall::onFinished()
+{
+    report( QStringLiteral( "finished" ), { { QStringLiteral( "success" ), !m_failed } } );
+    QCoreApplication::exit( m_failed ? 1 : 0 );
+}
+
+void
+UnattendedInstall::report( const QString& event, QVariantMap data ) const
+{
+    data.insert( QStringLiteral( "event" ), event );
+    std::cout << QJsonDocument( QJsonObject::fromVariantMap( data ) ).toJson( QJsonDocument::Compact ).constData()
+              << std::endl;
+}
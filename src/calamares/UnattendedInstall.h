@@ -0,0 +1,69 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#ifndef UNATTENDEDINSTALL_H
+#define UNATTENDEDINSTALL_H
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+namespace Calamares
+{
+class ModuleManager;
+}  // namespace Calamares
+
+/**
+ * @brief Runs the exec phases of the module sequence without a GUI
+ *
+ * The answers file is a YAML document whose top-level keys are
+ * loaded into Global Storage, taking the place of what the view
+ * pages would have put there (selected image, flavor, SSH keys,
+ * network settings, target disk). Only the exec phases of the
+ * sequence in settings.conf are loaded; view modules there contribute
+ * their headless job, if they have one.
+ *
+ * Progress is written to stdout as one JSON object per line,
+ * with an "event" key of *module*, *progress*, *failed* or *finished*.
+ * The application exits with 0 on success and 1 on failure.
+ *
+ * This needs only a QCoreApplication.
+ */
+class UnattendedInstall : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UnattendedInstall( const QString& answersFile, QObject* parent = nullptr );
+    ~UnattendedInstall() override;
+
+    /** @brief Loads the answers and starts loading modules
+     *
+     * Returns @c false if the answers file cannot be read, in which
+     * case nothing is started. Otherwise, the install runs from the
+     * event loop and quits the application when done.
+     */
+    bool init();
+
+private slots:
+    void startInstall();
+    void initFailed( const QStringList& l );
+    void onProgress( qreal percent, const QString& status );
+    void onFailed( const QString& message, const QString& details );
+    void onFinished();
+
+private:
+    /// Writes @p event as a single JSON line to stdout
+    void report( const QString& event, QVariantMap data = QVariantMap() ) const;
+
+    QString m_answersFile;
+    Calamares::ModuleManager* m_moduleManager = nullptr;
+    bool m_failed = false;
+};
+
+#endif  // UNATTENDEDINSTALL_H
@@ -0,0 +1,309 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file calamares-chroot-helper
+ *
+ * Usage: calamares-chroot-helper <root>
+ *
+ * Changes root to <root> and then starts processes there on request
+ * of Calamares, which started the helper with its end of a socketpair
+ * as fd 3 (see utils/ChrootHelperProtocol.h). This way, running a
+ * command in the target does not need a chroot(8) process, nor a fork
+ * of the (large) Calamares process. The helper exits when Calamares
+ * closes the socket.
+ *
+ * Each process changes root to <root> again, from the root of the host,
+ * so that it runs in whatever is mounted there now: the target may have
+ * been unmounted and mounted again since the helper started.
+ *
+ * This deliberately does not use Qt or libcalamares.
+ */
+
+#include "utils/ChrootHelperProtocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ChrootHelperProtocol;
+
+namespace
+{
+
+/// The root of the host, to find <root> again from
+int s_hostRootFd = -1;
+/// The target, as a path in the host
+const char* s_root = nullptr;
+
+bool
+send_reply( ReplyType type, std::uint32_t id, pid_t pid, int value, const struct rusage* ru = nullptr )
+{
+    Reply r {};
+    r.type = type;
+    r.id = id;
+    r.pid = pid;
+    r.value = value;
+    if ( ru )
+    {
+        r.userMicroseconds = std::int64_t( ru->ru_utime.tv_sec ) * 1000000 + ru->ru_utime.tv_usec;
+        r.systemMicroseconds = std::int64_t( ru->ru_stime.tv_sec ) * 1000000 + ru->ru_stime.tv_usec;
+        r.maxResidentKiB = ru->ru_maxrss;
+        r.blocksRead = ru->ru_inblock;
+        r.blocksWritten = ru->ru_oublock;
+    }
+    ssize_t w;
+    do
+    {
+        w = send( SocketFd, &r, sizeof( r ), MSG_NOSIGNAL );
+    } while ( w < 0 && errno == EINTR );
+    return w == sizeof( r );
+}
+
+/// Starts the process described by @p request and @p strings; returns the pid or -errno
+pid_t
+spawn( const Request& request,
+       const char* strings,
+       std::size_t length,
+       int stdinFd,
+       int outputFd,
+       const sigset_t& mask )
+{
+    std::vector< char* > argv;
+    std::vector< char* > envp;
+    const char* directory = strings;
+    const char* end = strings + length;
+    const char* p = directory + std::strlen( directory ) + 1;
+    for ( std::uint32_t i = 0; i < request.argc + request.envc; ++i )
+    {
+        if ( p >= end )
+        {
+            return -EINVAL;
+        }
+        ( i < request.argc ? argv : envp ).push_back( const_cast< char* >( p ) );
+        p += std::strlen( p ) + 1;
+    }
+    if ( argv.empty() )
+    {
+        return -EINVAL;
+    }
+    argv.push_back( nullptr );
+    envp.push_back( nullptr );
+
+    int errorPipe[ 2 ];
+    if ( pipe2( errorPipe, O_CLOEXEC ) != 0 )
+    {
+        return -errno;
+    }
+    const pid_t pid = fork();
+    if ( pid == 0 )
+    {
+        sigprocmask( SIG_SETMASK, &mask, nullptr );
+        // Calamares may have started the helper with SIGPIPE ignored
+        signal( SIGPIPE, SIG_DFL );
+        if ( dup2( stdinFd, STDIN_FILENO ) >= 0 && dup2( outputFd, STDOUT_FILENO ) >= 0
+             && dup2( outputFd, STDERR_FILENO ) >= 0 && fchdir( s_hostRootFd ) == 0 && chroot( "." ) == 0
+             && chroot( s_root ) == 0 && chdir( *directory ? directory : "/" ) == 0 )
+        {
+            execvpe( argv[ 0 ], argv.data(), envp.data() );
+        }
+        const int e = errno;
+        ( void )!write( errorPipe[ 1 ], &e, sizeof( e ) );
+        _exit( 127 );
+    }
+
+    close( errorPipe[ 1 ] );
+    int e = pid < 0 ? errno : 0;
+    if ( pid > 0 && read( errorPipe[ 0 ], &e, sizeof( e ) ) == sizeof( e ) )
+    {
+        waitpid( pid, nullptr, 0 );
+    }
+    close( errorPipe[ 0 ] );
+    return e ? -e : pid;
+}
+
+/// Reads one request; returns false when Calamares is gone
+bool
+handle_request( std::map< pid_t, std::uint32_t >& children, const sigset_t& mask )
+{
+    std::vector< char > buffer( MaxMessageSize );
+    union
+    {
+        char buf[ CMSG_SPACE( 2 * sizeof( int ) ) ];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { buffer.data(), buffer.size() };
+    struct msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof( control.buf );
+
+    ssize_t n;
+    do
+    {
+        n = recvmsg( SocketFd, &msg, MSG_CMSG_CLOEXEC );
+    } while ( n < 0 && errno == EINTR );
+    if ( n <= 0 )
+    {
+        return false;
+    }
+
+    int fds[ 2 ] = { -1, -1 };
+    for ( struct cmsghdr* c = CMSG_FIRSTHDR( &msg ); c; c = CMSG_NXTHDR( &msg, c ) )
+    {
+        if ( c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS
+             && c->cmsg_len == CMSG_LEN( 2 * sizeof( int ) ) )
+        {
+            std::memcpy( fds, CMSG_DATA( c ), sizeof( fds ) );
+        }
+    }
+
+    Request request;
+    if ( std::size_t( n ) < sizeof( request ) )
+    {
+        return true;
+    }
+    std::memcpy( &request, buffer.data(), sizeof( request ) );
+
+    if ( request.type == RequestType::Spawn )
+    {
+        // Make sure the strings are terminated, even if the message is not
+        buffer[ std::min( std::size_t( n ), buffer.size() - 1 ) ] = '\0';
+        const char* strings = buffer.data() + sizeof( request );
+        const pid_t pid = ( fds[ 0 ] < 0 || fds[ 1 ] < 0 )
+            ? -EBADF
+            : spawn( request, strings, n - sizeof( request ), fds[ 0 ], fds[ 1 ], mask );
+        if ( pid > 0 )
+        {
+            children[ pid ] = request.id;
+            send_reply( ReplyType::Started, request.id, pid, 0 );
+        }
+        else
+        {
+            send_reply( ReplyType::Failed, request.id, -1, -pid );
+        }
+    }
+    else if ( request.type == RequestType::Signal )
+    {
+        for ( const auto& [ pid, id ] : children )
+        {
+            if ( id == request.id )
+            {
+                kill( pid, request.signal );
+            }
+        }
+    }
+
+    for ( int fd : fds )
+    {
+        if ( fd >= 0 )
+        {
+            close( fd );
+        }
+    }
+    return true;
+}
+
+/// Reaps exited children and tells Calamares about them
+void
+reap_children( std::map< pid_t, std::uint32_t >& children )
+{
+    int status;
+    struct rusage ru;
+    pid_t pid;
+    while ( ( pid = wait4( -1, &status, WNOHANG, &ru ) ) > 0 )
+    {
+        auto it = children.find( pid );
+        if ( it != children.end() )
+        {
+            send_reply( ReplyType::Exited, it->second, pid, status, &ru );
+            children.erase( it );
+        }
+    }
+}
+
+}  // namespace
+
+int
+main( int argc, char** argv )
+{
+    if ( argc != 2 || fcntl( SocketFd, F_GETFD ) < 0 )
+    {
+        const char message[] = "calamares-chroot-helper is started by Calamares.\n";
+        ( void )!write( STDERR_FILENO, message, sizeof( message ) - 1 );
+        return 1;
+    }
+    s_root = argv[ 1 ];
+    s_hostRootFd = open( "/", O_PATH | O_DIRECTORY | O_CLOEXEC );
+    if ( s_hostRootFd < 0 || chroot( s_root ) != 0 || chdir( "/" ) != 0 )
+    {
+        send_reply( ReplyType::Failed, 0, -1, errno );
+        return 1;
+    }
+    // Commands are searched for here, as chroot(8) would with a typical PATH
+    setenv( "PATH", "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin", 1 );
+
+    sigset_t oldMask;
+    sigset_t childMask;
+    sigemptyset( &childMask );
+    sigaddset( &childMask, SIGCHLD );
+    sigprocmask( SIG_BLOCK, &childMask, &oldMask );
+    const int childFd = signalfd( -1, &childMask, SFD_CLOEXEC );
+    if ( childFd < 0 )
+    {
+        send_reply( ReplyType::Failed, 0, -1, errno );
+        return 1;
+    }
+    fcntl( SocketFd, F_SETFD, FD_CLOEXEC );
+
+    send_reply( ReplyType::Ready, 0, getpid(), 0 );
+
+    std::map< pid_t, std::uint32_t > children;
+    while ( true )
+    {
+        pollfd fds[ 2 ] = { { SocketFd, POLLIN, 0 }, { childFd, POLLIN, 0 } };
+        if ( poll( fds, 2, -1 ) < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            break;
+        }
+        if ( fds[ 1 ].revents )
+        {
+            signalfd_siginfo info;
+            ( void )!read( childFd, &info, sizeof( info ) );
+            reap_children( children );
+        }
+        if ( fds[ 0 ].revents && !handle_request( children, oldMask ) )
+        {
+            break;
+        }
+    }
+
+    // Calamares is done with us; don't leave anything running in the target.
+    for ( const auto& child : children )
+    {
+        kill( child.first, SIGKILL );
+    }
+    return 0;
+}
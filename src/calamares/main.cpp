@@ -9,6 +9,8 @@
  */
 
 #include "CalamaresApplication.h"
+#include "CalamaresVersionX.h"
+#include "UnattendedInstall.h"
 
 #include "Settings.h"
 #include "utils/Dirs.h"
@@ -24,6 +26,7 @@
 #endif
 
 #include <QCommandLineParser>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 
@@ -61,9 +64,11 @@ debug_level( QCommandLineParser& parser, QCommandLineOption& levelOption )
  * Sets up internals for Calamares based on command-line arguments like `-D`,
  * `-d`, etc. Returns @c true if this is a *debug* run, i.e. if the `-d`
  * command-line flag is given, @c false otherwise.
+ *
+ * If `--unattended` is given, @p answersFile is set to its value.
  */
 static bool
-handle_args( CalamaresApplication& a )
+handle_args( QCoreApplication& a, QString& answersFile )
 {
     QCommandLineOption debugOption( QStringList { "d", "debug" },
                                     "Also look in current directory for configuration. Implies -D8." );
@@ -75,6 +80,9 @@ handle_args( CalamaresApplication& a )
     QCommandLineOption configOption(
         QStringList { "c", "config" }, "Configuration directory to use, for testing purposes.", "config" );
     QCommandLineOption xdgOption( QStringList { "X", "xdg-config" }, "Use XDG_{CONFIG,DATA}_DIRS as well." );
+    QCommandLineOption unattendedOption( QStringList { "u", "unattended" },
+                                         "Install without GUI, using the Global Storage values in the answers file.",
+                                         "answers.yaml" );
 
     QCommandLineParser parser;
     parser.setApplicationDescription( "Distribution-independent installer framework" );
@@ -86,6 +94,7 @@ handle_args( CalamaresApplication& a )
     parser.addOption( configOption );
     parser.addOption( xdgOption );
     parser.addOption( debugTxOption );
+    parser.addOption( unattendedOption );
 
     parser.process( a );
 
@@ -99,13 +108,72 @@ handle_args( CalamaresApplication& a )
         Calamares::setXdgDirs();
     }
     Calamares::setAllowLocalTranslation( parser.isSet( debugOption ) || parser.isSet( debugTxOption ) );
+    answersFile = parser.value( unattendedOption );
 
     return parser.isSet( debugOption );
 }
 
+static bool
+is_unattended_option( const char* s )
+{
+    return !qstrcmp( s, "--unattended" ) || !qstrcmp( s, "-u" ) || !qstrncmp( s, "--unattended=", 13 );
+}
+
+/** @brief Runs an unattended install
+ *
+ * This does the non-GUI parts of the regular startup -- on a
+ * QCoreApplication -- and then hands over to UnattendedInstall.
+ */
+static int
+run_unattended( int& argc, char* argv[] )
+{
+    QCoreApplication a( argc, argv );
+    a.setOrganizationDomain( QStringLiteral( CALAMARES_ORGANIZATION_DOMAIN ) );
+    a.setApplicationName( QStringLiteral( CALAMARES_APPLICATION_NAME ) );
+    a.setApplicationVersion( QStringLiteral( CALAMARES_VERSION ) );
+
+    QString answersFile;
+    const bool is_debug = handle_args( a, answersFile );
+
+    std::unique_ptr< KDSingleApplication > possiblyUnique;
+    if ( !is_debug )
+    {
+        possiblyUnique = std::make_unique< KDSingleApplication >();
+        if ( !possiblyUnique->isPrimaryInstance() )
+        {
+            qCritical() << "Calamares is already running.";
+            return 87;  // EUSERS on Linux
+        }
+    }
+
+    Calamares::Settings::init( is_debug );
+    if ( !Calamares::Settings::instance() || !Calamares::Settings::instance()->isValid() )
+    {
+        qCritical() << "Calamares has invalid settings, shutting down.";
+        return 78;  // EX_CONFIG on FreeBSD
+    }
+
+    UnattendedInstall install( answersFile );
+    if ( !install.init() )
+    {
+        return 78;  // EX_CONFIG on FreeBSD
+    }
+    return a.exec();
+}
+
 int
 main( int argc, char* argv[] )
 {
+    // Unattended installs never create a QApplication, so this
+    // is decided before any application object exists.
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( is_unattended_option( argv[ i ] ) )
+        {
+            return run_unattended( argc, argv );
+        }
+    }
+
 #if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
     // Not needed in Qt6
     QApplication::setAttribute( Qt::AA_EnableHighDpiScaling );
@@ -132,7 +200,8 @@ main( int argc, char* argv[] )
 #endif
 
     std::unique_ptr< KDSingleApplication > possiblyUnique;
-    const bool is_debug = handle_args( a );
+    QString answersFile;  // Not used in GUI mode
+    const bool is_debug = handle_args( a, answersFile );
     if ( !is_debug )
     {
         possiblyUnique = std::make_unique< KDSingleApplication >();
@@ -11,8 +11,6 @@
 
 #include "GlobalStorage.h"
 
-#include "compat/Mutex.h"
-
 #include "utils/Logger.h"
 #include "utils/Units.h"
 #include "utils/Yaml.h"
@@ -20,31 +18,81 @@
 #include <QFile>
 #include <QJsonDocument>
 
+#include <utility>
+
 using namespace Calamares::Units;
 
 namespace Calamares
 {
 
-class GlobalStorage::ReadLock : public MutexLocker
+class GlobalStorage::ReadLock : public QReadLocker
 {
 public:
     ReadLock( const GlobalStorage* gs )
-        : MutexLocker( &gs->m_mutex )
+        : QReadLocker( &gs->m_lock )
     {
     }
 };
 
-class GlobalStorage::WriteLock : public MutexLocker
+/** @brief Exclusive access to the storage, for one batch of changes
+ *
+ * Modifications go through insert() and remove() on the lock, which
+ * keeps track of the keys whose value actually changes. The signals
+ * are emitted once the lock is released, so that slots can read
+ * the storage (and will see the whole batch).
+ */
+class GlobalStorage::WriteLock : public QWriteLocker
 {
 public:
     WriteLock( GlobalStorage* gs )
-        : MutexLocker( &gs->m_mutex )
+        : QWriteLocker( &gs->m_lock )
         , m_gs( gs )
     {
     }
-    ~WriteLock() { m_gs->changed(); }
+    ~WriteLock()
+    {
+        unlock();
+        for ( const auto& key : std::as_const( m_changedKeys ) )
+        {
+            emit m_gs->keyChanged( key );
+        }
+        emit m_gs->changed();
+    }
+
+    void insert( const QString& key, const QVariant& value )
+    {
+        auto it = m_gs->m.find( key );
+        if ( it == m_gs->m.end() )
+        {
+            m_gs->m.insert( key, value );
+            changed( key );
+        }
+        else if ( it.value() != value )
+        {
+            it.value() = value;
+            changed( key );
+        }
+    }
+
+    int remove( const QString& key )
+    {
+        const int n = m_gs->m.remove( key );
+        if ( n )
+        {
+            changed( key );
+        }
+        return n;
+    }
+
+private:
+    void changed( const QString& key )
+    {
+        m_gs->m_generations.insert( key, ++m_gs->m_generation );
+        m_changedKeys.append( key );
+    }
 
     GlobalStorage* m_gs;
+    QStringList m_changedKeys;
 };
 
 GlobalStorage::GlobalStorage( QObject* parent )
@@ -70,7 +118,17 @@ void
 GlobalStorage::insert( const QString& key, const QVariant& value )
 {
     WriteLock l( this );
-    m.insert( key, value );
+    l.insert( key, value );
+}
+
+void
+GlobalStorage::insert( const QVariantMap& values )
+{
+    WriteLock l( this );
+    for ( auto it = values.constBegin(); it != values.constEnd(); ++it )
+    {
+        l.insert( it.key(), it.value() );
+    }
 }
 
 QStringList
@@ -84,15 +142,31 @@ int
 GlobalStorage::remove( const QString& key )
 {
     WriteLock l( this );
-    int nItems = m.remove( key );
-    return nItems;
+    return l.remove( key );
 }
 
 void
 GlobalStorage::clear()
 {
     WriteLock l( this );
-    m.clear();
+    for ( const auto& key : m.keys() )
+    {
+        l.remove( key );
+    }
+}
+
+QVariantMap
+GlobalStorage::data() const
+{
+    ReadLock l( this );
+    return m;
+}
+
+quint64
+GlobalStorage::generation( const QString& key ) const
+{
+    ReadLock l( this );
+    return m_generations.value( key, 0 );
 }
 
 QVariant
@@ -149,15 +223,7 @@ GlobalStorage::loadJson( const QString& filename )
     }
     else
     {
-        WriteLock l( this );
-        // Do **not** use method insert() here, because it would
-        //   recursively lock the mutex, leading to deadlock. Also,
-        //   that would emit changed() for each key.
-        auto map = d.toVariant().toMap();
-        for ( auto i = map.constBegin(); i != map.constEnd(); ++i )
-        {
-            m.insert( i.key(), *i );
-        }
+        insert( d.toVariant().toMap() );
         return true;
     }
     return false;
@@ -177,14 +243,7 @@ GlobalStorage::loadYaml( const QString& filename )
     auto map = Calamares::YAML::load( filename, &ok );
     if ( ok )
     {
-        WriteLock l( this );
-        // Do **not** use method insert() here, because it would
-        //   recursively lock the mutex, leading to deadlock. Also,
-        //   that would emit changed() for each key.
-        for ( auto i = map.constBegin(); i != map.constEnd(); ++i )
-        {
-            m.insert( i.key(), *i );
-        }
+        insert( map );
         return true;
     }
     return false;
@@ -14,8 +14,9 @@
 
 #include "DllMacro.h"
 
-#include <QMutex>
+#include <QHash>
 #include <QObject>
+#include <QReadWriteLock>
 #include <QString>
 #include <QVariantMap>
 
@@ -34,15 +35,19 @@ namespace Calamares
  *
  * GS behaves as a basic key-value store, with a QVariantMap behind
  * it. Any QVariant can be put into the storage, and the signal
- * changed() is emitted when any data is modified.
+ * changed() is emitted when any data is modified. keyChanged() tells
+ * which keys were modified, so observers of one key do not need
+ * to re-read the whole store.
  *
  * In general, see QVariantMap (possibly after calling data()) for details.
  *
  * This class is thread-safe -- most accesses go through JobQueue, which
  * handles threading itself, but because modules load in parallel and can
  * have asynchronous tasks like GeoIP lookups, the storage itself also
- * has locking. All methods are thread-safe, use data() to make a snapshot
- * copy for use outside of the thread-safe API.
+ * has locking. Readers do not block each other, only writers. All methods
+ * are thread-safe, use data() to make a snapshot copy for use outside of
+ * the thread-safe API. Signals are emitted after the lock is released,
+ * in the thread that made the change.
  */
 class DLLEXPORT GlobalStorage : public QObject
 {
@@ -60,9 +65,17 @@ public:
      *
      * The @p value is added to the store with key @p key. If @p key
      * already exists in the store, its existing value is overwritten.
-     * The changed() signal is emitted regardless.
+     * The changed() signal is emitted regardless, keyChanged() only if
+     * the value is different.
      */
     void insert( const QString& key, const QVariant& value );
+    /** @brief Insert all the keys and values of @p values at once
+     *
+     * Other threads see either none or all of the new values, and
+     * changed() is emitted only once, after keyChanged() for each
+     * of the keys whose value is different.
+     */
+    void insert( const QVariantMap& values );
     /** @brief Removes a key and its value
      *
      * The @p key is removed from the store. If the @p key does not
@@ -118,9 +131,19 @@ public:
 
     /** @brief Make a complete copy of the data
      *
-     * Provides a snapshot of the data at a given time.
+     * Provides a snapshot of the data at a given time. This is cheap:
+     * the map is implicitly shared, and only copied (once) by the next
+     * change to the store while the snapshot is still alive.
      */
-    QVariantMap data() const { return m; }
+    QVariantMap data() const;
+
+    /** @brief A number that changes each time @p key changes
+     *
+     * This can be used to cache something derived from the value of
+     * @p key: while the generation stays the same, so does the value.
+     * Keys that have never been set have generation 0.
+     */
+    quint64 generation( const QString& key ) const;
 
 public Q_SLOTS:
     /** @brief Does the store contain the given key?
@@ -159,12 +182,20 @@ signals:
      * is already present.
      */
     void changed();
+    /** @brief Emitted for each key whose value was inserted, modified or removed
+     *
+     * A batch of changes (e.g. insert() of a whole map) emits this for
+     * each key first, and changed() once at the end.
+     */
+    void keyChanged( const QString& key );
 
 private:
     class ReadLock;
     class WriteLock;
     QVariantMap m;
-    mutable QMutex m_mutex;
+    QHash< QString, quint64 > m_generations;
+    quint64 m_generation = 0;
+    mutable QReadWriteLock m_lock;
 };
 
 
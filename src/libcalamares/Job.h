@@ -155,6 +155,14 @@ public:
     bool isEmergency() const { return m_emergency; }
     void setEmergency( bool e ) { m_emergency = e; }
 
+    /** @brief The instance key of the module this job belongs to
+     *
+     * Set when the job is queued; the JobQueue uses it to attribute
+     * log messages from exec() to the module (see Logger::ModuleScope).
+     */
+    QString module() const { return m_module; }
+    void setModule( const QString& module ) { m_module = module; }
+
 signals:
     /** @brief Signals that the job has made progress
      *
@@ -165,6 +173,7 @@ signals:
 
 private:
     bool m_emergency = false;
+    QString m_module;
 };
 
 using job_ptr = QSharedPointer< Job >;
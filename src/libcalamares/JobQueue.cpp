@@ -13,7 +13,9 @@
 #include "CalamaresConfig.h"
 #include "GlobalStorage.h"
 #include "Job.h"
+#include "PrepareQueue.h"
 #include "compat/Mutex.h"
+#include "utils/ChrootHelper.h"
 #include "utils/Logger.h"
 
 #include <QDBusConnection>
@@ -437,7 +439,11 @@ public:
                 o.refresh();  // So next time it shows the function header again
                 emitProgress( 0.0 );  // 0% for *this job*
                 connect( jobitem.job.data(), &Job::progress, this, &JobThread::emitProgress );
-                auto result = jobitem.job->exec();
+                auto result = [ &job = jobitem.job ]()
+                {
+                    Logger::ModuleScope scope( job->module() );
+                    return job->exec();
+                }();
                 if ( !failureEncountered && !result )
                 {
                     // so this is the first failure
@@ -452,6 +458,8 @@ public:
         }
         if ( failureEncountered )
         {
+            // The umount job may not have run, so don't keep the target busy
+            Calamares::Utils::ChrootHelper::stop();
             QMetaObject::invokeMethod(
                 m_queue, "failed", Qt::QueuedConnection, Q_ARG( QString, message ), Q_ARG( QString, details ) );
         }
@@ -552,6 +560,7 @@ JobQueue::JobQueue( QObject* parent )
     : QObject( parent )
     , m_thread( new JobThread( this ) )
     , m_storage( new GlobalStorage( this ) )
+    , m_prepare( new PrepareQueue( m_storage, this ) )
 {
     Q_ASSERT( !s_instance );
     s_instance = this;
@@ -569,7 +578,9 @@ JobQueue::~JobQueue()
         }
         delete m_thread;
     }
+    Calamares::Utils::ChrootHelper::stop();
 
+    delete m_prepare;
     delete m_storage;
     s_instance = nullptr;
 }
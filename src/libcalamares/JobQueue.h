@@ -19,6 +19,7 @@ namespace Calamares
 {
 class GlobalStorage;
 class JobThread;
+class PrepareQueue;
 
 ///@brief RAII class to suppress sleep / suspend during its lifetime
 class DLLEXPORT SleepInhibitor : public QObject
@@ -54,6 +55,8 @@ public:
     }
 
     GlobalStorage* globalStorage() const;
+    /// @brief The speculative prepare tasks that feed the jobs in this queue
+    PrepareQueue* prepareQueue() const { return m_prepare; }
 
     /** @brief Queues up jobs from a single module source
      *
@@ -114,6 +117,7 @@ private:
 
     JobThread* m_thread;
     GlobalStorage* m_storage;
+    PrepareQueue* m_prepare;
     bool m_finished = true;  ///< Initially, not running
 };
 
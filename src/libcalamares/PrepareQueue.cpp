@@ -0,0 +1,192 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "PrepareQueue.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "compat/Mutex.h"
+#include "utils/Logger.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+
+namespace Calamares
+{
+
+PrepareQueue::PrepareQueue( GlobalStorage* gs, QObject* parent )
+    : QObject( parent )
+    , m_gs( gs )
+{
+    connect( m_gs, &GlobalStorage::keyChanged, this, &PrepareQueue::globalStorageChanged );
+}
+
+PrepareQueue::~PrepareQueue()
+{
+    // Don't leave work running in the thread pool behind us.
+    setArmed( false );
+    for ( auto& task : m_tasks )
+    {
+        task.future.waitForFinished();
+    }
+}
+
+PrepareQueue*
+PrepareQueue::instance()
+{
+    auto* jq = JobQueue::instance();
+    return jq ? jq->prepareQueue() : nullptr;
+}
+
+void
+PrepareQueue::registerTask( const QString& id, const QStringList& inputKeys, Function f )
+{
+    MutexLocker lock( &m_mutex );
+    auto& task = m_tasks[ id ];
+    if ( task.token )
+    {
+        task.token->cancel();
+    }
+    task = Task { inputKeys, std::move( f ), QVariantMap(), nullptr, QFuture< QVariant >() };
+    cDebug() << "Prepare task" << id << "registered for" << inputKeys;
+    if ( m_armed )
+    {
+        launch( id, task );
+    }
+}
+
+void
+PrepareQueue::setArmed( bool armed )
+{
+    MutexLocker lock( &m_mutex );
+    if ( armed == m_armed )
+    {
+        return;
+    }
+    m_armed = armed;
+
+    for ( auto it = m_tasks.begin(); it != m_tasks.end(); ++it )
+    {
+        if ( armed )
+        {
+            launch( it.key(), it.value() );
+        }
+        else if ( it->token && !it->future.isFinished() )
+        {
+            it->token->cancel();
+            it->token = nullptr;
+            it->inputs.clear();
+        }
+    }
+}
+
+QVariant
+PrepareQueue::result( const QString& id, bool wait )
+{
+    QFuture< QVariant > future;
+    std::shared_ptr< Token > token;
+    {
+        MutexLocker lock( &m_mutex );
+        auto it = m_tasks.find( id );
+        if ( it == m_tasks.end() || !it->token )
+        {
+            return QVariant();
+        }
+        QVariantMap inputs;
+        if ( !currentInputs( it.value(), inputs ) || inputs != it->inputs )
+        {
+            cDebug() << "Prepare task" << id << "ran with outdated inputs.";
+            return QVariant();
+        }
+        future = it->future;
+        token = it->token;
+        if ( !wait && !future.isFinished() )
+        {
+            cDebug() << "Prepare task" << id << "not done, cancelled.";
+            token->cancel();
+            return QVariant();
+        }
+    }
+
+    if ( !future.isFinished() )
+    {
+        cDebug() << "Waiting for prepare task" << id;
+    }
+    future.waitForFinished();
+    return token->isCancelled() ? QVariant() : future.result();
+}
+
+void
+PrepareQueue::globalStorageChanged( const QString& key )
+{
+    if ( !m_armed )
+    {
+        return;
+    }
+    MutexLocker lock( &m_mutex );
+    for ( auto it = m_tasks.begin(); it != m_tasks.end(); ++it )
+    {
+        if ( it->inputKeys.contains( key ) )
+        {
+            launch( it.key(), it.value() );
+        }
+    }
+}
+
+bool
+PrepareQueue::currentInputs( const Task& task, QVariantMap& inputs ) const
+{
+    inputs.clear();
+    for ( const auto& key : task.inputKeys )
+    {
+        if ( !m_gs->contains( key ) )
+        {
+            return false;
+        }
+        inputs.insert( key, m_gs->value( key ) );
+    }
+    return true;
+}
+
+void
+PrepareQueue::launch( const QString& id, Task& task )
+{
+    QVariantMap inputs;
+    if ( !currentInputs( task, inputs ) || ( task.token && inputs == task.inputs ) )
+    {
+        return;
+    }
+
+    if ( task.token )
+    {
+        task.token->cancel();
+    }
+    task.inputs = inputs;
+    task.token = std::make_shared< Token >();
+
+    cDebug() << "Starting prepare task" << id;
+    task.future = QtConcurrent::run(
+        [ id, inputs, function = task.function, token = task.token ]() -> QVariant
+        {
+            QElapsedTimer timer;
+            timer.start();
+            QVariant r = function( inputs, *token );
+            if ( token->isCancelled() )
+            {
+                cDebug() << "Prepare task" << id << "cancelled after" << timer.elapsed() << "ms";
+            }
+            else
+            {
+                cDebug() << "Prepare task" << id << "done in" << timer.elapsed() << "ms";
+            }
+            return r;
+        } );
+}
+
+}  // namespace Calamares
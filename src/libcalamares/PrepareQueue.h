@@ -0,0 +1,136 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#ifndef CALAMARES_PREPAREQUEUE_H
+#define CALAMARES_PREPAREQUEUE_H
+
+#include "DllMacro.h"
+
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace Calamares
+{
+class GlobalStorage;
+
+/** @brief Speculative preparation work for the exec phase
+ *
+ * Some of the work done by jobs in the exec phase depends only on
+ * choices that are fixed well before the user clicks *Install*:
+ * checking the selected image, or finding what is on the target disk.
+ * Modules can register a *prepare task* for that work: an idempotent,
+ * read-only function of some Global Storage keys. While the queue is
+ * armed, each task is run on a background thread as soon as all its
+ * input keys are set, and re-run (cancelling the previous run) whenever
+ * one of them changes.
+ *
+ * The job that needs the work asks for the result(). That is only
+ * valid if the inputs of the run still match Global Storage; otherwise
+ * the job does the work itself as it always did. Prepare tasks must
+ * never change the system, since the user may still go back.
+ *
+ * ViewManager arms the queue on the last view step before an exec phase.
+ */
+class DLLEXPORT PrepareQueue : public QObject
+{
+    Q_OBJECT
+public:
+    /** @brief Cancellation flag shared with a running task
+     *
+     * Long-running tasks should check isCancelled() regularly and
+     * return early (with any value) when it is set.
+     */
+    class Token
+    {
+    public:
+        bool isCancelled() const { return m_cancelled.load(); }
+        void cancel() { m_cancelled.store( true ); }
+
+    private:
+        std::atomic< bool > m_cancelled { false };
+    };
+
+    /** @brief The work of a prepare task
+     *
+     * Called on a worker thread with the values of the input keys.
+     * Returns the result to hand to the consuming job.
+     */
+    using Function = std::function< QVariant( const QVariantMap& inputs, const Token& token ) >;
+
+    explicit PrepareQueue( GlobalStorage* gs, QObject* parent = nullptr );
+    ~PrepareQueue() override;
+
+    /** @brief The prepare queue of the JobQueue instance
+     *
+     * May be @c nullptr if there is no JobQueue.
+     */
+    static PrepareQueue* instance();
+
+    /** @brief Registers (or replaces) prepare task @p id
+     *
+     * The task runs once all of @p inputKeys are present in Global Storage.
+     * By convention, @p id is "<module>.<what>".
+     */
+    void registerTask( const QString& id, const QStringList& inputKeys, Function f );
+
+    /** @brief Allow (or stop) running tasks
+     *
+     * Arming starts every task whose inputs are available. Disarming
+     * cancels the runs in progress; finished results are kept, since
+     * they are checked against their inputs anyway.
+     */
+    void setArmed( bool armed );
+    bool isArmed() const { return m_armed; }
+
+    /** @brief Result of task @p id for the current inputs
+     *
+     * If a run with the inputs currently in Global Storage exists,
+     * waits for it to finish and returns its result. Returns an invalid
+     * QVariant if there is no such run or it was cancelled; the caller
+     * should then do the work itself. This is meant to be called from jobs.
+     *
+     * With @p wait false, a run that is not finished yet is cancelled
+     * instead, for work the job can do without (or better) itself.
+     */
+    QVariant result( const QString& id, bool wait = true );
+
+private:
+    struct Task
+    {
+        QStringList inputKeys;
+        Function function;
+        QVariantMap inputs;  ///< Inputs of the last run
+        std::shared_ptr< Token > token;  ///< Token of the last run, or @c nullptr
+        QFuture< QVariant > future;
+    };
+
+    void globalStorageChanged( const QString& key );
+    /// Returns @c true and fills @p inputs if all the keys are set
+    bool currentInputs( const Task& task, QVariantMap& inputs ) const;
+    /// Starts @p task if its inputs are available and changed; requires m_mutex
+    void launch( const QString& id, Task& task );
+
+    GlobalStorage* m_gs;
+    mutable QMutex m_mutex;
+    QMap< QString, Task > m_tasks;
+    std::atomic< bool > m_armed { false };  ///< Changed with m_mutex held, read without
+};
+
+}  // namespace Calamares
+
+#endif  // CALAMARES_PREPAREQUEUE_H
@@ -179,6 +179,37 @@ interpretInstances( const ::YAML::Node& node, Settings::InstanceDescriptionList&
     }
 }
 
+/** @brief Applies the per-module log levels from the *log-levels* map
+ *
+ * Invalid entries are warned about and ignored.
+ */
+static void
+interpretLogLevels( const ::YAML::Node& node )
+{
+    if ( !node )
+    {
+        return;
+    }
+    const auto levels = Calamares::YAML::toVariant( node ).toMap();
+    if ( levels.isEmpty() && !node.IsMap() )
+    {
+        cWarning() << "Settings *log-levels* should be a map of module names to levels.";
+        return;
+    }
+    for ( auto it = levels.constBegin(); it != levels.constEnd(); ++it )
+    {
+        bool ok = false;
+        const int level = it.value().toInt( &ok );
+        if ( !ok || level < 0 )
+        {
+            cWarning() << "Settings *log-levels* has invalid level" << it.value() << "for" << it.key();
+            continue;
+        }
+        Logger::setupModuleLogLevel( it.key(), static_cast< unsigned int >( level ) );
+        cDebug() << Logger::SubEntry << "Log level for" << it.key() << "is" << level;
+    }
+}
+
 static void
 interpretSequence( const ::YAML::Node& node, Settings::ModuleSequence& moduleSequence )
 {
@@ -326,6 +357,7 @@ Settings::setConfiguration( const QByteArray& ba, const QString& explainName )
             debugMode(), Calamares::YAML::toStringList( config[ "modules-search" ] ), m_modulesSearchPaths );
         interpretInstances( config[ "instances" ], m_moduleInstances );
         interpretSequence( config[ "sequence" ], m_modulesSequence );
+        interpretLogLevels( config[ "log-levels" ] );
 
         m_brandingComponentName = requireString( config, "branding" );
         m_promptInstall = requireBool( config, "prompt-install", false );
@@ -11,6 +11,7 @@
 
 #include "GlobalStorage.h"
 #include "JobQueue.h"
+#include "PrepareQueue.h"
 #include "Settings.h"
 #include "compat/Variant.h"
 #include "modulesystem/InstanceKey.h"
@@ -29,6 +30,7 @@ public:
 
 private Q_SLOTS:
     void testGSModify();
+    void testGSKeyChanged();
     void testGSLoadSave();
     void testGSLoadSave2();
     void testGSLoadSaveYAMLStringList();
@@ -40,6 +42,7 @@ private Q_SLOTS:
     void testSettings();
 
     void testJobQueue();
+    void testPrepareQueue();
 };
 
 void
@@ -68,6 +71,51 @@ TestLibCalamares::testGSModify()
     QCOMPARE( spy.count(), 2 );  // one insert, one remove
 }
 
+void
+TestLibCalamares::testGSKeyChanged()
+{
+    Calamares::GlobalStorage gs;
+    QSignalSpy spy( &gs, &Calamares::GlobalStorage::changed );
+    QSignalSpy keySpy( &gs, &Calamares::GlobalStorage::keyChanged );
+
+    gs.insert( "derp", 17 );
+    QCOMPARE( spy.count(), 1 );
+    QCOMPARE( keySpy.count(), 1 );
+    QCOMPARE( keySpy.takeFirst().first().toString(), QStringLiteral( "derp" ) );
+
+    // Same value: changed, but not keyChanged, and the generation stays
+    const auto generation = gs.generation( "derp" );
+    QVERIFY( generation > 0 );
+    QCOMPARE( gs.generation( "cow" ), quint64( 0 ) );
+    gs.insert( "derp", 17 );
+    QCOMPARE( spy.count(), 2 );
+    QCOMPARE( keySpy.count(), 0 );
+    QCOMPARE( gs.generation( "derp" ), generation );
+    gs.insert( "derp", 18 );
+    QVERIFY( gs.generation( "derp" ) > generation );
+    keySpy.clear();
+
+    // A batch is one change, with one keyChanged for each modified key
+    gs.insert( QVariantMap { { "derp", 18 }, { "cow", "moo" }, { "dog", "woof" } } );
+    QCOMPARE( spy.count(), 4 );
+    QCOMPARE( keySpy.count(), 2 );
+    QCOMPARE( gs.count(), 3 );
+
+    // The snapshot does not follow changes
+    const auto snapshot = gs.data();
+    gs.remove( "cow" );
+    gs.remove( "cow" );
+    QCOMPARE( spy.count(), 6 );
+    QCOMPARE( keySpy.count(), 3 );
+    QCOMPARE( snapshot.count(), 3 );
+    QCOMPARE( gs.count(), 2 );
+
+    gs.clear();
+    QCOMPARE( spy.count(), 7 );
+    QCOMPARE( keySpy.count(), 5 );
+    QCOMPARE( gs.count(), 0 );
+}
+
 void
 TestLibCalamares::testGSLoadSave()
 {
@@ -661,6 +709,61 @@ TestLibCalamares::testJobQueue()
     }
 }
 
+void
+TestLibCalamares::testPrepareQueue()
+{
+    Calamares::JobQueue q;
+    auto* gs = q.globalStorage();
+    auto* pq = Calamares::PrepareQueue::instance();
+    QVERIFY( pq );
+    QCOMPARE( pq, q.prepareQueue() );
+
+    QAtomicInt runs = 0;
+    pq->registerTask( "test.double",
+                      { "number" },
+                      [ &runs ]( const QVariantMap& inputs, const Calamares::PrepareQueue::Token& )
+                      {
+                          runs.ref();
+                          return QVariant( inputs.value( "number" ).toInt() * 2 );
+                      } );
+
+    // Nothing runs unless armed, and nothing runs without inputs
+    QVERIFY( !pq->result( "test.double" ).isValid() );
+    gs->insert( "number", 3 );
+    QVERIFY( !pq->result( "test.double" ).isValid() );
+    QCOMPARE( runs.loadRelaxed(), 0 );
+
+    pq->setArmed( true );
+    QCOMPARE( pq->result( "test.double" ), QVariant( 6 ) );
+    QCOMPARE( pq->result( "test.double" ), QVariant( 6 ) );
+    QCOMPARE( runs.loadRelaxed(), 1 );
+
+    // Changed inputs: a new run starts right away
+    gs->insert( "number", 5 );
+    QCOMPARE( pq->result( "test.double" ), QVariant( 10 ) );
+    QCOMPARE( runs.loadRelaxed(), 2 );
+
+    // Unrelated changes don't re-run
+    gs->insert( "other", true );
+    QCOMPARE( pq->result( "test.double" ), QVariant( 10 ) );
+    QCOMPARE( runs.loadRelaxed(), 2 );
+
+    // A cancelled run has no result
+    pq->registerTask( "test.slow",
+                      { "number" },
+                      []( const QVariantMap&, const Calamares::PrepareQueue::Token& token )
+                      {
+                          while ( !token.isCancelled() )
+                          {
+                              QThread::msleep( 10 );
+                          }
+                          return QVariant( true );
+                      } );
+    QVERIFY( !pq->result( "test.slow", false ).isValid() );
+    QVERIFY( !pq->result( "test.slow" ).isValid() );
+    QCOMPARE( pq->result( "test.double" ), QVariant( 10 ) );
+}
+
 
 QTEST_GUILESS_MAIN( TestLibCalamares )
 
@@ -88,6 +88,21 @@ moduleConfigurationCandidates( bool assumeBuildDir, const QString& moduleName, c
     return paths;
 }
 
+QString
+Module::configurationFilePath( const QString& moduleName, const QString& configFileName )
+{
+    const QStringList configCandidates
+        = moduleConfigurationCandidates( Settings::instance()->debugMode(), moduleName, configFileName );
+    for ( const QString& path : configCandidates )
+    {
+        if ( QFileInfo( path ).isFile() )
+        {
+            return path;
+        }
+    }
+    return QString();
+}
+
 void
 Module::loadConfigurationFile( const QString& configFileName )  //throws YAML::Exception
 {
@@ -98,6 +113,18 @@ Module::loadConfigurationFile( const QString& configFileName )  //throws YAML::E
         QFile configFile( path );
         if ( configFile.exists() && configFile.open( QFile::ReadOnly | QFile::Text ) )
         {
+            // Usually already parsed, by the ModuleManager; otherwise parse
+            // again below to find out what is wrong with the file.
+            bool ok = false;
+            QVariantMap cached = Calamares::YAML::loadCached( path, &ok );
+            if ( ok )
+            {
+                m_configurationMap = cached;
+                m_emergency = m_maybe_emergency && m_configurationMap.contains( EMERGENCY )
+                    && m_configurationMap[ EMERGENCY ].toBool();
+                return;
+            }
+
             QByteArray ba = configFile.readAll();
 
             auto doc = ::YAML::Load( ba.constData() );  // Throws on error
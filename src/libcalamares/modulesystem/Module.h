@@ -138,6 +138,13 @@ public:
      */
     virtual RequirementsList checkRequirements();
 
+    /** @brief The file that module @p moduleName reads as @p configFileName
+     *
+     * This is the first of the places where configuration files are
+     * looked for that has the file, or an empty string if there is none.
+     */
+    static QString configurationFilePath( const QString& moduleName, const QString& configFileName );
+
 protected:
     explicit Module();
 
@@ -0,0 +1,558 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "Gpt.h"
+
+#include "utils/Logger.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/blkpg.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+/// Size of the header fields in the UEFI specification; the rest of the sector is zero
+static constexpr const quint32 HEADER_SIZE = 92;
+/// Larger entry arrays than this are taken to be damage, not a real table
+static constexpr const quint64 MAX_ENTRIES_BYTES = 1024 * 1024;
+
+/** @brief The CRC32 of @p data, as used by GPT (and zlib, and Ethernet) */
+STATICTEST quint32
+gptCrc32( const QByteArray& data )
+{
+    static const auto table = []
+    {
+        std::array< quint32, 256 > t {};
+        for ( quint32 i = 0; i < 256; ++i )
+        {
+            quint32 c = i;
+            for ( int k = 0; k < 8; ++k )
+            {
+                c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+            }
+            t[ i ] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for ( const char c : data )
+    {
+        crc = table[ ( crc ^ quint8( c ) ) & 0xFF ] ^ ( crc >> 8 );
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+namespace
+{
+
+/// GUIDs are stored with the first three fields little-endian
+QUuid
+guidFromBytes( const char* p )
+{
+    const auto* u = reinterpret_cast< const uchar* >( p );
+    return QUuid( qFromLittleEndian< quint32 >( u ),
+                  qFromLittleEndian< quint16 >( u + 4 ),
+                  qFromLittleEndian< quint16 >( u + 6 ),
+                  u[ 8 ],
+                  u[ 9 ],
+                  u[ 10 ],
+                  u[ 11 ],
+                  u[ 12 ],
+                  u[ 13 ],
+                  u[ 14 ],
+                  u[ 15 ] );
+}
+
+QByteArray
+readAt( QFile& f, quint64 offset, quint64 length )
+{
+    if ( !f.seek( qint64( offset ) ) )
+    {
+        return QByteArray();
+    }
+    return f.read( qint64( length ) );
+}
+
+bool
+writeAt( QFile& f, quint64 offset, const QByteArray& data )
+{
+    return f.seek( qint64( offset ) ) && f.write( data ) == data.size();
+}
+
+QString
+canonicalDevicePath( const QString& devicePath )
+{
+    const QString canonical = QFileInfo( devicePath ).canonicalFilePath();
+    return canonical.isEmpty() ? devicePath : canonical;
+}
+
+}  // namespace
+
+namespace Calamares
+{
+namespace Partition
+{
+
+QVariantMap
+GptPartition::toMap() const
+{
+    QVariantMap m;
+    m[ "index" ] = number;
+    m[ "type_guid" ] = typeGuid.toString( QUuid::WithoutBraces );
+    m[ "uniq_guid" ] = uniqueGuid.toString( QUuid::WithoutBraces );
+    m[ "first_lba" ] = firstLba;
+    m[ "last_lba" ] = lastLba;
+    m[ "size_sectors" ] = sectors();
+    m[ "name" ] = name;
+    m[ "attrs" ] = attributes;
+    return m;
+}
+
+bool
+Gpt::parseHeader( const QByteArray& sector, quint64 lba, Header& header )
+{
+    if ( sector.size() < int( HEADER_SIZE ) || !sector.startsWith( "EFI PART" ) )
+    {
+        return false;
+    }
+    const char* p = sector.constData();
+    const quint32 headerSize = qFromLittleEndian< quint32 >( p + 12 );
+    if ( headerSize < HEADER_SIZE || headerSize > quint32( sector.size() ) )
+    {
+        return false;
+    }
+    // The CRC is computed with its own field set to zero
+    QByteArray copy = sector.left( int( headerSize ) );
+    std::memset( copy.data() + 16, 0, 4 );
+    if ( gptCrc32( copy ) != qFromLittleEndian< quint32 >( p + 16 ) || qFromLittleEndian< quint64 >( p + 24 ) != lba )
+    {
+        return false;
+    }
+
+    header.myLba = lba;
+    header.alternateLba = qFromLittleEndian< quint64 >( p + 32 );
+    header.firstUsableLba = qFromLittleEndian< quint64 >( p + 40 );
+    header.lastUsableLba = qFromLittleEndian< quint64 >( p + 48 );
+    header.diskGuid = sector.mid( 56, 16 );
+    header.entriesLba = qFromLittleEndian< quint64 >( p + 72 );
+    header.entryCount = qFromLittleEndian< quint32 >( p + 80 );
+    header.entrySize = qFromLittleEndian< quint32 >( p + 84 );
+    header.entriesCrc = qFromLittleEndian< quint32 >( p + 88 );
+    return header.entrySize >= 128 && header.entrySize % 8 == 0 && header.entryCount > 0
+        && quint64( header.entryCount ) * header.entrySize <= MAX_ENTRIES_BYTES
+        && header.firstUsableLba <= header.lastUsableLba;
+}
+
+QByteArray
+Gpt::headerSector( const Header& header, int sectorSize )
+{
+    QByteArray sector( sectorSize, '\0' );
+    char* p = sector.data();
+    std::memcpy( p, "EFI PART", 8 );
+    qToLittleEndian< quint32 >( 0x00010000, p + 8 );
+    qToLittleEndian< quint32 >( HEADER_SIZE, p + 12 );
+    qToLittleEndian< quint64 >( header.myLba, p + 24 );
+    qToLittleEndian< quint64 >( header.alternateLba, p + 32 );
+    qToLittleEndian< quint64 >( header.firstUsableLba, p + 40 );
+    qToLittleEndian< quint64 >( header.lastUsableLba, p + 48 );
+    std::memcpy( p + 56, header.diskGuid.constData(), qMin( header.diskGuid.size(), 16 ) );
+    qToLittleEndian< quint64 >( header.entriesLba, p + 72 );
+    qToLittleEndian< quint32 >( header.entryCount, p + 80 );
+    qToLittleEndian< quint32 >( header.entrySize, p + 84 );
+    qToLittleEndian< quint32 >( header.entriesCrc, p + 88 );
+    qToLittleEndian< quint32 >( gptCrc32( sector.left( HEADER_SIZE ) ), p + 16 );
+    return sector;
+}
+
+quint64
+Gpt::entrySectors() const
+{
+    const quint64 bytes = quint64( m_header.entryCount ) * m_header.entrySize;
+    return m_sectorSize > 0 ? ( bytes + m_sectorSize - 1 ) / m_sectorSize : 0;
+}
+
+Gpt
+Gpt::read( const QString& path )
+{
+    QFile f( path );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        cWarning() << "Could not open" << path << "to read its GPT:" << f.errorString();
+        return Gpt();
+    }
+
+    quint64 bytes = quint64( f.size() );
+    int logicalSectorSize = 0;
+    if ( bytes == 0 )
+    {
+        // A block device, which has no size as a file
+        quint64 deviceBytes = 0;
+        if ( ioctl( f.handle(), BLKGETSIZE64, &deviceBytes ) == 0 )
+        {
+            bytes = deviceBytes;
+        }
+        if ( ioctl( f.handle(), BLKSSZGET, &logicalSectorSize ) != 0 )
+        {
+            logicalSectorSize = 0;
+        }
+    }
+
+    // Reads a header at @p lba and its entries; returns false if anything is wrong
+    auto readCopy = [ &f ]( int sectorSize, quint64 lba, Header& header, QByteArray& entries )
+    {
+        if ( !parseHeader( readAt( f, lba * sectorSize, sectorSize ), lba, header ) )
+        {
+            return false;
+        }
+        const quint64 length = quint64( header.entryCount ) * header.entrySize;
+        entries = readAt( f, header.entriesLba * sectorSize, length );
+        return quint64( entries.size() ) == length && gptCrc32( entries ) == header.entriesCrc;
+    };
+
+    const QVector< int > sectorSizes
+        = logicalSectorSize > 0 ? QVector< int > { logicalSectorSize } : QVector< int > { 512, 4096 };
+    for ( const int sectorSize : sectorSizes )
+    {
+        const quint64 total = bytes / sectorSize;
+        if ( total < 3 )
+        {
+            continue;
+        }
+
+        Header primary;
+        QByteArray primaryEntries;
+        const bool primaryValid = readCopy( sectorSize, 1, primary, primaryEntries );
+        // The backup is where the primary says, or else at the end of the disk
+        const bool backupKnown = primaryValid && primary.alternateLba > 1 && primary.alternateLba < total;
+        const quint64 backupLba = backupKnown ? primary.alternateLba : total - 1;
+        Header backup;
+        QByteArray backupEntries;
+        const bool backupValid = readCopy( sectorSize, backupLba, backup, backupEntries );
+        if ( !primaryValid && !backupValid )
+        {
+            continue;
+        }
+
+        Gpt gpt;
+        gpt.m_sectorSize = sectorSize;
+        gpt.m_totalSectors = total;
+        gpt.m_primaryValid = primaryValid;
+        gpt.m_backupValid = backupValid;
+        if ( primaryValid )
+        {
+            gpt.m_header = primary;
+            gpt.m_entries = primaryEntries;
+        }
+        else
+        {
+            // Mirror the backup into where the primary belongs
+            gpt.m_header = backup;
+            gpt.m_header.myLba = 1;
+            gpt.m_header.alternateLba = backupLba;
+            gpt.m_header.entriesLba = 2;
+            gpt.m_entries = backupEntries;
+            cWarning() << "The primary GPT of" << path << "is damaged, using the backup.";
+        }
+        return gpt;
+    }
+
+    cDebug() << "No GPT found on" << path;
+    return Gpt();
+}
+
+Gpt
+Gpt::fromData( const QByteArray& data )
+{
+    for ( const int sectorSize : { 512, 4096 } )
+    {
+        Header header;
+        if ( data.size() < 2 * sectorSize || !parseHeader( data.mid( sectorSize, sectorSize ), 1, header ) )
+        {
+            continue;
+        }
+        const quint64 offset = header.entriesLba * sectorSize;
+        const quint64 length = quint64( header.entryCount ) * header.entrySize;
+        if ( offset + length > quint64( data.size() ) )
+        {
+            cWarning() << "The GPT partition entries are not in the first" << data.size() << "bytes of the image.";
+            continue;
+        }
+        const QByteArray entries = data.mid( int( offset ), int( length ) );
+        if ( gptCrc32( entries ) != header.entriesCrc )
+        {
+            continue;
+        }
+
+        Gpt gpt;
+        gpt.m_sectorSize = sectorSize;
+        gpt.m_primaryValid = true;
+        gpt.m_header = header;
+        gpt.m_entries = entries;
+        return gpt;
+    }
+    return Gpt();
+}
+
+bool
+Gpt::needsRepair() const
+{
+    return isValid()
+        && ( !m_primaryValid || !m_backupValid || ( m_totalSectors && m_header.alternateLba != m_totalSectors - 1 ) );
+}
+
+QUuid
+Gpt::diskGuid() const
+{
+    return m_header.diskGuid.size() == 16 ? guidFromBytes( m_header.diskGuid.constData() ) : QUuid();
+}
+
+QVector< GptPartition >
+Gpt::partitions() const
+{
+    QVector< GptPartition > partitions;
+    for ( quint32 i = 0; i < m_header.entryCount; ++i )
+    {
+        const char* entry = m_entries.constData() + quint64( i ) * m_header.entrySize;
+        GptPartition p;
+        p.typeGuid = guidFromBytes( entry );
+        if ( p.typeGuid.isNull() )
+        {
+            continue;
+        }
+        p.number = int( i ) + 1;
+        p.uniqueGuid = guidFromBytes( entry + 16 );
+        p.firstLba = qFromLittleEndian< quint64 >( entry + 32 );
+        p.lastLba = qFromLittleEndian< quint64 >( entry + 40 );
+        p.attributes = qFromLittleEndian< quint64 >( entry + 48 );
+        // UTF-16LE, zero-terminated unless it fills the field
+        for ( quint32 j = 56; j + 1 < m_header.entrySize; j += 2 )
+        {
+            const quint16 c = qFromLittleEndian< quint16 >( entry + j );
+            if ( !c )
+            {
+                break;
+            }
+            p.name.append( QChar( c ) );
+        }
+        partitions.append( p );
+    }
+    return partitions;
+}
+
+QVariantMap
+Gpt::toMap() const
+{
+    QVariantList partitionList;
+    for ( const auto& p : partitions() )
+    {
+        partitionList.append( p.toMap() );
+    }
+
+    QVariantMap m;
+    m[ "sector_size" ] = m_sectorSize;
+    m[ "total_sectors" ] = m_totalSectors;
+    m[ "disk_guid" ] = diskGuid().toString( QUuid::WithoutBraces );
+    m[ "first_usable_lba" ] = m_header.firstUsableLba;
+    m[ "last_usable_lba" ] = m_header.lastUsableLba;
+    m[ "primary_valid" ] = m_primaryValid;
+    m[ "backup_valid" ] = m_backupValid;
+    m[ "needs_repair" ] = needsRepair();
+    m[ "partitions" ] = partitionList;
+    return m;
+}
+
+bool
+Gpt::relocateBackup()
+{
+    if ( !isValid() || m_totalSectors < 2 + 2 * entrySectors() )
+    {
+        return false;
+    }
+    const quint64 lastUsable = m_totalSectors - 2 - entrySectors();
+    for ( const auto& p : partitions() )
+    {
+        if ( p.lastLba > lastUsable )
+        {
+            cWarning() << "GPT partition" << p.number << "does not fit on a disk of" << m_totalSectors << "sectors.";
+            return false;
+        }
+    }
+    m_header.alternateLba = m_totalSectors - 1;
+    m_header.lastUsableLba = lastUsable;
+    return true;
+}
+
+quint64
+Gpt::maximumLastLba( int number ) const
+{
+    const auto all = partitions();
+    const auto it
+        = std::find_if( all.cbegin(), all.cend(), [ number ]( const GptPartition& p ) { return p.number == number; } );
+    if ( it == all.cend() )
+    {
+        return 0;
+    }
+    quint64 last = m_header.lastUsableLba;
+    for ( const auto& p : all )
+    {
+        if ( p.number != number && p.firstLba > it->firstLba )
+        {
+            last = qMin( last, p.firstLba - 1 );
+        }
+    }
+    return last;
+}
+
+bool
+Gpt::resizePartition( int number, quint64 lastLba )
+{
+    if ( number < 1 || quint32( number ) > m_header.entryCount )
+    {
+        return false;
+    }
+    char* entry = m_entries.data() + quint64( number - 1 ) * m_header.entrySize;
+    const quint64 firstLba = qFromLittleEndian< quint64 >( entry + 32 );
+    const quint64 maximum = maximumLastLba( number );
+    if ( maximum == 0 || lastLba < firstLba || lastLba > maximum )
+    {
+        return false;
+    }
+    qToLittleEndian< quint64 >( lastLba, entry + 40 );
+    return true;
+}
+
+bool
+Gpt::write( const QString& path ) const
+{
+    if ( !isValid() || m_totalSectors == 0 )
+    {
+        cWarning() << "Not writing an incomplete GPT to" << path;
+        return false;
+    }
+    QFile f( path );
+    if ( !f.open( QIODevice::ReadWrite ) )
+    {
+        cWarning() << "Could not open" << path << "to write its GPT:" << f.errorString();
+        return false;
+    }
+
+    Header primary = m_header;
+    primary.entriesCrc = gptCrc32( m_entries );
+    Header backup = primary;
+    backup.myLba = primary.alternateLba;
+    backup.alternateLba = primary.myLba;
+    backup.entriesLba = primary.alternateLba - entrySectors();
+
+    const quint64 sectorSize = quint64( m_sectorSize );
+    // Entries before headers, and the backup first: an interrupted write leaves one valid copy
+    bool ok = writeAt( f, backup.entriesLba * sectorSize, m_entries )
+        && writeAt( f, backup.myLba * sectorSize, headerSector( backup, m_sectorSize ) )
+        && writeAt( f, primary.entriesLba * sectorSize, m_entries )
+        && writeAt( f, primary.myLba * sectorSize, headerSector( primary, m_sectorSize ) );
+
+    // The protective MBR covers the disk, as far as 32 bits can
+    QByteArray mbr = readAt( f, 0, 512 );
+    if ( ok && mbr.size() == 512 && quint8( mbr[ 510 ] ) == 0x55 && quint8( mbr[ 511 ] ) == 0xAA )
+    {
+        for ( int i = 0; i < 4; ++i )
+        {
+            char* entry = mbr.data() + 446 + 16 * i;
+            if ( quint8( entry[ 4 ] ) == 0xEE )
+            {
+                qToLittleEndian< quint32 >( quint32( qMin< quint64 >( m_totalSectors - 1, 0xFFFFFFFFu ) ), entry + 12 );
+            }
+        }
+        ok = writeAt( f, 0, mbr );
+    }
+
+    ok = ok && f.flush() && fsync( f.handle() ) == 0;
+    if ( !ok )
+    {
+        cWarning() << "Could not write the GPT of" << path << f.errorString();
+    }
+    return ok;
+}
+
+bool
+updateKernelPartitions( const QString& disk, const Gpt& gpt )
+{
+    const int fd = open( disk.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        cWarning() << "Could not open" << disk << strerror( errno );
+        return false;
+    }
+    if ( ioctl( fd, BLKRRPART ) == 0 )
+    {
+        close( fd );
+        return true;
+    }
+    if ( errno != EBUSY )
+    {
+        cWarning() << "Could not re-read the partition table of" << disk << strerror( errno );
+        close( fd );
+        return false;
+    }
+
+    // Some partitions are in use; update each partition instead, like partprobe(8)
+    bool ok = true;
+    const qint64 sectorSize = gpt.sectorSize();
+    for ( const auto& p : gpt.partitions() )
+    {
+        struct blkpg_partition partition {};
+        partition.start = qint64( p.firstLba ) * sectorSize;
+        partition.length = qint64( p.sectors() ) * sectorSize;
+        partition.pno = p.number;
+        struct blkpg_ioctl_arg arg {};
+        arg.op = BLKPG_RESIZE_PARTITION;
+        arg.datalen = sizeof( partition );
+        arg.data = &partition;
+        if ( ioctl( fd, BLKPG, &arg ) != 0 )
+        {
+            arg.op = BLKPG_ADD_PARTITION;
+            if ( ioctl( fd, BLKPG, &arg ) != 0 && errno != EBUSY )
+            {
+                cWarning() << "Could not update partition" << p.number << "of" << disk << strerror( errno );
+                ok = false;
+            }
+        }
+    }
+    close( fd );
+    return ok;
+}
+
+QString
+partitionDeviceNode( const QString& disk, int number )
+{
+    const QDir sysfs( QStringLiteral( "/sys/class/block/" ) + QFileInfo( canonicalDevicePath( disk ) ).fileName() );
+    const auto names = sysfs.entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+    for ( const auto& name : names )
+    {
+        QFile partition( sysfs.filePath( name + QStringLiteral( "/partition" ) ) );
+        if ( partition.open( QIODevice::ReadOnly ) && partition.readAll().trimmed().toInt() == number )
+        {
+            return QStringLiteral( "/dev/" ) + name;
+        }
+    }
+    return QString();
+}
+
+}  // namespace Partition
+}  // namespace Calamares
@@ -0,0 +1,175 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file Reading and writing GUID Partition Tables
+ *
+ * This reads and writes the GPT of a disk, or of a disk image, in-process
+ * rather than by running sgdisk(8) or parted(8). Both the primary and the
+ * backup copy (header and partition entries) are handled, with their CRCs,
+ * for 512-byte and 4KiB sectors.
+ *
+ * Only what SEAPATH needs is here: reading the table, moving the backup
+ * to the end of a disk that is larger than the image written to it,
+ * and growing a partition into the free space.
+ */
+
+#ifndef PARTITION_GPT_H
+#define PARTITION_GPT_H
+
+#include "DllMacro.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QUuid>
+#include <QVariantMap>
+#include <QVector>
+
+namespace Calamares
+{
+namespace Partition
+{
+
+/** @brief A used entry of a GPT */
+struct DLLEXPORT GptPartition
+{
+    int number = 0;  ///< From 1, in the order of the entries; the kernel numbers partitions this way too
+    QUuid typeGuid;
+    QUuid uniqueGuid;
+    quint64 firstLba = 0;
+    quint64 lastLba = 0;  ///< Inclusive
+    quint64 attributes = 0;
+    QString name;
+
+    quint64 sectors() const { return lastLba - firstLba + 1; }
+
+    /** @brief The entry as a map, for GlobalStorage and Python
+     *
+     * The keys are index (the number), type_guid, uniq_guid, first_lba,
+     * last_lba, size_sectors, name and attrs.
+     */
+    QVariantMap toMap() const;
+};
+
+class DLLEXPORT Gpt
+{
+public:
+    /** @brief Reads the GPT of the disk or disk image at @p path
+     *
+     * Both copies are read and checked; the primary one is used if it
+     * is valid, the backup otherwise. For a disk, the sector size is its
+     * logical sector size; for an image file it is 512 bytes, or 4096
+     * if there is a GPT with that sector size only.
+     *
+     * Returns an invalid Gpt if there is no (undamaged) GPT at all.
+     */
+    static Gpt read( const QString& path );
+    /** @brief Parses the GPT at the start of the disk image @p data
+     *
+     * This is for images that can only be read from the start, like
+     * compressed ones. Only the primary copy is looked at, so @p data
+     * must contain the primary header and partition entries.
+     */
+    static Gpt fromData( const QByteArray& data );
+
+    bool isValid() const { return m_sectorSize > 0; }
+    bool isPrimaryValid() const { return m_primaryValid; }
+    bool isBackupValid() const { return m_backupValid; }
+    /** @brief Should the GPT be repaired?
+     *
+     * That is if one of the copies is damaged, or if the backup is not at
+     * the end of the disk, e.g. after writing an image to a larger disk.
+     * This is what `sgdisk -v` reports as problems.
+     */
+    bool needsRepair() const;
+
+    int sectorSize() const { return m_sectorSize; }
+    /// @brief Size of the disk or image, in sectors; 0 if unknown (from fromData())
+    quint64 totalSectors() const { return m_totalSectors; }
+    quint64 firstUsableLba() const { return m_header.firstUsableLba; }
+    quint64 lastUsableLba() const { return m_header.lastUsableLba; }
+    QUuid diskGuid() const;
+    QVector< GptPartition > partitions() const;
+
+    /** @brief The table as a map, for Python
+     *
+     * The keys are sector_size, total_sectors, disk_guid, first_usable_lba,
+     * last_usable_lba, primary_valid, backup_valid, needs_repair and
+     * partitions (a list of GptPartition::toMap()).
+     */
+    QVariantMap toMap() const;
+
+    /** @brief Moves the backup copy to the end of the disk
+     *
+     * The usable area grows to match, like `sgdisk -e` does. Returns
+     * false if the disk is too small for the partitions. Call write()
+     * to store the change.
+     */
+    bool relocateBackup();
+    /// @brief The largest last sector partition @p number can have, or 0 if there is no such partition
+    quint64 maximumLastLba( int number ) const;
+    /** @brief Moves the last sector of partition @p number to @p lastLba
+     *
+     * Returns false if there is no such partition, or if it would overlap
+     * another partition or end outside of the usable area. Call write()
+     * to store the change.
+     */
+    bool resizePartition( int number, quint64 lastLba );
+
+    /** @brief Writes both copies of the GPT to @p path
+     *
+     * The protective MBR is updated to cover the whole disk as well.
+     * The kernel is not told about the changes; see updateKernelPartitions().
+     */
+    bool write( const QString& path ) const;
+
+private:
+    struct Header
+    {
+        quint64 myLba = 0;
+        quint64 alternateLba = 0;
+        quint64 firstUsableLba = 0;
+        quint64 lastUsableLba = 0;
+        QByteArray diskGuid;  ///< 16 bytes, as on disk
+        quint64 entriesLba = 0;
+        quint32 entryCount = 0;
+        quint32 entrySize = 0;
+        quint32 entriesCrc = 0;
+    };
+
+    static bool parseHeader( const QByteArray& sector, quint64 lba, Header& header );
+    static QByteArray headerSector( const Header& header, int sectorSize );
+    quint64 entrySectors() const;
+
+    int m_sectorSize = 0;
+    quint64 m_totalSectors = 0;
+    bool m_primaryValid = false;
+    bool m_backupValid = false;
+    Header m_header;  ///< As the primary copy; the backup mirrors it at m_header.alternateLba
+    QByteArray m_entries;
+};
+
+/** @brief Tells the kernel about the partitions in @p gpt, on @p disk
+ *
+ * Like partprobe(8): the whole table is re-read, or if some partitions
+ * are in use, the partitions are updated one by one.
+ */
+DLLEXPORT bool updateKernelPartitions( const QString& disk, const Gpt& gpt );
+
+/** @brief The device node of partition @p number of @p disk
+ *
+ * This asks sysfs, so it is right for any naming scheme (/dev/sda6,
+ * /dev/nvme0n1p6, /dev/mmcblk0p6), but the kernel must know about the
+ * partition. Returns an empty string otherwise.
+ */
+DLLEXPORT QString partitionDeviceNode( const QString& disk, int number );
+
+}  // namespace Partition
+}  // namespace Calamares
+
+#endif
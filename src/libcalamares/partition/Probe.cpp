@@ -0,0 +1,279 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "Probe.h"
+
+#include "compat/Mutex.h"
+#include "utils/Logger.h"
+#include "utils/System.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QtConcurrent/QtConcurrent>
+
+#ifdef HAVE_LIBBLKID
+#include <blkid/blkid.h>
+#endif
+
+using Calamares::Partition::ProbeResult;
+
+/** @brief Parses the output of `blkid -o export`
+ *
+ * The output has a block of KEY=value lines for each device,
+ * starting with DEVNAME; special characters in values are
+ * escaped with a backslash. Returns the results by device name.
+ *
+ * With libblkid this is only used by the tests.
+ */
+[[maybe_unused]] STATICTEST QHash< QString, ProbeResult >
+parseBlkidExport( const QString& output )
+{
+    QHash< QString, ProbeResult > results;
+    QString device;
+    const auto lines = output.split( '\n' );
+    for ( const auto& line : lines )
+    {
+        const int equals = line.indexOf( '=' );
+        if ( equals <= 0 )
+        {
+            continue;
+        }
+        const QString key = line.left( equals );
+        QString value;
+        for ( int i = equals + 1; i < line.length(); ++i )
+        {
+            if ( line[ i ] == '\\' && i + 1 < line.length() )
+            {
+                ++i;
+            }
+            value.append( line[ i ] );
+        }
+
+        if ( key == QStringLiteral( "DEVNAME" ) )
+        {
+            device = value;
+            results[ device ].isValid = true;
+        }
+        else if ( device.isEmpty() )
+        {
+            continue;
+        }
+        else if ( key == QStringLiteral( "TYPE" ) )
+        {
+            results[ device ].fsType = value;
+        }
+        else if ( key == QStringLiteral( "UUID" ) )
+        {
+            results[ device ].uuid = value;
+        }
+        else if ( key == QStringLiteral( "LABEL" ) )
+        {
+            results[ device ].label = value;
+        }
+        else if ( key == QStringLiteral( "PARTUUID" ) )
+        {
+            results[ device ].partUuid = value;
+        }
+    }
+    return results;
+}
+
+namespace
+{
+
+struct CacheEntry
+{
+    ProbeResult result;
+    quint64 seqnum = 0;  ///< uevent sequence number when probed
+};
+
+struct Cache
+{
+    QMutex mutex;
+    QHash< QString, CacheEntry > entries;
+};
+
+Cache&
+cache()
+{
+    static Cache c;
+    return c;
+}
+
+void
+store( const QString& devicePath, const ProbeResult& result, quint64 seqnum )
+{
+    Calamares::MutexLocker lock( &cache().mutex );
+    cache().entries.insert( devicePath, CacheEntry { result, seqnum } );
+}
+
+#ifdef HAVE_LIBBLKID
+QString
+lookup( blkid_probe pr, const char* name )
+{
+    const char* value = nullptr;
+    return blkid_probe_lookup_value( pr, name, &value, nullptr ) == 0 ? QString::fromUtf8( value ) : QString();
+}
+
+ProbeResult
+probeDevice( const QString& devicePath )
+{
+    ProbeResult result;
+    blkid_probe pr = blkid_new_probe_from_filename( devicePath.toLocal8Bit().constData() );
+    if ( !pr )
+    {
+        return result;
+    }
+    blkid_probe_enable_superblocks( pr, 1 );
+    blkid_probe_set_superblocks_flags( pr, BLKID_SUBLKS_TYPE | BLKID_SUBLKS_UUID | BLKID_SUBLKS_LABEL );
+    blkid_probe_enable_partitions( pr, 1 );
+    blkid_probe_set_partitions_flags( pr, BLKID_PARTS_ENTRY_DETAILS );
+
+    // 0 is found, 1 is nothing found, negative is an error or ambiguous result
+    const int r = blkid_do_safeprobe( pr );
+    result.isValid = r >= 0;
+    if ( r == 0 )
+    {
+        result.fsType = lookup( pr, "TYPE" );
+        result.uuid = lookup( pr, "UUID" );
+        result.label = lookup( pr, "LABEL" );
+        result.partUuid = lookup( pr, "PART_ENTRY_UUID" );
+    }
+    blkid_free_probe( pr );
+    return result;
+}
+#else
+ProbeResult
+probeDevice( const QString& devicePath )
+{
+    // Without a cache file, so blkid actually looks at the device
+    auto r = Calamares::System::runCommand( { "blkid", "-c", "/dev/null", "-o", "export", devicePath },
+                                            std::chrono::seconds( 30 ) );
+    // Exit code 2 means nothing was found, which is a valid answer
+    ProbeResult result = parseBlkidExport( r.getOutput() ).value( devicePath );
+    result.isValid = r.getExitCode() == 0 || r.getExitCode() == 2;
+    return result;
+}
+#endif
+
+QString
+canonicalDevicePath( const QString& devicePath )
+{
+    const QString canonical = QFileInfo( devicePath ).canonicalFilePath();
+    return canonical.isEmpty() ? devicePath : canonical;
+}
+
+/// @brief Device nodes of the block devices that have media
+QStringList
+blockDevices()
+{
+    QStringList devices;
+    const auto names = QDir( QStringLiteral( "/sys/class/block" ) )
+                           .entryList( QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System );
+    for ( const auto& name : names )
+    {
+        QFile size( QStringLiteral( "/sys/class/block/%1/size" ).arg( name ) );
+        if ( size.open( QIODevice::ReadOnly ) && size.readAll().trimmed().toULongLong() > 0
+             && QFileInfo::exists( QStringLiteral( "/dev/" ) + name ) )
+        {
+            devices.append( QStringLiteral( "/dev/" ) + name );
+        }
+    }
+    return devices;
+}
+
+}  // namespace
+
+namespace Calamares
+{
+namespace Partition
+{
+
+quint64
+ueventSeqnum()
+{
+    QFile f( QStringLiteral( "/sys/kernel/uevent_seqnum" ) );
+    return f.open( QIODevice::ReadOnly ) ? f.readAll().trimmed().toULongLong() : 0;
+}
+
+ProbeResult
+probe( const QString& path )
+{
+    // The cache is by kernel name, so /dev/mapper/ and /dev/disk/ links find it too
+    const QString devicePath = canonicalDevicePath( path );
+    const quint64 seqnum = ueventSeqnum();
+    {
+        Calamares::MutexLocker lock( &cache().mutex );
+        const auto it = cache().entries.constFind( devicePath );
+        if ( it != cache().entries.constEnd() && it->seqnum == seqnum )
+        {
+            return it->result;
+        }
+    }
+
+    // Something that changes while probing gets a newer seqnum, so is probed again next time
+    const ProbeResult result = probeDevice( devicePath );
+    store( devicePath, result, seqnum );
+    return result;
+}
+
+void
+probeAll()
+{
+    QElapsedTimer timer;
+    timer.start();
+    const quint64 seqnum = ueventSeqnum();
+    const QStringList devices = blockDevices();
+
+#ifdef HAVE_LIBBLKID
+    QList< QFuture< ProbeResult > > futures;
+    for ( const auto& device : devices )
+    {
+        futures.append( QtConcurrent::run( probeDevice, device ) );
+    }
+    for ( int i = 0; i < devices.count(); ++i )
+    {
+        store( devices[ i ], futures[ i ].result(), seqnum );
+    }
+#else
+    // One blkid run for all devices, rather than one per device
+    auto r = Calamares::System::runCommand( { "blkid", "-c", "/dev/null", "-o", "export" },
+                                            std::chrono::seconds( 30 ) );
+    const bool ok = r.getExitCode() == 0 || r.getExitCode() == 2;
+    QHash< QString, ProbeResult > results;
+    const auto parsed = parseBlkidExport( r.getOutput() );
+    for ( auto it = parsed.cbegin(); it != parsed.cend(); ++it )
+    {
+        // blkid lists e.g. /dev/mapper/ names, rather than /dev/dm-0
+        results.insert( canonicalDevicePath( it.key() ), it.value() );
+    }
+    for ( const auto& device : devices )
+    {
+        // Devices with nothing on them are not listed
+        ProbeResult result = results.value( device );
+        result.isValid = ok;
+        store( device, result, seqnum );
+    }
+#endif
+    cDebug() << "Probed" << devices.count() << "block devices in" << timer.elapsed() << "ms";
+}
+
+void
+clearProbeCache()
+{
+    Calamares::MutexLocker lock( &cache().mutex );
+    cache().entries.clear();
+}
+
+}  // namespace Partition
+}  // namespace Calamares
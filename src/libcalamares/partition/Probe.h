@@ -0,0 +1,71 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file Cached probing of block devices
+ *
+ * This answers "what is on this device" (file system type, UUID, label)
+ * without running blkid(8) for every question. With libblkid the probes
+ * are done in-process; without it, one blkid(8) run probes all devices.
+ *
+ * Results are cached until the kernel sends a uevent (any uevent,
+ * the sequence number is global), since that is what happens when
+ * partitions or file systems change.
+ */
+
+#ifndef PARTITION_PROBE_H
+#define PARTITION_PROBE_H
+
+#include "DllMacro.h"
+
+#include <QString>
+
+namespace Calamares
+{
+namespace Partition
+{
+
+/** @brief What is on a block device, as far as blkid can tell */
+struct DLLEXPORT ProbeResult
+{
+    QString fsType;  ///< e.g. "ext4", "swap" or "iso9660"; empty if nothing was found
+    QString uuid;
+    QString label;
+    QString partUuid;  ///< Of the partition table entry, if this is a partition
+
+    bool isValid = false;  ///< The device could be probed
+};
+
+/** @brief Probes the device at @p devicePath
+ *
+ * Returns the cached result if nothing changed since the last probe.
+ * This may be called from any thread.
+ */
+DLLEXPORT ProbeResult probe( const QString& devicePath );
+
+/** @brief Probes all the block devices, in parallel
+ *
+ * Call this before asking about many devices, e.g. when listing
+ * disks; probe() then answers from the cache.
+ */
+DLLEXPORT void probeAll();
+
+/// @brief Forgets all the cached results
+DLLEXPORT void clearProbeCache();
+
+/** @brief The sequence number of the most recent kernel uevent
+ *
+ * Partitions and file systems changing cause uevents, so if this
+ * number has not changed, neither have the block devices.
+ */
+DLLEXPORT quint64 ueventSeqnum();
+
+}  // namespace Partition
+}  // namespace Calamares
+
+#endif
@@ -0,0 +1,366 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "Reset.h"
+
+#include "Teardown.h"
+#include "utils/Logger.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QPair>
+#include <QVector>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <linux/nvme_ioctl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+/// Bytes zeroed at the start and at the end of the disk and of each partition
+static constexpr quint64 SIGNATURE_REGION_SIZE = 1024 * 1024;
+/// An NVMe format that erases user data may take a while
+static constexpr quint32 NVME_FORMAT_TIMEOUT_MS = 10 * 60 * 1000;
+
+using Region = QPair< quint64, quint64 >;  ///< Offset and length, in bytes
+
+/** @brief Where signatures may be on a disk of @p deviceBytes
+ *
+ * Those are the start and end of the disk, and of each of the
+ * @p partitions. Partition tables, file systems, LVM and RAID all
+ * keep their signatures within 1MiB of one of those. The regions are
+ * whole blocks of @p blockSize, sorted and merged.
+ */
+STATICTEST QVector< Region >
+signatureRegions( quint64 deviceBytes, const QVector< Region >& partitions, quint64 blockSize )
+{
+    QVector< Region > regions;
+    auto add = [ &regions ]( quint64 start, quint64 length )
+    {
+        const quint64 size = std::min( length, SIGNATURE_REGION_SIZE );
+        regions.append( { start, size } );
+        if ( length > size )
+        {
+            regions.append( { start + length - size, size } );
+        }
+    };
+    add( 0, deviceBytes );
+    for ( const auto& p : partitions )
+    {
+        add( p.first, p.second );
+    }
+
+    const quint64 deviceEnd = deviceBytes / blockSize * blockSize;
+    for ( auto& r : regions )
+    {
+        const quint64 start = r.first / blockSize * blockSize;
+        const quint64 end = std::min( ( r.first + r.second + blockSize - 1 ) / blockSize * blockSize, deviceEnd );
+        r = { start, end > start ? end - start : 0 };
+    }
+    std::sort( regions.begin(), regions.end() );
+
+    QVector< Region > merged;
+    for ( const auto& r : regions )
+    {
+        if ( r.second == 0 )
+        {
+            continue;
+        }
+        if ( !merged.isEmpty() && r.first <= merged.last().first + merged.last().second )
+        {
+            const quint64 end = std::max( merged.last().first + merged.last().second, r.first + r.second );
+            merged.last().second = end - merged.last().first;
+        }
+        else
+        {
+            merged.append( r );
+        }
+    }
+    return merged;
+}
+
+namespace
+{
+
+QString
+sysfsPath( const QString& name )
+{
+    return QStringLiteral( "/sys/class/block/" ) + name;
+}
+
+quint64
+readSysfsNumber( const QString& path )
+{
+    QFile f( path );
+    return f.open( QIODevice::ReadOnly ) ? f.readAll().trimmed().toULongLong() : 0;
+}
+
+/// The kernel name of @p devicePath, e.g. dm-0 for /dev/mapper/vg-root
+QString
+kernelName( const QString& devicePath )
+{
+    const QString canonical = QFileInfo( devicePath ).canonicalFilePath();
+    return QFileInfo( canonical.isEmpty() ? devicePath : canonical ).fileName();
+}
+
+/// The kernel names of the partitions of @p disk
+QStringList
+partitionNames( const QString& disk )
+{
+    QStringList partitions;
+    const QDir dir( sysfsPath( disk ) );
+    const auto names = dir.entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+    for ( const auto& name : names )
+    {
+        if ( dir.exists( name + QStringLiteral( "/partition" ) ) )
+        {
+            partitions.append( name );
+        }
+    }
+    return partitions;
+}
+
+/// Adds the holders of @p name to @p holders, those that hold others first
+void
+collectHolders( const QString& name, QStringList& holders )
+{
+    const auto names = QDir( sysfsPath( name ) + QStringLiteral( "/holders" ) )
+                           .entryList( QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System );
+    for ( const auto& holder : names )
+    {
+        collectHolders( holder, holders );
+        if ( !holders.contains( holder ) )
+        {
+            holders.append( holder );
+        }
+    }
+}
+
+/// Removes a device-mapper device or stops a RAID array; returns an error message on failure
+QString
+removeHolder( const QString& name )
+{
+    if ( name.startsWith( QStringLiteral( "dm-" ) ) )
+    {
+        QFile nameFile( sysfsPath( name ) + QStringLiteral( "/dm/name" ) );
+        const QString dmName = nameFile.open( QIODevice::ReadOnly )
+            ? QString::fromLocal8Bit( nameFile.readAll().trimmed() )
+            : QString();
+        return dmName.isEmpty() ? QStringLiteral( "no device-mapper name for %1" ).arg( name )
+                                : Calamares::Partition::removeMapperDevice( dmName );
+    }
+    if ( name.startsWith( QStringLiteral( "md" ) ) )
+    {
+        return Calamares::Partition::stopRaidArray( QStringLiteral( "/dev/" ) + name );
+    }
+    return QStringLiteral( "%1 is not device-mapper or RAID" ).arg( name );
+}
+
+bool
+nvmeAdmin( int fd, nvme_admin_cmd& command )
+{
+    return ioctl( fd, NVME_IOCTL_ADMIN_CMD, &command ) == 0;
+}
+
+/** @brief Formats the NVMe namespace open as @p fd, erasing user data
+ *
+ * Returns false without doing anything if @p fd is not an NVMe
+ * namespace, if the controller can't format, or if a format would
+ * erase other namespaces as well.
+ */
+bool
+formatNvme( int fd )
+{
+    const int nsid = ioctl( fd, NVME_IOCTL_ID );
+    if ( nsid <= 0 )
+    {
+        return false;
+    }
+
+    QByteArray identify( 4096, '\0' );
+    nvme_admin_cmd command {};
+    command.opcode = 0x06;  // Identify, controller
+    command.addr = reinterpret_cast< quintptr >( identify.data() );
+    command.data_len = quint32( identify.size() );
+    command.cdw10 = 1;
+    if ( !nvmeAdmin( fd, command ) )
+    {
+        return false;
+    }
+    const quint16 oacs = qFromLittleEndian< quint16 >( identify.constData() + 256 );
+    const quint32 namespaces = qFromLittleEndian< quint32 >( identify.constData() + 516 );
+    // Format and secure erase may each apply to all namespaces at once
+    const quint8 fna = quint8( identify[ 524 ] );
+    if ( !( oacs & 0x2 ) || ( ( fna & 0x3 ) && namespaces > 1 ) )
+    {
+        cDebug() << "NVMe namespace" << nsid << "can't be formatted on its own.";
+        return false;
+    }
+
+    command = {};
+    command.opcode = 0x06;  // Identify, namespace
+    command.nsid = quint32( nsid );
+    command.addr = reinterpret_cast< quintptr >( identify.data() );
+    command.data_len = quint32( identify.size() );
+    if ( !nvmeAdmin( fd, command ) )
+    {
+        return false;
+    }
+    // Keep the current layout: LBA format, metadata and protection information
+    const quint8 flbas = quint8( identify[ 26 ] );
+    const quint8 dps = quint8( identify[ 29 ] );
+    const quint32 format = ( flbas & 0x1F )  // LBA format index (low bits) and metadata setting
+        | ( quint32( dps & 0xF ) << 5 )  // Protection information type and location
+        | ( quint32( ( flbas >> 5 ) & 0x3 ) << 12 );  // LBA format index (high bits)
+
+    command = {};
+    command.opcode = 0x80;  // Format NVM
+    command.nsid = quint32( nsid );
+    command.cdw10 = format | ( 1 << 9 );  // Secure erase of user data
+    command.timeout_ms = NVME_FORMAT_TIMEOUT_MS;
+    return nvmeAdmin( fd, command );
+}
+
+}  // namespace
+
+namespace Calamares
+{
+namespace Partition
+{
+
+QVariantMap
+ResetResult::toMap() const
+{
+    QVariantMap m;
+    m[ "ok" ] = ok;
+    m[ "steps" ] = steps;
+    m[ "elapsed_ms" ] = milliseconds;
+    m[ "message" ] = message;
+    return m;
+}
+
+ResetResult
+resetDevice( const QString& disk )
+{
+    ResetResult result;
+    QElapsedTimer timer;
+    timer.start();
+    auto finish = [ & ]( const QString& message )
+    {
+        result.ok = message.isEmpty();
+        result.message = message;
+        result.milliseconds = timer.elapsed();
+        if ( result.ok )
+        {
+            cDebug() << "Reset" << disk << "in" << result.milliseconds << "ms:" << result.steps;
+        }
+        else
+        {
+            cWarning() << "Could not reset" << disk << message << "after" << result.steps;
+        }
+        return result;
+    };
+
+    const QString name = kernelName( disk );
+    if ( name.isEmpty() || !QFileInfo::exists( sysfsPath( name ) ) )
+    {
+        return finish( QStringLiteral( "%1 is not a block device" ).arg( disk ) );
+    }
+
+    // The old partitions are gone from sysfs once the table is re-read
+    QVector< Region > partitions;
+    QStringList holders;
+    collectHolders( name, holders );
+    for ( const auto& partition : partitionNames( name ) )
+    {
+        const QString path = sysfsPath( name ) + '/' + partition;
+        // Always in 512-byte units
+        partitions.append( { readSysfsNumber( path + QStringLiteral( "/start" ) ) * 512,
+                             readSysfsNumber( path + QStringLiteral( "/size" ) ) * 512 } );
+        collectHolders( partition, holders );
+    }
+
+    for ( const auto& holder : std::as_const( holders ) )
+    {
+        const QString error = removeHolder( holder );
+        if ( !error.isEmpty() )
+        {
+            return finish( QStringLiteral( "Could not release %1: %2" ).arg( holder, error ) );
+        }
+        result.steps.append( QStringLiteral( "released %1" ).arg( holder ) );
+    }
+
+    // Exclusive, so this fails if a partition is still mounted or otherwise used
+    const int fd = open( disk.toLocal8Bit().constData(), O_RDWR | O_EXCL | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        return finish( errno == EBUSY ? QStringLiteral( "%1 is in use, is a partition mounted?" ).arg( disk )
+                                      : QStringLiteral( "%1: %2" ).arg( disk, strerror( errno ) ) );
+    }
+    quint64 bytes = 0;
+    int blockSize = 0;
+    if ( ioctl( fd, BLKGETSIZE64, &bytes ) != 0 || ioctl( fd, BLKSSZGET, &blockSize ) != 0 || blockSize <= 0 )
+    {
+        const int error = errno;
+        close( fd );
+        return finish( QStringLiteral( "%1: %2" ).arg( disk, strerror( error ) ) );
+    }
+
+    // Dropping everything at once is cheap on flash; it is only a bonus, the signatures are zeroed below
+    if ( readSysfsNumber( sysfsPath( name ) + QStringLiteral( "/queue/discard_max_bytes" ) ) > 0 )
+    {
+        quint64 range[ 2 ] = { 0, bytes };
+        if ( ioctl( fd, BLKDISCARD, range ) == 0 )
+        {
+            result.steps.append( QStringLiteral( "discard" ) );
+        }
+        else
+        {
+            cDebug() << "Discarding" << disk << "failed:" << strerror( errno );
+        }
+    }
+    else if ( formatNvme( fd ) )
+    {
+        result.steps.append( QStringLiteral( "NVMe format" ) );
+    }
+
+    const auto regions = signatureRegions( bytes, partitions, quint64( blockSize ) );
+    for ( const auto& region : regions )
+    {
+        quint64 range[ 2 ] = { region.first, region.second };
+        if ( ioctl( fd, BLKZEROOUT, range ) != 0 )
+        {
+            const int error = errno;
+            close( fd );
+            return finish( QStringLiteral( "Could not zero %1 bytes at %2: %3" )
+                               .arg( region.second )
+                               .arg( region.first )
+                               .arg( strerror( error ) ) );
+        }
+    }
+    result.steps.append( QStringLiteral( "zeroed %1 signature regions" ).arg( regions.count() ) );
+
+    if ( ioctl( fd, BLKRRPART ) != 0 )
+    {
+        cDebug() << "Could not re-read the partition table of" << disk << strerror( errno );
+    }
+    close( fd );
+    return finish( QString() );
+}
+
+}  // namespace Partition
+}  // namespace Calamares
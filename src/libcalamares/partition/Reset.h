@@ -0,0 +1,67 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file Preparing a whole disk to be overwritten
+ *
+ * Before a disk image is written, whatever uses the disk (LVM volumes,
+ * dm-crypt, software RAID) must let go of it, and whatever was on it
+ * must not be found again later: an image does not overwrite the
+ * whole disk, and an old LVM signature outside of it confuses the
+ * installed system.
+ *
+ * This does that with ioctls, using what the disk can do: discard
+ * (or NVMe format) drops all of the old contents at once, and the
+ * places where signatures live are zeroed in any case.
+ */
+
+#ifndef PARTITION_RESET_H
+#define PARTITION_RESET_H
+
+#include "DllMacro.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+namespace Calamares
+{
+namespace Partition
+{
+
+/** @brief What resetDevice() did, and how long it took */
+struct DLLEXPORT ResetResult
+{
+    bool ok = false;
+    QStringList steps;  ///< What was done, e.g. "removed dm-0", "discard", "zeroed 8 regions"
+    qint64 milliseconds = 0;
+    QString message;  ///< Why it failed, if it did
+
+    QVariantMap toMap() const;
+};
+
+/** @brief Prepares @p disk to be overwritten completely
+ *
+ * - device-mapper devices (LVM, dm-crypt) and RAID arrays that use the
+ *   disk or its partitions are removed, holders first;
+ * - the whole disk is discarded if it supports that, or else an NVMe
+ *   namespace is formatted if that is safe (it is the only namespace);
+ * - the start and end of the disk and of each of its old partitions
+ *   are zeroed, which is where partition tables, file systems, LVM
+ *   and RAID keep their signatures;
+ * - the kernel re-reads the (now empty) partition table.
+ *
+ * Mounted partitions are not unmounted; the reset fails if there are any.
+ * This blocks for as long as the disk needs, so call it from a job.
+ */
+DLLEXPORT ResetResult resetDevice( const QString& disk );
+
+}  // namespace Partition
+}  // namespace Calamares
+
+#endif
@@ -0,0 +1,68 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "Teardown.h"
+
+#include <QByteArray>
+
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/dm-ioctl.h>
+#include <linux/major.h>
+#include <linux/raid/md_u.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace Calamares
+{
+namespace Partition
+{
+
+QString
+removeMapperDevice( const QString& mapperName )
+{
+    const QByteArray name = mapperName.toLocal8Bit();
+    if ( name.isEmpty() || name.size() >= DM_NAME_LEN )
+    {
+        return QStringLiteral( "%1 is not a device-mapper name" ).arg( mapperName );
+    }
+    const int control = open( "/dev/mapper/control", O_RDWR | O_CLOEXEC );
+    if ( control < 0 )
+    {
+        return QStringLiteral( "/dev/mapper/control: %1" ).arg( strerror( errno ) );
+    }
+    struct dm_ioctl io {};
+    io.version[ 0 ] = DM_VERSION_MAJOR;
+    io.data_size = sizeof( io );
+    io.data_start = sizeof( io );
+    std::memcpy( io.name, name.constData(), name.size() );
+    const int r = ioctl( control, DM_DEV_REMOVE, &io );
+    const int error = errno;
+    close( control );
+    return r == 0 ? QString() : QStringLiteral( "%1: %2" ).arg( mapperName, strerror( error ) );
+}
+
+QString
+stopRaidArray( const QString& devicePath )
+{
+    const int fd = open( devicePath.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        return QStringLiteral( "%1: %2" ).arg( devicePath, strerror( errno ) );
+    }
+    const int r = ioctl( fd, STOP_ARRAY, 0 );
+    const int error = errno;
+    close( fd );
+    return r == 0 ? QString() : QStringLiteral( "%1: %2" ).arg( devicePath, strerror( error ) );
+}
+
+}  // namespace Partition
+}  // namespace Calamares
@@ -0,0 +1,45 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file Releasing the devices stacked on a disk
+ *
+ * Device-mapper devices (LVM, dm-crypt) and software RAID arrays hold
+ * the disks and partitions they are built on. These remove them with
+ * ioctls, without running dmsetup or mdadm.
+ */
+
+#ifndef PARTITION_TEARDOWN_H
+#define PARTITION_TEARDOWN_H
+
+#include "DllMacro.h"
+
+#include <QString>
+
+namespace Calamares
+{
+namespace Partition
+{
+
+/** @brief Removes the device-mapper device called @p mapperName
+ *
+ * That is the name in /dev/mapper, e.g. "vg-root". Returns an empty
+ * string on success, or else why it failed (not translated).
+ */
+DLLEXPORT QString removeMapperDevice( const QString& mapperName );
+
+/** @brief Stops the software RAID array at @p devicePath, e.g. /dev/md0
+ *
+ * Returns an empty string on success, or else why it failed (not translated).
+ */
+DLLEXPORT QString stopRaidArray( const QString& devicePath );
+
+}  // namespace Partition
+}  // namespace Calamares
+
+#endif
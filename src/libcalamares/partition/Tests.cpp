@@ -9,12 +9,18 @@
  */
 
 #include "Global.h"
+#include "Gpt.h"
 #include "PartitionSize.h"
+#include "Probe.h"
+#include "Topology.h"
 
 #include "GlobalStorage.h"
 #include "utils/Logger.h"
 
 #include <QObject>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QtEndian>
 #include <QtTest/QtTest>
 
 using SizeUnit = Calamares::Partition::SizeUnit;
@@ -39,6 +45,17 @@ private Q_SLOTS:
     void testUnitNormalisation();
 
     void testFilesystemGS();
+
+    void testBlkidExport();
+
+    void testGptCrc();
+    void testGptRead();
+    void testGptBackup();
+    void testGptGrow();
+
+    void testTopology();
+
+    void testSignatureRegions();
 };
 
 PartitionServiceTests::PartitionServiceTests() {}
@@ -219,6 +236,383 @@ PartitionServiceTests::testFilesystemGS()
     QVERIFY( !isFilesystemUsedGS( &gs, "ext4" ) );
 }
 
+/* Not exactly public API */
+QHash< QString, Calamares::Partition::ProbeResult > parseBlkidExport( const QString& output );
+
+void
+PartitionServiceTests::testBlkidExport()
+{
+    const QString output = QStringLiteral( "DEVNAME=/dev/sda1\n"
+                                           "UUID=1234-ABCD\n"
+                                           "TYPE=vfat\n"
+                                           "PARTUUID=0f3e5a1c-01\n"
+                                           "\n"
+                                           "DEVNAME=/dev/sda2\n"
+                                           "LABEL=my\\ root\n"
+                                           "UUID=6a1f0b7e-5c4d-4e3a-9f21-0c8d7b6a5e4f\n"
+                                           "TYPE=ext4\n"
+                                           "\n"
+                                           "DEVNAME=/dev/sr0\n"
+                                           "TYPE=iso9660\n" );
+    const auto results = parseBlkidExport( output );
+    QCOMPARE( results.count(), 3 );
+    QVERIFY( results[ "/dev/sda1" ].isValid );
+    QCOMPARE( results[ "/dev/sda1" ].fsType, QStringLiteral( "vfat" ) );
+    QCOMPARE( results[ "/dev/sda1" ].uuid, QStringLiteral( "1234-ABCD" ) );
+    QCOMPARE( results[ "/dev/sda1" ].partUuid, QStringLiteral( "0f3e5a1c-01" ) );
+    QVERIFY( results[ "/dev/sda1" ].label.isEmpty() );
+    QCOMPARE( results[ "/dev/sda2" ].label, QStringLiteral( "my root" ) );
+    QCOMPARE( results[ "/dev/sda2" ].fsType, QStringLiteral( "ext4" ) );
+    QCOMPARE( results[ "/dev/sr0" ].fsType, QStringLiteral( "iso9660" ) );
+    QVERIFY( !results.contains( "/dev/sdb" ) );
+
+    // Values before any DEVNAME are ignored
+    QVERIFY( parseBlkidExport( QStringLiteral( "TYPE=ext4\n" ) ).isEmpty() );
+}
+
+/* Not exactly public API */
+quint32 gptCrc32( const QByteArray& data );
+
+/** @brief A disk image of @p sectors 512-byte sectors with a GPT
+ *
+ * There are two partitions: "boot" from sector 2048 to 4095 and
+ * "persistent" from 4096 to 6143, as on an image before writing it.
+ */
+static QByteArray
+gptImage( quint64 sectors )
+{
+    const int sectorSize = 512;
+    const quint32 entryCount = 128;
+    const quint32 entrySize = 128;
+    const quint64 entrySectors = entryCount * entrySize / sectorSize;
+    QByteArray image( int( sectors * sectorSize ), '\0' );
+
+    // Protective MBR
+    char* mbr = image.data();
+    mbr[ 446 + 4 ] = char( 0xEE );
+    qToLittleEndian< quint32 >( 1, mbr + 446 + 8 );
+    qToLittleEndian< quint32 >( quint32( sectors - 1 ), mbr + 446 + 12 );
+    mbr[ 510 ] = char( 0x55 );
+    mbr[ 511 ] = char( 0xAA );
+
+    QByteArray entries( int( entryCount * entrySize ), '\0' );
+    const QUuid linuxData( QStringLiteral( "0fc63daf-8483-4772-8e79-3d69d8477de4" ) );
+    const struct
+    {
+        quint64 first, last;
+        QString name;
+    } partitions[] = { { 2048, 4095, QStringLiteral( "boot" ) }, { 4096, 6143, QStringLiteral( "persistent" ) } };
+    for ( int i = 0; i < 2; ++i )
+    {
+        char* e = entries.data() + i * entrySize;
+        const QByteArray type = linuxData.toRfc4122();
+        qToLittleEndian< quint32 >( qFromBigEndian< quint32 >( type.constData() ), e );
+        qToLittleEndian< quint16 >( qFromBigEndian< quint16 >( type.constData() + 4 ), e + 4 );
+        qToLittleEndian< quint16 >( qFromBigEndian< quint16 >( type.constData() + 6 ), e + 6 );
+        std::memcpy( e + 8, type.constData() + 8, 8 );
+        e[ 16 ] = char( i + 1 );
+        qToLittleEndian< quint64 >( partitions[ i ].first, e + 32 );
+        qToLittleEndian< quint64 >( partitions[ i ].last, e + 40 );
+        for ( int c = 0; c < partitions[ i ].name.length(); ++c )
+        {
+            qToLittleEndian< quint16 >( partitions[ i ].name[ c ].unicode(), e + 56 + 2 * c );
+        }
+    }
+
+    auto writeCopy = [ & ]( quint64 myLba, quint64 alternateLba, quint64 entriesLba )
+    {
+        char* h = image.data() + myLba * sectorSize;
+        std::memcpy( h, "EFI PART", 8 );
+        qToLittleEndian< quint32 >( 0x00010000, h + 8 );
+        qToLittleEndian< quint32 >( 92, h + 12 );
+        qToLittleEndian< quint64 >( myLba, h + 24 );
+        qToLittleEndian< quint64 >( alternateLba, h + 32 );
+        qToLittleEndian< quint64 >( 2 + entrySectors, h + 40 );
+        qToLittleEndian< quint64 >( sectors - 2 - entrySectors, h + 48 );
+        h[ 56 ] = 0x42;
+        qToLittleEndian< quint64 >( entriesLba, h + 72 );
+        qToLittleEndian< quint32 >( entryCount, h + 80 );
+        qToLittleEndian< quint32 >( entrySize, h + 84 );
+        qToLittleEndian< quint32 >( gptCrc32( entries ), h + 88 );
+        qToLittleEndian< quint32 >( gptCrc32( QByteArray( h, 92 ) ), h + 16 );
+        std::memcpy( image.data() + entriesLba * sectorSize, entries.constData(), entries.size() );
+    };
+    writeCopy( 1, sectors - 1, 2 );
+    writeCopy( sectors - 1, 1, sectors - 1 - entrySectors );
+    return image;
+}
+
+static QString
+writeImage( QTemporaryFile& f, const QByteArray& image )
+{
+    if ( !f.open() || f.write( image ) != image.size() )
+    {
+        return QString();
+    }
+    f.close();
+    return f.fileName();
+}
+
+void
+PartitionServiceTests::testGptCrc()
+{
+    // The check value of CRC-32
+    QCOMPARE( gptCrc32( QByteArrayLiteral( "123456789" ) ), 0xCBF43926u );
+    QCOMPARE( gptCrc32( QByteArray() ), 0u );
+}
+
+void
+PartitionServiceTests::testGptRead()
+{
+    using Calamares::Partition::Gpt;
+
+    const QByteArray image = gptImage( 8192 );
+    QTemporaryFile f;
+    const QString path = writeImage( f, image );
+    QVERIFY( !path.isEmpty() );
+
+    const Gpt gpt = Gpt::read( path );
+    QVERIFY( gpt.isValid() );
+    QVERIFY( gpt.isPrimaryValid() );
+    QVERIFY( gpt.isBackupValid() );
+    QVERIFY( !gpt.needsRepair() );
+    QCOMPARE( gpt.sectorSize(), 512 );
+    QCOMPARE( gpt.totalSectors(), quint64( 8192 ) );
+    QCOMPARE( gpt.firstUsableLba(), quint64( 34 ) );
+    QCOMPARE( gpt.lastUsableLba(), quint64( 8158 ) );
+
+    const auto partitions = gpt.partitions();
+    QCOMPARE( partitions.count(), 2 );
+    QCOMPARE( partitions[ 0 ].number, 1 );
+    QCOMPARE( partitions[ 0 ].name, QStringLiteral( "boot" ) );
+    QCOMPARE( partitions[ 0 ].typeGuid, QUuid( QStringLiteral( "0fc63daf-8483-4772-8e79-3d69d8477de4" ) ) );
+    QCOMPARE( partitions[ 1 ].number, 2 );
+    QCOMPARE( partitions[ 1 ].name, QStringLiteral( "persistent" ) );
+    QCOMPARE( partitions[ 1 ].firstLba, quint64( 4096 ) );
+    QCOMPARE( partitions[ 1 ].sectors(), quint64( 2048 ) );
+
+    const auto map = partitions[ 1 ].toMap();
+    QCOMPARE( map.value( "index" ).toInt(), 2 );
+    QCOMPARE( map.value( "type_guid" ).toString(), QStringLiteral( "0fc63daf-8483-4772-8e79-3d69d8477de4" ) );
+    QCOMPARE( map.value( "last_lba" ).toULongLong(), quint64( 6143 ) );
+
+    // Only the start of the image, as for a compressed one
+    const Gpt start = Gpt::fromData( image.left( 64 * 1024 ) );
+    QVERIFY( start.isValid() );
+    QCOMPARE( start.partitions().count(), 2 );
+    QCOMPARE( start.partitions()[ 1 ].name, QStringLiteral( "persistent" ) );
+    QVERIFY( !Gpt::fromData( image.left( 4096 ) ).isValid() );
+
+    // A damaged entry is caught by the CRC
+    QByteArray damaged = image;
+    damaged[ 1024 + 130 ] = 'x';
+    QVERIFY( !Gpt::fromData( damaged.left( 64 * 1024 ) ).isValid() );
+
+    QVERIFY( !Gpt::fromData( QByteArray( 64 * 1024, '\0' ) ).isValid() );
+}
+
+void
+PartitionServiceTests::testGptBackup()
+{
+    using Calamares::Partition::Gpt;
+
+    QByteArray image = gptImage( 8192 );
+    image[ 512 + 60 ] = 'x';  // In the disk GUID of the primary header
+    QTemporaryFile f;
+    const QString path = writeImage( f, image );
+    QVERIFY( !path.isEmpty() );
+
+    Gpt gpt = Gpt::read( path );
+    QVERIFY( gpt.isValid() );
+    QVERIFY( !gpt.isPrimaryValid() );
+    QVERIFY( gpt.isBackupValid() );
+    QVERIFY( gpt.needsRepair() );
+    QCOMPARE( gpt.partitions().count(), 2 );
+
+    // Writing restores the primary
+    QVERIFY( gpt.write( path ) );
+    gpt = Gpt::read( path );
+    QVERIFY( gpt.isPrimaryValid() );
+    QVERIFY( gpt.isBackupValid() );
+    QVERIFY( !gpt.needsRepair() );
+    QCOMPARE( gpt.partitions()[ 0 ].name, QStringLiteral( "boot" ) );
+}
+
+void
+PartitionServiceTests::testGptGrow()
+{
+    using Calamares::Partition::Gpt;
+
+    // An image written to a disk twice its size
+    QByteArray image = gptImage( 8192 );
+    image.append( QByteArray( image.size(), '\0' ) );
+    QTemporaryFile f;
+    const QString path = writeImage( f, image );
+    QVERIFY( !path.isEmpty() );
+
+    Gpt gpt = Gpt::read( path );
+    QVERIFY( gpt.isPrimaryValid() );
+    QVERIFY( gpt.isBackupValid() );  // Found where the primary says it is
+    QVERIFY( gpt.needsRepair() );
+    QCOMPARE( gpt.totalSectors(), quint64( 16384 ) );
+
+    QCOMPARE( gpt.maximumLastLba( 1 ), quint64( 4095 ) );
+    QCOMPARE( gpt.maximumLastLba( 2 ), quint64( 8158 ) );
+    QCOMPARE( gpt.maximumLastLba( 3 ), quint64( 0 ) );
+    QVERIFY( gpt.relocateBackup() );
+    QCOMPARE( gpt.lastUsableLba(), quint64( 16350 ) );
+    QCOMPARE( gpt.maximumLastLba( 2 ), quint64( 16350 ) );
+
+    QVERIFY( !gpt.resizePartition( 1, 4096 ) );  // Overlaps partition 2
+    QVERIFY( !gpt.resizePartition( 2, 16351 ) );
+    QVERIFY( !gpt.resizePartition( 2, 4000 ) );  // Before its start
+    QVERIFY( !gpt.resizePartition( 3, 10000 ) );
+    QVERIFY( gpt.resizePartition( 2, gpt.maximumLastLba( 2 ) ) );
+    QVERIFY( gpt.write( path ) );
+
+    gpt = Gpt::read( path );
+    QVERIFY( gpt.isPrimaryValid() );
+    QVERIFY( gpt.isBackupValid() );
+    QVERIFY( !gpt.needsRepair() );
+    QCOMPARE( gpt.partitions()[ 1 ].lastLba, quint64( 16350 ) );
+    QCOMPARE( gpt.partitions()[ 0 ].lastLba, quint64( 4095 ) );
+
+    QFile written( path );
+    QVERIFY( written.open( QIODevice::ReadOnly ) );
+    const QByteArray mbr = written.read( 512 );
+    QCOMPARE( qFromLittleEndian< quint32 >( mbr.constData() + 446 + 12 ), 16383u );
+}
+
+/* Not exactly public API */
+Calamares::Partition::DeviceTopology topologyFromSysfs( const QString& sysfsPath );
+
+static bool
+writeSysfs( const QDir& dir, const QString& name, quint64 value )
+{
+    QFile f( dir.filePath( name ) );
+    return f.open( QIODevice::WriteOnly ) && f.write( QByteArray::number( value ) + '\n' ) > 0;
+}
+
+void
+PartitionServiceTests::testTopology()
+{
+    using Calamares::Partition::DeviceTopology;
+
+    // A plain disk is aligned to 1MiB
+    DeviceTopology plain;
+    QCOMPARE( plain.alignment(), quint64( 1024 * 1024 ) );
+    QVERIFY( plain.isAligned( 0 ) );
+    QVERIFY( plain.isAligned( 2048 * 512 ) );
+    QVERIFY( !plain.isAligned( 34 * 512 ) );
+    QCOMPARE( plain.alignUp( 34 * 512 ), quint64( 1024 * 1024 ) );
+    QCOMPARE( plain.ioSize( 4 * 1024 * 1024 ), quint64( 4 * 1024 * 1024 ) );
+    // .. but the disk itself does not mind
+    QCOMPARE( plain.granularity(), quint64( 512 ) );
+    QVERIFY( plain.isOnGranularity( 34 * 512 ) );
+
+    // A RAID5 of 4 disks with 128KiB chunks, and flash with 4MiB erase blocks
+    DeviceTopology raid;
+    raid.minimumIoSize = 128 * 1024;
+    raid.optimalIoSize = 3 * 128 * 1024;
+    QCOMPARE( raid.alignment(), quint64( 3 * 1024 * 1024 ) );
+    QVERIFY( !raid.isAligned( 1024 * 1024 ) );
+    QCOMPARE( raid.alignUp( 1024 * 1024 ), quint64( 3 * 1024 * 1024 ) );
+    QCOMPARE( raid.ioSize( 4 * 1024 * 1024 ), quint64( 11 * 384 * 1024 ) );
+    QCOMPARE( raid.granularity(), quint64( 384 * 1024 ) );
+    QVERIFY( raid.isOnGranularity( 384 * 1024 ) );
+    QVERIFY( !raid.isOnGranularity( 1024 * 1024 ) );
+    DeviceTopology flash;
+    flash.discardGranularity = 4 * 1024 * 1024;
+    QCOMPARE( flash.alignment(), quint64( 4 * 1024 * 1024 ) );
+    QCOMPARE( flash.granularity(), quint64( 4 * 1024 * 1024 ) );
+
+    // Nonsense from a USB bridge is ignored
+    DeviceTopology bridge;
+    bridge.optimalIoSize = 33553920;
+    QCOMPARE( bridge.alignment(), quint64( 1024 * 1024 ) );
+    QCOMPARE( bridge.ioSize( 1024 * 1024 ), quint64( 1024 * 1024 ) );
+    QCOMPARE( bridge.granularity(), quint64( 512 ) );
+
+    // The disk starts 3584 bytes before a physical block
+    DeviceTopology offset;
+    offset.physicalBlockSize = 4096;
+    offset.alignmentOffset = 3584;
+    QVERIFY( offset.isAligned( 3584 ) );
+    QVERIFY( !offset.isAligned( 0 ) );
+    QCOMPARE( offset.alignUp( 4096 ), quint64( 1024 * 1024 + 3584 ) );
+    QCOMPARE( offset.granularity(), quint64( 4096 ) );
+    QVERIFY( offset.isOnGranularity( 4096 + 3584 ) );
+    QVERIFY( !offset.isOnGranularity( 4096 ) );
+
+    QTemporaryDir sysfs;
+    QVERIFY( sysfs.isValid() );
+    QDir disk( sysfs.path() );
+    QVERIFY( disk.mkpath( QStringLiteral( "queue" ) ) && disk.mkpath( QStringLiteral( "sda1" ) ) );
+    QVERIFY( !topologyFromSysfs( disk.path() ).isValid );
+
+    const QDir queue( disk.filePath( QStringLiteral( "queue" ) ) );
+    QVERIFY( writeSysfs( queue, QStringLiteral( "logical_block_size" ), 512 ) );
+    QVERIFY( writeSysfs( queue, QStringLiteral( "physical_block_size" ), 4096 ) );
+    QVERIFY( writeSysfs( queue, QStringLiteral( "minimum_io_size" ), 4096 ) );
+    QVERIFY( writeSysfs( queue, QStringLiteral( "optimal_io_size" ), 0 ) );
+    QVERIFY( writeSysfs( queue, QStringLiteral( "discard_granularity" ), 2 * 1024 * 1024 ) );
+    const QDir partition( disk.filePath( QStringLiteral( "sda1" ) ) );
+    QVERIFY( writeSysfs( partition, QStringLiteral( "partition" ), 1 ) );
+    QVERIFY( writeSysfs( partition, QStringLiteral( "alignment_offset" ), 512 ) );
+
+    const auto t = topologyFromSysfs( disk.path() );
+    QVERIFY( t.isValid );
+    QCOMPARE( t.logicalBlockSize, quint64( 512 ) );
+    QCOMPARE( t.physicalBlockSize, quint64( 4096 ) );
+    QCOMPARE( t.minimumIoSize, quint64( 4096 ) );
+    QCOMPARE( t.optimalIoSize, quint64( 0 ) );
+    QCOMPARE( t.alignmentOffset, quint64( 0 ) );
+    QCOMPARE( t.alignment(), quint64( 2 * 1024 * 1024 ) );
+
+    // The partition has the queue of its disk
+    const auto p = topologyFromSysfs( partition.path() );
+    QVERIFY( p.isValid );
+    QCOMPARE( p.physicalBlockSize, quint64( 4096 ) );
+    QCOMPARE( p.discardGranularity, quint64( 2 * 1024 * 1024 ) );
+    QCOMPARE( p.alignmentOffset, quint64( 512 ) );
+}
+
+/* Not exactly public API */
+QVector< QPair< quint64, quint64 > >
+signatureRegions( quint64 deviceBytes, const QVector< QPair< quint64, quint64 > >& partitions, quint64 blockSize );
+
+void
+PartitionServiceTests::testSignatureRegions()
+{
+    using Region = QPair< quint64, quint64 >;
+    const quint64 MiB = 1024 * 1024;
+
+    // A disk without partitions: its start and end
+    QCOMPARE( signatureRegions( 100 * MiB, {}, 512 ), QVector< Region >( { { 0, MiB }, { 99 * MiB, MiB } } ) );
+    // A tiny disk is zeroed completely, once
+    QCOMPARE( signatureRegions( MiB / 2, {}, 512 ), QVector< Region >( { { 0, MiB / 2 } } ) );
+
+    // A partition that starts at 1MiB touches the start of the disk
+    // and the end of the first partition touches the start of the second
+    const QVector< Region > partitions = { { MiB, 10 * MiB }, { 11 * MiB, 80 * MiB - 17 * 512 } };
+    const auto regions = signatureRegions( 100 * MiB, partitions, 512 );
+    QCOMPARE( regions.count(), 4 );
+    QCOMPARE( regions[ 0 ], Region( 0, 2 * MiB ) );
+    QCOMPARE( regions[ 1 ], Region( 10 * MiB, 2 * MiB ) );
+    QCOMPARE( regions[ 2 ], Region( 90 * MiB - 17 * 512, MiB ) );
+    QCOMPARE( regions[ 3 ], Region( 99 * MiB, MiB ) );
+
+    // Whole blocks, within the disk
+    const auto blocks = signatureRegions( 8 * MiB + 512, { { 4 * MiB + 512, 3 * MiB } }, 4096 );
+    for ( const auto& r : blocks )
+    {
+        QCOMPARE( r.first % 4096, quint64( 0 ) );
+        QCOMPARE( r.second % 4096, quint64( 0 ) );
+        QVERIFY( r.first + r.second <= 8 * MiB );
+    }
+    QCOMPARE( blocks.first(), Region( 0, MiB ) );
+    QCOMPARE( blocks[ 1 ], Region( 4 * MiB, MiB + 4096 ) );
+}
 
 QTEST_GUILESS_MAIN( PartitionServiceTests )
 
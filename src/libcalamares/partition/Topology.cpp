@@ -0,0 +1,147 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "Topology.h"
+
+#include "utils/Units.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <numeric>
+
+using Calamares::Partition::DeviceTopology;
+
+/// Larger alignments than this come from devices reporting nonsense
+static constexpr quint64 MAX_ALIGNMENT = Calamares::MiBtoBytes( 64ULL );
+
+static quint64
+readSysfsNumber( const QString& path )
+{
+    QFile f( path );
+    return f.open( QIODevice::ReadOnly ) ? f.readAll().trimmed().toULongLong() : 0;
+}
+
+/** @brief Reads the topology of the device at @p sysfsPath
+ *
+ * That is the directory of the device in sysfs, e.g. /sys/block/sda
+ * or /sys/block/sda/sda1 for a partition.
+ */
+STATICTEST DeviceTopology
+topologyFromSysfs( const QString& sysfsPath )
+{
+    DeviceTopology t;
+    const QDir device( sysfsPath );
+    // Partitions have no queue of their own
+    const bool isPartition = device.exists( QStringLiteral( "partition" ) );
+    const QDir queue( device.filePath( isPartition ? QStringLiteral( "../queue" ) : QStringLiteral( "queue" ) ) );
+
+    const quint64 logical = readSysfsNumber( queue.filePath( QStringLiteral( "logical_block_size" ) ) );
+    if ( logical == 0 )
+    {
+        return t;
+    }
+    t.isValid = true;
+    t.logicalBlockSize = logical;
+    t.physicalBlockSize
+        = std::max( logical, readSysfsNumber( queue.filePath( QStringLiteral( "physical_block_size" ) ) ) );
+    t.minimumIoSize = readSysfsNumber( queue.filePath( QStringLiteral( "minimum_io_size" ) ) );
+    t.optimalIoSize = readSysfsNumber( queue.filePath( QStringLiteral( "optimal_io_size" ) ) );
+    t.discardGranularity = readSysfsNumber( queue.filePath( QStringLiteral( "discard_granularity" ) ) );
+    t.alignmentOffset = readSysfsNumber( device.filePath( QStringLiteral( "alignment_offset" ) ) );
+    return t;
+}
+
+namespace Calamares
+{
+namespace Partition
+{
+
+quint64
+DeviceTopology::alignment() const
+{
+    quint64 a = Calamares::MiBtoBytes( 1ULL );
+    for ( const quint64 size : { physicalBlockSize, minimumIoSize, optimalIoSize, discardGranularity } )
+    {
+        const quint64 multiple = size > 0 ? std::lcm( a, size ) : a;
+        if ( multiple <= MAX_ALIGNMENT )
+        {
+            a = multiple;
+        }
+    }
+    return a;
+}
+
+bool
+DeviceTopology::isAligned( quint64 offset ) const
+{
+    const quint64 a = alignment();
+    return ( offset + a - alignmentOffset % a ) % a == 0;
+}
+
+quint64
+DeviceTopology::granularity() const
+{
+    // Only the sizes that alignment() takes into account, the others are nonsense
+    const quint64 a = alignment();
+    quint64 g = logicalBlockSize;
+    for ( const quint64 size : { physicalBlockSize, optimalIoSize, discardGranularity } )
+    {
+        if ( size > g && a % size == 0 )
+        {
+            g = size;
+        }
+    }
+    return g;
+}
+
+bool
+DeviceTopology::isOnGranularity( quint64 offset ) const
+{
+    const quint64 g = granularity();
+    return ( offset + g - alignmentOffset % g ) % g == 0;
+}
+
+quint64
+DeviceTopology::alignUp( quint64 offset ) const
+{
+    const quint64 a = alignment();
+    const quint64 misalignment = ( offset + a - alignmentOffset % a ) % a;
+    return misalignment ? offset + a - misalignment : offset;
+}
+
+quint64
+DeviceTopology::ioSize( quint64 preferred ) const
+{
+    // Only the sizes that alignment() takes into account, the others are nonsense
+    const quint64 a = alignment();
+    quint64 unit = std::max( logicalBlockSize, physicalBlockSize );
+    for ( const quint64 size : { minimumIoSize, optimalIoSize } )
+    {
+        if ( size > unit && size % unit == 0 && a % size == 0 )
+        {
+            unit = size;
+        }
+    }
+    return std::max( unit, ( preferred + unit - 1 ) / unit * unit );
+}
+
+DeviceTopology
+topology( const QString& devicePath )
+{
+    // sysfs has the kernel name, e.g. dm-0 rather than /dev/mapper/something
+    const QString canonical = QFileInfo( devicePath ).canonicalFilePath();
+    const QString name = QFileInfo( canonical.isEmpty() ? devicePath : canonical ).fileName();
+    return topologyFromSysfs( QFileInfo( QStringLiteral( "/sys/class/block/" ) + name ).canonicalFilePath() );
+}
+
+}  // namespace Partition
+}  // namespace Calamares
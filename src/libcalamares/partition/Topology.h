@@ -0,0 +1,81 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file I/O topology of block devices
+ *
+ * The kernel knows how a device prefers to be written: its physical
+ * block size, the chunk and stripe sizes of a RAID, the erase block of
+ * flash (as discard granularity). This reads that from sysfs, and
+ * derives where partitions should start and how large I/O should be.
+ */
+
+#ifndef PARTITION_TOPOLOGY_H
+#define PARTITION_TOPOLOGY_H
+
+#include "DllMacro.h"
+
+#include <QString>
+
+namespace Calamares
+{
+namespace Partition
+{
+
+/** @brief The I/O properties of a block device, from sysfs */
+struct DLLEXPORT DeviceTopology
+{
+    quint64 logicalBlockSize = 512;
+    quint64 physicalBlockSize = 512;
+    quint64 minimumIoSize = 0;  ///< e.g. the RAID chunk size
+    quint64 optimalIoSize = 0;  ///< e.g. the RAID stripe width; 0 if the device has no preference
+    quint64 alignmentOffset = 0;  ///< Of the start of the device from its natural alignment
+    quint64 discardGranularity = 0;  ///< The erase block of flash, if the device supports discard
+
+    bool isValid = false;  ///< sysfs knows the device
+
+    /** @brief Partitions should start at a multiple of this many bytes
+     *
+     * This is 1MiB, the usual alignment, or a multiple of it that is
+     * also a multiple of the block, stripe and erase block sizes. Sizes
+     * that would make the alignment unreasonably large are ignored,
+     * since some devices report nonsense.
+     */
+    quint64 alignment() const;
+    /// @brief Does a partition at @p offset bytes start aligned?
+    bool isAligned( quint64 offset ) const;
+    /** @brief The largest unit the device itself asks to be aligned to
+     *
+     * That is the physical block, optimal I/O or discard size, whichever
+     * is largest, without the 1MiB that alignment() adds. Starting
+     * elsewhere costs the device read-modify-write cycles.
+     */
+    quint64 granularity() const;
+    /// @brief Does a partition at @p offset bytes start on the granularity()?
+    bool isOnGranularity( quint64 offset ) const;
+    /// @brief The first aligned offset at or after @p offset bytes
+    quint64 alignUp( quint64 offset ) const;
+    /** @brief A good size for I/O buffers of about @p preferred bytes
+     *
+     * Rounded up to a multiple of the optimal (or minimum) I/O size,
+     * so that a RAID gets whole stripes.
+     */
+    quint64 ioSize( quint64 preferred ) const;
+};
+
+/** @brief The topology of the device at @p devicePath
+ *
+ * For a partition, the queue properties are those of its disk,
+ * with the alignment offset of the partition.
+ */
+DLLEXPORT DeviceTopology topology( const QString& devicePath );
+
+}  // namespace Partition
+}  // namespace Calamares
+
+#endif
@@ -318,5 +318,17 @@ GlobalStorageProxy::value( const std::string& key ) const
     return Calamares::Python::variantToPyObject( m_gs->value( gsKey ) );
 }
 
+Object
+GlobalStorageProxy::view( const std::string& key )
+{
+    const QString gsKey( QString::fromStdString( key ) );
+    if ( !m_gs->contains( gsKey ) )
+    {
+        cWarning() << "Unknown GS key" << key.c_str();
+        return py::none();
+    }
+    return m_views.view( m_gs, gsKey );
+}
+
 }  // namespace Python
 }  // namespace Calamares
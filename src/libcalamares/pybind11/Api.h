@@ -18,6 +18,7 @@
  */
 
 #include "PythonTypes.h"
+#include "python/Variant.h"
 
 #include <string>
 
@@ -71,6 +72,8 @@ namespace Python __attribute__( ( visibility( "hidden" ) ) )
         List keys() const;
         int remove( const std::string& key );
         Object value( const std::string& key ) const;
+        /// @brief Like value(), but shared and cached until @p key changes; do not modify
+        Object view( const std::string& key );
 
         // This is a helper for scripts that do not go through
         // the JobQueue (i.e. the module testpython script),
@@ -79,6 +82,7 @@ namespace Python __attribute__( ( visibility( "hidden" ) ) )
 
     private:
         Calamares::GlobalStorage* m_gs;
+        GlobalStorageViews m_views;
         static Calamares::GlobalStorage* s_gs_instance;  // See globalStorageInstance()
     };
 
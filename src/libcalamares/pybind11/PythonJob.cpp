@@ -136,6 +136,38 @@ populate_utils( py::module_& m )
            "Returns list of languages (most to least-specific) for gettext." );
     m.def( "gettext_path", &Calamares::Python::gettext_path, "Returns path for gettext search." );
 
+    m.def( "prepared_result",
+           &Calamares::Python::prepared_result,
+           "Returns the result of a prepare task for the current inputs, or None.",
+           py::arg( "id" ),
+           py::arg( "wait" ) = true );
+
+    m.def( "gpt_read",
+           &Calamares::Python::gpt_read,
+           "Returns the GPT of a disk or disk image as a dictionary, or None.",
+           py::arg( "path" ) );
+    m.def( "gpt_repair",
+           &Calamares::Python::gpt_repair,
+           "Repairs the GPT of a disk and moves its backup to the end of the disk.\n"
+           "Returns True if the GPT is fine afterwards.",
+           py::arg( "path" ) );
+    m.def( "gpt_grow_partition",
+           &Calamares::Python::gpt_grow_partition,
+           "Grows a partition into the free space after it and tells the kernel.\n"
+           "Returns True on success.",
+           py::arg( "disk" ),
+           py::arg( "number" ) );
+    m.def( "partition_device",
+           &Calamares::Python::partition_device,
+           "Returns the device node of a partition of a disk, or an empty string.",
+           py::arg( "disk" ),
+           py::arg( "number" ) );
+    m.def( "reset_device",
+           &Calamares::Python::reset_device,
+           "Removes what uses a disk and wipes its old contents, so that it can be overwritten.\n"
+           "Returns a dictionary with ok, steps, elapsed_ms and message.",
+           py::arg( "disk" ) );
+
     m.def( "mount",
            &Calamares::Python::mount,
            "Runs the mount utility with the specified parameters.\n"
@@ -173,7 +205,8 @@ populate_libcalamares( py::module_& m )
         .def( "insert", &Calamares::Python::GlobalStorageProxy::insert )
         .def( "keys", &Calamares::Python::GlobalStorageProxy::keys )
         .def( "remove", &Calamares::Python::GlobalStorageProxy::remove )
-        .def( "value", &Calamares::Python::GlobalStorageProxy::value );
+        .def( "value", &Calamares::Python::GlobalStorageProxy::value )
+        .def( "view", &Calamares::Python::GlobalStorageProxy::view );
 }
 
 }  // namespace
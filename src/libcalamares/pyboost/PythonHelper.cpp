@@ -371,4 +371,16 @@ GlobalStoragePythonWrapper::value( const std::string& key ) const
     return Calamares::Python::variantToPyObject( m_gs->value( gsKey ) );
 }
 
+bp::object
+GlobalStoragePythonWrapper::view( const std::string& key )
+{
+    const QString gsKey( QString::fromStdString( key ) );
+    if ( !m_gs->contains( gsKey ) )
+    {
+        cWarning() << "Unknown GS key" << key.c_str();
+        return bp::object();  // None, as with pybind11
+    }
+    return m_views.view( m_gs, gsKey );
+}
+
 }  // namespace CalamaresPython
@@ -14,6 +14,7 @@
 #include "DllMacro.h"
 #include "PythonJob.h"
 #include "PythonTypes.h"
+#include "python/Variant.h"
 
 #include <QStringList>
 
@@ -62,6 +63,8 @@ public:
     boost::python::list keys() const;
     int remove( const std::string& key );
     boost::python::api::object value( const std::string& key ) const;
+    /// @brief Like value(), but shared and cached until @p key changes; do not modify
+    boost::python::api::object view( const std::string& key );
 
     // This is a helper for scripts that do not go through
     // the JobQueue (i.e. the module testpython script),
@@ -70,6 +73,7 @@ public:
 
 private:
     Calamares::GlobalStorage* m_gs;
+    Calamares::Python::GlobalStorageViews m_views;
     static Calamares::GlobalStorage* s_gs_instance;  // See globalStorageInstance()
 };
 
@@ -34,6 +34,7 @@ QT_WARNING_PUSH
 QT_WARNING_DISABLE_CLANG( "-Wdisabled-macro-expansion" )
 
 BOOST_PYTHON_FUNCTION_OVERLOADS( mount_overloads, Calamares::Python::mount, 2, 4 );
+BOOST_PYTHON_FUNCTION_OVERLOADS( prepared_result_overloads, Calamares::Python::prepared_result, 1, 2 );
 BOOST_PYTHON_FUNCTION_OVERLOADS( target_env_call_str_overloads, CalamaresPython::target_env_call, 1, 3 );
 BOOST_PYTHON_FUNCTION_OVERLOADS( target_env_call_list_overloads, CalamaresPython::target_env_call, 1, 3 );
 BOOST_PYTHON_FUNCTION_OVERLOADS( check_target_env_call_str_overloads, CalamaresPython::check_target_env_call, 1, 3 );
@@ -83,7 +84,8 @@ BOOST_PYTHON_MODULE( libcalamares )
         .def( "insert", &CalamaresPython::GlobalStoragePythonWrapper::insert )
         .def( "keys", &CalamaresPython::GlobalStoragePythonWrapper::keys )
         .def( "remove", &CalamaresPython::GlobalStoragePythonWrapper::remove )
-        .def( "value", &CalamaresPython::GlobalStoragePythonWrapper::value );
+        .def( "value", &CalamaresPython::GlobalStoragePythonWrapper::value )
+        .def( "view", &CalamaresPython::GlobalStoragePythonWrapper::view );
 
     // libcalamares.utils submodule starts here
     bp::object utilsModule( bp::handle<>( bp::borrowed( PyImport_AddModule( "libcalamares.utils" ) ) ) );
@@ -193,6 +195,36 @@ BOOST_PYTHON_MODULE( libcalamares )
              "Returns list of languages (most to least-specific) for gettext." );
 
     bp::def( "gettext_path", &Calamares::Python::gettext_path, "Returns path for gettext search." );
+
+    bp::def( "prepared_result",
+             &Calamares::Python::prepared_result,
+             prepared_result_overloads( bp::args( "id", "wait" ),
+                                        "Returns the result of a prepare task for the current inputs, or None." ) );
+
+    // .. Partition table functions
+    bp::def( "gpt_read",
+             &Calamares::Python::gpt_read,
+             bp::args( "path" ),
+             "Returns the GPT of a disk or disk image as a dictionary, or None." );
+    bp::def( "gpt_repair",
+             &Calamares::Python::gpt_repair,
+             bp::args( "path" ),
+             "Repairs the GPT of a disk and moves its backup to the end of the disk.\n"
+             "Returns True if the GPT is fine afterwards." );
+    bp::def( "gpt_grow_partition",
+             &Calamares::Python::gpt_grow_partition,
+             bp::args( "disk", "number" ),
+             "Grows a partition into the free space after it and tells the kernel.\n"
+             "Returns True on success." );
+    bp::def( "partition_device",
+             &Calamares::Python::partition_device,
+             bp::args( "disk", "number" ),
+             "Returns the device node of a partition of a disk, or an empty string." );
+    bp::def( "reset_device",
+             &Calamares::Python::reset_device,
+             bp::args( "disk" ),
+             "Removes what uses a disk and wipes its old contents, so that it can be overwritten.\n"
+             "Returns a dictionary with ok, steps, elapsed_ms and message." );
 }
 
 
@@ -13,8 +13,11 @@
 
 #include "GlobalStorage.h"
 #include "JobQueue.h"
+#include "PrepareQueue.h"
 #include "locale/Global.h"
+#include "partition/Gpt.h"
 #include "partition/Mount.h"
+#include "partition/Reset.h"
 #include "utils/Logger.h"
 #include "utils/RAII.h"
 #include "utils/String.h"
@@ -203,5 +206,81 @@ mount( const std::string& device_path,
                                         QString::fromStdString( options ) );
 }
 
+Python::Object
+prepared_result( const std::string& id, bool wait )
+{
+    auto* pq = Calamares::PrepareQueue::instance();
+    if ( !pq )
+    {
+        return Python::None();
+    }
+    const QVariant r = pq->result( QString::fromStdString( id ), wait );
+    if ( !r.isValid() )
+    {
+        return Python::None();
+    }
+    return variantToPyObject( r );
+}
+
+Python::Object
+gpt_read( const std::string& path )
+{
+    const auto gpt = Calamares::Partition::Gpt::read( QString::fromStdString( path ) );
+    if ( !gpt.isValid() )
+    {
+        return Python::None();
+    }
+    return variantToPyObject( gpt.toMap() );
+}
+
+bool
+gpt_repair( const std::string& path )
+{
+    const QString disk = QString::fromStdString( path );
+    auto gpt = Calamares::Partition::Gpt::read( disk );
+    if ( !gpt.isValid() )
+    {
+        cWarning() << "No GPT to repair on" << disk;
+        return false;
+    }
+    if ( !gpt.needsRepair() )
+    {
+        return true;
+    }
+    cDebug() << "Repairing the GPT of" << disk;
+    return gpt.relocateBackup() && gpt.write( disk );
+}
+
+bool
+gpt_grow_partition( const std::string& disk, int number )
+{
+    const QString path = QString::fromStdString( disk );
+    auto gpt = Calamares::Partition::Gpt::read( path );
+    // The free space is at the end of the disk, beyond where the backup of the image is
+    if ( !gpt.isValid() || ( gpt.needsRepair() && !gpt.relocateBackup() ) )
+    {
+        cWarning() << "Could not read or repair the GPT of" << path;
+        return false;
+    }
+    if ( !gpt.resizePartition( number, gpt.maximumLastLba( number ) ) )
+    {
+        cWarning() << "Could not grow partition" << number << "of" << path;
+        return false;
+    }
+    return gpt.write( path ) && Calamares::Partition::updateKernelPartitions( path, gpt );
+}
+
+std::string
+partition_device( const std::string& disk, int number )
+{
+    return Calamares::Partition::partitionDeviceNode( QString::fromStdString( disk ), number ).toStdString();
+}
+
+Python::Object
+reset_device( const std::string& disk )
+{
+    return variantToPyObject( Calamares::Partition::resetDevice( QString::fromStdString( disk ) ).toMap() );
+}
+
 }
 }
@@ -42,6 +42,14 @@ namespace Python __attribute__( ( visibility( "hidden" ) ) )
             const std::string& filesystem_name = std::string(),
             const std::string& options = std::string() );
 
+    Object prepared_result( const std::string& id, bool wait = true );
+
+    Object gpt_read( const std::string& path );
+    bool gpt_repair( const std::string& path );
+    bool gpt_grow_partition( const std::string& disk, int number );
+    std::string partition_device( const std::string& disk, int number );
+    Object reset_device( const std::string& disk );
+
 }
 }
 
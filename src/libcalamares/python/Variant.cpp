@@ -10,6 +10,7 @@
 
 #include "Variant.h"
 
+#include "GlobalStorage.h"
 #include "PythonTypes.h"
 #include "compat/Variant.h"
 
@@ -110,5 +111,22 @@ variantToPyObject( const QVariant& variant )
 }
 
 
+Object
+GlobalStorageViews::view( const Calamares::GlobalStorage* gs, const QString& key )
+{
+    // Generation first: if the key changes in between, the value we
+    // convert is newer than the generation, and is converted again next time.
+    const auto generation = gs->generation( key );
+    auto it = m_entries.find( key );
+    if ( it != m_entries.end() && it->generation == generation )
+    {
+        return it->object;
+    }
+
+    Object object = variantToPyObject( gs->value( key ) );
+    m_entries.insert( key, Entry { generation, object } );
+    return object;
+}
+
     }
 }
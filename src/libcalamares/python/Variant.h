@@ -21,10 +21,15 @@
 
 #include "PythonTypes.h"
 
+#include <QHash>
 #include <QStringList>
 #include <QVariant>
 #include <QVariantMap>
 
+namespace Calamares
+{
+class GlobalStorage;
+}
 
 namespace Calamares
 {
@@ -34,6 +39,30 @@ namespace Python __attribute__( ( visibility( "hidden" ) ) )
 Dictionary variantMapToPyDict( const QVariantMap& variantMap );
 Object variantToPyObject( const QVariant& variant ); ///< More generic version of variantMapToPyDict
 
+/** @brief Python values of Global Storage keys, converted once
+ *
+ * A key is converted when it is first asked for, and the Python object
+ * is handed out again until the key changes in Global Storage. Large
+ * values (e.g. lists of partitions) are then not rebuilt on each access.
+ *
+ * The objects are shared, so callers must not modify them. This holds
+ * Python objects: use it only with the GIL held, and don't keep it
+ * beyond the lifetime of the interpreter.
+ */
+class GlobalStorageViews
+{
+public:
+    Object view( const Calamares::GlobalStorage* gs, const QString& key );
+
+private:
+    struct Entry
+    {
+        quint64 generation;
+        Object object;
+    };
+    QHash< QString, Entry > m_entries;
+};
+
 }
 }
 
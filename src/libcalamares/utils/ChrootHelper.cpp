@@ -0,0 +1,377 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "ChrootHelper.h"
+
+#include "CalamaresConfig.h"
+#include "utils/ChrootHelperProtocol.h"
+#include "utils/Logger.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+
+#include <cstring>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace ChrootHelperProtocol;
+
+/// How long the helper may take to chroot(2) and say it is ready
+static constexpr const int READY_TIMEOUT_MS = 5000;
+
+namespace
+{
+
+QString
+helper_path()
+{
+    // Next to the calamares executable in the build directory, or installed
+    const QString local = QCoreApplication::applicationDirPath() + QStringLiteral( "/calamares-chroot-helper" );
+    if ( QFileInfo( local ).isExecutable() )
+    {
+        return local;
+    }
+    const QString installed = QStringLiteral( CMAKE_INSTALL_FULL_LIBEXECDIR "/calamares-chroot-helper" );
+    if ( QFileInfo( installed ).isExecutable() )
+    {
+        return installed;
+    }
+    return QString();
+}
+
+bool
+send_message( int socket, const void* data, std::size_t length, const int* fds, int fdCount )
+{
+    struct iovec iov = { const_cast< void* >( data ), length };
+    struct msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    union
+    {
+        char buf[ CMSG_SPACE( 2 * sizeof( int ) ) ];
+        struct cmsghdr align;
+    } control;
+    if ( fdCount > 0 )
+    {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = CMSG_SPACE( fdCount * sizeof( int ) );
+        struct cmsghdr* c = CMSG_FIRSTHDR( &msg );
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN( fdCount * sizeof( int ) );
+        std::memcpy( CMSG_DATA( c ), fds, fdCount * sizeof( int ) );
+    }
+
+    ssize_t w;
+    do
+    {
+        w = sendmsg( socket, &msg, MSG_NOSIGNAL );
+    } while ( w < 0 && errno == EINTR );
+    return w == static_cast< ssize_t >( length );
+}
+
+void
+append_string( std::vector< char >& message, const char* s )
+{
+    message.insert( message.end(), s, s + std::strlen( s ) + 1 );
+}
+
+/// Starts the helper for @p root; returns its pid and fills @p socket, or returns -1
+pid_t
+start_helper( const std::string& root, int& socket )
+{
+    const QString path = helper_path();
+    if ( path.isEmpty() )
+    {
+        cWarning() << "No calamares-chroot-helper found, forking for commands in the target.";
+        return -1;
+    }
+
+    int sv[ 2 ];
+    if ( socketpair( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv ) != 0 )
+    {
+        cWarning() << "Could not create socket for the chroot helper:" << strerror( errno );
+        return -1;
+    }
+    if ( sv[ 1 ] == SocketFd )
+    {
+        // dup2() onto itself would leave close-on-exec set
+        const int fd = fcntl( sv[ 1 ], F_DUPFD_CLOEXEC, SocketFd + 1 );
+        close( sv[ 1 ] );
+        sv[ 1 ] = fd;
+    }
+
+    const std::string pathString = path.toStdString();
+    std::string rootString = root;
+    char* const argv[] = { const_cast< char* >( pathString.c_str() ), rootString.data(), nullptr };
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_adddup2( &actions, sv[ 1 ], SocketFd );
+    pid_t pid = -1;
+    const int error
+        = sv[ 1 ] < 0 ? errno : posix_spawn( &pid, pathString.c_str(), &actions, nullptr, argv, environ );
+    posix_spawn_file_actions_destroy( &actions );
+    if ( sv[ 1 ] >= 0 )
+    {
+        close( sv[ 1 ] );
+    }
+    if ( error )
+    {
+        cWarning() << "Could not start" << path << strerror( error );
+        close( sv[ 0 ] );
+        return -1;
+    }
+
+    Reply reply {};
+    pollfd pfd = { sv[ 0 ], POLLIN, 0 };
+    if ( poll( &pfd, 1, READY_TIMEOUT_MS ) <= 0 || recv( sv[ 0 ], &reply, sizeof( reply ), 0 ) != sizeof( reply )
+         || reply.type != ReplyType::Ready )
+    {
+        cWarning() << "The chroot helper for" << root << "did not start:"
+                   << ( reply.type == ReplyType::Failed ? strerror( reply.value ) : "no reply" );
+        close( sv[ 0 ] );
+        kill( pid, SIGKILL );
+        waitpid( pid, nullptr, 0 );
+        return -1;
+    }
+
+    cDebug() << "Started chroot helper for" << root << "pid" << pid;
+    socket = sv[ 0 ];
+    return pid;
+}
+
+}  // namespace
+
+namespace Calamares
+{
+namespace Utils
+{
+
+static std::mutex s_instanceMutex;
+static std::shared_ptr< ChrootHelper > s_instance;
+static std::string s_instanceRoot;
+static std::string s_failedRoot;  ///< Don't retry starting the helper for this root
+
+ChrootHelper::ChrootHelper( pid_t helperPid, int socket )
+    : m_helperPid( helperPid )
+    , m_socket( socket )
+{
+    m_reader = std::thread( &ChrootHelper::readReplies, this );
+}
+
+ChrootHelper::~ChrootHelper()
+{
+    // The helper gets EOF, kills whatever is left and exits
+    shutdown( m_socket, SHUT_RDWR );
+    m_reader.join();
+    close( m_socket );
+    int status;
+    pid_t r;
+    do
+    {
+        r = waitpid( m_helperPid, &status, 0 );
+    } while ( r < 0 && errno == EINTR );
+    cDebug() << "Chroot helper" << m_helperPid << "stopped.";
+}
+
+std::shared_ptr< ChrootHelper >
+ChrootHelper::instance( const std::string& root )
+{
+    std::lock_guard< std::mutex > lock( s_instanceMutex );
+    if ( s_instance && s_instanceRoot == root )
+    {
+        return s_instance;
+    }
+    s_instance.reset();
+    if ( root == s_failedRoot )
+    {
+        return nullptr;
+    }
+
+    int socket = -1;
+    const pid_t pid = start_helper( root, socket );
+    if ( pid < 0 )
+    {
+        s_failedRoot = root;
+        return nullptr;
+    }
+    s_instance.reset( new ChrootHelper( pid, socket ) );
+    s_instanceRoot = root;
+    return s_instance;
+}
+
+void
+ChrootHelper::stop()
+{
+    std::shared_ptr< ChrootHelper > helper;
+    {
+        std::lock_guard< std::mutex > lock( s_instanceMutex );
+        helper.swap( s_instance );
+        s_instanceRoot.clear();
+        s_failedRoot.clear();
+    }
+    // Destroyed here (outside the lock) unless processes still use it
+}
+
+pid_t
+ChrootHelper::spawn( const std::string& directory,
+                     char* const argv[],
+                     char* const envp[],
+                     int stdinFd,
+                     int outputFd,
+                     int& error )
+{
+    Request request {};
+    request.type = RequestType::Spawn;
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        request.id = m_nextId++;
+    }
+
+    std::vector< char > message( sizeof( request ) );
+    append_string( message, directory.c_str() );
+    for ( char* const* a = argv; *a; ++a, ++request.argc )
+    {
+        append_string( message, *a );
+    }
+    for ( char* const* e = envp; *e; ++e, ++request.envc )
+    {
+        append_string( message, *e );
+    }
+    std::memcpy( message.data(), &request, sizeof( request ) );
+    if ( message.size() > static_cast< std::size_t >( MaxMessageSize ) )
+    {
+        error = E2BIG;
+        return -1;
+    }
+
+    const int fds[ 2 ] = { stdinFd, outputFd };
+    if ( !send_message( m_socket, message.data(), message.size(), fds, 2 ) )
+    {
+        error = errno ? errno : EPIPE;
+        return -1;
+    }
+
+    std::unique_lock< std::mutex > lock( m_mutex );
+    m_replied.wait( lock, [ & ]() { return m_gone || m_started.count( request.id ); } );
+    auto it = m_started.find( request.id );
+    if ( it == m_started.end() )
+    {
+        error = EPIPE;
+        return -1;
+    }
+    const auto [ pid, e ] = it->second;
+    m_started.erase( it );
+    error = e;
+    return pid;
+}
+
+bool
+ChrootHelper::wait( pid_t pid, bool block, int& status, ProcessUsage& usage )
+{
+    std::unique_lock< std::mutex > lock( m_mutex );
+    if ( block )
+    {
+        m_replied.wait( lock, [ & ]() { return m_gone || m_exited.count( pid ); } );
+    }
+    auto it = m_exited.find( pid );
+    if ( it != m_exited.end() )
+    {
+        std::tie( status, usage ) = it->second;
+        m_exited.erase( it );
+        return true;
+    }
+    if ( m_gone )
+    {
+        status = -1;
+        return true;
+    }
+    return false;
+}
+
+void
+ChrootHelper::signal( pid_t pid, int sig )
+{
+    Request request {};
+    request.type = RequestType::Signal;
+    request.signal = sig;
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        auto it = m_ids.find( pid );
+        if ( it == m_ids.end() )
+        {
+            return;
+        }
+        request.id = it->second;
+    }
+    send_message( m_socket, &request, sizeof( request ), nullptr, 0 );
+}
+
+void
+ChrootHelper::readReplies()
+{
+    while ( true )
+    {
+        Reply reply;
+        const ssize_t n = recv( m_socket, &reply, sizeof( reply ), 0 );
+        if ( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( n != sizeof( reply ) )
+        {
+            break;
+        }
+
+        std::lock_guard< std::mutex > lock( m_mutex );
+        switch ( reply.type )
+        {
+        case ReplyType::Started:
+            m_started[ reply.id ] = { reply.pid, 0 };
+            m_ids[ reply.pid ] = reply.id;
+            break;
+        case ReplyType::Failed:
+            m_started[ reply.id ] = { -1, reply.value };
+            break;
+        case ReplyType::Exited:
+        {
+            using std::chrono::microseconds;
+            ProcessUsage usage;
+            usage.userTime = microseconds( reply.userMicroseconds );
+            usage.systemTime = microseconds( reply.systemMicroseconds );
+            usage.maxResidentKiB = reply.maxResidentKiB;
+            usage.blocksRead = reply.blocksRead;
+            usage.blocksWritten = reply.blocksWritten;
+            m_exited[ reply.pid ] = { reply.value, usage };
+            m_ids.erase( reply.pid );
+            break;
+        }
+        case ReplyType::Ready:
+            break;
+        }
+        m_replied.notify_all();
+    }
+
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_gone = true;
+    m_replied.notify_all();
+}
+
+}  // namespace Utils
+}  // namespace Calamares
@@ -0,0 +1,108 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#ifndef UTILS_CHROOTHELPER_H
+#define UTILS_CHROOTHELPER_H
+
+#include "DllMacro.h"
+#include "utils/Runner.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <sys/types.h>
+
+namespace Calamares
+{
+namespace Utils
+{
+
+/** @brief Starts processes in the target through calamares-chroot-helper
+ *
+ * The helper is a small process that forks and execs the commands
+ * that Calamares asks for, each after a chroot(2) into the target
+ * as it is mounted at that moment. That is much cheaper than forking
+ * Calamares itself for every command in the target, and cheaper
+ * still than also running chroot(8).
+ *
+ * The helper needs root, like chroot(2) does. If it cannot be
+ * started, instance() returns @c nullptr and the Runner falls back
+ * to forking the process itself.
+ */
+class DLLEXPORT ChrootHelper
+{
+public:
+    ~ChrootHelper();
+
+    /** @brief The helper for @p root
+     *
+     * Starts the helper if needed; a helper for a different root is
+     * stopped. Returns @c nullptr if there is no helper (a failure
+     * to start is remembered for that root).
+     */
+    static std::shared_ptr< ChrootHelper > instance( const std::string& root );
+    /** @brief Stops the helper
+     *
+     * Processes that are still running keep their helper alive until
+     * they exit. The helper is started again if a process is run in
+     * the target afterwards. Call this before unmounting the target;
+     * the JobQueue also calls it when a job fails, and on destruction.
+     */
+    static void stop();
+
+    /** @brief Starts a process in the target
+     *
+     * The process runs in @p directory (relative to the target root)
+     * with @p stdinFd as stdin and @p outputFd as stdout and stderr.
+     * The program in @p argv is searched for in the PATH of the target.
+     * Returns the pid, or -1 with @p error set.
+     */
+    pid_t spawn( const std::string& directory,
+                 char* const argv[],
+                 char* const envp[],
+                 int stdinFd,
+                 int outputFd,
+                 int& error );
+    /** @brief Waits for process @p pid, like wait4(2)
+     *
+     * Returns @c false if @p block is false and the process is still
+     * running. If the helper is gone, the process is reported as exited
+     * with a status of -1.
+     */
+    bool wait( pid_t pid, bool block, int& status, ProcessUsage& usage );
+    /// @brief Sends signal @p sig to process @p pid
+    void signal( pid_t pid, int sig );
+
+private:
+    ChrootHelper( pid_t helperPid, int socket );
+    /// Body of the reader thread, which dispatches the replies
+    void readReplies();
+
+    pid_t m_helperPid;
+    int m_socket;
+    std::thread m_reader;
+
+    std::mutex m_mutex;  ///< Guards the fields below
+    std::condition_variable m_replied;
+    std::uint32_t m_nextId = 1;
+    bool m_gone = false;  ///< The helper closed its socket
+    std::map< std::uint32_t, std::pair< pid_t, int > > m_started;  ///< Started or Failed, by request id
+    std::map< pid_t, std::uint32_t > m_ids;  ///< Request id of running processes
+    std::map< pid_t, std::pair< int, ProcessUsage > > m_exited;
+};
+
+}  // namespace Utils
+}  // namespace Calamares
+
+#endif
@@ -0,0 +1,75 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+/** @file Messages between Calamares and calamares-chroot-helper
+ *
+ * This header is shared by ChrootHelper (in libcalamares) and the
+ * helper executable, which does not link to Qt or libcalamares.
+ *
+ * The two talk over a SOCK_SEQPACKET socketpair; the helper has its
+ * end as file descriptor ChrootHelperProtocol::SocketFd. Each message
+ * starts with a Request or Reply. A Spawn request is followed by
+ * NUL-terminated strings: the working directory, then argc arguments,
+ * then envc environment entries. It carries two file descriptors
+ * (SCM_RIGHTS): stdin and the output (stdout and stderr) of the process.
+ */
+
+#ifndef UTILS_CHROOTHELPERPROTOCOL_H
+#define UTILS_CHROOTHELPERPROTOCOL_H
+
+#include <cstdint>
+
+namespace ChrootHelperProtocol
+{
+
+/// The helper's end of the socketpair
+static constexpr const int SocketFd = 3;
+/// Largest message; the command line and environment must fit
+static constexpr const int MaxMessageSize = 128 * 1024;
+
+enum class RequestType : std::uint32_t
+{
+    Spawn = 1,  ///< Start a process, reply Started or Failed, later Exited
+    Signal = 2,  ///< Send signal to the process started for id
+};
+
+enum class ReplyType : std::uint32_t
+{
+    Ready = 0,  ///< Sent once, after chroot(2) succeeded
+    Started = 1,
+    Failed = 2,  ///< value is errno
+    Exited = 3,  ///< value is the wait status
+};
+
+struct Request
+{
+    RequestType type;
+    std::uint32_t id;  ///< Chosen by Calamares, unique per helper
+    std::int32_t signal;  ///< For Signal
+    std::uint32_t argc;  ///< For Spawn
+    std::uint32_t envc;  ///< For Spawn
+};
+
+struct Reply
+{
+    ReplyType type;
+    std::uint32_t id;
+    std::int32_t pid;
+    std::int32_t value;
+    // Resource usage, for Exited
+    std::int64_t userMicroseconds;
+    std::int64_t systemMicroseconds;
+    std::int64_t maxResidentKiB;
+    std::int64_t blocksRead;
+    std::int64_t blocksWritten;
+};
+
+}  // namespace ChrootHelperProtocol
+
+#endif
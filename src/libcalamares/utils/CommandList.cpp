@@ -22,22 +22,74 @@
 #include "utils/Variant.h"
 
 #include <QCoreApplication>
+#include <QThread>
 #include <QVariantList>
 
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
+
 namespace Calamares
 {
 
+static CommandList_t get_variant_stringlist( const QVariantList& l, bool allowParallel = true );
+
+/** @brief Reads the commands of a *parallel* group
+ *
+ * The value of @p v is either a list of commands, or a map with
+ * keys *commands* (the list) and *limit* (the number of commands
+ * to run at a time, which defaults to the number of CPUs).
+ */
+static CommandList_t
+get_parallel_group( const QVariant& v, int group )
+{
+    QVariantList commands;
+    int limit = std::max( 1, QThread::idealThreadCount() );
+    if ( Calamares::typeOf( v ) == Calamares::ListVariantType )
+    {
+        commands = v.toList();
+    }
+    else if ( Calamares::typeOf( v ) == Calamares::MapVariantType )
+    {
+        const auto m = v.toMap();
+        commands = m.value( QStringLiteral( "commands" ) ).toList();
+        limit = static_cast< int >( Calamares::getInteger( m, "limit", limit ) );
+    }
+    if ( commands.isEmpty() || limit < 1 )
+    {
+        cWarning() << "Bad parallel CommandList element" << v;
+        return {};
+    }
+
+    auto l = get_variant_stringlist( commands, false );
+    std::for_each( l.begin(), l.end(), [ = ]( CommandLine& c ) { c.setParallel( group, limit ); } );
+    return l;
+}
+
 static CommandList_t
-get_variant_stringlist( const QVariantList& l )
+get_variant_stringlist( const QVariantList& l, bool allowParallel )
 {
     CommandList_t retl;
     unsigned int count = 0;
+    int group = 0;
     for ( const auto& v : l )
     {
         if ( Calamares::typeOf( v ) == Calamares::StringVariantType )
         {
             retl.append( CommandLine( v.toString(), CommandLine::TimeoutNotSet() ) );
         }
+        else if ( Calamares::typeOf( v ) == Calamares::MapVariantType && v.toMap().contains( "parallel" ) )
+        {
+            if ( allowParallel )
+            {
+                retl.append( get_parallel_group( v.toMap().value( "parallel" ), ++group ) );
+            }
+            else
+            {
+                cWarning() << "Nested parallel CommandList element" << count << "ignored.";
+            }
+        }
         else if ( Calamares::typeOf( v ) == Calamares::MapVariantType )
         {
             CommandLine command( v.toMap() );
@@ -56,47 +108,98 @@ get_variant_stringlist( const QVariantList& l )
     return retl;
 }
 
-/** @brief Inserts the keys from @p map into @p expander as "gs"-keys
+/** @brief Finds the value for `gs[name]` in Global Storage
  *
- * For each key k in @p map, a key with literal `gs[` + prefix + '.' + key +
- * literal `]` is inserted into the exapander.
+ * The @p name is split on '.' and looked up in successive sub-maps,
+ * but Global Storage keys may themselves contain a '.' (e.g.
+ * `imageselection.selectedFiles`), so each prefix of @p name is tried
+ * as a top-level key. Only strings and integers are expanded.
  */
-static void
-expand_tree( Calamares::String::DictionaryExpander& expander, const QString& prefix, const QVariantMap& map )
+static bool
+lookup_gs_key( const Calamares::GlobalStorage* gs, const QString& name, QString& value )
 {
-    // With the current prefix, turn a key into gs[prefix.key]
-    auto gs_key = [ &prefix ]( const QString& k ) -> QString
-    { return QStringLiteral( "gs[" ) + ( prefix.isEmpty() ? QString() : prefix + '.' ) + k + ']'; };
-
-    for ( QVariantMap::const_iterator valueiter = map.cbegin(); valueiter != map.cend(); ++valueiter )
+    const QStringList parts = name.split( '.' );
+    QString topKey;
+    for ( int i = 0; i < parts.count(); ++i )
     {
-        const QString key = valueiter.key();
-        const QVariant value = valueiter.value();
+        topKey += ( i ? QStringLiteral( "." ) : QString() ) + parts.at( i );
+        if ( !gs->contains( topKey ) )
+        {
+            continue;
+        }
 
-        switch ( Calamares::typeOf( value ) )
+        QVariant v = gs->value( topKey );
+        int j = i + 1;
+        for ( ; j < parts.count() && Calamares::typeOf( v ) == Calamares::MapVariantType; ++j )
+        {
+            const QVariantMap m = v.toMap();
+            if ( !m.contains( parts.at( j ) ) )
+            {
+                break;
+            }
+            v = m.value( parts.at( j ) );
+        }
+        if ( j < parts.count() )
+        {
+            continue;
+        }
+
+        switch ( Calamares::typeOf( v ) )
         {
-        case Calamares::MapVariantType:
-            expand_tree( expander, prefix.isEmpty() ? key : ( prefix + '.' + key ), value.toMap() );
-            break;
         case Calamares::StringVariantType:
-            expander.add( gs_key( key ), value.toString() );
-            break;
+            value = v.toString();
+            return true;
         case Calamares::IntVariantType:
-            expander.add( gs_key( key ), QString::number( value.toInt() ) );
-            break;
+            value = QString::number( v.toInt() );
+            return true;
         default:
-            // Silently ignore
+            // Silently ignore, as if missing
             break;
         }
     }
+    return false;
 }
 
-static Calamares::String::DictionaryExpander
+namespace
+{
+/** @brief Expander that looks up `gs[...]` variables when they are used
+ *
+ * Plain variables (ROOT, USER, LANG) are in the dictionary. Variables
+ * of the form `gs[a.b.c]` are resolved against Global Storage only when
+ * a command uses them, so expansion costs no more than the keys used.
+ */
+class GlobalStorageExpander : public Calamares::String::DictionaryExpander
+{
+public:
+    explicit GlobalStorageExpander( const Calamares::GlobalStorage* gs )
+        : m_gs( gs )
+    {
+    }
+
+protected:
+    bool expandMacro( const QString& str, QStringList& ret ) override
+    {
+        QString value;
+        if ( m_gs && str.startsWith( QStringLiteral( "gs[" ) ) && str.endsWith( ']' )
+             && lookup_gs_key( m_gs, str.mid( 3, str.length() - 4 ), value ) )
+        {
+            ret << value;
+            return true;
+        }
+        return DictionaryExpander::expandMacro( str, ret );
+    }
+
+private:
+    const Calamares::GlobalStorage* m_gs;
+};
+}  // namespace
+
+static GlobalStorageExpander
 get_gs_expander( System::RunLocation location )
 {
     Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
 
-    Calamares::String::DictionaryExpander expander;
+    GlobalStorageExpander expander( gs );
 
     // Figure out the replacement for ${ROOT}
     if ( location == System::RunLocation::RunInTarget )
@@ -124,11 +227,6 @@ get_gs_expander( System::RunLocation location )
         }
     }
 
-    if ( gs )
-    {
-        expand_tree( expander, QString(), gs->data() );
-    }
-
     return expander;
 }
 
@@ -170,6 +268,7 @@ CommandLine::expand( KMacroExpanderBase& expander ) const
     {
         l.updateVerbose( m_verbose.value() );
     }
+    l.setParallel( m_parallelGroup, m_parallelLimit );
     return l;
 }
 
@@ -205,6 +304,10 @@ CommandList::CommandList::CommandList( const QVariant& v, bool doChroot, std::ch
     {
         append( { v.toString(), m_timeout } );
     }
+    else if ( Calamares::typeOf( v ) == Calamares::MapVariantType && v.toMap().contains( "parallel" ) )
+    {
+        append( get_parallel_group( v.toMap().value( "parallel" ), 1 ) );
+    }
     else if ( Calamares::typeOf( v ) == Calamares::MapVariantType )
     {
         CommandLine c( v.toMap() );
@@ -220,33 +323,26 @@ CommandList::CommandList::CommandList( const QVariant& v, bool doChroot, std::ch
     }
 }
 
-Calamares::JobResult
-CommandList::run()
+namespace
 {
-    System::RunLocation location = m_doChroot ? System::RunLocation::RunInTarget : System::RunLocation::RunInHost;
-
-    auto expander = get_gs_expander( location );
-    auto expandedList = expand( expander );
-    if ( expander.hasErrors() )
-    {
-        const auto missing = expander.errorNames();
-        cError() << "Missing variables:" << missing;
-        return Calamares::JobResult::error(
-            QCoreApplication::translate( "CommandList", "Could not run command." ),
-            QCoreApplication::translate( "CommandList",
-                                         "The commands use variables that are not defined. "
-                                         "Missing variables are: %1." )
-                .arg( missing.join( ',' ) ) );
-    }
-
-    for ( CommandList::const_iterator i = expandedList.cbegin(); i != expandedList.cend(); ++i )
+/// @brief A command-line, ready to be run through the shell
+struct ShellCommand
+{
+    QString command;  ///< Without the leading - (if any)
+    bool suppressResult;
+    std::chrono::seconds timeout;
+    bool verbose;
+    Calamares::Utils::Runner runner;
+
+    ShellCommand( const CommandLine& c, System::RunLocation location, std::chrono::seconds defaultTimeout )
+        : command( c.command() )
+        , suppressResult( command.startsWith( '-' ) )
+        , timeout( c.timeout() >= std::chrono::seconds::zero() ? c.timeout() : defaultTimeout )
+        , verbose( c.isVerbose() )
     {
-        QString processed_cmd = i->command();
-        bool suppress_result = false;
-        if ( processed_cmd.startsWith( '-' ) )
+        if ( suppressResult )
         {
-            suppress_result = true;
-            processed_cmd.remove( 0, 1 );  // Drop the -
+            command.remove( 0, 1 );  // Drop the -
         }
 
         const QString environmentSetting = []( const QStringList& l ) -> QString
@@ -257,34 +353,140 @@ CommandList::run()
             }
 
             return QStringLiteral( "export " ) + l.join( " " ) + QStringLiteral( " ; " );
-        }( i->environment() );
-
-        QStringList shell_cmd { "/bin/sh", "-c" };
-        shell_cmd << ( environmentSetting + processed_cmd );
-
-        std::chrono::seconds timeout = i->timeout() >= std::chrono::seconds::zero() ? i->timeout() : m_timeout;
+        }( c.environment() );
 
-        Calamares::Utils::Runner runner( shell_cmd );
+        runner.setCommand( { "/bin/sh", "-c", environmentSetting + command } );
         runner.setLocation( location ).setTimeout( timeout ).setWorkingDirectory( QString() );
-        if ( i->isVerbose() )
-        {
-            runner.enableOutputProcessing();
-            QObject::connect(
-                &runner, &Calamares::Utils::Runner::output, []( QString output ) { cDebug() << output; } );
-        }
-        ProcessResult r = runner.run();
+    }
 
+    /// @brief Turns the process result into the job result
+    Calamares::JobResult result( const ProcessResult& r ) const
+    {
         if ( r.getExitCode() != 0 )
         {
-            if ( suppress_result )
+            if ( suppressResult )
             {
                 cDebug() << "Error code" << r.getExitCode() << "ignored by CommandList configuration.";
             }
             else
             {
-                return r.explainProcess( processed_cmd, timeout );
+                return r.explainProcess( command, timeout );
             }
         }
+        return Calamares::JobResult::ok();
+    }
+};
+}  // namespace
+
+static Calamares::JobResult
+run_one( const CommandLine& c, System::RunLocation location, std::chrono::seconds defaultTimeout )
+{
+    ShellCommand shell( c, location, defaultTimeout );
+    if ( shell.verbose )
+    {
+        shell.runner.enableOutputProcessing();
+        QObject::connect(
+            &shell.runner, &Calamares::Utils::Runner::output, []( QString output ) { cDebug() << output; } );
+    }
+    return shell.result( shell.runner.run() );
+}
+
+/** @brief Runs the commands [ @p begin, @p end ) of @p list concurrently
+ *
+ * Commands are started in order, with at most parallelLimit() running.
+ * Results are handled in order too: command n + limit is started only
+ * once command n is done. This makes the outcome deterministic: after
+ * a failure, no more commands are started, the running ones are waited
+ * for, and the failure of the first failing command is returned.
+ *
+ * Output is collected per command and logged (for verbose commands)
+ * in one piece when it is done, so it does not interleave.
+ */
+static Calamares::JobResult
+run_parallel( const CommandList& list,
+              int begin,
+              int end,
+              System::RunLocation location,
+              std::chrono::seconds defaultTimeout )
+{
+    const auto limit = static_cast< std::size_t >( list.at( begin ).parallelLimit() );
+    cDebug() << "Running" << ( end - begin ) << "commands, at most" << limit << "at a time.";
+
+    std::vector< std::unique_ptr< ShellCommand > > commands;
+    std::vector< Calamares::Utils::RunningProcess > processes;
+    for ( int i = begin; i < end; ++i )
+    {
+        commands.push_back( std::make_unique< ShellCommand >( list.at( i ), location, defaultTimeout ) );
+    }
+
+    std::optional< Calamares::JobResult > failure;
+    std::size_t started = 0;
+    for ( std::size_t done = 0; done < commands.size(); ++done )
+    {
+        while ( !failure && started < commands.size() && started < done + limit )
+        {
+            processes.push_back( commands[ started ]->runner.start() );
+            ++started;
+        }
+        if ( done >= started )
+        {
+            break;  // Failed, and nothing left running
+        }
+
+        const auto r = processes[ done ].wait();
+        const auto& shell = *commands[ done ];
+        if ( shell.verbose && !r.getOutput().isEmpty() )
+        {
+            cDebug() << Logger::SubEntry << "Output of" << shell.command << Logger::NoQuote << ":\n" << r.getOutput();
+        }
+        auto result = shell.result( r );
+        if ( !failure && !result )
+        {
+            failure.emplace( std::move( result ) );
+        }
+    }
+    if ( failure )
+    {
+        return std::move( *failure );
+    }
+    return Calamares::JobResult::ok();
+}
+
+Calamares::JobResult
+CommandList::run()
+{
+    System::RunLocation location = m_doChroot ? System::RunLocation::RunInTarget : System::RunLocation::RunInHost;
+
+    auto expander = get_gs_expander( location );
+    auto expandedList = expand( expander );
+    if ( expander.hasErrors() )
+    {
+        const auto missing = expander.errorNames();
+        cError() << "Missing variables:" << missing;
+        return Calamares::JobResult::error(
+            QCoreApplication::translate( "CommandList", "Could not run command." ),
+            QCoreApplication::translate( "CommandList",
+                                         "The commands use variables that are not defined. "
+                                         "Missing variables are: %1." )
+                .arg( missing.join( ',' ) ) );
+    }
+
+    for ( int i = 0; i < expandedList.count(); )
+    {
+        const int group = expandedList.at( i ).parallelGroup();
+        int end = i + 1;
+        while ( group && end < expandedList.count() && expandedList.at( end ).parallelGroup() == group )
+        {
+            ++end;
+        }
+
+        auto r = ( end - i > 1 ) ? run_parallel( expandedList, i, end, location, m_timeout )
+                                 : run_one( expandedList.at( i ), location, m_timeout );
+        if ( !r )
+        {
+            return r;
+        }
+        i = end;
     }
 
     return Calamares::JobResult::ok();
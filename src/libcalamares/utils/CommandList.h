@@ -95,11 +95,27 @@ public:
     /** @brief Unconditionally set verbosity (can also reset it to nullopt) */
     void setVerbose( std::optional< bool > v ) { m_verbose = v; }
 
+    /** @brief The parallel group this command belongs to
+     *
+     * Adjacent commands with the same non-zero group run concurrently,
+     * at most parallelLimit() at a time. Group 0 means the command
+     * runs on its own.
+     */
+    int parallelGroup() const { return m_parallelGroup; }
+    int parallelLimit() const { return m_parallelLimit; }
+    void setParallel( int group, int limit )
+    {
+        m_parallelGroup = group;
+        m_parallelLimit = limit;
+    }
+
 private:
     QString m_command;
     QStringList m_environment;
     std::chrono::seconds m_timeout = TimeoutNotSet();
     std::optional< bool > m_verbose;
+    int m_parallelGroup = 0;
+    int m_parallelLimit = 1;
 };
 
 /** @brief Abbreviation, used internally. */
@@ -121,7 +137,9 @@ public:
     /** @brief command-list constructed from script-entries in @p v
      *
      * The global settings @p doChroot and @p timeout can be overridden by
-     * the individual script-entries.
+     * the individual script-entries. An entry that is a map with key
+     * *parallel* is a group of commands that run concurrently; see
+     * CommandLine::parallelGroup().
      */
     CommandList( const QVariant& v, bool doChroot = true, std::chrono::seconds timeout = std::chrono::seconds( 10 ) );
     CommandList( int ) = delete;
@@ -130,6 +148,13 @@ public:
     bool doChroot() const { return m_doChroot; }
     std::chrono::seconds defaultTimeout() const { return m_timeout; }
 
+    /** @brief Runs the commands in order
+     *
+     * The commands of a parallel group all run (as far as the limit
+     * allows) before the next command or group starts. The first
+     * failing command -- in list order, also within a group -- stops
+     * the run, and its failure is returned.
+     */
     Calamares::JobResult run();
 
     using CommandList_t::at;
@@ -19,27 +19,61 @@
 #include "utils/Dirs.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMutex>
+#include <QProcess>
 #include <QRandomGenerator>
+#include <QStandardPaths>
 #include <QTextStream>
+#include <QThread>
 #include <QTime>
 #include <QVariant>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 static constexpr const int LOGFILE_SIZE = 1024 * 256;
+/// Number of old (rotated) segments of each log file that are kept
+static constexpr const int LOGFILE_SEGMENTS = 3;
 
 static std::ofstream logfile;
+static std::ofstream structuredfile;
 static unsigned int s_threshold =
 #ifdef QT_NO_DEBUG
     Logger::LOG_DISABLE;
 #else
     Logger::LOGDEBUG;  // Comparison is < in log() function
 #endif
-static QMutex s_mutex;
+static QMutex s_mutex;  ///< Guards logfile and structuredfile, which are written by the LogWriter thread
+
+/// Per-module thresholds, by instance key or module name; see setupModuleLogLevel()
+static QHash< QString, unsigned int > s_moduleThresholds;
+static QMutex s_moduleMutex;  ///< Guards s_moduleThresholds
+
+/// The module the current thread is logging for, if any (see ModuleScope)
+static thread_local QString t_module;
+/// Threshold for t_module, or 0 to use s_threshold
+static thread_local unsigned int t_threshold = 0;
+
+/// How long log lines may sit in the stream buffers before they are flushed
+static constexpr const std::chrono::milliseconds FLUSH_INTERVAL( 250 );
+/// How many records are kept in memory for recentRecords()
+static constexpr const std::size_t RECENT_RECORDS = 4096;
 
 static const char s_Continuation[] = "\n    ";
 static const char s_SubEntry[] = "    .. ";
@@ -64,17 +98,71 @@ logLevel()
     return s_threshold > 0 ? s_threshold - 1 : 0;
 }
 
+void
+setupModuleLogLevel( const QString& module, unsigned int level )
+{
+    if ( level > LOGVERBOSE )
+    {
+        level = LOGVERBOSE;
+    }
+    Calamares::MutexLocker lock( &s_moduleMutex );
+    s_moduleThresholds.insert( module, level + 1 );  // +1 like s_threshold, so 0 means "no override"
+}
+
+void
+clearModuleLogLevels()
+{
+    Calamares::MutexLocker lock( &s_moduleMutex );
+    s_moduleThresholds.clear();
+}
+
 bool
 logLevelEnabled( unsigned int level )
 {
-    return level < s_threshold;
+    return level < ( t_threshold ? t_threshold : s_threshold );
+}
+
+QString
+currentModule()
+{
+    return t_module;
+}
+
+ModuleScope::ModuleScope( const QString& module )
+    : m_previousModule( t_module )
+    , m_previousThreshold( t_threshold )
+{
+    t_module = module;
+    t_threshold = 0;
+
+    Calamares::MutexLocker lock( &s_moduleMutex );
+    if ( s_moduleThresholds.isEmpty() )
+    {
+        return;
+    }
+    auto it = s_moduleThresholds.constFind( module );
+    if ( it == s_moduleThresholds.constEnd() )
+    {
+        // Settings for the module name apply to all its instances
+        it = s_moduleThresholds.constFind( module.section( '@', 0, 0 ) );
+    }
+    if ( it != s_moduleThresholds.constEnd() )
+    {
+        t_threshold = it.value();
+    }
+}
+
+ModuleScope::~ModuleScope()
+{
+    t_module = m_previousModule;
+    t_threshold = m_previousThreshold;
 }
 
 /** @brief Should we call the log_implementation() function with this level?
  *
  * The implementation logs everything for which logLevelEnabled() is
- * true to the file **and** to stdout; it logs everything at debug-level
- * or below to the file regardless.
+ * true to the files **and** to stdout; it logs everything at debug-level
+ * or below to the files regardless.
  */
 static inline bool
 log_enabled( unsigned int level )
@@ -82,39 +170,412 @@ log_enabled( unsigned int level )
     return level <= LOGDEBUG || logLevelEnabled( level );
 }
 
-static void
-log_implementation( const char* msg, unsigned int debugLevel, const char* funcinfo )
+namespace
+{
+/// @brief One line (or a funcinfo line and a message) to be logged
+struct LogRecord
+{
+    qint64 msecs;  ///< Since epoch, when the record was made
+    unsigned int level;
+    bool hasFuncinfo;
+    bool hasMsg;
+    bool toStdout;  ///< logLevelEnabled() in the logging thread
+    quintptr thread;
+    QString module;  ///< Instance key, or empty outside of a ModuleScope
+    std::string funcinfo;
+    std::string msg;
+};
+
+/** @brief Formats the timestamps of log records
+ *
+ * Records come in bursts within the same second, so the date and
+ * time strings are only re-formatted when the second changes.
+ */
+class TimestampCache
 {
-    Calamares::MutexLocker lock( &s_mutex );
+public:
+    void update( qint64 msecs )
+    {
+        const qint64 secs = msecs / 1000;
+        if ( secs != m_secs )
+        {
+            m_secs = secs;
+            // If we don't format the date as a Qt::ISODate then we get a crash when
+            // logging at exit as Qt tries to use QLocale to format, but QLocale is
+            // on its way out.
+            const auto dt = QDateTime::fromMSecsSinceEpoch( secs * 1000 );
+            m_date = dt.date().toString( Qt::ISODate ).toStdString();
+            m_time = dt.time().toString( Qt::ISODate ).toStdString();
+        }
+    }
+    const std::string& date() const { return m_date; }
+    const std::string& time() const { return m_time; }
+
+private:
+    qint64 m_secs = -1;
+    std::string m_date;
+    std::string m_time;
+};
+
+/// Writes @p r as a JSON line to the structured log; requires s_mutex
+void
+write_structured( const LogRecord& r, const TimestampCache& timestamp )
+{
+    if ( !structuredfile.is_open() )
+    {
+        return;
+    }
+
+    char msecs[ 8 ];
+    std::snprintf( msecs, sizeof( msecs ), ".%03d", static_cast< int >( r.msecs % 1000 ) );
+    QJsonObject o {
+        { QStringLiteral( "time" ), QString::fromStdString( timestamp.date() + 'T' + timestamp.time() + msecs ) },
+        { QStringLiteral( "level" ), static_cast< int >( r.level ) },
+        { QStringLiteral( "module" ), r.module },
+        { QStringLiteral( "thread" ), QString::number( r.thread, 16 ) },
+    };
+    if ( r.hasFuncinfo )
+    {
+        o.insert( QStringLiteral( "func" ), QString::fromStdString( r.funcinfo ) );
+    }
+    if ( r.hasMsg )
+    {
+        o.insert( QStringLiteral( "msg" ), QString::fromStdString( r.msg ) );
+    }
+    structuredfile << QJsonDocument( o ).toJson( QJsonDocument::Compact ).constData() << '\n';
+}
 
-    const auto date = QDate::currentDate().toString( Qt::ISODate );
-    const auto time = QTime::currentTime().toString();
+/** @brief Writes the records to the log files and stdout
+ *
+ * Requires s_mutex to be held (for the files). Streams are not flushed.
+ */
+void
+write_record( const LogRecord& r, TimestampCache& timestamp )
+{
+    timestamp.update( r.msecs );
+    const auto& date = timestamp.date();
+    const auto& time = timestamp.time();
 
-    // If we don't format the date as a Qt::ISODate then we get a crash when
-    // logging at exit as Qt tries to use QLocale to format, but QLocale is
-    // on its way out.
-    if ( funcinfo )
+    if ( r.hasFuncinfo )
+    {
+        logfile << date << " - " << time << " [" << r.level << "]: " << r.funcinfo << '\n';
+    }
+    if ( r.hasMsg )
     {
-        logfile << date.toUtf8().data() << " - " << time.toUtf8().data() << " [" << debugLevel << "]: " << funcinfo
+        logfile << date << " - " << time << " [" << r.level << ( r.hasFuncinfo ? "]:     " : "]: " ) << r.msg
                 << '\n';
     }
-    if ( msg )
+
+    write_structured( r, timestamp );
+
+    if ( r.toStdout )
     {
-        logfile << date.toUtf8().data() << " - " << time.toUtf8().data() << " [" << debugLevel
-                << ( funcinfo ? "]:     " : "]: " ) << msg << '\n';
+        if ( r.hasFuncinfo )
+        {
+            std::cout << time << " [" << r.level << "]: " << r.funcinfo << ( r.hasMsg ? s_Continuation : "" );
+        }
+        std::cout << r.msg << '\n';
     }
+}
+
+void
+flush_streams()
+{
     logfile.flush();
+    structuredfile.flush();
+    std::cout.flush();
+}
+
+/** @brief The most recent records, and who wants to hear about new ones
+ *
+ * Filled by the LogWriter thread after each batch is written.
+ */
+class RecordRing
+{
+public:
+    void append( std::vector< LogRecord >& batch )
+    {
+        if ( batch.empty() )
+        {
+            return;
+        }
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            for ( auto& r : batch )
+            {
+                m_records.push_back( std::move( r ) );
+            }
+            m_last += batch.size();
+            while ( m_records.size() > RECENT_RECORDS )
+            {
+                m_records.pop_front();
+            }
+        }
 
-    if ( logLevelEnabled( debugLevel ) )
+        std::lock_guard< std::mutex > lock( m_listenerMutex );
+        for ( const auto& l : m_listeners )
+        {
+            l.second();
+        }
+    }
+
+    QVector< Record > recent( quint64 after ) const
     {
-        if ( funcinfo )
+        std::lock_guard< std::mutex > lock( m_mutex );
+        const quint64 first = m_last - m_records.size() + 1;  // Sequence of m_records.front()
+        QVector< Record > records;
+        for ( quint64 sequence = std::max( first, after + 1 ); sequence <= m_last; ++sequence )
         {
-            std::cout << time.toUtf8().data() << " [" << debugLevel << "]: " << funcinfo
-                      << ( msg ? s_Continuation : "" );
+            const auto& r = m_records[ sequence - first ];
+            QString text = QString::fromStdString( r.hasFuncinfo ? r.funcinfo : r.msg );
+            if ( r.hasFuncinfo && r.hasMsg )
+            {
+                text.append( QLatin1String( s_Continuation ) );
+                text.append( QString::fromStdString( r.msg ) );
+            }
+            records.append( Record { sequence, r.msecs, r.level, r.module, text } );
         }
-        // The endl is desired, since it also flushes (like the logfile, above)
-        std::cout << ( msg ? msg : "" ) << std::endl;
+        return records;
+    }
+
+    int addListener( std::function< void() >&& f )
+    {
+        std::lock_guard< std::mutex > lock( m_listenerMutex );
+        m_listeners.emplace_back( ++m_lastListener, std::move( f ) );
+        return m_lastListener;
     }
+
+    void removeListener( int id )
+    {
+        std::lock_guard< std::mutex > lock( m_listenerMutex );
+        m_listeners.erase( std::remove_if( m_listeners.begin(),
+                                           m_listeners.end(),
+                                           [ id ]( const auto& l ) { return l.first == id; } ),
+                           m_listeners.end() );
+    }
+
+private:
+    mutable std::mutex m_mutex;  ///< Guards m_records and m_last
+    std::deque< LogRecord > m_records;
+    quint64 m_last = 0;  ///< Sequence of the last record
+
+    std::mutex m_listenerMutex;  ///< Held while listeners are called
+    std::vector< std::pair< int, std::function< void() > > > m_listeners;
+    int m_lastListener = 0;
+};
+
+RecordRing&
+recordRing()
+{
+    static RecordRing ring;
+    return ring;
+}
+
+/** @brief Background thread that does the actual log I/O
+ *
+ * Logging threads only append a record to the pending list, which is
+ * a short critical section without any I/O. The writer thread takes
+ * the whole pending list at once, writes it, and flushes the streams
+ * every FLUSH_INTERVAL. A flush can be requested (and waited for) so
+ * that errors reach the disk before, e.g., a crash.
+ *
+ * The writer is a function-static; once it is destroyed at exit,
+ * logging falls back to writing directly. It holds on to the record
+ * ring, which is constructed first so that it outlives the writer.
+ */
+class LogWriter
+{
+public:
+    static LogWriter* instance()
+    {
+        static LogWriter writer;
+        return s_alive ? &writer : nullptr;
+    }
+
+    ~LogWriter()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        s_alive = false;
+    }
+
+    /// Queues @p r; if @p flush, waits until it has been flushed
+    void enqueue( LogRecord&& r, bool flush )
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        m_pending.push_back( std::move( r ) );
+        const auto sequence = ++m_enqueued;
+        if ( flush )
+        {
+            waitForFlush( lock, sequence );
+        }
+        else if ( m_pending.size() == 1 )
+        {
+            m_wake.notify_one();
+        }
+    }
+
+    void flush()
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        waitForFlush( lock, m_enqueued );
+    }
+
+private:
+    LogWriter()
+        : m_ring( recordRing() )
+        , m_thread( &LogWriter::run, this )
+    {
+        s_alive = true;
+    }
+
+    void waitForFlush( std::unique_lock< std::mutex >& lock, quint64 sequence )
+    {
+        if ( m_flushed >= sequence || std::this_thread::get_id() == m_thread.get_id() )
+        {
+            return;
+        }
+        m_flushRequested = true;
+        m_wake.notify_one();
+        m_flushedCondition.wait( lock, [ & ]() { return m_flushed >= sequence || m_stopped; } );
+    }
+
+    void run()
+    {
+        TimestampCache timestamp;
+        auto lastFlush = std::chrono::steady_clock::now();
+        bool dirty = false;  // Written, but not flushed
+        std::vector< LogRecord > batch;
+
+        std::unique_lock< std::mutex > lock( m_mutex );
+        while ( true )
+        {
+            const auto wakeup = [ this ]() { return m_stop || m_flushRequested || !m_pending.empty(); };
+            if ( dirty )
+            {
+                m_wake.wait_for( lock, FLUSH_INTERVAL, wakeup );
+            }
+            else
+            {
+                m_wake.wait( lock, wakeup );
+            }
+            batch.swap( m_pending );
+            const auto upTo = m_enqueued;
+            const bool flushNow = m_flushRequested || m_stop;
+            const bool stop = m_stop;
+            m_flushRequested = false;
+            lock.unlock();
+
+            {
+                Calamares::MutexLocker fileLock( &s_mutex );
+                for ( const auto& r : batch )
+                {
+                    write_record( r, timestamp );
+                }
+                dirty = dirty || !batch.empty();
+                const auto now = std::chrono::steady_clock::now();
+                if ( dirty && ( flushNow || ( now - lastFlush >= FLUSH_INTERVAL ) ) )
+                {
+                    flush_streams();
+                    lastFlush = now;
+                    dirty = false;
+                }
+            }
+            m_ring.append( batch );
+            batch.clear();
+
+            lock.lock();
+            if ( flushNow )
+            {
+                m_flushed = upTo;
+                m_flushedCondition.notify_all();
+            }
+            if ( stop && m_pending.empty() )
+            {
+                m_stopped = true;
+                m_flushedCondition.notify_all();
+                break;
+            }
+        }
+    }
+
+    static std::atomic< bool > s_alive;
+
+    RecordRing& m_ring;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushedCondition;
+    std::vector< LogRecord > m_pending;
+    quint64 m_enqueued = 0;
+    quint64 m_flushed = 0;
+    bool m_flushRequested = false;
+    bool m_stop = false;
+    bool m_stopped = false;
+    std::thread m_thread;  // Last, so it starts after everything else is initialized
+};
+
+std::atomic< bool > LogWriter::s_alive { false };
+
+}  // namespace
+
+static void
+log_implementation( const char* msg, unsigned int debugLevel, const char* funcinfo )
+{
+    LogRecord r { QDateTime::currentMSecsSinceEpoch(),
+                  debugLevel,
+                  funcinfo != nullptr,
+                  msg != nullptr,
+                  logLevelEnabled( debugLevel ),
+                  reinterpret_cast< quintptr >( QThread::currentThreadId() ),
+                  t_module,
+                  funcinfo ? std::string( funcinfo ) : std::string(),
+                  msg ? std::string( msg ) : std::string() };
+
+    if ( auto* writer = LogWriter::instance() )
+    {
+        // Errors are flushed right away, so that they survive a crash
+        writer->enqueue( std::move( r ), debugLevel <= LOGERROR );
+    }
+    else
+    {
+        // At exit, after the writer is gone
+        static TimestampCache timestamp;
+        Calamares::MutexLocker lock( &s_mutex );
+        write_record( r, timestamp );
+        flush_streams();
+    }
+}
+
+void
+flush()
+{
+    if ( auto* writer = LogWriter::instance() )
+    {
+        writer->flush();
+    }
+}
+
+QVector< Record >
+recentRecords( quint64 after )
+{
+    return recordRing().recent( after );
+}
+
+int
+addRecordListener( std::function< void() > f )
+{
+    return recordRing().addListener( std::move( f ) );
+}
+
+void
+removeRecordListener( int id )
+{
+    recordRing().removeListener( id );
 }
 
 static void
@@ -158,29 +619,57 @@ logFile()
     return Calamares::appLogDir().filePath( "session.log" );
 }
 
-void
-setupLogfile()
+QString
+structuredLogFile()
 {
-    if ( QFileInfo( logFile().toLocal8Bit() ).size() > LOGFILE_SIZE )
-    {
-        QByteArray lc;
-        {
-            QFile f( logFile().toLocal8Bit() );
-            f.open( QIODevice::ReadOnly | QIODevice::Text );
-            lc = f.readAll();
-            f.close();
-        }
+    return Calamares::appLogDir().filePath( "session.jsonl" );
+}
 
-        QFile::remove( logFile().toLocal8Bit() );
+/** @brief Rotates the log file at @p path if it is too large
+ *
+ * Segment n of the log is called <path>.n, or <path>.n.zst once
+ * compressed; segment 1 is the most recent. The file is renamed
+ * rather than copied, and compressing happens in a separate process,
+ * so this does not hold up startup.
+ */
+static void
+rotate_logfile( const QString& path )
+{
+    if ( QFileInfo( path ).size() <= LOGFILE_SIZE )
+    {
+        return;
+    }
 
+    const auto segment = [ &path ]( int n, const char* suffix )
+    { return path + '.' + QString::number( n ) + QString::fromLatin1( suffix ); };
+    for ( const char* suffix : { "", ".zst" } )
+    {
+        QFile::remove( segment( LOGFILE_SEGMENTS, suffix ) );
+        for ( int n = LOGFILE_SEGMENTS - 1; n > 0; --n )
         {
-            QFile f( logFile().toLocal8Bit() );
-            f.open( QIODevice::WriteOnly | QIODevice::Text );
-            f.write( lc.right( LOGFILE_SIZE - ( LOGFILE_SIZE / 4 ) ) );
-            f.close();
+            QFile::rename( segment( n, suffix ), segment( n + 1, suffix ) );
         }
     }
 
+    const QString latest = segment( 1, "" );
+    if ( !QFile::rename( path, latest ) )
+    {
+        QFile::remove( path );
+        return;
+    }
+    const QString zstd = QStandardPaths::findExecutable( QStringLiteral( "zstd" ) );
+    if ( !zstd.isEmpty() )
+    {
+        QProcess::startDetached( zstd, { QStringLiteral( "-q" ), QStringLiteral( "--rm" ), latest } );
+    }
+}
+
+void
+setupLogfile()
+{
+    rotate_logfile( logFile() );
+    rotate_logfile( structuredLogFile() );
+
     // Since the log isn't open yet, this probably only goes to stdout
     cDebug() << "Using log file:" << logFile();
 
@@ -193,6 +682,7 @@ setupLogfile()
             logfile << "\n\n" << std::endl;
         }
         logfile << "=== START CALAMARES " << CALAMARES_VERSION << std::endl;
+        structuredfile.open( structuredLogFile().toLocal8Bit(), std::ios::app );
     }
 
     qInstallMessageHandler( CalamaresLogHandler );
@@ -18,7 +18,9 @@
 #include <QDebug>
 #include <QSharedPointer>
 #include <QVariant>
+#include <QVector>
 
+#include <functional>
 #include <memory>
 
 namespace Logger
@@ -103,15 +105,76 @@ operator<<( QDebug& s, const Quote_t& )
  */
 DLLEXPORT QString logFile();
 
+/**
+ * @brief The full path of the structured log file.
+ *
+ * This holds the same records as logFile(), one JSON object per line,
+ * with keys *time*, *level*, *module*, *thread*, *func* and *msg*.
+ */
+DLLEXPORT QString structuredLogFile();
+
 /**
  * @brief Start logging to the log file.
  *
  * Call this (once) to start logging to the log file (usually
- * ~/.cache/calamares/session.log ). An existing log file is
- * rolled over if it is too large.
+ * ~/.cache/calamares/session.log ) and the structured log file.
+ * An existing log file that is too large is rotated: it becomes
+ * segment 1 (e.g. session.log.1) and is compressed in the background
+ * with zstd, if available. Only a few old segments are kept.
  */
 DLLEXPORT void setupLogfile();
 
+/**
+ * @brief Write out all pending log messages.
+ *
+ * Logging is done by a background thread, which flushes the log
+ * file regularly, and immediately after an error. Call this before
+ * doing something drastic (like exiting without returning from main).
+ */
+DLLEXPORT void flush();
+
+/**
+ * @brief A recent log message, for display in the UI.
+ *
+ * The logger keeps the last few thousand messages in memory;
+ * see recentRecords().
+ */
+struct Record
+{
+    quint64 sequence;  ///< Increases by one for each message logged
+    qint64 msecs;  ///< Since epoch
+    unsigned int level;
+    QString module;  ///< Instance key, may be empty
+    QString text;  ///< Function header and message, without timestamp
+};
+
+/**
+ * @brief The recent messages logged after message @p after
+ *
+ * Pass 0 to get all the messages still in memory. If the first
+ * returned record has a sequence greater than @p after + 1,
+ * messages have been dropped from memory in between.
+ */
+DLLEXPORT QVector< Record > recentRecords( quint64 after = 0 );
+
+/**
+ * @brief Call @p f whenever new records are available
+ *
+ * The function is called from the logging thread, so it should
+ * do very little (e.g. queue a call into the thread that wants the
+ * records) and must not log anything. Returns an id for
+ * removeRecordListener().
+ */
+DLLEXPORT int addRecordListener( std::function< void() > f );
+
+/**
+ * @brief Stop calling the listener with the given @p id
+ *
+ * Once this returns, the listener is not running and will not
+ * be called again.
+ */
+DLLEXPORT void removeRecordListener( int id );
+
 /**
  * @brief Set a log level for future logging.
  *
@@ -126,9 +189,57 @@ DLLEXPORT void setupLogLevel( unsigned int level );
 /** @brief Return the configured log-level. */
 DLLEXPORT unsigned int logLevel();
 
-/** @brief Would the given @p level really be logged? */
+/**
+ * @brief Set a log level for one module.
+ *
+ * The @p module is an instance key (e.g. "shellprocess@bootloader")
+ * or a module name, which applies to all instances of that module.
+ * The level replaces the global one from setupLogLevel() for messages
+ * logged in a ModuleScope of that module. Call this during startup,
+ * before any jobs run.
+ */
+DLLEXPORT void setupModuleLogLevel( const QString& module, unsigned int level );
+
+/// @brief Remove all the log levels set with setupModuleLogLevel()
+DLLEXPORT void clearModuleLogLevels();
+
+/** @brief Would the given @p level really be logged?
+ *
+ * This takes the module of the current thread (see ModuleScope)
+ * into account.
+ */
 DLLEXPORT bool logLevelEnabled( unsigned int level );
 
+/** @brief The module the current thread logs for, or empty
+ *
+ * Work that a module hands to another thread can take this along,
+ * and open a ModuleScope for it there.
+ */
+DLLEXPORT QString currentModule();
+
+/**
+ * @brief Attributes log messages to a module.
+ *
+ * While an object of this class exists, messages logged from the
+ * thread that created it are marked with the module instance key
+ * @p module in the structured log, and are filtered with the
+ * log level of that module (see setupModuleLogLevel()).
+ * Scopes nest; the previous module is restored on destruction.
+ */
+class DLLEXPORT ModuleScope
+{
+public:
+    explicit ModuleScope( const QString& module );
+    ~ModuleScope();
+
+    ModuleScope( const ModuleScope& ) = delete;
+    ModuleScope& operator=( const ModuleScope& ) = delete;
+
+private:
+    QString m_previousModule;
+    unsigned int m_previousThreshold;
+};
+
 /**
  * @brief Row-oriented formatted logging.
  *
@@ -25,6 +25,10 @@
  * It gets a single CreateInstanceFunction and calls that;
  * the function is set when registerPlugin() is called in a subclass.
  *
+ * A viewstep plugin may additionally register a *headless* job
+ * with registerHeadlessJob(). That job is used instead of the
+ * viewstep when there is no GUI (e.g. for unattended installs),
+ * and must do its work from Global Storage alone.
  */
 class DLLEXPORT CalamaresPluginFactory : public QObject
 {
@@ -38,7 +42,25 @@ public:
     template < class T >
     T* create( QObject* parent = nullptr )
     {
-        auto* op = fn ? fn( parent ) : nullptr;
+        return createFrom< T >( fn, parent );
+    }
+
+    /// @brief Creates the headless job, if one was registered
+    template < class T >
+    T* createHeadless( QObject* parent = nullptr )
+    {
+        return createFrom< T >( headlessFn, parent );
+    }
+
+protected:
+    CreateInstanceFunction fn = nullptr;
+    CreateInstanceFunction headlessFn = nullptr;
+
+private:
+    template < class T >
+    static T* createFrom( CreateInstanceFunction f, QObject* parent )
+    {
+        auto* op = f ? f( parent ) : nullptr;
         if ( !op )
         {
             return nullptr;
@@ -50,9 +72,6 @@ public:
         }
         return tp;
     }
-
-protected:
-    CreateInstanceFunction fn = nullptr;
 };
 
 /** @brief declare a Calamares Plugin Factory
@@ -81,6 +100,11 @@ protected:
         { \
             fn = createInstance< T >; \
         } \
+        template < class T > \
+        void registerHeadlessJob() \
+        { \
+            headlessFn = createInstance< T >; \
+        } \
     };
 
 /** @brief Define a Calamares Plugin Factory
@@ -99,6 +123,13 @@ protected:
  * ```
  *
  * Leaving out the `()` will lead to generally-weird compiler warnings.
+ *
+ * A viewstep plugin that can also run without a GUI adds a second
+ * registration for its headless job (a subclass of CppJob), eg.
+ *
+ * ```
+ * CALAMARES_PLUGIN_FACTORY_DEFINITION( MyPlugin, registerPlugin<MyViewStep>(); registerHeadlessJob<MyJob>(); )
+ * ```
  */
 #define CALAMARES_PLUGIN_FACTORY_DEFINITION( name, pluginRegistrations ) \
     name::name() \
@@ -13,9 +13,43 @@
 #include "GlobalStorage.h"
 #include "JobQueue.h"
 #include "Settings.h"
+#include "utils/ChrootHelper.h"
 #include "utils/Logger.h"
 
-#include <QProcess>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+/// Length of a poll() slice; a process that exits while its output is still held open is noticed this late
+static constexpr const std::chrono::milliseconds POLL_SLICE( 100 );
+/// Time between SIGTERM and SIGKILL when a process is cancelled
+static constexpr const std::chrono::seconds CANCEL_GRACE( 3 );
+
+#if defined( __GLIBC__ ) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 29 ) )
+#define HAVE_SPAWN_ADDCHDIR
+#endif
 
 /** @brief Descend from directory, always relative
  *
@@ -95,6 +129,544 @@ namespace Calamares
 namespace Utils
 {
 
+struct RunningProcess::State
+{
+    // Written before the I/O thread starts, then read-only
+    QString program;  ///< For logging
+    pid_t pid = -1;
+    std::shared_ptr< ChrootHelper > helper;  ///< Set if the helper started the process
+    std::chrono::milliseconds timeout { 0 };
+    Runner::ChunkCallback chunkCallback;
+    Runner::LineCallback lineCallback;
+    std::function< void() > finishedCallback;  ///< Called from the I/O thread, after finishing
+    QByteArray input;
+
+    std::atomic< bool > cancelled { false };
+
+    mutable std::mutex mutex;  ///< Guards the fields below
+    mutable std::condition_variable finishedCondition;
+    bool finished = false;
+    ProcessResult result { ProcessResult::Code::FailedToStart };
+    ProcessUsage usage;
+};
+
+RunningProcess::RunningProcess()
+    : RunningProcess( std::make_shared< State >() )
+{
+    m_state->finished = true;
+}
+
+RunningProcess::RunningProcess( std::shared_ptr< State > state )
+    : m_state( std::move( state ) )
+{
+}
+
+qint64
+RunningProcess::pid() const
+{
+    return m_state->pid;
+}
+
+bool
+RunningProcess::isFinished() const
+{
+    std::lock_guard< std::mutex > lock( m_state->mutex );
+    return m_state->finished;
+}
+
+ProcessResult
+RunningProcess::wait() const
+{
+    std::unique_lock< std::mutex > lock( m_state->mutex );
+    m_state->finishedCondition.wait( lock, [ this ]() { return m_state->finished; } );
+    return m_state->result;
+}
+
+bool
+RunningProcess::waitFor( std::chrono::milliseconds timeout ) const
+{
+    std::unique_lock< std::mutex > lock( m_state->mutex );
+    return m_state->finishedCondition.wait_for( lock, timeout, [ this ]() { return m_state->finished; } );
+}
+
+void
+RunningProcess::cancel()
+{
+    // The I/O thread sends the signals, since it is the one that reaps the process
+    m_state->cancelled = true;
+}
+
+ProcessResult
+RunningProcess::result() const
+{
+    std::lock_guard< std::mutex > lock( m_state->mutex );
+    return m_state->result;
+}
+
+ProcessUsage
+RunningProcess::usage() const
+{
+    std::lock_guard< std::mutex > lock( m_state->mutex );
+    return m_state->usage;
+}
+
+}  // namespace Utils
+}  // namespace Calamares
+
+namespace
+{
+using Calamares::Utils::ProcessResult;
+using Calamares::Utils::ProcessUsage;
+using State = Calamares::Utils::RunningProcess::State;
+
+/** @brief The environment for child processes
+ *
+ * This is the environment of Calamares, with LC_ALL=C so we don't
+ * get issues with translation. Settings for /tmp/ in the host
+ * make no sense in the target, so those are dropped there.
+ */
+std::vector< std::string >
+child_environment( bool inTarget )
+{
+    std::vector< std::string > env;
+    for ( char** e = environ; e && *e; ++e )
+    {
+        const std::string_view entry( *e );
+        const auto name = entry.substr( 0, entry.find( '=' ) );
+        if ( name == "LC_ALL"
+             || ( inTarget && ( name == "TEMP" || name == "TEMPDIR" || name == "TMP" || name == "TMPDIR" ) ) )
+        {
+            continue;
+        }
+        env.emplace_back( entry );
+    }
+    env.emplace_back( "LC_ALL=C" );
+    return env;
+}
+
+/// @brief Null-terminated array of pointers into @p strings, for exec
+std::vector< char* >
+c_array( std::vector< std::string >& strings )
+{
+    std::vector< char* > a;
+    a.reserve( strings.size() + 1 );
+    for ( auto& s : strings )
+    {
+        a.push_back( s.data() );
+    }
+    a.push_back( nullptr );
+    return a;
+}
+
+/** @brief Finds @p program in the PATH of @p env, inside @p root
+ *
+ * Without a PATH in @p env, the usual bin directories are searched.
+ * Returns the path inside @p root, or an empty string.
+ */
+std::string
+find_in_target( const QString& root, const QString& program, const std::vector< std::string >& env )
+{
+    if ( program.contains( '/' ) )
+    {
+        return program.toStdString();
+    }
+    QStringList dirs;
+    for ( const auto& e : env )
+    {
+        if ( e.rfind( "PATH=", 0 ) == 0 )
+        {
+            dirs = QString::fromStdString( e.substr( 5 ) ).split( ':', Qt::SkipEmptyParts );
+        }
+    }
+    if ( dirs.isEmpty() )
+    {
+        dirs = QStringList { "/usr/local/sbin", "/usr/local/bin", "/usr/sbin", "/usr/bin", "/sbin", "/bin" };
+    }
+    for ( const auto& dir : std::as_const( dirs ) )
+    {
+        if ( !dir.startsWith( '/' ) )
+        {
+            continue;  // Relative to the working directory, not useful in the target
+        }
+        const QString path = dir + '/' + program;
+        const QFileInfo fi( root + path );
+        // An absolute symlink points into the target, so QFileInfo can't check it from the host
+        if ( fi.isSymLink() || ( fi.isFile() && fi.isExecutable() ) )
+        {
+            return path.toStdString();
+        }
+    }
+    return std::string();
+}
+
+/** @brief Starts the process with fork(2)
+ *
+ * This is needed for chroot(2), which posix_spawn() cannot do. The
+ * child only makes async-signal-safe calls; everything it needs
+ * is prepared beforehand. Exec failures are reported through a
+ * close-on-exec pipe. Returns the pid, or -1 with @p error set.
+ */
+pid_t
+fork_child( const char* root,
+            const char* directory,
+            const char* path,
+            char* const argv[],
+            char* const envp[],
+            int stdinFd,
+            int outputFd,
+            int& error )
+{
+    int errorPipe[ 2 ];
+    if ( pipe2( errorPipe, O_CLOEXEC ) != 0 )
+    {
+        error = errno;
+        return -1;
+    }
+
+    const pid_t pid = fork();
+    if ( pid == 0 )
+    {
+        int e = 0;
+        signal( SIGPIPE, SIG_DFL );
+        if ( dup2( stdinFd, STDIN_FILENO ) < 0 || dup2( outputFd, STDOUT_FILENO ) < 0
+             || dup2( outputFd, STDERR_FILENO ) < 0 || ( root && chroot( root ) != 0 )
+             || ( directory && chdir( directory ) != 0 ) )
+        {
+            e = errno;
+        }
+        else
+        {
+            execve( path, argv, envp );
+            e = errno;
+        }
+        ( void )!write( errorPipe[ 1 ], &e, sizeof( e ) );
+        _exit( 127 );
+    }
+
+    error = pid < 0 ? errno : 0;
+    close( errorPipe[ 1 ] );
+    if ( pid > 0 )
+    {
+        int e = 0;
+        ssize_t r;
+        do
+        {
+            r = read( errorPipe[ 0 ], &e, sizeof( e ) );
+        } while ( r < 0 && errno == EINTR );
+        if ( r == sizeof( e ) )
+        {
+            // The child did not get to exec
+            int status;
+            waitpid( pid, &status, 0 );
+            error = e;
+            close( errorPipe[ 0 ] );
+            return -1;
+        }
+    }
+    close( errorPipe[ 0 ] );
+    return pid;
+}
+
+/** @brief Starts the process with posix_spawn(3), searching PATH
+ *
+ * Returns the pid, or -1 with @p error set.
+ */
+pid_t
+spawn_child( const char* directory, char* const argv[], char* const envp[], int stdinFd, int outputFd, int& error )
+{
+#ifndef HAVE_SPAWN_ADDCHDIR
+    if ( directory )
+    {
+        const QString program = QString::fromLocal8Bit( argv[ 0 ] );
+        const QString path = program.contains( '/' ) ? program : QStandardPaths::findExecutable( program );
+        if ( path.isEmpty() )
+        {
+            error = ENOENT;
+            return -1;
+        }
+        return fork_child( nullptr, directory, path.toLocal8Bit().constData(), argv, envp, stdinFd, outputFd, error );
+    }
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_adddup2( &actions, stdinFd, STDIN_FILENO );
+    posix_spawn_file_actions_adddup2( &actions, outputFd, STDOUT_FILENO );
+    posix_spawn_file_actions_adddup2( &actions, outputFd, STDERR_FILENO );
+#ifdef HAVE_SPAWN_ADDCHDIR
+    if ( directory )
+    {
+        posix_spawn_file_actions_addchdir_np( &actions, directory );
+    }
+#endif
+
+    // Whatever Calamares does with SIGPIPE, the process gets the default
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init( &attributes );
+    sigset_t sigpipe;
+    sigemptyset( &sigpipe );
+    sigaddset( &sigpipe, SIGPIPE );
+    posix_spawnattr_setsigdefault( &attributes, &sigpipe );
+    posix_spawnattr_setflags( &attributes, POSIX_SPAWN_SETSIGDEF );
+
+    pid_t pid = -1;
+    error = posix_spawnp( &pid, argv[ 0 ], &actions, &attributes, argv, envp );
+    posix_spawnattr_destroy( &attributes );
+    posix_spawn_file_actions_destroy( &actions );
+    return error ? -1 : pid;
+}
+
+/// @brief Delivers a chunk of output to the callbacks, or collects it
+void
+deliver( State& state, const char* data, std::size_t length, std::string& partialLine, QByteArray& collected )
+{
+    if ( !state.chunkCallback && !state.lineCallback )
+    {
+        collected.append( data, static_cast< int >( length ) );
+        return;
+    }
+    if ( state.chunkCallback )
+    {
+        state.chunkCallback( data, length );
+    }
+    if ( !state.lineCallback )
+    {
+        return;
+    }
+
+    std::string_view chunk( data, length );
+    for ( auto newline = chunk.find( '\n' ); newline != std::string_view::npos; newline = chunk.find( '\n' ) )
+    {
+        const auto line = chunk.substr( 0, newline + 1 );
+        if ( partialLine.empty() )
+        {
+            state.lineCallback( line );
+        }
+        else
+        {
+            partialLine.append( line );
+            state.lineCallback( partialLine );
+            partialLine.clear();
+        }
+        chunk.remove_prefix( newline + 1 );
+    }
+    partialLine.append( chunk );
+}
+
+/** @brief Reaps the process, filling in the status and usage
+ *
+ * Returns @c false if the process has not exited (with WNOHANG in @p options).
+ */
+bool
+reap( State& state, int options, int& status, ProcessUsage& usage )
+{
+    if ( state.helper )
+    {
+        return state.helper->wait( state.pid, !( options & WNOHANG ), status, usage );
+    }
+
+    struct rusage ru;
+    pid_t r;
+    do
+    {
+        r = wait4( state.pid, &status, options, &ru );
+    } while ( r < 0 && errno == EINTR );
+    if ( r == 0 )
+    {
+        return false;
+    }
+    if ( r < 0 )
+    {
+        // Reaped by someone else; nothing to report
+        status = -1;
+        return true;
+    }
+
+    using std::chrono::microseconds;
+    using std::chrono::seconds;
+    usage.userTime = seconds( ru.ru_utime.tv_sec ) + microseconds( ru.ru_utime.tv_usec );
+    usage.systemTime = seconds( ru.ru_stime.tv_sec ) + microseconds( ru.ru_stime.tv_usec );
+    usage.maxResidentKiB = ru.ru_maxrss;
+    usage.blocksRead = ru.ru_inblock;
+    usage.blocksWritten = ru.ru_oublock;
+    return true;
+}
+
+/// @brief Sends signal @p sig to the process, wherever it was started
+void
+signal_process( State& state, int sig )
+{
+    if ( state.helper )
+    {
+        state.helper->signal( state.pid, sig );
+    }
+    else
+    {
+        kill( state.pid, sig );
+    }
+}
+
+/** @brief The I/O thread of a process
+ *
+ * Writes the input, reads the output, handles timeout and
+ * cancellation, and finally reaps the process.
+ */
+void
+process_io( std::shared_ptr< State > state, int inputFd, int outputFd )
+{
+    // Don't die of SIGPIPE when the process does not read all its input. The
+    // signal is blocked in this thread only, so write() fails with EPIPE instead.
+    sigset_t sigpipe;
+    sigemptyset( &sigpipe );
+    sigaddset( &sigpipe, SIGPIPE );
+    pthread_sigmask( SIG_BLOCK, &sigpipe, nullptr );
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    const auto deadline
+        = state->timeout > std::chrono::milliseconds::zero() ? start + state->timeout : Clock::time_point::max();
+    auto killAt = Clock::time_point::max();
+    bool timedOut = false;
+    bool terminated = false;
+    bool reaped = false;
+    int status = 0;
+    ProcessUsage usage;
+
+    std::string partialLine;
+    QByteArray collected;
+    std::vector< char > buffer( 65536 );
+    std::size_t inputWritten = 0;
+    if ( state->input.isEmpty() )
+    {
+        close( inputFd );
+        inputFd = -1;
+    }
+    else
+    {
+        // A full pipe must not block the loop, or the output is never read
+        fcntl( inputFd, F_SETFL, fcntl( inputFd, F_GETFL ) | O_NONBLOCK );
+    }
+
+    while ( outputFd >= 0 )
+    {
+        pollfd fds[ 2 ] = { { outputFd, POLLIN, 0 }, { inputFd, POLLOUT, 0 } };
+        const int n = poll( fds, inputFd >= 0 ? 2 : 1, static_cast< int >( POLL_SLICE.count() ) );
+        if ( n < 0 && errno != EINTR )
+        {
+            break;
+        }
+
+        if ( n > 0 && inputFd >= 0 && fds[ 1 ].revents )
+        {
+            const ssize_t w
+                = write( inputFd, state->input.constData() + inputWritten, state->input.size() - inputWritten );
+            if ( w > 0 )
+            {
+                inputWritten += w;
+            }
+            else if ( w < 0 && errno == EPIPE )
+            {
+                // Take the pending SIGPIPE, so it isn't delivered later
+                const timespec noWait { 0, 0 };
+                sigtimedwait( &sigpipe, nullptr, &noWait );
+            }
+            if ( ( w < 0 && errno != EINTR && errno != EAGAIN )
+                 || inputWritten >= static_cast< std::size_t >( state->input.size() ) )
+            {
+                close( inputFd );
+                inputFd = -1;
+            }
+        }
+        if ( n > 0 && fds[ 0 ].revents )
+        {
+            const ssize_t r = read( outputFd, buffer.data(), buffer.size() );
+            if ( r > 0 )
+            {
+                deliver( *state, buffer.data(), r, partialLine, collected );
+            }
+            else if ( r == 0 || ( errno != EINTR && errno != EAGAIN ) )
+            {
+                break;
+            }
+        }
+        if ( n == 0 && reap( *state, WNOHANG, status, usage ) )
+        {
+            // Exited, but something else holds the output open; take what's there.
+            reaped = true;
+            fcntl( outputFd, F_SETFL, O_NONBLOCK );
+            ssize_t r;
+            while ( ( r = read( outputFd, buffer.data(), buffer.size() ) ) > 0 )
+            {
+                deliver( *state, buffer.data(), r, partialLine, collected );
+            }
+            break;
+        }
+
+        const auto now = Clock::now();
+        if ( !timedOut && now >= deadline )
+        {
+            timedOut = true;
+            signal_process( *state, SIGKILL );
+        }
+        if ( state->cancelled && !terminated )
+        {
+            terminated = true;
+            signal_process( *state, SIGTERM );
+            killAt = now + CANCEL_GRACE;
+        }
+        if ( now >= killAt )
+        {
+            killAt = Clock::time_point::max();
+            signal_process( *state, SIGKILL );
+        }
+    }
+    if ( inputFd >= 0 )
+    {
+        close( inputFd );
+    }
+    close( outputFd );
+    if ( !reaped )
+    {
+        reap( *state, 0, status, usage );
+    }
+    // Only the I/O thread uses it; don't keep the helper (and the target) busy any longer
+    state->helper.reset();
+    if ( !partialLine.empty() && state->lineCallback )
+    {
+        state->lineCallback( partialLine );
+    }
+
+    ProcessResult result( ProcessResult::Code::Crashed );
+    if ( timedOut )
+    {
+        cWarning() << "Process" << state->program << "timed out after" << state->timeout.count() << "ms.";
+        result = ProcessResult::Code::TimedOut;
+    }
+    else if ( status >= 0 && WIFEXITED( status ) )
+    {
+        result = ProcessResult( WEXITSTATUS( status ), QString::fromLocal8Bit( collected ).trimmed() );
+    }
+
+    {
+        std::lock_guard< std::mutex > lock( state->mutex );
+        state->result = result;
+        state->usage = usage;
+        state->finished = true;
+        state->finishedCondition.notify_all();
+    }
+    if ( state->finishedCallback )
+    {
+        state->finishedCallback();
+    }
+}
+
+}  // namespace
+
+namespace Calamares
+{
+namespace Utils
+{
+
 Runner::Runner() {}
 
 }  // namespace Utils
@@ -107,121 +679,193 @@ Calamares::Utils::Runner::Runner( const QStringList& command )
 
 Calamares::Utils::Runner::~Runner() {}
 
-Calamares::Utils::ProcessResult
-Calamares::Utils::Runner::run()
+Calamares::Utils::RunningProcess
+Calamares::Utils::Runner::start()
+{
+    return startProcess( m_chunkCallback, m_lineCallback, nullptr );
+}
+
+Calamares::Utils::RunningProcess
+Calamares::Utils::Runner::startProcess( ChunkCallback chunks, LineCallback lines, std::function< void() > finished )
 {
     if ( m_command.isEmpty() )
     {
         cWarning() << "Cannot run an empty program list";
-        return ProcessResult::Code::FailedToStart;
+        return RunningProcess();
     }
 
     auto [ ok, workingDirectory ] = calculateWorkingDirectory( m_location, m_directory );
     if ( !ok || !workingDirectory.exists() )
     {
         // Warnings have already been printed
-        return ProcessResult::Code::NoWorkingDirectory;
+        RunningProcess p;
+        p.m_state->result = ProcessResult::Code::NoWorkingDirectory;
+        return p;
     }
 
-    QProcess process;
-    // Make the process run in "C" locale so we don't get issues with translation
+    const bool inTarget = m_location == RunLocation::RunInTarget;
+    std::string root;
+    std::string directory;
+    if ( inTarget )
     {
-        auto env = QProcessEnvironment::systemEnvironment();
-        env.insert( "LC_ALL", "C" );
-        // No guarantees that host settings for /tmp/ make sense in target
-        if ( m_location == RunLocation::RunInTarget )
-        {
-            env.remove( "TEMP" );
-            env.remove( "TEMPDIR" );
-            env.remove( "TMP" );
-            env.remove( "TMPDIR" );
-        }
-        process.setProcessEnvironment( env );
+        // calculateWorkingDirectory() has checked that this exists
+        const QString rootMountPoint
+            = Calamares::JobQueue::instance()->globalStorage()->value( "rootMountPoint" ).toString();
+        root = QDir( rootMountPoint ).absolutePath().toStdString();
+        directory = ( '/' + QDir( rootMountPoint ).relativeFilePath( workingDirectory.absolutePath() ) ).toStdString();
     }
-    process.setProcessChannelMode( QProcess::MergedChannels );
-    if ( !m_directory.isEmpty() )
+    else if ( !m_directory.isEmpty() )
     {
-        process.setWorkingDirectory( workingDirectory.absolutePath() );
+        directory = workingDirectory.absolutePath().toStdString();
     }
-    if ( m_location == RunLocation::RunInTarget )
+
+    std::vector< std::string > args;
+    for ( const auto& a : m_command )
     {
-        process.setProgram( "chroot" );
-        process.setArguments( QStringList { workingDirectory.absolutePath() } << m_command );
+        args.push_back( a.toStdString() );
     }
-    else
+    std::vector< std::string > env = child_environment( inTarget );
+    auto argv = c_array( args );
+    auto envp = c_array( env );
+
+    auto state = std::make_shared< RunningProcess::State >();
+    state->program = m_command.first();
+    state->timeout = m_timeout;
+    state->chunkCallback = std::move( chunks );
+    state->lineCallback = std::move( lines );
+    state->finishedCallback = std::move( finished );
+    state->input = m_input.toLocal8Bit();
+
+    int inputPipe[ 2 ];
+    int outputPipe[ 2 ];
+    if ( pipe2( inputPipe, O_CLOEXEC ) != 0 )
     {
-        process.setProgram( "env" );
-        process.setArguments( m_command );
+        cWarning() << "Process" << m_command.first() << "failed to start, no pipes:" << strerror( errno );
+        return RunningProcess();
     }
-
-    if ( m_output )
+    if ( pipe2( outputPipe, O_CLOEXEC ) != 0 )
     {
-        connect( &process,
-                 &QProcess::readyReadStandardOutput,
-                 [ this, &process ]()
-                 {
-                     do
-                     {
-                         QString s = process.readLine();
-                         if ( !s.isEmpty() )
-                         {
-                             Q_EMIT this->output( s );
-                         }
-                     } while ( process.canReadLine() );
-                 } );
+        cWarning() << "Process" << m_command.first() << "failed to start, no pipes:" << strerror( errno );
+        close( inputPipe[ 0 ] );
+        close( inputPipe[ 1 ] );
+        return RunningProcess();
     }
 
     cDebug() << Logger::SubEntry << "Running" << Logger::RedactedCommand( m_command );
-    process.start();
-    if ( !process.waitForStarted() )
+    int error = 0;
+    auto helper = inTarget ? ChrootHelper::instance( root ) : nullptr;
+    if ( helper )
     {
-        cWarning() << "Process" << m_command.first() << "failed to start" << process.error();
-        return ProcessResult::Code::FailedToStart;
+        state->pid = helper->spawn( directory, argv.data(), envp.data(), inputPipe[ 0 ], outputPipe[ 1 ], error );
+        state->helper = helper;
     }
-
-    if ( !m_input.isEmpty() )
+    else if ( inTarget )
+    {
+        const std::string path = find_in_target( QString::fromStdString( root ), m_command.first(), env );
+        if ( path.empty() )
+        {
+            error = ENOENT;
+        }
+        else
+        {
+            state->pid = fork_child( root.c_str(),
+                                     directory.c_str(),
+                                     path.c_str(),
+                                     argv.data(),
+                                     envp.data(),
+                                     inputPipe[ 0 ],
+                                     outputPipe[ 1 ],
+                                     error );
+        }
+    }
+    else
     {
-        process.write( m_input.toLocal8Bit() );
+        state->pid = spawn_child( directory.empty() ? nullptr : directory.c_str(),
+                                  argv.data(),
+                                  envp.data(),
+                                  inputPipe[ 0 ],
+                                  outputPipe[ 1 ],
+                                  error );
     }
-    process.closeWriteChannel();
+    close( inputPipe[ 0 ] );
+    close( outputPipe[ 1 ] );
 
-    if ( !process.waitForFinished( m_timeout > std::chrono::seconds::zero()
-                                       ? ( static_cast< int >( std::chrono::milliseconds( m_timeout ).count() ) )
-                                       : -1 ) )
+    if ( state->pid < 0 )
     {
-        cWarning() << "Process" << m_command.first() << "timed out after" << m_timeout.count() << "ms."
-                   << Logger::NoQuote << "Output so far:\n"
-                   << process.readAllStandardOutput();
-        return ProcessResult::Code::TimedOut;
+        cWarning() << "Process" << m_command.first() << "failed to start:" << strerror( error );
+        close( inputPipe[ 1 ] );
+        close( outputPipe[ 0 ] );
+        return RunningProcess();
     }
 
-    QString output = m_output ? QString() : QString::fromLocal8Bit( process.readAllStandardOutput() ).trimmed();
+    std::thread( process_io, state, inputPipe[ 1 ], outputPipe[ 0 ] ).detach();
+    return RunningProcess( state );
+}
+
+Calamares::Utils::ProcessResult
+Calamares::Utils::Runner::run()
+{
+    // Lines are handed from the I/O thread to this one, so output() is emitted here
+    struct Lines
+    {
+        std::mutex mutex;
+        std::condition_variable available;
+        std::deque< QString > lines;
+        bool done = false;
+    };
+    auto lines = std::make_shared< Lines >();
+
+    LineCallback lineCallback;
     if ( m_output )
     {
-        // Try to read trailing output, if any
-        do
+        lineCallback = [ lines ]( std::string_view line )
         {
-            output = process.readLine();
-            if ( !output.isEmpty() )
+            std::lock_guard< std::mutex > lock( lines->mutex );
+            lines->lines.push_back( QString::fromLocal8Bit( line.data(), static_cast< int >( line.size() ) ) );
+            lines->available.notify_one();
+        };
+    }
+    auto process = startProcess( nullptr,
+                                 lineCallback,
+                                 [ lines ]()
+                                 {
+                                     std::lock_guard< std::mutex > lock( lines->mutex );
+                                     lines->done = true;
+                                     lines->available.notify_one();
+                                 } );
+
+    if ( m_output && process.pid() > 0 )
+    {
+        std::unique_lock< std::mutex > lock( lines->mutex );
+        while ( true )
+        {
+            lines->available.wait( lock, [ &lines ]() { return lines->done || !lines->lines.empty(); } );
+            if ( lines->lines.empty() )
             {
-                Q_EMIT this->output( output );
+                break;
             }
-        } while ( !output.isEmpty() );
-        output = process.readAllStandardOutput();
-        if ( !output.isEmpty() )
-        {
-            cWarning() << "Some process output left-over";
-            Q_EMIT this->output( output );
+            const QString line = std::move( lines->lines.front() );
+            lines->lines.pop_front();
+            lock.unlock();
+            Q_EMIT this->output( line );
+            lock.lock();
         }
     }
 
-    if ( process.exitStatus() == QProcess::CrashExit )
+    const auto result = process.wait();
+    const auto r = result.getExitCode();
+    const auto& output = result.getOutput();
+    if ( r == static_cast< int >( ProcessResult::Code::Crashed ) )
     {
         cWarning() << "Process" << m_command.first() << "crashed." << Logger::NoQuote << "Output so far:\n" << output;
-        return ProcessResult::Code::Crashed;
+        return result;
+    }
+    if ( r < 0 )
+    {
+        // Failed to start, or timed out; warnings have already been printed
+        return result;
     }
 
-    auto r = process.exitCode();
     const bool showDebug = ( !Calamares::Settings::instance() ) || ( Calamares::Settings::instance()->debugMode() );
     if ( r == 0 )
     {
@@ -244,5 +888,5 @@ Calamares::Utils::Runner::run()
                      << "(no output)";
         }
     }
-    return ProcessResult( r, output );
+    return result;
 }
@@ -18,8 +18,10 @@
 #include <QStringList>
 
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <string_view>
 
 namespace Calamares
 {
@@ -29,26 +31,98 @@ namespace Utils
 using RunLocation = Calamares::System::RunLocation;
 using ProcessResult = Calamares::ProcessResult;
 
+/** @brief CPU and I/O used by a finished process
+ *
+ * This is the resource usage reported by wait4(2) for the process
+ * itself and its waited-for children.
+ */
+struct ProcessUsage
+{
+    std::chrono::microseconds userTime { 0 };
+    std::chrono::microseconds systemTime { 0 };
+    long maxResidentKiB = 0;
+    long blocksRead = 0;  ///< Filesystem input operations
+    long blocksWritten = 0;  ///< Filesystem output operations
+};
+
+/** @brief Handle to a process started by Runner::start()
+ *
+ * Handles are cheap to copy; all copies refer to the same process.
+ * The process keeps running (and its output keeps being delivered)
+ * when all handles are gone.
+ */
+class DLLEXPORT RunningProcess
+{
+public:
+    /// @brief A handle to nothing, which is finished and failed to start
+    RunningProcess();
+
+    /// @brief Process id, or -1 if the process could not be started
+    qint64 pid() const;
+
+    bool isFinished() const;
+    /// @brief Waits until the process is done, and returns its result
+    ProcessResult wait() const;
+    /// @brief Waits at most @p timeout, returns @c true if the process is done
+    bool waitFor( std::chrono::milliseconds timeout ) const;
+
+    /** @brief Asks the process to stop
+     *
+     * The process gets SIGTERM, and SIGKILL if it has not stopped after
+     * a few seconds. It then ends with ProcessResult::Code::Crashed
+     * (unless it exits normally on SIGTERM).
+     */
+    void cancel();
+
+    /// @brief The result; only meaningful once the process is finished
+    ProcessResult result() const;
+    /// @brief The resources used; only meaningful once the process is finished
+    ProcessUsage usage() const;
+
+    struct State;
+
+private:
+    friend class Runner;
+    explicit RunningProcess( std::shared_ptr< State > state );
+
+    std::shared_ptr< State > m_state;
+};
+
 /** @brief A Runner wraps a process and handles running it and processing output
  *
- * This is basically a QProcess, but handles both running in the
- * host system (through env(1)) or in the target (by calling chroot(8)).
- * It has an output signal that handles output one line at a time
- * (unlike QProcess that lets you do the buffering yourself).
- * This output processing is only enabled if you do so explicitly.
+ * This handles both running in the host system and in the target
+ * (chrooted into the rootMountPoint). Processes are started directly
+ * with posix_spawn(3) or fork(2), without a wrapper process.
+ * There are two ways of running:
+ *  - run() blocks until the process is done; it has an output signal
+ *    that handles output one line at a time. This output processing
+ *    is only enabled if you do so explicitly.
+ *  - start() returns a RunningProcess right away. The output is
+ *    delivered to callbacks, as raw chunks or as lines, from a
+ *    background thread. Several processes can run at once.
  *
  * Use the set*() methods to configure the runner.
  *
  * If you call enableOutputProcessing(), then you can connect to
  * the output() signal to receive each line (including trailing newline!).
  *
- * Processes are always run with LC_ALL and LANG set to "C".
+ * Processes are always run with LC_ALL set to "C".
  */
 class DLLEXPORT Runner : public QObject
 {
     Q_OBJECT
 
 public:
+    /// @brief Receives raw output (stdout and stderr, merged)
+    using ChunkCallback = std::function< void( const char* data, std::size_t length ) >;
+    /** @brief Receives output one line at a time
+     *
+     * The line includes its trailing newline, except maybe the last one.
+     * The view is only valid during the call; it points into the read
+     * buffer when possible, so lines are not copied.
+     */
+    using LineCallback = std::function< void( std::string_view line ) >;
+
     /** @brief Create an empty runner
      *
      * This is a runner with no commands, nothing; call set*() methods
@@ -105,7 +179,38 @@ public:
         return *this;
     }
 
+    /** @brief Set a callback for raw output, for start()
+     *
+     * If any callback is set, the output is not collected
+     * in the ProcessResult.
+     */
+    Runner& setChunkCallback( ChunkCallback f )
+    {
+        m_chunkCallback = std::move( f );
+        return *this;
+    }
+    /// @brief Set a callback for lines of output, for start()
+    Runner& setLineCallback( LineCallback f )
+    {
+        m_lineCallback = std::move( f );
+        return *this;
+    }
+
+    /** @brief Runs the command and waits for it to finish
+     *
+     * If output processing is enabled, the output() signal is emitted
+     * for each line, from the calling thread. Otherwise the (trimmed)
+     * output is in the returned ProcessResult.
+     */
     ProcessResult run();
+
+    /** @brief Starts the command, and returns right away
+     *
+     * Callbacks are called from a thread belonging to the process.
+     * Output processing (and the output() signal) is not used.
+     */
+    RunningProcess start();
+
     /** @brief The executable (argv[0]) that this runner will run
      *
      * This is the first element of the command; it does not include
@@ -118,6 +223,8 @@ signals:
     void output( QString line );
 
 private:
+    RunningProcess startProcess( ChunkCallback chunks, LineCallback lines, std::function< void() > finished );
+
     // What to run, and where.
     QStringList m_command;
     QString m_directory;
@@ -127,6 +234,8 @@ private:
     QString m_input;
     std::chrono::milliseconds m_timeout { 0 };
     bool m_output = false;
+    ChunkCallback m_chunkCallback;
+    LineCallback m_lineCallback;
 };
 
 }  // namespace Utils
@@ -31,6 +31,9 @@
 
 #include <QtTest/QtTest>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 #include <fcntl.h>
@@ -47,9 +50,12 @@ public:
 private Q_SLOTS:
     void initTestCase();
     void testDebugLevels();
+    void testModuleDebugLevels();
+    void testRecentRecords();
 
     void testLoadSaveYaml();  // Just settings.conf
     void testLoadSaveYamlExtended();  // Do a find() in the src dir
+    void testLoadCachedYaml();
 
     /** @section Test running commands and command-expansion. */
     void testCommands();
@@ -98,6 +104,7 @@ private Q_SLOTS:
     void testRunnerDirs();
     void testCalculateWorkingDirectory();
     void testRunnerOutput();
+    void testRunnerAsync();
 
     /** @section Test file-functions */
     void testReadWriteFile();
@@ -145,6 +152,93 @@ LibCalamaresTests::testDebugLevels()
     }
 }
 
+void
+LibCalamaresTests::testModuleDebugLevels()
+{
+    // Put the levels back for the other tests, also if a check fails
+    struct RestoreLevels
+    {
+        unsigned int level = Logger::logLevel();
+        ~RestoreLevels()
+        {
+            Logger::clearModuleLogLevels();
+            Logger::setupLogLevel( level );
+        }
+    } restore;
+
+    Logger::setupLogLevel( Logger::LOGWARNING );
+    Logger::setupModuleLogLevel( QStringLiteral( "partition" ), Logger::LOGVERBOSE );
+    Logger::setupModuleLogLevel( QStringLiteral( "shellprocess@quiet" ), Logger::LOGERROR );
+
+    QVERIFY( !Logger::logLevelEnabled( Logger::LOGDEBUG ) );
+    {
+        Logger::ModuleScope scope( QStringLiteral( "partition@partition" ) );
+        QVERIFY( Logger::logLevelEnabled( Logger::LOGVERBOSE ) );
+        {
+            // Instance key, no module-name setting: the global level
+            Logger::ModuleScope inner( QStringLiteral( "shellprocess@loud" ) );
+            QVERIFY( Logger::logLevelEnabled( Logger::LOGWARNING ) );
+            QVERIFY( !Logger::logLevelEnabled( Logger::LOGDEBUG ) );
+        }
+        {
+            Logger::ModuleScope inner( QStringLiteral( "shellprocess@quiet" ) );
+            QVERIFY( Logger::logLevelEnabled( Logger::LOGERROR ) );
+            QVERIFY( !Logger::logLevelEnabled( Logger::LOGWARNING ) );
+        }
+        QVERIFY( Logger::logLevelEnabled( Logger::LOGVERBOSE ) );
+        QCOMPARE( Logger::currentModule(), QStringLiteral( "partition@partition" ) );
+
+        // Another thread takes the module along
+        const QString module = Logger::currentModule();
+        bool verbose = false;
+        std::thread(
+            [ module, &verbose ]
+            {
+                Logger::ModuleScope threadScope( module );
+                verbose = Logger::logLevelEnabled( Logger::LOGVERBOSE );
+            } )
+            .join();
+        QVERIFY( verbose );
+    }
+    QVERIFY( Logger::currentModule().isEmpty() );
+    QVERIFY( !Logger::logLevelEnabled( Logger::LOGDEBUG ) );
+    QVERIFY( Logger::logLevelEnabled( Logger::LOGWARNING ) );
+}
+
+void
+LibCalamaresTests::testRecentRecords()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+    Logger::flush();
+    const auto before = Logger::recentRecords();
+    const quint64 last = before.isEmpty() ? 0 : before.last().sequence;
+
+    std::atomic< int > notified { 0 };
+    const int listener = Logger::addRecordListener( [ &notified ]() { notified++; } );
+    {
+        Logger::ModuleScope scope( QStringLiteral( "recent@test" ) );
+        cDebug() << "Recent record";
+        cWarning() << "Recent warning";
+    }
+    Logger::flush();
+    Logger::removeRecordListener( listener );
+    QVERIFY( notified > 0 );
+
+    const auto records = Logger::recentRecords( last );
+    QCOMPARE( records.count(), 2 );
+    QCOMPARE( records[ 0 ].sequence, last + 1 );
+    QCOMPARE( records[ 0 ].level, static_cast< unsigned int >( Logger::LOGDEBUG ) );
+    QCOMPARE( records[ 0 ].module, QStringLiteral( "recent@test" ) );
+    QVERIFY( records[ 0 ].text.contains( QStringLiteral( "Recent record" ) ) );
+    QCOMPARE( records[ 1 ].level, static_cast< unsigned int >( Logger::LOGWARNING ) );
+    QVERIFY( records[ 1 ].text.contains( QStringLiteral( "WARNING: Recent warning" ) ) );
+
+    const int count = notified;
+    cDebug() << "Not heard";
+    Logger::flush();
+    QCOMPARE( int( notified ), count );
+}
+
 void
 LibCalamaresTests::testLoadSaveYaml()
 {
@@ -183,6 +277,46 @@ LibCalamaresTests::testLoadSaveYaml()
     QFile::remove( "out2.yaml" );
 }
 
+void
+LibCalamaresTests::testLoadCachedYaml()
+{
+    QTemporaryDir tempRoot( QDir::tempPath() + QStringLiteral( "/test-yaml-XXXXXX" ) );
+    QVERIFY( tempRoot.isValid() );
+    const QString path = tempRoot.filePath( "cached.conf" );
+    auto write = [ &path ]( const QByteArray& contents )
+    {
+        QFile f( path );
+        QVERIFY( f.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+        f.write( contents );
+    };
+
+    bool ok = false;
+    write( "name: one\nlist: [ 1, 2 ]\n" );
+    auto map = Calamares::YAML::loadCached( path, &ok );
+    QVERIFY( ok );
+    QCOMPARE( map, Calamares::YAML::load( path ) );
+    QCOMPARE( map.value( "name" ).toString(), QStringLiteral( "one" ) );
+    // Same again, from the cache
+    QCOMPARE( Calamares::YAML::loadCached( path, &ok ), map );
+    QVERIFY( ok );
+
+    // A changed file is parsed again
+    write( "name: three\n" );
+    map = Calamares::YAML::loadCached( path, &ok );
+    QVERIFY( ok );
+    QCOMPARE( map.value( "name" ).toString(), QStringLiteral( "three" ) );
+    QVERIFY( !map.contains( "list" ) );
+
+    // Broken or missing files are not remembered
+    write( "name: [ three\n" );
+    map = Calamares::YAML::loadCached( path, &ok );
+    QVERIFY( !ok );
+    QVERIFY( map.isEmpty() );
+    map = Calamares::YAML::loadCached( tempRoot.filePath( "missing.conf" ), &ok );
+    QVERIFY( !ok );
+    QVERIFY( map.isEmpty() );
+}
+
 static QStringList
 findConf( const QDir& d )
 {
@@ -298,6 +432,12 @@ LibCalamaresTests::testCommandExpansion_data()
     // QStringList does not expand
     QTest::newRow( "gs-list" ) << QStringLiteral( "colors ${gs[branding.color]}" )
                                << QStringLiteral( "colors ${gs[branding.color]}" );
+    // Keys with a '.' in Global Storage itself
+    QTest::newRow( "gs-dot" ) << QStringLiteral( "bmaptool copy ${gs[image.name]}" )
+                               << QStringLiteral( "bmaptool copy seapath.wic.gz" );
+    QTest::newRow( "gs-dot2" ) << QStringLiteral( "echo ${gs[image.info.size]}" ) << QStringLiteral( "echo 42" );
+    QTest::newRow( "gs-miss" ) << QStringLiteral( "echo ${gs[branding.cows]}" )
+                               << QStringLiteral( "echo ${gs[branding.cows]}" );
 }
 
 void
@@ -313,6 +453,8 @@ LibCalamaresTests::testCommandExpansion()
     m.insert( QStringLiteral( "ducks" ), 3 );
     m.insert( QStringLiteral( "color" ), QStringList { "green", "red" } );
     gs->insert( QStringLiteral( "branding" ), m );
+    gs->insert( QStringLiteral( "image.name" ), QStringLiteral( "seapath.wic.gz" ) );
+    gs->insert( QStringLiteral( "image.info" ), QVariantMap { { QStringLiteral( "size" ), 42 } } );
 
     QFETCH( QString, command );
     QFETCH( QString, expected );
@@ -1383,6 +1525,82 @@ LibCalamaresTests::testRunnerOutput()
     }
 }
 
+void
+LibCalamaresTests::testRunnerAsync()
+{
+    cDebug() << "Testing concurrent processes";
+    {
+        QStringList lines;
+        std::mutex linesMutex;
+        Calamares::Utils::Runner r( { "sh", "-c", "echo one; sleep 0.2; printf 'two\\nthree'" } );
+        r.setLineCallback(
+            [ & ]( std::string_view line )
+            {
+                std::lock_guard< std::mutex > lock( linesMutex );
+                lines << QString::fromLatin1( line.data(), int( line.size() ) );
+            } );
+
+        auto first = r.start();
+        auto second = r.start();
+        QVERIFY( first.pid() > 0 );
+        QVERIFY( second.pid() > 0 );
+        QVERIFY( first.pid() != second.pid() );
+        // Starting the second did not wait for the first
+        QVERIFY( !first.isFinished() );
+        QVERIFY( !second.isFinished() );
+
+        QCOMPARE( first.wait().getExitCode(), 0 );
+        QCOMPARE( second.wait().getExitCode(), 0 );
+        QCOMPARE( first.result().getOutput(), QString() );  // Not collected, there is a callback
+        QCOMPARE( lines.count(), 6 );
+        QCOMPARE( lines.count( QStringLiteral( "one\n" ) ), 2 );
+        QCOMPARE( lines.count( QStringLiteral( "three" ) ), 2 );  // no newline
+    }
+
+    cDebug() << "Testing chunks and collected output";
+    {
+        QByteArray chunks;
+        Calamares::Utils::Runner r( { "cat" } );
+        r.setInput( QStringLiteral( "hello\nworld" ) );
+        auto collected = r.start().wait();
+        QCOMPARE( collected.getExitCode(), 0 );
+        QCOMPARE( collected.getOutput(), QStringLiteral( "hello\nworld" ) );
+
+        r.setChunkCallback( [ &chunks ]( const char* data, std::size_t length )
+                            { chunks.append( data, int( length ) ); } );
+        QCOMPARE( r.start().wait().getExitCode(), 0 );
+        QCOMPARE( chunks, QByteArray( "hello\nworld" ) );
+    }
+
+    cDebug() << "Testing cancel and usage";
+    {
+        Calamares::Utils::Runner r( { "sleep", "10" } );
+        auto p = r.start();
+        QVERIFY( !p.waitFor( std::chrono::milliseconds( 50 ) ) );
+        p.cancel();
+        QVERIFY( p.waitFor( std::chrono::seconds( 2 ) ) );
+        QCOMPARE( p.result().getExitCode(), int( Calamares::Utils::ProcessResult::Code::Crashed ) );
+
+        Calamares::Utils::Runner busy( { "sh", "-c", "i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done" } );
+        auto b = busy.start();
+        QCOMPARE( b.wait().getExitCode(), 0 );
+        QVERIFY( b.usage().maxResidentKiB > 0 );
+    }
+
+    cDebug() << "Testing failures";
+    {
+        Calamares::Utils::Runner r( { "/nonexistent/program" } );
+        auto p = r.start();
+        QVERIFY( p.isFinished() );
+        QCOMPARE( p.pid(), qint64( -1 ) );
+        QCOMPARE( p.wait().getExitCode(), int( Calamares::Utils::ProcessResult::Code::FailedToStart ) );
+
+        Calamares::Utils::Runner slow( { "sleep", "10" } );
+        slow.setTimeout( std::chrono::seconds( 1 ) );
+        QCOMPARE( slow.run().getExitCode(), int( Calamares::Utils::ProcessResult::Code::TimedOut ) );
+    }
+}
+
 Calamares::System*
 file_setup( const QTemporaryDir& tempRoot )
 {
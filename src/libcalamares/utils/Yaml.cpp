@@ -12,13 +12,21 @@
  */
 #include "Yaml.h"
 
+#include "compat/Mutex.h"
 #include "compat/Variant.h"
 #include "utils/Logger.h"
 
 #include <QByteArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 #include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 void
 operator>>( const ::YAML::Node& node, QStringList& v )
@@ -217,6 +225,175 @@ load( const QString& filename, bool* ok )
     return QVariantMap();
 }
 
+namespace
+{
+constexpr quint32 CACHE_MAGIC = 0x43594d4c;  // "CYML"
+constexpr quint32 CACHE_VERSION = 1;
+
+/// @brief A parsed file, and how to tell that the file did not change since
+struct CachedFile
+{
+    qint64 size = -1;
+    qint64 modified = -1;  ///< Milliseconds since the epoch
+    QVariantMap data;
+    bool used = false;  ///< Loaded in this run; not saved
+};
+
+QDataStream&
+operator<<( QDataStream& s, const CachedFile& f )
+{
+    return s << f.size << f.modified << f.data;
+}
+
+QDataStream&
+operator>>( QDataStream& s, CachedFile& f )
+{
+    return s >> f.size >> f.modified >> f.data;
+}
+
+struct Cache
+{
+    QMutex mutex;
+    QHash< QString, CachedFile > files;  ///< By absolute path
+    bool isRead = false;  ///< The cache file was read
+    bool isChanged = false;  ///< Some file was parsed since
+};
+
+Cache&
+cache()
+{
+    static Cache c;
+    return c;
+}
+
+QString
+cacheFilePath()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + QStringLiteral( "/yaml.cache" );
+}
+
+/// @brief Reads the cache file the first time; call this with the mutex held
+void
+readCacheFile( Cache& c )
+{
+    if ( c.isRead )
+    {
+        return;
+    }
+    c.isRead = true;
+
+    QFile f( cacheFilePath() );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        return;
+    }
+    QDataStream s( &f );
+    s.setVersion( QDataStream::Qt_5_15 );
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 qtVersion = 0;
+    s >> magic >> version >> qtVersion;
+    // QVariant types differ between Qt versions, don't bother
+    if ( magic != CACHE_MAGIC || version != CACHE_VERSION || qtVersion != QT_VERSION_MAJOR )
+    {
+        return;
+    }
+    QHash< QString, CachedFile > files;
+    s >> files;
+    if ( s.status() == QDataStream::Ok )
+    {
+        c.files = files;
+    }
+}
+}  // namespace
+
+QVariantMap
+loadCached( const QString& filename, bool* ok )
+{
+    const QFileInfo fi( filename );
+    if ( !fi.exists() )
+    {
+        return load( filename, ok );
+    }
+    const QString path = fi.absoluteFilePath();
+    const qint64 size = fi.size();
+    const qint64 modified = fi.lastModified().toMSecsSinceEpoch();
+
+    auto& c = cache();
+    {
+        Calamares::MutexLocker lock( &c.mutex );
+        readCacheFile( c );
+        auto it = c.files.find( path );
+        if ( it != c.files.end() && it->size == size && it->modified == modified )
+        {
+            it->used = true;
+            if ( ok )
+            {
+                *ok = true;
+            }
+            return it->data;
+        }
+    }
+
+    // Parse without holding the lock, so that other files can be parsed meanwhile
+    bool loaded = false;
+    const QVariantMap data = load( path, &loaded );
+    if ( loaded )
+    {
+        Calamares::MutexLocker lock( &c.mutex );
+        c.files.insert( path, CachedFile { size, modified, data, true } );
+        c.isChanged = true;
+    }
+    if ( ok )
+    {
+        *ok = loaded;
+    }
+    return data;
+}
+
+void
+saveCache()
+{
+    auto& c = cache();
+    Calamares::MutexLocker lock( &c.mutex );
+
+    // Forget the files that are no longer used, e.g. of removed modules
+    bool dropped = false;
+    for ( auto it = c.files.begin(); it != c.files.end(); )
+    {
+        if ( it->used )
+        {
+            ++it;
+        }
+        else
+        {
+            it = c.files.erase( it );
+            dropped = true;
+        }
+    }
+    if ( !c.isChanged && !dropped )
+    {
+        return;
+    }
+
+    const QString path = cacheFilePath();
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+    QSaveFile f( path );
+    if ( !f.open( QIODevice::WriteOnly ) )
+    {
+        cWarning() << "Could not write the YAML cache" << path;
+        return;
+    }
+    QDataStream s( &f );
+    s.setVersion( QDataStream::Qt_5_15 );
+    s << CACHE_MAGIC << CACHE_VERSION << qint32( QT_VERSION_MAJOR ) << c.files;
+    if ( f.commit() )
+    {
+        c.isChanged = false;
+        cDebug() << "Saved" << c.files.count() << "parsed YAML files to" << path;
+    }
+}
+
 /// @brief Convenience function writes @p indent times four spaces
 static void
 writeIndent( QFile& f, int indent )
@@ -59,6 +59,21 @@ DLLEXPORT QVariantMap load( const QString& filename, bool* ok = nullptr );
 /** Convenience overload. */
 DLLEXPORT QVariantMap load( const QFileInfo&, bool* ok = nullptr );
 
+/** @brief Loads @p filename like load(), parsing it only if it changed
+ *
+ * Parsed files are remembered by path, size and modification time,
+ * also across runs of Calamares: saveCache() writes them to a file
+ * in the cache directory. Files that do not parse are not remembered.
+ * This may be called from several threads at once.
+ */
+DLLEXPORT QVariantMap loadCached( const QString& filename, bool* ok = nullptr );
+/** @brief Writes the files remembered by loadCached() to the cache directory
+ *
+ * Only the files loaded in this run are kept, and nothing is written
+ * if none of them had to be parsed.
+ */
+DLLEXPORT void saveCache();
+
 DLLEXPORT QVariant toVariant( const ::YAML::Node& node );
 DLLEXPORT QVariant scalarToVariant( const ::YAML::Node& scalarNode );
 DLLEXPORT QVariantList sequenceToVariant( const ::YAML::Node& sequenceNode );
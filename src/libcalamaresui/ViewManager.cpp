@@ -15,6 +15,7 @@
 
 #include "Branding.h"
 #include "JobQueue.h"
+#include "PrepareQueue.h"
 #include "Settings.h"
 
 #include "utils/Logger.h"
@@ -267,6 +268,20 @@ stepIsExecute( const ViewStepList& steps, int index )
         && ( qobject_cast< ExecutionViewStep* >( steps.at( index ) ) != nullptr );
 }
 
+/** @brief Arm the prepare queue only right before (or during) an execution step
+ *
+ * By then, the choices made in the view steps are final unless the user
+ * goes back, in which case the queue is disarmed again.
+ */
+static void
+updatePrepareQueue( const ViewStepList& steps, int index )
+{
+    if ( auto* pq = PrepareQueue::instance() )
+    {
+        pq->setArmed( stepIsExecute( steps, index ) || stepIsExecute( steps, index + 1 ) );
+    }
+}
+
 static inline bool
 isAtVeryEnd( const ViewStepList& steps, int index )
 {
@@ -368,6 +383,7 @@ ViewManager::next()
         {
             m_steps.at( m_currentStep )->onActivate();
             executing = qobject_cast< ExecutionViewStep* >( m_steps.at( m_currentStep ) ) != nullptr;
+            updatePrepareQueue( m_steps, m_currentStep );
             emit currentStepChanged();
         }
         else
@@ -466,6 +482,7 @@ ViewManager::back()
         m_stack->setCurrentIndex( m_currentStep );
         step->onLeave();
         m_steps.at( m_currentStep )->onActivate();
+        updatePrepareQueue( m_steps, m_currentStep );
         emit currentStepChanged();
     }
     else if ( !step->isAtBeginning() )
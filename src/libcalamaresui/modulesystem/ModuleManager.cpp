@@ -22,7 +22,9 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QTimer>
+#include <QtConcurrent/QtConcurrent>
 
 namespace Calamares
 {
@@ -68,7 +70,10 @@ ModuleManager::doInit()
     // the module name, and must contain a settings file named module.desc.
     // If at any time the module loading procedure finds something unexpected, it
     // silently skips to the next module or search path. --Teo 6/2014
+    QElapsedTimer timer;
+    timer.start();
     Logger::Once deb;
+    QList< QFileInfo > descriptorFiles;
     for ( const QString& path : m_paths )
     {
         QDir currentDir( path );
@@ -93,28 +98,7 @@ ModuleManager::doInit()
                         cDebug() << deb << bad_descriptor << descriptorFileInfo.absoluteFilePath() << "(unreadable)";
                         continue;
                     }
-
-                    bool ok = false;
-                    QVariantMap moduleDescriptorMap = Calamares::YAML::load( descriptorFileInfo, &ok );
-                    QString moduleName = ok ? moduleDescriptorMap.value( "name" ).toString() : QString();
-
-                    if ( ok && !moduleName.isEmpty() && ( moduleName == currentDir.dirName() )
-                         && !m_availableDescriptorsByModuleName.contains( moduleName ) )
-                    {
-                        auto descriptor = Calamares::ModuleSystem::Descriptor::fromDescriptorData(
-                            moduleDescriptorMap, descriptorFileInfo.absoluteFilePath() );
-                        descriptor.setDirectory( descriptorFileInfo.absoluteDir().absolutePath() );
-                        m_availableDescriptorsByModuleName.insert( moduleName, descriptor );
-                    }
-                    else
-                    {
-                        // Duplicate modules are ok; other issues like empty name or dir-mismatch are reported.
-                        if ( !m_availableDescriptorsByModuleName.contains( moduleName ) )
-                        {
-                            cWarning() << deb << "ModuleManager module descriptor"
-                                       << descriptorFileInfo.absoluteFilePath() << "has bad name" << moduleName;
-                        }
-                    }
+                    descriptorFiles.append( descriptorFileInfo );
                 }
                 else
                 {
@@ -127,9 +111,44 @@ ModuleManager::doInit()
             cDebug() << deb << "ModuleManager module search path does not exist:" << path;
         }
     }
+
+    // Parse the descriptors on the thread pool, but use them in search-path
+    // order, so that the first module with a given name is the one that counts.
+    QList< QFuture< QVariantMap > > futures;
+    for ( const auto& descriptorFileInfo : std::as_const( descriptorFiles ) )
+    {
+        futures.append( QtConcurrent::run( [ path = descriptorFileInfo.absoluteFilePath() ]()
+                                           { return Calamares::YAML::loadCached( path ); } ) );
+    }
+    for ( int i = 0; i < descriptorFiles.count(); ++i )
+    {
+        const QFileInfo& descriptorFileInfo = descriptorFiles.at( i );
+        // The map is empty if the descriptor could not be loaded
+        const QVariantMap moduleDescriptorMap = futures[ i ].result();
+        const QString moduleName = moduleDescriptorMap.value( "name" ).toString();
+
+        if ( !moduleName.isEmpty() && ( moduleName == descriptorFileInfo.absoluteDir().dirName() )
+             && !m_availableDescriptorsByModuleName.contains( moduleName ) )
+        {
+            auto descriptor = Calamares::ModuleSystem::Descriptor::fromDescriptorData(
+                moduleDescriptorMap, descriptorFileInfo.absoluteFilePath() );
+            descriptor.setDirectory( descriptorFileInfo.absoluteDir().absolutePath() );
+            m_availableDescriptorsByModuleName.insert( moduleName, descriptor );
+        }
+        else
+        {
+            // Duplicate modules are ok; other issues like empty name or dir-mismatch are reported.
+            if ( !m_availableDescriptorsByModuleName.contains( moduleName ) )
+            {
+                cWarning() << deb << "ModuleManager module descriptor" << descriptorFileInfo.absoluteFilePath()
+                           << "has bad name" << moduleName;
+            }
+        }
+    }
     // At this point m_availableDescriptorsByModuleName is filled with
     // the modules that were found in the search paths.
-    cDebug() << deb << "Found" << m_availableDescriptorsByModuleName.count() << "modules";
+    cDebug() << deb << "Found" << m_availableDescriptorsByModuleName.count() << "modules in" << timer.elapsed()
+             << "ms";
     QTimer::singleShot( 10, this, &ModuleManager::initDone );
 }
 
@@ -183,6 +202,51 @@ getConfigFileName( const Settings::InstanceDescriptionList& descriptorList,
     return QString();
 }
 
+/** @brief Parses the configuration files of the modules in @p sequence
+ *
+ * Modules are created one after the other on the main thread, and read
+ * their configuration file then. This parses those files on the thread
+ * pool beforehand, so that the modules find them in the YAML cache.
+ */
+static void
+preloadConfigurations( const Settings::ModuleSequence& sequence,
+                       const Settings::InstanceDescriptionList& customInstances,
+                       const QMap< QString, ModuleSystem::Descriptor >& available,
+                       bool withViews )
+{
+    QStringList paths;
+    for ( const auto& modulePhase : sequence )
+    {
+        if ( !withViews && modulePhase.first == ModuleSystem::Action::Show )
+        {
+            continue;
+        }
+        for ( const auto& instanceKey : modulePhase.second )
+        {
+            const auto descriptor = available.value( instanceKey.module() );
+            const QString configFileName
+                = descriptor.isValid() ? getConfigFileName( customInstances, instanceKey, descriptor ) : QString();
+            const QString path = configFileName.isEmpty()
+                ? QString()
+                : Module::configurationFilePath( instanceKey.module(), configFileName );
+            if ( !path.isEmpty() && !paths.contains( path ) )
+            {
+                paths.append( path );
+            }
+        }
+    }
+
+    QList< QFuture< QVariantMap > > futures;
+    for ( const auto& path : std::as_const( paths ) )
+    {
+        futures.append( QtConcurrent::run( [ path ]() { return Calamares::YAML::loadCached( path ); } ) );
+    }
+    for ( auto& f : futures )
+    {
+        f.waitForFinished();
+    }
+}
+
 void
 ModuleManager::loadModules()
 {
@@ -192,11 +256,26 @@ ModuleManager::loadModules()
     }
     Settings::InstanceDescriptionList customInstances = Settings::instance()->moduleInstances();
 
-    QStringList failedModules;
+    // Without a ViewManager (e.g. an unattended install) there is nowhere
+    // to show pages, so only the exec phases are loaded and no
+    // ExecutionViewStep is created for them.
+    auto* viewManager = ViewManager::instance();
+
+    QElapsedTimer timer;
+    timer.start();
     const auto modulesSequence = Settings::instance()->modulesSequence();
+    preloadConfigurations(
+        modulesSequence, customInstances, m_availableDescriptorsByModuleName, viewManager != nullptr );
+    const qint64 configurationTime = timer.elapsed();
+
+    QStringList failedModules;
     for ( const auto& modulePhase : modulesSequence )
     {
         ModuleSystem::Action currentAction = modulePhase.first;
+        if ( !viewManager && currentAction == ModuleSystem::Action::Show )
+        {
+            continue;
+        }
 
         for ( const auto& instanceKey : modulePhase.second )
         {
@@ -266,23 +345,30 @@ ModuleManager::loadModules()
 
             // At this point we most certainly have a pointer to a loaded module in
             // thisModule. We now need to enqueue jobs info into an EVS.
-            if ( currentAction == ModuleSystem::Action::Exec )
+            if ( viewManager && currentAction == ModuleSystem::Action::Exec )
             {
-                const auto steps = Calamares::ViewManager::instance()->viewSteps();
+                const auto steps = viewManager->viewSteps();
                 ExecutionViewStep* evs = steps.isEmpty() ? nullptr : qobject_cast< ExecutionViewStep* >( steps.last() );
                 if ( !evs )  // If the last step is not an EVS, we must create it.
                 {
-                    evs = new ExecutionViewStep( ViewManager::instance() );
-                    ViewManager::instance()->addViewStep( evs );
+                    evs = new ExecutionViewStep( viewManager );
+                    viewManager->addViewStep( evs );
                 }
 
                 evs->appendJobModuleInstanceKey( instanceKey );
             }
         }
     }
+    cDebug() << "Loaded" << m_loadedModulesByInstanceKey.count() << "modules in" << timer.elapsed() << "ms,"
+             << configurationTime << "ms of which reading configuration.";
+    Calamares::YAML::saveCache();
+
     if ( !failedModules.isEmpty() )
     {
-        ViewManager::instance()->onInitFailed( failedModules );
+        if ( viewManager )
+        {
+            viewManager->onInitFailed( failedModules );
+        }
         QTimer::singleShot( 10, [ = ]() { emit modulesFailed( failedModules ); } );
     }
     else
@@ -310,6 +396,7 @@ ModuleManager::addModule( Module* module )
 
     if ( !module->isLoaded() )
     {
+        Logger::ModuleScope scope( module->instanceKey().toString() );
         module->loadSelf();
     }
 
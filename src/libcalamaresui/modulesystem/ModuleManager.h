@@ -85,6 +85,9 @@ public:
      * @brief loadModules does all of the module loading operation.
      * When this is done, the signal modulesLoaded is emitted.
      * It is recommended to call this from a single-shot QTimer.
+     *
+     * If there is no ViewManager, only the modules of the exec
+     * phases are loaded (this is what unattended installs use).
      */
     void loadModules();
 
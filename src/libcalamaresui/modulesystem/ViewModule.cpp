@@ -10,11 +10,13 @@
 
 #include "ViewModule.h"
 
+#include "CppJob.h"
 #include "ViewManager.h"
 #include "utils/Logger.h"
 #include "utils/PluginFactory.h"
 #include "viewpages/ViewStep.h"
 
+#include <QApplication>
 #include <QDir>
 #include <QPluginLoader>
 
@@ -36,6 +38,13 @@ ViewModule::interface() const
 }
 
 
+/// @brief Without a QApplication, no widgets (and so no ViewSteps) can be created
+static bool
+isHeadless()
+{
+    return !qobject_cast< QApplication* >( QCoreApplication::instance() );
+}
+
 void
 ViewModule::loadSelf()
 {
@@ -48,6 +57,24 @@ ViewModule::loadSelf()
             return;
         }
 
+        if ( isHeadless() )
+        {
+            CppJob* cppJob = pf->createHeadless< Calamares::CppJob >();
+            if ( cppJob )
+            {
+                cppJob->setModuleInstanceKey( instanceKey() );
+                cppJob->setConfigurationMap( m_configurationMap );
+                m_headlessJob = Calamares::job_ptr( static_cast< Calamares::Job* >( cppJob ) );
+                cDebug() << "ViewModule" << instanceKey() << "loaded headless job.";
+            }
+            else
+            {
+                cWarning() << "ViewModule" << instanceKey() << "has no headless job, it will do nothing.";
+            }
+            m_loaded = true;
+            return;
+        }
+
         m_viewStep = pf->create< Calamares::ViewStep >();
         if ( !m_viewStep )
         {
@@ -75,7 +102,11 @@ ViewModule::loadSelf()
 JobList
 ViewModule::jobs() const
 {
-    return m_viewStep->jobs();
+    if ( m_viewStep )
+    {
+        return m_viewStep->jobs();
+    }
+    return m_headlessJob ? JobList() << m_headlessJob : JobList();
 }
 
 
@@ -123,7 +154,7 @@ ViewModule::~ViewModule()
 RequirementsList
 ViewModule::checkRequirements()
 {
-    return m_viewStep->checkRequirements();
+    return m_viewStep ? m_viewStep->checkRequirements() : RequirementsList();
 }
 
 }  // namespace Calamares
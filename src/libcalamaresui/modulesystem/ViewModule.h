@@ -21,6 +21,14 @@ namespace Calamares
 
 class ViewStep;
 
+/** @brief A module that provides a page in the UI
+ *
+ * When Calamares runs without a GUI (that is, the application
+ * object is not a QApplication, as in an unattended install)
+ * no ViewStep is created, since that would create widgets.
+ * Instead the plugin's headless job is loaded, if it registers one;
+ * otherwise the module loads successfully but has no jobs.
+ */
 class UIDLLEXPORT ViewModule : public Module
 {
 public:
@@ -41,6 +49,7 @@ private:
 
     QPluginLoader* m_loader;
     ViewStep* m_viewStep = nullptr;
+    job_ptr m_headlessJob;
 
     friend Module* Calamares::moduleFromDescriptor( const ModuleSystem::Descriptor& moduleDescriptor,
                                                     const QString& instanceId,
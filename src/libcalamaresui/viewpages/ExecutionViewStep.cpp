@@ -183,9 +183,10 @@ ExecutionViewStep::onActivate()
         if ( module )
         {
             auto jl = module->jobs();
-            if ( module->isEmergency() )
+            for ( auto& j : jl )
             {
-                for ( auto& j : jl )
+                j->setModule( instanceKey.toString() );
+                if ( module->isEmergency() )
                 {
                     j->setEmergency( true );
                 }
@@ -0,0 +1,64 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "LoadingPage.h"
+
+#include "widgets/WaitingWidget.h"
+
+#include <QBoxLayout>
+
+namespace Calamares
+{
+namespace Widgets
+{
+
+LoadingPage::LoadingPage( QWidget* page, const QString& waitingText, QWidget* parent )
+    : QWidget( parent )
+    , m_page( page )
+    , m_waiting( new WaitingWidget( waitingText ) )
+{
+    if ( m_page->layout() )
+    {
+        m_page->layout()->setContentsMargins( 0, 0, 0, 0 );
+    }
+    m_page->hide();
+
+    auto* layout = new QVBoxLayout( this );
+    layout->setContentsMargins( 0, 0, 0, 0 );
+    layout->addWidget( m_waiting );
+    layout->addWidget( m_page );
+}
+
+LoadingPage::~LoadingPage() {}
+
+void
+LoadingPage::setWaitingText( const QString& text )
+{
+    if ( m_waiting )
+    {
+        m_waiting->setText( text );
+    }
+}
+
+void
+LoadingPage::loadDone()
+{
+    if ( --m_pending > 0 || !m_waiting )
+    {
+        return;
+    }
+    m_waiting->hide();
+    m_waiting->deleteLater();
+    m_waiting = nullptr;
+    m_page->show();
+    emit loaded();
+}
+
+}  // namespace Widgets
+}  // namespace Calamares
@@ -0,0 +1,89 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#ifndef LIBCALAMARESUI_WIDGETS_LOADINGPAGE_H
+#define LIBCALAMARESUI_WIDGETS_LOADINGPAGE_H
+
+#include "DllMacro.h"
+
+#include <QFutureWatcher>
+#include <QWidget>
+#include <QtConcurrent/QtConcurrent>
+
+class WaitingWidget;
+
+namespace Calamares
+{
+namespace Widgets
+{
+/** @brief A page that shows a spinner until its data has been loaded
+ *
+ * View steps are created before the first page is shown, and so are
+ * their widgets. Anything slow that a page needs (scanning directories,
+ * running tools) is better done with load(): it runs on the thread pool
+ * right away, the spinner is shown meanwhile, and the page replaces the
+ * spinner once the data is there.
+ *
+ * Return a LoadingPage from ViewStep::widget(), with the real page in it.
+ * The margins that the ViewManager gives the LoadingPage are those of
+ * the page; the page's own layout has none.
+ */
+class UIDLLEXPORT LoadingPage : public QWidget
+{
+    Q_OBJECT
+public:
+    /// Shows @p waitingText below a spinner until the data for @p page is loaded
+    LoadingPage( QWidget* page, const QString& waitingText, QWidget* parent = nullptr );
+    ~LoadingPage() override;
+
+    QWidget* page() const { return m_page; }
+    bool isLoaded() const { return !m_waiting; }
+
+    void setWaitingText( const QString& text );
+
+    /** @brief Calls @p load on the thread pool, then @p show with what it returns
+     *
+     * @p load must not touch any widgets. @p show is called in the GUI
+     * thread, unless the page is gone by then; afterwards the page is shown
+     * and loaded() is emitted. Pages with several loads are shown after the
+     * last one is done.
+     */
+    template < typename Load, typename Show >
+    void load( Load load, Show show )
+    {
+        using Result = decltype( load() );
+        auto* watcher = new QFutureWatcher< Result >( this );
+        ++m_pending;
+        connect( watcher,
+                 &QFutureWatcher< Result >::finished,
+                 this,
+                 [ this, watcher, show ]()
+                 {
+                     show( watcher->result() );
+                     watcher->deleteLater();
+                     loadDone();
+                 } );
+        watcher->setFuture( QtConcurrent::run( load ) );
+    }
+
+signals:
+    void loaded();
+
+private:
+    void loadDone();
+
+    QWidget* m_page;
+    WaitingWidget* m_waiting;
+    int m_pending = 0;
+};
+
+}  // namespace Widgets
+}  // namespace Calamares
+
+#endif  // LIBCALAMARESUI_WIDGETS_LOADINGPAGE_H
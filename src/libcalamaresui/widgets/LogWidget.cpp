@@ -9,104 +9,148 @@
 
 #include "LogWidget.h"
 
-#include "utils/Logger.h"
-
-#include <QFile>
-#include <QScrollBar>
-#include <QStackedLayout>
-#include <QTextStream>
-#include <QThread>
+#include <QComboBox>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
 
 namespace Calamares
 {
 
-LogThread::LogThread( QObject* parent )
-    : QThread( parent )
-{
-}
-
-LogThread::~LogThread()
-{
-    quit();
-    requestInterruption();
-    wait();
-}
-
-void
-LogThread::run()
-{
-    const auto filePath = Logger::logFile();
-
-    qint64 lastPosition = 0;
-
-    while ( !QThread::currentThread()->isInterruptionRequested() )
-    {
-        QFile file( filePath );
-
-        qint64 fileSize = file.size();
-        // Check whether the file size has changed since last time
-        // we read the file.
-        if ( lastPosition != fileSize && file.open( QFile::ReadOnly | QFile::Text ) )
-        {
-
-            // Start reading at the position we ended up last time we read the file.
-            file.seek( lastPosition );
-
-            QTextStream in( &file );
-            auto chunk = in.readAll();
-            qint64 newPosition = in.pos();
-
-            lastPosition = newPosition;
-
-            Q_EMIT onLogChunk( chunk );
-        }
-        QThread::msleep( 100 );
-    }
-}
+/// Lines kept in the view; the full log is in the log file
+static constexpr const int MAX_LINES = 5000;
 
 LogWidget::LogWidget( QWidget* parent )
     : QWidget( parent )
     , m_text( new QPlainTextEdit )
-    , m_log_thread( this )
+    , m_levelFilter( new QComboBox )
+    , m_moduleFilter( new QComboBox )
 {
-    auto layout = new QStackedLayout( this );
-    setLayout( layout );
-
     m_text->setReadOnly( true );
     m_text->setVerticalScrollBarPolicy( Qt::ScrollBarPolicy::ScrollBarAlwaysOn );
+    m_text->setMaximumBlockCount( MAX_LINES );
 
     QFont monospaceFont( "monospace" );
     monospaceFont.setStyleHint( QFont::Monospace );
     m_text->setFont( monospaceFont );
 
+    m_levelFilter->addItem( tr( "Errors", "@item:inlistbox" ), Logger::LOGERROR );
+    m_levelFilter->addItem( tr( "Warnings", "@item:inlistbox" ), Logger::LOGWARNING );
+    m_levelFilter->addItem( tr( "Debug", "@item:inlistbox" ), Logger::LOGDEBUG );
+    m_levelFilter->addItem( tr( "Everything", "@item:inlistbox" ), Logger::LOGVERBOSE );
+    m_levelFilter->setCurrentIndex( m_levelFilter->count() - 1 );
+    m_moduleFilter->addItem( tr( "All modules", "@item:inlistbox" ), QString() );
+
+    auto* filters = new QHBoxLayout;
+    filters->addWidget( new QLabel( tr( "Show:", "@label" ) ) );
+    filters->addWidget( m_levelFilter );
+    filters->addWidget( m_moduleFilter );
+    filters->addStretch();
+
+    auto* layout = new QVBoxLayout( this );
+    layout->setContentsMargins( 0, 0, 0, 0 );
+    layout->addLayout( filters );
     layout->addWidget( m_text );
+    setLayout( layout );
 
-    connect( &m_log_thread, &LogThread::onLogChunk, this, &LogWidget::handleLogChunk );
-
-    m_log_thread.start( QThread::LowestPriority );
+    connect( m_levelFilter, QOverload< int >::of( &QComboBox::currentIndexChanged ), this, &LogWidget::refilter );
+    connect( m_moduleFilter, QOverload< int >::of( &QComboBox::currentIndexChanged ), this, &LogWidget::refilter );
 }
 
-void
-LogWidget::handleLogChunk( const QString& logChunk )
+LogWidget::~LogWidget()
 {
-    m_text->appendPlainText( logChunk );
+    stop();
 }
 
 void
 LogWidget::start()
 {
-    if ( !m_log_thread.isRunning() )
+    if ( m_listener >= 0 )
     {
-        m_text->clear();
-        m_log_thread.start();
+        return;
     }
+    m_listener = Logger::addRecordListener(
+        [ this ]()
+        {
+            // Called from the logger thread; coalesce into one fetch in the GUI thread.
+            if ( !m_fetchQueued.exchange( true ) )
+            {
+                QMetaObject::invokeMethod( this, &LogWidget::fetchRecords, Qt::QueuedConnection );
+            }
+        } );
+    refilter();
 }
 
 void
 LogWidget::stop()
 {
-    m_log_thread.requestInterruption();
+    if ( m_listener >= 0 )
+    {
+        Logger::removeRecordListener( m_listener );
+        m_listener = -1;
+    }
 }
 
+void
+LogWidget::fetchRecords()
+{
+    m_fetchQueued = false;
+    if ( m_listener >= 0 )
+    {
+        appendRecords( Logger::recentRecords( m_lastSequence ) );
+    }
+}
+
+void
+LogWidget::refilter()
+{
+    m_fetchQueued = false;
+    m_text->clear();
+    m_lastSequence = 0;
+    appendRecords( Logger::recentRecords() );
+}
+
+void
+LogWidget::appendRecords( const QVector< Logger::Record >& records )
+{
+    if ( records.isEmpty() )
+    {
+        return;
+    }
+
+    QString lines;
+    if ( records.first().sequence > m_lastSequence + 1 )
+    {
+        lines = tr( "Earlier messages are in %1", "@info" ).arg( Logger::logFile() ) + '\n';
+    }
+
+    const auto maxLevel = m_levelFilter->currentData().toUInt();
+    const auto module = m_moduleFilter->currentData().toString();
+    for ( const auto& r : records )
+    {
+        if ( !r.module.isEmpty() && !m_modules.contains( r.module ) )
+        {
+            m_modules.insert( r.module );
+            m_moduleFilter->addItem( r.module, r.module );
+        }
+        if ( r.level > maxLevel || ( !module.isEmpty() && r.module != module ) )
+        {
+            continue;
+        }
+        lines.append( QDateTime::fromMSecsSinceEpoch( r.msecs ).time().toString( Qt::ISODate ) );
+        lines.append( QStringLiteral( " [%1]: " ).arg( r.level ) );
+        lines.append( r.text );
+        lines.append( '\n' );
+    }
+    m_lastSequence = records.last().sequence;
+
+    if ( !lines.isEmpty() )
+    {
+        lines.chop( 1 );
+        m_text->appendPlainText( lines );
+    }
+}
 
 }  // namespace Calamares
@@ -10,45 +10,57 @@
 #ifndef LIBCALAMARESUI_LOGWIDGET_H
 #define LIBCALAMARESUI_LOGWIDGET_H
 
-#include <QPlainTextEdit>
-#include <QThread>
-#include <QWidget>
+#include "utils/Logger.h"
 
-namespace Calamares
-{
-
-class LogThread : public QThread
-{
-    Q_OBJECT
+#include <QSet>
+#include <QWidget>
 
-    void run() override;
+#include <atomic>
 
-public:
-    explicit LogThread( QObject* parent = nullptr );
-    ~LogThread() override;
+class QComboBox;
+class QPlainTextEdit;
 
-Q_SIGNALS:
-    void onLogChunk( const QString& logChunk );
-};
+namespace Calamares
+{
 
+/** @brief Shows the recent log messages
+ *
+ * Messages come from the logger's in-memory records (see
+ * Logger::recentRecords()), not from the log file. While started,
+ * the widget is told when new messages are available; while stopped
+ * (e.g. hidden) it does nothing at all. The view keeps a bounded number
+ * of lines, and can be filtered by level and by module.
+ */
 class LogWidget : public QWidget
 {
     Q_OBJECT
 
-    QPlainTextEdit* m_text;
-    LogThread m_log_thread;
-
 public:
     explicit LogWidget( QWidget* parent = nullptr );
+    ~LogWidget() override;
 
 public Q_SLOTS:
-    /// @brief Called by the thread when there is new data
-    void handleLogChunk( const QString& logChunk );
-
     /// @brief Stop watching for log data
     void stop();
-    /// @brief Start watching for new log data
+    /// @brief Start watching for new log data, showing what is in memory
     void start();
+
+private:
+    /// @brief Appends the records logged since the last fetch
+    void fetchRecords();
+    /// @brief Re-displays the records in memory, with the current filter
+    void refilter();
+    /// @brief Appends the records from @p records that pass the filter
+    void appendRecords( const QVector< Logger::Record >& records );
+
+    QPlainTextEdit* m_text;
+    QComboBox* m_levelFilter;
+    QComboBox* m_moduleFilter;
+
+    int m_listener = -1;
+    quint64 m_lastSequence = 0;
+    std::atomic< bool > m_fetchQueued { false };
+    QSet< QString > m_modules;  ///< Those in m_moduleFilter
 };
 
 }  // namespace Calamares
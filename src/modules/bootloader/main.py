@@ -52,7 +52,7 @@ def get_uuid():
 
     :return:
     """
-    partitions = libcalamares.globalstorage.value("partitions")
+    partitions = libcalamares.globalstorage.view("partitions")
 
     for partition in partitions:
         if partition["mountPoint"] == "/":
@@ -140,7 +140,7 @@ def get_kernel_params(uuid):
 
     use_systemd_naming = have_program_in_target("dracut") or (libcalamares.utils.target_env_call(["/usr/bin/grep", "-q", "^HOOKS.*systemd", "/etc/mkinitcpio.conf"]) == 0)
 
-    partitions = libcalamares.globalstorage.value("partitions")
+    partitions = libcalamares.globalstorage.view("partitions")
 
     cryptdevice_params = []
     swap_uuid = ""
@@ -685,7 +685,7 @@ def install_grub(efi_directory, fw_type, install_hybrid_grub):
     :param install_hybrid_grub:
     """
     # get the partition from global storage
-    partitions = libcalamares.globalstorage.value("partitions")
+    partitions = libcalamares.globalstorage.view("partitions")
     if not partitions:
         libcalamares.utils.warning(_("Failed to install grub, no partitions defined in global storage"))
         return
@@ -815,7 +815,7 @@ def efi_partitions(efi_boot_path):
     """
     The (one) partition mounted on @p efi_boot_path, or an empty list.
     """
-    return [p for p in libcalamares.globalstorage.value("partitions") if p["mountPoint"] == efi_boot_path]
+    return [p for p in libcalamares.globalstorage.view("partitions") if p["mountPoint"] == efi_boot_path]
 
 
 def update_refind_config(efi_directory, installation_root_path):
@@ -944,7 +944,7 @@ def run():
         libcalamares.utils.warning("Non-EFI system, and no bootloader is set.")
         return None
 
-    partitions = libcalamares.globalstorage.value("partitions")
+    partitions = libcalamares.globalstorage.view("partitions")
     if fw_type == "efi":
         efi_system_partition = libcalamares.globalstorage.value("efiSystemPartition")
         esp_found = [p for p in partitions if p["mountPoint"] == efi_system_partition]
@@ -59,7 +59,7 @@ ImageSelectionPage::ImageSelectionPage( Config* config, QWidget* parent )
     ui->treeWidget->header()->setResizeMode(1, QHeaderView::ResizeToContents);
     ui->treeWidget->header()->setResizeMode(2, QHeaderView::Stretch);
 #endif
-    scanAvailableImages();
+    // The images are listed by setImages(), once findImages() is done
 
 
     connect( ui->treeWidget, &QTreeWidget::itemChanged, this, [this]( QTreeWidgetItem* changed, int column )
@@ -86,6 +86,7 @@ ImageSelectionPage::ImageSelectionPage( Config* config, QWidget* parent )
         QStringList seapathFlavor;
         auto* gs = Calamares::JobQueue::instance()->globalStorage();
         QStringList noBmap;
+        qint64 mappedSize = 0;
 
         for ( int i = 0; i < ui->treeWidget->topLevelItemCount(); ++i )
         {
@@ -102,6 +103,8 @@ ImageSelectionPage::ImageSelectionPage( Config* config, QWidget* parent )
                 noBmap << it->data( 1, Qt::UserRole ).toString();
                 cDebug() << "BMAP provided with image:" << seapathFlavor;
 
+                mappedSize = it->data( 2, Qt::UserRole ).toLongLong();
+
                 gs->insert( "seapathFlavor", seapathFlavor[0] );
             }
         }
@@ -119,6 +122,8 @@ ImageSelectionPage::ImageSelectionPage( Config* config, QWidget* parent )
             gs->insert( "imageselection.selected", selected );
             gs->insert( "imageselection.selectedFiles", selectedFiles );
             gs->insert( "noBmap", noBmap[0] );
+            // What bmaptool writes, for the partition page's estimate of how long that takes
+            gs->insert( "imageselection.mappedSize", mappedSize );
         }
 
         else{
@@ -136,107 +141,110 @@ bool ImageSelectionPage::hasSelection() const
     return false;
 }
 
-void
-ImageSelectionPage::scanAvailableImages()
+QVector< ImageInfo >
+ImageSelectionPage::findImages()
 {
     QDir dir( "/seapath/images" );
+    QVector< ImageInfo > images;
 
     QStringList image_files = dir.entryList(QStringList() << "*.wic.gz" << "*.raw.gz" << "*.iso", QDir::Files);
     cDebug() << "imageselection: scanning" << dir.path() << "found" << image_files.size() << "image file(s)";
     for ( const QString& fn : image_files )
     {
-        QString gz_image = fn;
-        QString json = fn;
         QString bmap = fn;
-        QString imageName;
-        QString imageDescription;
-        QString imageVersion;
-        QString imageFlavor;
-        QString imageSetup;
-        auto* gs = Calamares::JobQueue::instance()->globalStorage();
 
         bmap.replace(QRegularExpression("(\\.gz)$"), ".bmap");
-        gz_image.replace(QRegularExpression("\\.json$"), ".gz");
 
         cDebug() << "imageselection: found" << fn;
         cDebug() << "imageselection: looking for bmap file" << bmap;
 
+        ImageInfo image;
+        image.path = dir.absoluteFilePath( fn );
+
         /* Bmap file not readable/not present
         --> No metadata support, marked them as 'Not available'
         */
         if ( !QFile::exists( dir.absoluteFilePath( bmap ) ) )
         {
             cDebug() << "imageselection: no BMAP metadata file found for" << fn;
-            QString name = fn;
-            auto* item = new QTreeWidgetItem( ui->treeWidget );
-            item->setText( 0, name );
-            item->setText( 1, "Not available" );
-            item->setText( 2, "Not available" );
-            item->setText( 3, "Not available" );
-            item->setText( 4, "Not available" );
-            item->setFlags( item->flags() | Qt::ItemIsUserCheckable );
-            item->setCheckState( 0, Qt::Unchecked );
-            item->setData( 0, Qt::UserRole, dir.absoluteFilePath( fn ) ); // Checkbox metadata (hidden)
-            item->setData( 1, Qt::UserRole, true ); // Checkbox metadata (hidden)
+            image.name = fn;
+            image.flavor = "Not available";
+            image.setup = "Not available";
+            image.version = "Not available";
+            image.description = "Not available";
+            images.append( image );
             continue;
         }
 
-        else {
-            QFile bmapFile( dir.absoluteFilePath( bmap ) );
-            if ( !bmapFile.open( QIODevice::ReadOnly ) )
-            {
-                cDebug() << "imageselection: cannot open BMAP file" << bmapFile.fileName();
-                continue;
-            }
-            gs->insert( "False", "noBmap" );
-            QDomDocument xmlBMAP;
-            xmlBMAP.setContent(&bmapFile);
-
-            QDomElement root=xmlBMAP.documentElement();
-
-            // Extract value of a XML tag field
-            auto getElementText = [](const QDomElement& parent, const QString& tag) -> QString {
-                QDomElement elem = parent.firstChildElement(tag);
-                return elem.text().trimmed();
-            };
-
-            // If XML tag do not exist mark the value as not available
-            auto checkEmptyElement = [](const QString& tag) -> QString {
-                if(tag == "")
-                    return "Not available";
-                return tag;
-            };
-
-            imageName = getElementText(root, "ImageName");
-
-            // If no image name defined print the image file name
-            if(imageName == "")
-                imageName = fn;
-
-            imageVersion = getElementText(root, "ImageVersion");
-            imageDescription = getElementText(root, "ImageDescription");
-            imageFlavor = getElementText(root, "ImageFlavor");
-            imageSetup = getElementText(root, "ImageSetup");
-
-            imageVersion = checkEmptyElement(imageVersion);
-            imageDescription = checkEmptyElement(imageDescription);
-            imageFlavor = checkEmptyElement(imageFlavor);
-            imageSetup = checkEmptyElement(imageSetup);
-
-            auto* item = new QTreeWidgetItem( ui->treeWidget );
-            item->setText( 0, imageName );
-            item->setText( 1, imageFlavor );
-            item->setText( 2, imageSetup );
-            item->setText( 3, imageVersion );
-            item->setText( 4, imageDescription );
-            item->setFlags( item->flags() | Qt::ItemIsUserCheckable );
-            item->setCheckState( 0, Qt::Unchecked );
-
-            item->setData( 0, Qt::UserRole, dir.absoluteFilePath( fn ) );
-            item->setData( 1, Qt::UserRole, false );
-            bmapFile.close();
+        QFile bmapFile( dir.absoluteFilePath( bmap ) );
+        if ( !bmapFile.open( QIODevice::ReadOnly ) )
+        {
+            cDebug() << "imageselection: cannot open BMAP file" << bmapFile.fileName();
             continue;
         }
+        QDomDocument xmlBMAP;
+        xmlBMAP.setContent(&bmapFile);
+
+        QDomElement root=xmlBMAP.documentElement();
+
+        // Extract value of a XML tag field
+        auto getElementText = [](const QDomElement& parent, const QString& tag) -> QString {
+            QDomElement elem = parent.firstChildElement(tag);
+            return elem.text().trimmed();
+        };
+
+        // If XML tag do not exist mark the value as not available
+        auto checkEmptyElement = [](const QString& tag) -> QString {
+            if(tag == "")
+                return "Not available";
+            return tag;
+        };
+
+        image.name = getElementText(root, "ImageName");
+
+        // If no image name defined print the image file name
+        if(image.name == "")
+            image.name = fn;
+
+        image.version = checkEmptyElement( getElementText( root, "ImageVersion" ) );
+        image.description = checkEmptyElement( getElementText( root, "ImageDescription" ) );
+        image.flavor = checkEmptyElement( getElementText( root, "ImageFlavor" ) );
+        image.setup = checkEmptyElement( getElementText( root, "ImageSetup" ) );
+        image.noBmap = false;
+
+        // Only the mapped blocks are written
+        image.mappedSize = getElementText( root, "BlockSize" ).toLongLong()
+            * getElementText( root, "MappedBlocksCount" ).toLongLong();
+
+        bmapFile.close();
+        images.append( image );
+    }
+    return images;
+}
+
+void
+ImageSelectionPage::setImages( const QVector< ImageInfo >& images )
+{
+    auto* gs = Calamares::JobQueue::instance()->globalStorage();
+    for ( const auto& image : images )
+    {
+        if ( !image.noBmap )
+        {
+            gs->insert( "False", "noBmap" );
+        }
+
+        auto* item = new QTreeWidgetItem( ui->treeWidget );
+        item->setText( 0, image.name );
+        item->setText( 1, image.flavor );
+        item->setText( 2, image.setup );
+        item->setText( 3, image.version );
+        item->setText( 4, image.description );
+        item->setFlags( item->flags() | Qt::ItemIsUserCheckable );
+        item->setCheckState( 0, Qt::Unchecked );
+
+        item->setData( 0, Qt::UserRole, image.path );  // Checkbox metadata (hidden)
+        item->setData( 1, Qt::UserRole, image.noBmap );
+        item->setData( 2, Qt::UserRole, image.mappedSize );
     }
 }
 
@@ -12,6 +12,7 @@
 #define IMAGESELECTION_H
 
 
+#include <QVector>
 #include <QWidget>
 
 #include <optional>
@@ -25,6 +26,19 @@ class ImageSelectionPage;
 
 struct ImageRow { const char* name; const char* version; const char* desc; };
 
+/// @brief An image file, with what its BMAP file says about it
+struct ImageInfo
+{
+    QString path;
+    QString name;
+    QString flavor;
+    QString setup;
+    QString version;
+    QString description;
+    bool noBmap = true;
+    qint64 mappedSize = 0;  ///< What bmaptool writes
+};
+
 class ImageSelectionPage : public QWidget
 {
     Q_OBJECT
@@ -32,6 +46,14 @@ public:
     explicit ImageSelectionPage( Config* config, QWidget* parent = nullptr );
     bool hasSelection() const;
 
+    /** @brief Finds the images in /seapath/images and reads their BMAP files
+     *
+     * This does not touch the page, so it can run in another thread.
+     */
+    static QVector< ImageInfo > findImages();
+    /// @brief Lists @p images on the page
+    void setImages( const QVector< ImageInfo >& images );
+
 
 public slots:
     void onInstallationFailed( const QString& message, const QString& details );
@@ -41,7 +63,6 @@ public slots:
 
 protected:
     void focusInEvent( QFocusEvent* e ) override;  //choose the child widget to focus
-    void scanAvailableImages();
 
 
 private:
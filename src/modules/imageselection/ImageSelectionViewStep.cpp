@@ -16,7 +16,10 @@
 
 #include "JobQueue.h"
 #include "GlobalStorage.h"
+#include "PrepareQueue.h"
+#include "partition/Gpt.h"
 #include "utils/Logger.h"
+#include "widgets/LoadingPage.h"
 
 #include <QApplication>
 #include <QFile>
@@ -27,15 +30,79 @@ extern "C" {
 #include <zlib.h>
 }
 
+/** @brief Decompresses the whole selected image to check its integrity
+ *
+ * This is a prepare task: it runs in the background once the image is
+ * chosen, so that a corrupt or truncated image is reported before
+ * rawimage starts overwriting the target disk.
+ */
+static QVariant
+verifyImage( const QVariantMap& inputs, const Calamares::PrepareQueue::Token& token )
+{
+    const QString imagePath = inputs.value( "imageselection.selectedFiles" ).toStringList().value( 0 );
+    if ( imagePath.isEmpty() )
+    {
+        return QVariant();
+    }
+
+    QVariantMap result { { "ok", false }, { "image", imagePath } };
+    gzFile gzf = gzopen( imagePath.toUtf8().constData(), "rb" );
+    if ( !gzf )
+    {
+        result.insert( "message", QStringLiteral( "Cannot open image %1" ).arg( imagePath ) );
+        return result;
+    }
+    gzbuffer( gzf, 1 << 17 );
+
+    QByteArray buffer( 1 << 20, Qt::Uninitialized );
+    int bytesRead = 0;
+    do
+    {
+        bytesRead = gzread( gzf, buffer.data(), static_cast< unsigned >( buffer.size() ) );
+    } while ( bytesRead > 0 && !token.isCancelled() );
+    if ( token.isCancelled() )
+    {
+        gzclose( gzf );
+        return QVariant();
+    }
+
+    int errnum = Z_OK;
+    const QString readError = bytesRead < 0 ? QString::fromUtf8( gzerror( gzf, &errnum ) ) : QString();
+    const int closeStatus = gzclose( gzf );
+    if ( bytesRead < 0 )
+    {
+        result.insert( "message", QStringLiteral( "Image %1 is corrupt: %2" ).arg( imagePath, readError ) );
+    }
+    else if ( closeStatus != Z_OK )
+    {
+        result.insert( "message", QStringLiteral( "Image %1 is truncated" ).arg( imagePath ) );
+    }
+    else
+    {
+        result.insert( "ok", true );
+    }
+    return result;
+}
+
 ImageSelectionViewStep::ImageSelectionViewStep( QObject* parent )
     : Calamares::ViewStep( parent )
     , m_config( new Config( this ) )
     , m_widget( new ImageSelectionPage( m_config ) )
+    , m_loadingPage( new Calamares::Widgets::LoadingPage( m_widget, tr( "Looking for images…", "@status" ) ) )
 {
+    // Reading the BMAP files of the images is slow on the live medium
+    m_loadingPage->load( &ImageSelectionPage::findImages,
+                         [ this ]( const QVector< ImageInfo >& images ) { m_widget->setImages( images ); } );
+
     auto jq = Calamares::JobQueue::instance();
     connect( jq, &Calamares::JobQueue::failed, m_config, &Config::onInstallationFailed );
     connect( jq, &Calamares::JobQueue::failed, m_widget, &ImageSelectionPage::onInstallationFailed );
 
+    if ( auto* pq = Calamares::PrepareQueue::instance() )
+    {
+        pq->registerTask( "imageselection.verify", { "imageselection.selectedFiles" }, verifyImage );
+    }
+
     emit nextStatusChanged( true );
             connect( m_widget, &ImageSelectionPage::selectionChanged,
             this, [this]( bool ) { emit nextStatusChanged( isNextEnabled() ); } );
@@ -44,9 +111,9 @@ ImageSelectionViewStep::ImageSelectionViewStep( QObject* parent )
 
 ImageSelectionViewStep::~ImageSelectionViewStep()
 {
-    if ( m_widget && m_widget->parent() == nullptr )
+    if ( m_loadingPage && m_loadingPage->parent() == nullptr )
     {
-        m_widget->deleteLater();
+        m_loadingPage->deleteLater();
     }
 }
 
@@ -61,7 +128,7 @@ ImageSelectionViewStep::prettyName() const
 QWidget*
 ImageSelectionViewStep::widget()
 {
-    return m_widget;
+    return m_loadingPage;
 }
 
 
@@ -117,9 +184,9 @@ ImageSelectionViewStep::onLeave()
     QString imagePath = selectedFiles.first();
     cDebug() << "Parsing GPT from image:" << imagePath;
 
-    // Read GPT headers from gzipped image
-    const int BLOCK_SIZE = 512; // Default GPT block size
-    const int COUNT = 40; // 40 * 512 = 20KB, enough for GPT headers
+    // Read the start of the gzipped image, enough for the GPT with 512-byte or 4KiB sectors
+    const int BLOCK_SIZE = 4096;
+    const int COUNT = 16;
     QByteArray rawData;
     rawData.reserve( BLOCK_SIZE * COUNT );
 
@@ -146,71 +213,25 @@ ImageSelectionViewStep::onLeave()
         ::exit( EXIT_FAILURE );
     }
 
-    // Parse GPT header (at block 1, offset 512)
-    const unsigned char* gptHeader = reinterpret_cast< const unsigned char* >( rawData.constData() + 512 );
-
-    // Extract GPT header fields
-    quint32 numEntries = *reinterpret_cast< const quint32* >( gptHeader + 80 );
-    quint32 entrySize = *reinterpret_cast< const quint32* >( gptHeader + 84 );
-    quint64 partLba = *reinterpret_cast< const quint64* >( gptHeader + 72 );
-
-    cDebug() << "GPT detected: entries= " << numEntries << " entry_size= " << entrySize << " table_lba= " << partLba;
-
-    // Parse partition entries (starting at block 2, offset 1024)
-    const unsigned char* entriesData = reinterpret_cast< const unsigned char* >( rawData.constData() + 1024 );
-    int maxEntries = qMin( static_cast< int >( numEntries ), ( rawData.size() - 1024 ) / static_cast< int >( entrySize ) );
+    const auto gpt = Calamares::Partition::Gpt::fromData( rawData );
+    if ( !gpt.isValid() )
+    {
+        cWarning() << "No valid GPT in image" << imagePath;
+    }
 
     QVariantList partitions;
-    for ( int i = 0; i < maxEntries; ++i )
+    for ( const auto& partition : gpt.partitions() )
     {
-        const unsigned char* entry = entriesData + ( i * entrySize );
-
-        quint64 firstLba = *reinterpret_cast< const quint64* >( entry + 32 );
-        quint64 lastLba = *reinterpret_cast< const quint64* >( entry + 40 );
-        quint64 attrs = *reinterpret_cast< const quint64* >( entry + 48 );
-
-        // Extract partition name (UTF-16LE, starts at offset 56)
-        QString name;
-        const quint16* nameData = reinterpret_cast< const quint16* >( entry + 56 );
-        int maxNameChars = ( entrySize - 56 ) / 2;
-
-        if ( firstLba == 0 && lastLba == 0 )
-            continue;
-
-        for ( int j = 0; j < maxNameChars; ++j )
-        {
-            if ( nameData[ j ] == 0 )
-                break;
-            name.append( QChar( nameData[ j ] ) );
-        }
-
-
-
-        quint64 sizeSectors = lastLba - firstLba + 1;
-
-        cDebug() << ( i + 1 ) << ": start=" << firstLba << "end=" << lastLba
-                 << "size_sectors=" << sizeSectors << "name='" << name << "' attrs=0x" << QString::number( attrs, 16 );
-
-        // Extract GUIDs as hex strings
-        QByteArray typeGuid( reinterpret_cast< const char* >( entry ), 16 );
-        QByteArray uniqGuid( reinterpret_cast< const char* >( entry + 16 ), 16 );
-
-        QVariantMap partition;
-        partition[ "index" ] = i + 1;
-        partition[ "type_guid" ] = typeGuid.toHex();
-        partition[ "uniq_guid" ] = uniqGuid.toHex();
-        partition[ "first_lba" ] = firstLba;
-        partition[ "last_lba" ] = lastLba;
-        partition[ "size_sectors" ] = sizeSectors;
-        partition[ "name" ] = name;
-        partition[ "attrs" ] = attrs;
-
-        partitions.append( partition );
+        cDebug() << partition.number << ": start=" << partition.firstLba << "end=" << partition.lastLba
+                 << "size_sectors=" << partition.sectors() << "name='" << partition.name << "' attrs=0x"
+                 << QString::number( partition.attributes, 16 );
+        partitions.append( partition.toMap() );
     }
 
     cDebug() << "Extracted" << partitions.size() << "partitions from GPT layout";
 
     gs->insert( "imageselection.gptPartitions", partitions );
+    gs->insert( "imageselection.gptSectorSize", gpt.isValid() ? gpt.sectorSize() : 512 );
 }
 
 Calamares::JobList
@@ -18,6 +18,14 @@
 class Config;
 class ImageSelectionPage;
 
+namespace Calamares
+{
+namespace Widgets
+{
+class LoadingPage;
+}  // namespace Widgets
+}  // namespace Calamares
+
 class PLUGINDLLEXPORT ImageSelectionViewStep : public Calamares::ViewStep
 {
     Q_OBJECT
@@ -45,6 +53,7 @@ public:
 private:
     Config* m_config;
     ImageSelectionPage* m_widget;
+    Calamares::Widgets::LoadingPage* m_loadingPage;  ///< Shows m_widget once the images are found
 };
 
 CALAMARES_PLUGIN_FACTORY_DECLARATION( ImageSelectionViewStepFactory )
@@ -141,8 +141,10 @@ def get_partitions(device_name, seapath_flavor):
             )
             raise RuntimeError("Root LVM partition not found")
     else:
-        rootfs_partition = partitions[3]
-        persistent_partition = partitions[6]
+        # Ask the kernel which node is which partition, rather than
+        # relying on the order of lsblk or on the naming scheme.
+        rootfs_partition = libcalamares.utils.partition_device(device_name, 3) or partitions[3]
+        persistent_partition = libcalamares.utils.partition_device(device_name, 6) or partitions[6]
     return rootfs_partition, persistent_partition
 
 
@@ -10,51 +10,191 @@
 #include "NetworkInterfaceList.h"
 
 #include "utils/Logger.h"
-#include "utils/System.h"
 
-#include <QProcess>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+
+#include <cstring>
+
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const QString SYSFS_NET = QStringLiteral( "/sys/class/net/" );
+/// Interface type of Ethernet, ARPHRD_ETHER
+static constexpr int ETHERNET_TYPE = 1;
+
+/// @brief The contents of the sysfs attribute @p path, or an empty string
+static QString
+readSysfs( const QString& path )
+{
+    QFile f( path );
+    // Some attributes, like speed, fail to read while the link is down
+    return f.open( QIODevice::ReadOnly ) ? QString::fromLatin1( f.readAll() ).trimmed() : QString();
+}
 
 namespace NetworkUtils
 {
 
-NetworkInterfaceList::NetworkInterfaceList()
+NetworkInterface
+NetworkInterface::fromSysfs( const QString& name )
 {
-    populateInterfaceList();
+    const QDir dir( SYSFS_NET + name );
+    // Virtual interfaces have no device; wireless ones are Ethernet too, for the kernel
+    if ( name.isEmpty() || name.contains( '/' ) || !dir.exists( QStringLiteral( "device" ) )
+         || readSysfs( dir.filePath( QStringLiteral( "type" ) ) ).toInt() != ETHERNET_TYPE
+         || dir.exists( QStringLiteral( "wireless" ) ) || dir.exists( QStringLiteral( "phy80211" ) ) )
+    {
+        return NetworkInterface();
+    }
+
+    NetworkInterface i;
+    i.name = name;
+    i.driver = QFileInfo( QFileInfo( dir.filePath( QStringLiteral( "device/driver" ) ) ).canonicalFilePath() )
+                   .fileName();
+    i.macAddress = readSysfs( dir.filePath( QStringLiteral( "address" ) ) );
+    i.busPath = QFileInfo( QFileInfo( dir.filePath( QStringLiteral( "device" ) ) ).canonicalFilePath() ).fileName();
+    bool ok = false;
+    const int speed = readSysfs( dir.filePath( QStringLiteral( "speed" ) ) ).toInt( &ok );
+    i.speed = ok && speed > 0 ? speed : -1;
+    i.carrier = readSysfs( dir.filePath( QStringLiteral( "carrier" ) ) ) == QStringLiteral( "1" );
+    return i;
 }
 
-QStringList
-NetworkInterfaceList::getPhysicalNetworkInterfaces() const
+NetworkInterfaceList::NetworkInterfaceList()
 {
-    return interfaceList;
+    populateInterfaceList();
 }
 
 void
 NetworkInterfaceList::populateInterfaceList()
 {
-    auto result = Calamares::System::runCommand(
-            { "nmcli", "--terse", "--field", "DEVICE,TYPE,STATE", "device" },
-            std::chrono::seconds( 30 ) );
- 
-    if ( result.getExitCode() == 0 )
-    {
-        QString output = result.getOutput();
-        QStringList lines = output.split("\n");
+    QElapsedTimer timer;
+    timer.start();
 
-        for (const QString &line : lines)
+    // The names are sorted, so the first interface is the same on every boot
+    const auto names = QDir( SYSFS_NET ).entryList( QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name );
+    for ( const QString& name : names )
+    {
+        const auto i = NetworkInterface::fromSysfs( name );
+        if ( i.isValid() )
         {
-            QStringList parts = line.split(":");
-            if ( parts.size() == 3 && parts.at(1) == "ethernet" )
-            {
-                interfaceList.append(parts.at(0));
-            }
+            m_interfaces.append( i );
         }
+    }
+    cDebug() << "Found" << m_interfaces.count() << "Ethernet interfaces in" << timer.nsecsElapsed() / 1000 << "us";
+}
 
+LinkMonitor::LinkMonitor( QObject* parent )
+    : QObject( parent )
+{
+    m_socket = socket( AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE );
+    if ( m_socket < 0 )
+    {
+        cWarning() << "Cannot open a netlink socket, link changes are not shown." << strerror( errno );
+        return;
     }
-    else
+
+    struct sockaddr_nl address
     {
-        cWarning() << "Failed to list network interfaces." << result.getOutput();
+    };
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK;
+    if ( bind( m_socket, reinterpret_cast< struct sockaddr* >( &address ), sizeof( address ) ) != 0 )
+    {
+        cWarning() << "Cannot listen to link changes." << strerror( errno );
+        close( m_socket );
+        m_socket = -1;
+        return;
     }
 
+    m_notifier = new QSocketNotifier( m_socket, QSocketNotifier::Read, this );
+    connect( m_notifier, &QSocketNotifier::activated, this, &LinkMonitor::readNotifications );
+}
+
+LinkMonitor::~LinkMonitor()
+{
+    if ( m_socket >= 0 )
+    {
+        delete m_notifier;
+        close( m_socket );
+    }
+}
+
+void
+LinkMonitor::readNotifications()
+{
+    // Link messages carry many attributes (statistics, for one), so they can be large
+    alignas( nlmsghdr ) char buffer[ 32768 ];
+    for ( ;; )
+    {
+        // With MSG_TRUNC, the full length is returned even if it did not fit
+        const ssize_t received = recv( m_socket, buffer, sizeof( buffer ), MSG_TRUNC );
+        if ( received < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            if ( errno == ENOBUFS )
+            {
+                // The kernel dropped some, there's no telling which
+                emit linksChanged();
+                continue;
+            }
+            if ( errno != EAGAIN && errno != EWOULDBLOCK )
+            {
+                // Don't let the notifier fire again and again for a broken socket
+                cWarning() << "Cannot read link changes." << strerror( errno );
+                m_notifier->setEnabled( false );
+            }
+            return;
+        }
+        if ( received > ssize_t( sizeof( buffer ) ) )
+        {
+            // The rest of the messages are lost
+            emit linksChanged();
+            continue;
+        }
+
+        int length = int( received );
+        for ( auto* header = reinterpret_cast< nlmsghdr* >( buffer ); NLMSG_OK( header, length );
+              header = NLMSG_NEXT( header, length ) )
+        {
+            if ( header->nlmsg_type != RTM_NEWLINK && header->nlmsg_type != RTM_DELLINK )
+            {
+                continue;
+            }
+            auto* info = static_cast< ifinfomsg* >( NLMSG_DATA( header ) );
+            int attributesLength = int( IFLA_PAYLOAD( header ) );
+            QString name;
+            for ( auto* attribute = IFLA_RTA( info ); RTA_OK( attribute, attributesLength );
+                  attribute = RTA_NEXT( attribute, attributesLength ) )
+            {
+                if ( attribute->rta_type == IFLA_IFNAME )
+                {
+                    name = QString::fromLatin1( static_cast< const char* >( RTA_DATA( attribute ) ) );
+                }
+            }
+            if ( name.isEmpty() )
+            {
+                continue;
+            }
+            if ( header->nlmsg_type == RTM_DELLINK )
+            {
+                emit linkRemoved( name );
+            }
+            else
+            {
+                emit linkChanged( name );
+            }
+        }
+    }
 }
 
 }  // namespace NetworkUtils
@@ -10,26 +10,78 @@
 #ifndef NETWORKINTERFACELIST_H
 #define NETWORKINTERFACELIST_H
 
-#include <QStringList>
+#include <QObject>
 #include <QString>
+#include <QVector>
+
+class QSocketNotifier;
 
 namespace NetworkUtils
 {
 
+/// @brief A physical Ethernet interface, as sysfs describes it
+struct NetworkInterface
+{
+    QString name;
+    QString driver;
+    QString macAddress;
+    QString busPath;  ///< Of the device, e.g. 0000:03:00.0 for a PCI card
+    int speed = -1;  ///< In Mb/s, -1 if unknown (e.g. without a link)
+    bool carrier = false;  ///< A cable is plugged in, and the link is up
+
+    bool isValid() const { return !name.isEmpty(); }
+
+    /** @brief Describes the interface @p name
+     *
+     * Returns an invalid interface if there is no such interface,
+     * or if it is not a physical Ethernet interface (but e.g. a bridge,
+     * a VLAN or a wireless interface).
+     */
+    static NetworkInterface fromSysfs( const QString& name );
+};
+
 class NetworkInterfaceList
 {
-    public:
-        NetworkInterfaceList();
-        /**
-         * @brief Gets a list of network interfaces.
-         *
-         * This returns a list of physical network interfaces
-         * using the nmcli.
-         */
-        QStringList getPhysicalNetworkInterfaces() const;
-    private:
-        QStringList interfaceList;
-        void populateInterfaceList();
+public:
+    NetworkInterfaceList();
+
+    /// @brief The physical Ethernet interfaces from /sys/class/net, sorted by name
+    QVector< NetworkInterface > interfaces() const { return m_interfaces; }
+
+private:
+    QVector< NetworkInterface > m_interfaces;
+    void populateInterfaceList();
+};
+
+/** @brief Reports changes of network interfaces as they happen
+ *
+ * This listens to the kernel's rtnetlink link notifications, so it
+ * notices when a cable is plugged in or out, and when an interface
+ * appears or disappears (e.g. a USB adapter).
+ */
+class LinkMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LinkMonitor( QObject* parent = nullptr );
+    ~LinkMonitor() override;
+
+    /// @brief Are notifications received at all?
+    bool isValid() const { return m_socket >= 0; }
+
+signals:
+    /// The interface @p name is new, or its state changed
+    void linkChanged( const QString& name );
+    /// The interface @p name is gone
+    void linkRemoved( const QString& name );
+    /// Notifications were lost, everything may have changed
+    void linksChanged();
+
+private:
+    void readNotifications();
+
+    int m_socket = -1;
+    QSocketNotifier* m_notifier = nullptr;
 };
 
 }  // namespace NetworkUtils
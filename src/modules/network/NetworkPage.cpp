@@ -17,7 +17,6 @@
 
 #include "Config.h"
 #include "ui_NetworkPage.h"
-#include "NetworkInterfaceList.h"
 
 #include "GlobalStorage.h"
 #include "JobQueue.h"
@@ -34,6 +33,7 @@
 #include <QLineEdit>
 #include <QStringList>
 #include <QComboBox>
+#include <QSignalBlocker>
 
 /** @brief Add an error message and pixmap to a label. */
 static inline void
@@ -124,6 +124,18 @@ void
 NetworkPage::retranslate()
 {
     ui->retranslateUi( this );
+
+    // The entries describe the interfaces in the language they were made in
+    auto* combo = ui->comboBoxNetworkInterface;
+    const QSignalBlocker blocker( combo );
+    for ( int index = 0; index < combo->count(); ++index )
+    {
+        const auto networkInterface = NetworkUtils::NetworkInterface::fromSysfs( combo->itemData( index ).toString() );
+        if ( networkInterface.isValid() )
+        {
+            updateInterface( networkInterface );
+        }
+    }
 }
 
 void
@@ -132,14 +144,99 @@ NetworkPage::initInterfaces()
     ui->comboBoxNetworkInterface->clear();
     ui->comboBoxNetworkInterface->setInsertPolicy( QComboBox::InsertAtBottom  );
 
-    NetworkUtils::NetworkInterfaceList interfaceList;
-    QStringList interfaces = interfaceList.getPhysicalNetworkInterfaces();
-    ui->comboBoxNetworkInterface->addItems(interfaces);
-
-    ui->comboBoxNetworkInterface->setCurrentIndex( m_interfaceIndex );
-    m_config->setNetworkInterface( ui->comboBoxNetworkInterface->currentText() );
-    connect( ui->comboBoxNetworkInterface, &QComboBox::currentTextChanged, m_config, &Config::setNetworkInterface );
+    // The entries show the state of the interfaces, the name is in the item data
+    connect( ui->comboBoxNetworkInterface,
+             QOverload< int >::of( &QComboBox::currentIndexChanged ),
+             this,
+             [ this ]( int index )
+             { m_config->setNetworkInterface( ui->comboBoxNetworkInterface->itemData( index ).toString() ); } );
     connect( m_config, &Config::networkInterfaceChanged, this, &NetworkPage::onNetworkInterfaceSelectionChanged );
+
+    auto* monitor = new NetworkUtils::LinkMonitor( this );
+    connect( monitor, &NetworkUtils::LinkMonitor::linkChanged, this, &NetworkPage::onLinkChanged );
+    connect( monitor, &NetworkUtils::LinkMonitor::linkRemoved, this, &NetworkPage::onLinkRemoved );
+    connect( monitor,
+             &NetworkUtils::LinkMonitor::linksChanged,
+             this,
+             [ this ]() { setInterfaces( NetworkUtils::NetworkInterfaceList().interfaces() ); } );
+
+    setInterfaces( NetworkUtils::NetworkInterfaceList().interfaces() );
+}
+
+void
+NetworkPage::setInterfaces( const QVector< NetworkUtils::NetworkInterface >& interfaces )
+{
+    const QString selected = m_config->networkInterface();
+    {
+        const QSignalBlocker blocker( ui->comboBoxNetworkInterface );
+        ui->comboBoxNetworkInterface->clear();
+        for ( const auto& networkInterface : interfaces )
+        {
+            updateInterface( networkInterface );
+        }
+    }
+
+    // Keep the selection when listing again
+    const int index = ui->comboBoxNetworkInterface->findData( selected );
+    ui->comboBoxNetworkInterface->setCurrentIndex( index >= 0 ? index : m_interfaceIndex );
+    m_config->setNetworkInterface( ui->comboBoxNetworkInterface->currentData().toString() );
+}
+
+QString
+NetworkPage::describeInterface( const NetworkUtils::NetworkInterface& networkInterface ) const
+{
+    QString link;
+    if ( !networkInterface.carrier )
+    {
+        link = tr( "no link", "@label" );
+    }
+    else if ( networkInterface.speed > 0 )
+    {
+        //: %1 is a speed in Mb/s, e.g. 1000
+        link = tr( "link up, %1 Mb/s", "@label" ).arg( networkInterface.speed );
+    }
+    else
+    {
+        link = tr( "link up", "@label" );
+    }
+    //: %1 is the interface name, %2 its driver, %3 its MAC address, %4 the link state
+    return tr( "%1 (%2, %3): %4", "@label" )
+        .arg( networkInterface.name, networkInterface.driver, networkInterface.macAddress, link );
+}
+
+void
+NetworkPage::updateInterface( const NetworkUtils::NetworkInterface& networkInterface )
+{
+    auto* combo = ui->comboBoxNetworkInterface;
+    int index = combo->findData( networkInterface.name );
+    if ( index < 0 )
+    {
+        combo->addItem( QString(), networkInterface.name );
+        index = combo->count() - 1;
+    }
+    combo->setItemText( index, describeInterface( networkInterface ) );
+    combo->setItemData( index, networkInterface.busPath, Qt::ToolTipRole );
+}
+
+void
+NetworkPage::onLinkChanged( const QString& name )
+{
+    const auto networkInterface = NetworkUtils::NetworkInterface::fromSysfs( name );
+    // A cable plugged in, or a new (USB) adapter; the first one is selected when it is added
+    if ( networkInterface.isValid() )
+    {
+        updateInterface( networkInterface );
+    }
+}
+
+void
+NetworkPage::onLinkRemoved( const QString& name )
+{
+    const int index = ui->comboBoxNetworkInterface->findData( name );
+    if ( index >= 0 )
+    {
+        ui->comboBoxNetworkInterface->removeItem( index );
+    }
 }
 
 void
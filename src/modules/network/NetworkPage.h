@@ -15,6 +15,8 @@
 #ifndef NETWORKPAGE_H
 #define NETWORKPAGE_H
 
+#include "NetworkInterfaceList.h"
+
 #include <QWidget>
 #include <QString>
 
@@ -35,6 +37,8 @@ public:
     ~NetworkPage() override;
 
     void onActivate();
+    /// @brief Lists @p interfaces to choose from, and selects one
+    void setInterfaces( const QVector< NetworkUtils::NetworkInterface >& interfaces );
 
 protected slots:
     void onUseDhcpChanged( const int checked );
@@ -42,10 +46,15 @@ protected slots:
     void reportIpAddressStatus( const QString& );
     void reportMaskStatus( const QString& );
     void reportGatewayStatus( const QString& );
+    void onLinkChanged( const QString& name );
+    void onLinkRemoved( const QString& name );
 
 private:
     void retranslate();
     void initInterfaces();
+    /// @brief Adds or updates the entry of @p networkInterface
+    void updateInterface( const NetworkUtils::NetworkInterface& networkInterface );
+    QString describeInterface( const NetworkUtils::NetworkInterface& networkInterface ) const;
 
     int m_interfaceIndex = 0;
 
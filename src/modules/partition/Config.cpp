@@ -454,6 +454,32 @@ Config::setConfigurationMap( const QVariantMap& configurationMap )
         m_isLVMEnabled = Calamares::getBool( lvmConfiguration, "enable", true );
     }
 
+    {
+        bool bogus = true;
+        const auto osproberConfiguration = Calamares::getSubMap( configurationMap, "osProber", bogus );
+        m_isOsproberEnabled = Calamares::getBool( osproberConfiguration, "enable", true );
+        const auto timeout = Calamares::getInteger( osproberConfiguration, "timeout", 60 );
+        if ( timeout <= 0 )
+        {
+            cWarning() << "Partition-module setting *osProber.timeout* must be positive, using 60 seconds.";
+        }
+        m_osproberTimeout = std::chrono::seconds( timeout > 0 ? timeout : 60 );
+    }
+
+    {
+        bool bogus = true;
+        const auto speedConfiguration = Calamares::getSubMap( configurationMap, "diskSpeed", bogus );
+        m_isDiskSpeedProbeEnabled = Calamares::getBool( speedConfiguration, "enable", false );
+        const auto probeSize = Calamares::getInteger( speedConfiguration, "probeSize", 256 );
+        if ( probeSize <= 0 )
+        {
+            cWarning() << "Partition-module setting *diskSpeed.probeSize* must be positive, using 256 MiB.";
+        }
+        m_diskSpeedProbeSize = qint64( probeSize > 0 ? probeSize : 256 ) * 1024 * 1024;
+        m_slowDiskThreshold = qint64( Calamares::getInteger( speedConfiguration, "slowThreshold", 50 ) ) * 1024 * 1024;
+        m_preselectFastestDisk = Calamares::getBool( speedConfiguration, "preselectFastest", false );
+    }
+
     m_essentialMounts= Calamares::getStringList( configurationMap, "essentialMounts" );
 
     Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
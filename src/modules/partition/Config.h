@@ -18,6 +18,8 @@
 #include <QObject>
 #include <QSet>
 
+#include <chrono>
+
 class Config : public QObject
 {
     Q_OBJECT
@@ -188,6 +190,20 @@ public:
      */
     QStringList essentialMounts() const { return m_essentialMounts; }
 
+    /// @brief Should os-prober look for other operating systems?
+    bool isOsproberEnabled() const { return m_isOsproberEnabled; }
+    /// @brief How long os-prober may take before it is stopped
+    std::chrono::seconds osproberTimeout() const { return m_osproberTimeout; }
+
+    /// @brief Should the speed of the disks be measured?
+    bool isDiskSpeedProbeEnabled() const { return m_isDiskSpeedProbeEnabled; }
+    /// @brief How much of each disk is read to measure its speed, in bytes
+    qint64 diskSpeedProbeSize() const { return m_diskSpeedProbeSize; }
+    /// @brief Disks slower than this (bytes per second) are flagged
+    qint64 slowDiskThreshold() const { return m_slowDiskThreshold; }
+    /// @brief Should the fastest disk be selected, once the speeds are known?
+    bool preselectFastestDisk() const { return m_preselectFastestDisk; }
+
 public Q_SLOTS:
     void setInstallChoice( int );  ///< Translates a button ID or so to InstallChoice
     void setInstallChoice( InstallChoice );
@@ -224,6 +240,12 @@ private:
     bool m_showNotEncryptedBootMessage = true;
     bool m_isLVMEnabled = true;
     QStringList m_essentialMounts;
+    bool m_isOsproberEnabled = true;
+    std::chrono::seconds m_osproberTimeout { 60 };
+    bool m_isDiskSpeedProbeEnabled = false;
+    qint64 m_diskSpeedProbeSize = 256 * 1024 * 1024;
+    qint64 m_slowDiskThreshold = 50 * 1024 * 1024;
+    bool m_preselectFastestDisk = false;
 };
 
 /** @brief Given a set of swap choices, return a sensible value from it.
@@ -58,6 +58,19 @@ PartitionViewStep::PartitionViewStep( QObject* parent )
         if ( m_waitingWidget ) { m_waitingWidget->setText( tr( "Gathering system information…", "@status" ) ); } );
 
     m_core = new PartitionCoreModule( this );  // Unusable before init is complete!
+    connect( m_core,
+             &PartitionCoreModule::scanProgress,
+             this,
+             [ this ]( int scanned, int total )
+             {
+                 if ( m_waitingWidget )
+                 {
+                     //: %1 and %2 are numbers of disks
+                     m_waitingWidget->setText( tr( "Gathering system information… (%1 of %2 disks)", "@status" )
+                                                   .arg( scanned )
+                                                   .arg( total ) );
+                 }
+             } );
     // We're not done loading, but we need the configuration map first.
 }
 
@@ -464,6 +477,8 @@ void
 PartitionViewStep::onActivate()
 {
     m_config->fillGSSecondaryConfiguration();
+    // Back from the next page, where onLeave() stopped them
+    m_core->resumeProbes();
 
     // if we're coming back to PVS from the next VS
     if ( m_widget->currentWidget() == m_choicePage && m_config->installChoice() == Config::InstallChoice::Alongside )
@@ -682,6 +697,11 @@ checkForFilesystemConflicts( PartitionCoreModule* core )
 void
 PartitionViewStep::onLeave()
 {
+    // os-prober results are only used on this page, and os-prober must
+    // not be mounting things when the installation starts.
+    m_core->cancelOsprober();
+    m_core->cancelDiskSpeedProbe();
+
     if ( m_widget->currentWidget() == m_choicePage )
     {
         m_choicePage->onLeave();
@@ -921,6 +941,10 @@ PartitionViewStep::setConfigurationMap( const QVariantMap& configurationMap )
     gs->insert( "createHybridBootloaderLayout",
                 Calamares::getBool( configurationMap, "createHybridBootloaderLayout", false ) );
 
+    m_core->setOsproberPolicy( m_config->isOsproberEnabled(), m_config->osproberTimeout() );
+    m_core->setDiskSpeedPolicy(
+        m_config->isDiskSpeedProbeEnabled(), m_config->diskSpeedProbeSize(), m_config->slowDiskThreshold() );
+
     // Now that we have the config, we load the PartitionCoreModule in the background
     // because it could take a while. Then when it's done, we can set up the widgets
     // and remove the spinner.
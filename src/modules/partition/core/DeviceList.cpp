@@ -11,15 +11,22 @@
 #include "DeviceList.h"
 
 #include "partition/PartitionIterator.h"
+#include "partition/Probe.h"
 #include "utils/Logger.h"
-#include "utils/System.h"
 
 #include <kpmcore/backend/corebackend.h>
 #include <kpmcore/backend/corebackendmanager.h>
 #include <kpmcore/core/device.h>
 #include <kpmcore/core/partition.h>
+#include <kpmcore/core/volumemanagerdevice.h>
 
-#include <QProcess>
+#include <QAtomicInt>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
 
 using Calamares::Partition::PartitionIterator;
 
@@ -50,9 +57,8 @@ hasRootPartition( Device* device )
 static bool
 blkIdCheckIso9660( const QString& path )
 {
-    // If blkid fails, there's no output, but we don't care
-    auto r = Calamares::System::runCommand( { "blkid", path }, std::chrono::seconds( 30 ) );
-    return r.getOutput().contains( "iso9660" );
+    // If probing fails, there's no type, but we don't care
+    return Calamares::Partition::probe( path ).fsType == QStringLiteral( "iso9660" );
 }
 
 /// @brief Convenience to check if @p partition holds an iso9660 filesystem
@@ -120,8 +126,82 @@ erase( DeviceList& l, DeviceList::iterator& it )
     return r;
 }
 
+/** @brief Device nodes of the writable disks, sorted
+ *
+ * These are the devices that KPMcore's scanDevices() would consider
+ * without includeReadOnly and includeLoopback: block devices backed by
+ * hardware, which leaves out loop, RAM, device-mapper and md devices.
+ */
+static QStringList
+diskNodes()
+{
+    QStringList nodes;
+    const auto names
+        = QDir( QStringLiteral( "/sys/block" ) ).entryList( QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System );
+    for ( const auto& name : names )
+    {
+        const QString sys = QStringLiteral( "/sys/block/" ) + name;
+        QFile ro( sys + QStringLiteral( "/ro" ) );
+        if ( !QFileInfo::exists( sys + QStringLiteral( "/device" ) ) || name.startsWith( QStringLiteral( "sr" ) )
+             || !ro.open( QIODevice::ReadOnly ) || ro.readAll().trimmed() != "0" )
+        {
+            continue;
+        }
+        nodes.append( QStringLiteral( "/dev/" ) + name );
+    }
+    nodes.sort();
+    return nodes;
+}
+
+/** @brief Scans the disks in parallel, like CoreBackend::scanDevices()
+ *
+ * Scanning a disk runs several tools for it and each of its partitions,
+ * so with many disks it pays to do them at the same time. LVM volume
+ * groups are added afterwards, as KPMcore does.
+ */
+static DeviceList
+scanDevices( CoreBackend* backend, const ScanProgress& progress )
+{
+    const QStringList nodes = diskNodes();
+    // The Devices are QObjects, so give them to this thread, as a serial scan would
+    QThread* thread = QThread::currentThread();
+    const QString module = Logger::currentModule();
+    QAtomicInt scanned( 0 );
+
+    QList< QFuture< Device* > > futures;
+    for ( const auto& node : nodes )
+    {
+        futures.append( QtConcurrent::run(
+            [ =, &scanned ]() -> Device*
+            {
+                Logger::ModuleScope scope( module );
+                Device* device = backend->scanDevice( node );
+                if ( device )
+                {
+                    device->moveToThread( thread );
+                }
+                if ( progress )
+                {
+                    progress( scanned.fetchAndAddOrdered( 1 ) + 1, nodes.count() );
+                }
+                return device;
+            } ) );
+    }
+
+    DeviceList devices;
+    for ( auto& f : futures )
+    {
+        if ( Device* device = f.result() )
+        {
+            devices.append( device );
+        }
+    }
+    VolumeManagerDevice::scanDevices( devices );
+    return devices;
+}
+
 QList< Device* >
-getDevices( DeviceType which )
+getDevices( DeviceType which, const ScanProgress& progress )
 {
     CoreBackend* backend = CoreBackendManager::self()->backend();
     if ( !backend )
@@ -129,7 +209,10 @@ getDevices( DeviceType which )
         cWarning() << "No KPM backend found.";
         return {};
     }
-    DeviceList devices = backend->scanDevices( /* not includeReadOnly, not includeLoopback */ ScanFlag( 0 ) );
+    QElapsedTimer timer;
+    timer.start();
+    DeviceList devices = scanDevices( backend, progress );
+    cDebug() << "Scanned" << devices.count() << "devices in" << timer.elapsed() << "ms";
 
     /* The list of devices is cleaned up for use:
      *  - some devices can **never** be used (e.g. floppies, nullptr)
@@ -155,6 +238,11 @@ getDevices( DeviceType which )
 #endif
 
     cDebug() << "Removing unsuitable devices:" << devices.count() << "candidates.";
+    // The iso9660 checks look at every device and partition; do that all at once
+    if ( which == DeviceType::WritableOnly )
+    {
+        Calamares::Partition::probeAll();
+    }
 
     bool writableOnly = ( which == DeviceType::WritableOnly );
     // Remove the device which contains / from the list
@@ -194,4 +282,33 @@ getDevices( DeviceType which )
     return devices;
 }
 
+QString
+kernelPartitionLayout( const QString& deviceNode )
+{
+    const QString name = QFileInfo( QFileInfo( deviceNode ).canonicalFilePath() ).fileName();
+    if ( name.isEmpty() )
+    {
+        return QString();
+    }
+
+    auto read = []( const QString& path )
+    {
+        QFile f( path );
+        return f.open( QIODevice::ReadOnly ) ? QString::fromLatin1( f.readAll().trimmed() ) : QString();
+    };
+
+    const QString sys = QStringLiteral( "/sys/class/block/" ) + name;
+    QStringList layout { read( sys + QStringLiteral( "/size" ) ) };
+    const auto entries = QDir( sys ).entryList( QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name );
+    for ( const auto& entry : entries )
+    {
+        if ( QFileInfo::exists( sys + '/' + entry + QStringLiteral( "/partition" ) ) )
+        {
+            layout.append( entry + ':' + read( sys + '/' + entry + QStringLiteral( "/start" ) ) + ':'
+                           + read( sys + '/' + entry + QStringLiteral( "/size" ) ) );
+        }
+    }
+    return layout.join( ' ' );
+}
+
 }  // namespace PartUtils
@@ -14,6 +14,8 @@
 #include <QList>
 #include <QString>
 
+#include <functional>
+
 class Device;
 
 namespace PartUtils
@@ -25,15 +27,31 @@ enum class DeviceType
     WritableOnly
 };
 
+/** @brief Called each time a disk has been scanned
+ *
+ * The arguments are the number of disks scanned so far and the total.
+ * This is called from the thread that finished the scan.
+ */
+using ScanProgress = std::function< void( int scanned, int total ) >;
+
 /**
  * @brief Gets a list of storage devices.
  * @param which Can be used to select from all the devices in
  *      the system, filtering out those that do not meet a criterium.
  *      If set to WritableOnly, only devices which can be overwritten
  *      safely are returned (e.g. RO-media are ignored, as are mounted partitions).
+ * @param progress Is told about each disk scanned; disks are scanned in parallel.
  * @return a list of Devices meeting this criterium.
  */
-QList< Device* > getDevices( DeviceType which = DeviceType::All );
+QList< Device* > getDevices( DeviceType which = DeviceType::All, const ScanProgress& progress = nullptr );
+
+/** @brief The partitions on the disk @p deviceNode, as the kernel sees them
+ *
+ * This is the size of the disk and the start and size of each partition,
+ * read from sysfs. It changes when the partition table on the disk is
+ * changed, so compare it to find out if a disk needs scanning again.
+ */
+QString kernelPartitionLayout( const QString& deviceNode );
 
 }  // namespace PartUtils
 
@@ -25,6 +25,17 @@
 // STL
 #include <algorithm>
 
+/// @brief Short text for a duration of @p seconds
+static QString
+formatDuration( qint64 seconds )
+{
+    if ( seconds < 60 )
+    {
+        return DeviceModel::tr( "%n second(s)", "@label", int( qMax( seconds, qint64( 1 ) ) ) );
+    }
+    return DeviceModel::tr( "%n minute(s)", "@label", int( ( seconds + 30 ) / 60 ) );
+}
+
 static void
 sortDevices( DeviceModel::DeviceList& l )
 {
@@ -65,24 +76,28 @@ DeviceModel::data( const QModelIndex& index, int role ) const
     }
 
     Device* device = m_devices.at( row );
+    const PartUtils::DiskSpeed speed = m_diskSpeeds.value( device->deviceNode() );
+    const bool isSlow = speed.isValid() && speed.bytesPerSecond < m_slowDiskThreshold;
 
     switch ( role )
     {
     case Qt::DisplayRole:
     case Qt::ToolTipRole:
+    {
+        QString text;
         if ( device->name().isEmpty() )
         {
-            return device->deviceNode();
+            text = device->deviceNode();
         }
         else
         {
             if ( device->logicalSize() >= 0 && device->totalLogical() >= 0 )
             {
                 //: device[name] - size[number] (device-node[name])
-                return tr( "%1 - %2 (%3)" )
-                    .arg( device->name() )
-                    .arg( formatByteSize( device->capacity() ) )
-                    .arg( device->deviceNode() );
+                text = tr( "%1 - %2 (%3)" )
+                           .arg( device->name() )
+                           .arg( formatByteSize( device->capacity() ) )
+                           .arg( device->deviceNode() );
             }
             else
             {
@@ -90,12 +105,37 @@ DeviceModel::data( const QModelIndex& index, int role ) const
                 // always has 1B capacity), so don't show it for a while.
                 //
                 //: device[name] - (device-node[name])
-                return tr( "%1 - (%2)" ).arg( device->name() ).arg( device->deviceNode() );
+                text = tr( "%1 - (%2)" ).arg( device->name() ).arg( device->deviceNode() );
             }
         }
+        if ( !speed.isValid() )
+        {
+            return text;
+        }
+
+        // Writing is about as fast as reading, for the sequential writes of an image
+        const QString estimate = m_imageSize > 0 ? formatDuration( m_imageSize / speed.bytesPerSecond ) : QString();
+        if ( role == Qt::DisplayRole )
+        {
+            //: The first %1 is the device, %2 a speed like 500 MiB, %3 a time like 2 minutes
+            return estimate.isEmpty() ? tr( "%1, %2/s" ).arg( text, formatByteSize( speed.bytesPerSecond ) )
+                                      : tr( "%1, %2/s, about %3" )
+                                            .arg( text, formatByteSize( speed.bytesPerSecond ), estimate );
+        }
+        QStringList tooltip { text, tr( "Reads %1 per second." ).arg( formatByteSize( speed.bytesPerSecond ) ) };
+        if ( !estimate.isEmpty() )
+        {
+            tooltip.append( tr( "Writing the image takes about %1." ).arg( estimate ) );
+        }
+        if ( isSlow )
+        {
+            tooltip.append( tr( "This disk is unusually slow, it may be degraded." ) );
+        }
+        return tooltip.join( '\n' );
+    }
     case Qt::DecorationRole:
         return Calamares::defaultPixmap(
-            Calamares::PartitionDisk,
+            isSlow ? Calamares::StatusWarning : Calamares::PartitionDisk,
             Calamares::Original,
             QSize( Calamares::defaultIconSize().width() * 2, Calamares::defaultIconSize().height() * 2 ) );
     default:
@@ -148,3 +188,63 @@ DeviceModel::removeDevice( Device* device )
     sortDevices( m_devices );
     endResetModel();
 }
+
+void
+DeviceModel::setDiskSpeed( const QString& deviceNode, const PartUtils::DiskSpeed& speed )
+{
+    m_diskSpeeds.insert( deviceNode, speed );
+    for ( int row = 0; row < m_devices.count(); ++row )
+    {
+        if ( m_devices.at( row )->deviceNode() == deviceNode )
+        {
+            Q_EMIT dataChanged( index( row ), index( row ) );
+        }
+    }
+}
+
+PartUtils::DiskSpeed
+DeviceModel::diskSpeed( const QString& deviceNode ) const
+{
+    return m_diskSpeeds.value( deviceNode );
+}
+
+void
+DeviceModel::setSlowDiskThreshold( qint64 bytesPerSecond )
+{
+    m_slowDiskThreshold = bytesPerSecond;
+    if ( !m_devices.isEmpty() )
+    {
+        Q_EMIT dataChanged( index( 0 ), index( m_devices.count() - 1 ) );
+    }
+}
+
+void
+DeviceModel::setImageSize( qint64 bytes )
+{
+    if ( bytes == m_imageSize )
+    {
+        return;
+    }
+    m_imageSize = bytes;
+    if ( !m_devices.isEmpty() )
+    {
+        Q_EMIT dataChanged( index( 0 ), index( m_devices.count() - 1 ) );
+    }
+}
+
+int
+DeviceModel::fastestDeviceRow() const
+{
+    int fastest = -1;
+    qint64 fastestSpeed = 0;
+    for ( int row = 0; row < m_devices.count(); ++row )
+    {
+        const qint64 speed = m_diskSpeeds.value( m_devices.at( row )->deviceNode() ).bytesPerSecond;
+        if ( speed > fastestSpeed )
+        {
+            fastest = row;
+            fastestSpeed = speed;
+        }
+    }
+    return fastest;
+}
@@ -10,7 +10,10 @@
 #ifndef DEVICEMODEL_H
 #define DEVICEMODEL_H
 
+#include "core/DiskSpeed.h"
+
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
 #include <QScopedPointer>
 
@@ -19,6 +22,9 @@ class PartitionModel;
 
 /**
  * A Qt model which exposes a list of Devices.
+ *
+ * When the speed of a device has been measured, it is shown with the
+ * device, along with how long writing the image would take.
  */
 class DeviceModel : public QAbstractListModel
 {
@@ -46,8 +52,25 @@ public:
 
     void removeDevice( Device* device );
 
+    /** @brief Remembers how fast the disk @p deviceNode is
+     *
+     * Speeds are kept by device node, so they survive init().
+     */
+    void setDiskSpeed( const QString& deviceNode, const PartUtils::DiskSpeed& speed );
+    PartUtils::DiskSpeed diskSpeed( const QString& deviceNode ) const;
+    /// @brief Disks that read slower than @p bytesPerSecond are flagged; 0 flags none
+    void setSlowDiskThreshold( qint64 bytesPerSecond );
+    /// @brief How much is written to the disk, for the estimate; 0 if not known
+    void setImageSize( qint64 bytes );
+
+    /// @brief Row of the fastest disk that was measured, or -1 if none was
+    int fastestDeviceRow() const;
+
 private:
     DeviceList m_devices;
+    QHash< QString, PartUtils::DiskSpeed > m_diskSpeeds;
+    qint64 m_slowDiskThreshold = 0;
+    qint64 m_imageSize = 0;
 };
 
 #endif /* DEVICEMODEL_H */
@@ -0,0 +1,102 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#include "DiskSpeed.h"
+
+#include "partition/Topology.h"
+#include "utils/Logger.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/// Size of each read, rounded to whole RAID stripes; the kernel splits it into requests of max_sectors_kb
+static constexpr quint64 CHUNK_SIZE = 4 * 1024 * 1024;
+/// O_DIRECT needs aligned buffers; this covers any logical block size
+static constexpr std::size_t ALIGNMENT = 4096;
+/// A degraded disk is not read for long, it is slow enough after a few seconds
+static constexpr qint64 TIME_LIMIT_MS = 10000;
+
+static int
+readSysfsNumber( const QString& path )
+{
+    QFile f( path );
+    return f.open( QIODevice::ReadOnly ) ? f.readAll().trimmed().toInt() : 0;
+}
+
+namespace PartUtils
+{
+
+DiskSpeed
+probeDiskSpeed( const QString& deviceNode, qint64 bytes, const std::atomic< bool >& cancelled )
+{
+    DiskSpeed speed;
+
+    // sysfs has the kernel name, e.g. dm-0 rather than /dev/mapper/something
+    const QString canonical = QFileInfo( deviceNode ).canonicalFilePath();
+    const QString queue = QStringLiteral( "/sys/class/block/%1/queue/" )
+                              .arg( QFileInfo( canonical.isEmpty() ? deviceNode : canonical ).fileName() );
+    speed.isRotational = readSysfsNumber( queue + QStringLiteral( "rotational" ) ) == 1;
+    speed.maxSectorsKiB = readSysfsNumber( queue + QStringLiteral( "max_sectors_kb" ) );
+    speed.queueDepth = readSysfsNumber( queue + QStringLiteral( "nr_requests" ) );
+    const std::size_t chunkSize = Calamares::Partition::topology( deviceNode ).ioSize( CHUNK_SIZE );
+
+    const int fd = open( deviceNode.toLocal8Bit().constData(), O_RDONLY | O_DIRECT | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        cWarning() << "Could not open" << deviceNode << "to measure its speed:" << strerror( errno );
+        return speed;
+    }
+    void* buffer = nullptr;
+    if ( posix_memalign( &buffer, ALIGNMENT, chunkSize ) != 0 )
+    {
+        close( fd );
+        return speed;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 done = 0;
+    while ( done < bytes && !cancelled && timer.elapsed() < TIME_LIMIT_MS )
+    {
+        const ssize_t r = read( fd, buffer, chunkSize );
+        if ( r < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( r <= 0 )
+        {
+            // The end of a small disk, or an error; what was read so far still counts
+            break;
+        }
+        done += r;
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+    free( buffer );
+    close( fd );
+
+    // A single read says more about latency than about speed
+    if ( !cancelled && done >= qint64( chunkSize ) && elapsed > 0 )
+    {
+        speed.bytesPerSecond = qint64( double( done ) * 1e9 / elapsed );
+    }
+    cDebug() << "Disk" << deviceNode << "read" << done << "bytes in" << elapsed / 1000000 << "ms,"
+             << ( speed.isRotational ? "rotational," : "non-rotational," ) << "max_sectors_kb"
+             << speed.maxSectorsKiB << "nr_requests" << speed.queueDepth;
+    return speed;
+}
+
+}  // namespace PartUtils
@@ -0,0 +1,42 @@
+/* === This file is part of Calamares - <https://calamares.io> ===
+ *
+ *   SPDX-FileCopyrightText: 2025 Savoir-faire Linux, Inc.
+ *   SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ *   Calamares is Free Software: see the License-Identifier above.
+ *
+ */
+
+#ifndef PARTITION_DISKSPEED_H
+#define PARTITION_DISKSPEED_H
+
+#include <QString>
+
+#include <atomic>
+
+namespace PartUtils
+{
+
+/** @brief How fast a disk is, as far as a quick look can tell */
+struct DiskSpeed
+{
+    qint64 bytesPerSecond = 0;  ///< Sequential read speed; 0 if it was not measured
+    bool isRotational = false;  ///< From sysfs queue/rotational
+    int maxSectorsKiB = 0;  ///< Largest request the kernel sends, from sysfs queue/max_sectors_kb
+    int queueDepth = 0;  ///< From sysfs queue/nr_requests
+
+    bool isValid() const { return bytesPerSecond > 0; }
+};
+
+/** @brief Measures how fast the disk @p deviceNode reads
+ *
+ * Reads (at most) @p bytes from the start of the disk, bypassing the
+ * page cache, and stops early if that takes too long or when
+ * @p cancelled is set. Nothing is written. This blocks, so call it
+ * from a thread.
+ */
+DiskSpeed probeDiskSpeed( const QString& deviceNode, qint64 bytes, const std::atomic< bool >& cancelled );
+
+}  // namespace PartUtils
+
+#endif
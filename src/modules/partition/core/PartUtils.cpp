@@ -17,11 +17,15 @@
 
 #include "GlobalStorage.h"
 #include "JobQueue.h"
+#include "compat/Mutex.h"
 #include "partition/Mount.h"
 #include "partition/PartitionIterator.h"
 #include "partition/PartitionQuery.h"
+#include "partition/Probe.h"
+#include "partition/Topology.h"
 #include "utils/Logger.h"
 #include "utils/RAII.h"
+#include "utils/Runner.h"
 #include "utils/System.h"
 
 #include <kpmcore/backend/corebackend.h>
@@ -29,11 +33,21 @@
 #include <kpmcore/core/device.h>
 #include <kpmcore/core/partition.h>
 
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 #include <QProcess>
+#include <QSet>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 
 using Calamares::Partition::isPartitionFreeSpace;
 using Calamares::Partition::isPartitionNew;
+using Calamares::Partition::PartitionIterator;
 
 using Calamares::Units::operator""_MiB;
 
@@ -228,22 +242,17 @@ lookForFstabEntries( const QString& partitionPath )
 {
     QStringList mountOptions { "ro" };
 
-    auto r = Calamares::System::runCommand( Calamares::System::RunLocation::RunInHost,
-                                            { "blkid", "-s", "TYPE", "-o", "value", partitionPath } );
-    if ( r.getExitCode() )
+    const auto probed = Calamares::Partition::probe( partitionPath );
+    if ( !probed.isValid )
     {
         cWarning() << "blkid on" << partitionPath << "failed.";
     }
-    else
+    else if ( ( probed.fsType == "ext3" ) || ( probed.fsType == "ext4" ) )
     {
-        QString fstype = r.getOutput().trimmed();
-        if ( ( fstype == "ext3" ) || ( fstype == "ext4" ) )
-        {
-            mountOptions.append( "noload" );
-        }
+        mountOptions.append( "noload" );
     }
 
-    cDebug() << "Checking device" << partitionPath << "for fstab (fs=" << r.getOutput() << ')';
+    cDebug() << "Checking device" << partitionPath << "for fstab (fs=" << probed.fsType << ')';
 
     Calamares::Partition::TemporaryMount mount( partitionPath, QString(), mountOptions.join( ',' ) );
     if ( mount.isValid() )
@@ -348,33 +357,155 @@ findPartitionPathForMountPoint( const FstabEntryList& fstab, const QString& moun
     return QString();
 }
 
+/// @brief The kernel name of the device at @p path, so /dev/mapper/ and /dev/disk/ links match
+static QString
+canonicalDevicePath( const QString& path )
+{
+    const QString canonical = QFileInfo( path ).canonicalFilePath();
+    return canonical.isEmpty() ? path : canonical;
+}
+
+static QString
+osproberCachePath()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + QStringLiteral( "/os-prober" );
+}
+
+static QMutex s_osproberCacheMutex;
+static QHash< QString, QStringList > s_osproberCache;  ///< os-prober output, by fingerprint
+
+/** @brief Looks for cached os-prober output for @p fingerprint
+ *
+ * The output of the most recent run is also kept in a file, so
+ * that restarting Calamares does not run os-prober again.
+ */
+static bool
+readOsproberCache( const QString& fingerprint, QStringList& lines )
+{
+    {
+        Calamares::MutexLocker lock( &s_osproberCacheMutex );
+        const auto it = s_osproberCache.constFind( fingerprint );
+        if ( it != s_osproberCache.constEnd() )
+        {
+            lines = it.value();
+            return true;
+        }
+    }
+
+    QFile f( osproberCachePath() );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        return false;
+    }
+    const QStringList cached = QString::fromUtf8( f.readAll() ).split( '\n' );
+    if ( cached.first() != fingerprint )
+    {
+        return false;
+    }
+    lines = cached.mid( 1 );
+    return true;
+}
+
+static void
+writeOsproberCache( const QString& fingerprint, const QStringList& lines )
+{
+    {
+        Calamares::MutexLocker lock( &s_osproberCacheMutex );
+        s_osproberCache.insert( fingerprint, lines );
+    }
+
+    const QString path = osproberCachePath();
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+    QFile f( path );
+    if ( f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        f.write( ( QStringList { fingerprint } + lines ).join( '\n' ).toUtf8() );
+    }
+}
+
+QString
+osproberFingerprint( const QList< Device* >& devices )
+{
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    for ( Device* device : devices )
+    {
+        hash.addData( device->deviceNode().toUtf8() );
+        hash.addData( QByteArray::number( device->capacity() ) );
+        for ( auto it = PartitionIterator::begin( device ); it != PartitionIterator::end( device ); ++it )
+        {
+            const Partition* partition = *it;
+            hash.addData( partition->partitionPath().toUtf8() );
+            hash.addData( QByteArray::number( partition->firstSector() ) );
+            hash.addData( QByteArray::number( partition->lastSector() ) );
+            hash.addData( QByteArray::number( static_cast< int >( partition->fileSystem().type() ) ) );
+            hash.addData( partition->fileSystem().uuid().toUtf8() );
+        }
+    }
+    return QString::fromLatin1( hash.result().toHex() );
+}
+
 OsproberEntryList
-runOsprober( DeviceModel* dm )
+runOsprober( const QString& fingerprint,
+             const QStringList& devicePaths,
+             std::chrono::seconds timeout,
+             const std::atomic< bool >& cancelled )
 {
     Logger::Once o;
 
-    QString osproberOutput;
-    QProcess osprober;
-    osprober.setProgram( "os-prober" );
-    osprober.setProcessChannelMode( QProcess::SeparateChannels );
-    osprober.start();
-    if ( !osprober.waitForStarted() )
+    QStringList lines;
+    if ( readOsproberCache( fingerprint, lines ) )
     {
-        cError() << "os-prober cannot start.";
+        cDebug() << o << "Using cached os-prober output.";
     }
-    else if ( !osprober.waitForFinished( 60000 ) )
+    else
     {
-        cError() << "os-prober timed out.";
+        using Code = Calamares::ProcessResult::Code;
+
+        QElapsedTimer timer;
+        timer.start();
+        Calamares::Utils::Runner runner( { QStringLiteral( "os-prober" ) } );
+        runner.setTimeout( timeout );
+        auto process = runner.start();
+        while ( !process.waitFor( std::chrono::seconds( 1 ) ) )
+        {
+            if ( cancelled )
+            {
+                process.cancel();
+                process.wait();
+                cDebug() << o << "os-prober was cancelled.";
+                return {};
+            }
+        }
+
+        const auto r = process.result();
+        if ( r.getExitCode() == static_cast< int >( Code::FailedToStart ) )
+        {
+            cError() << "os-prober cannot start.";
+        }
+        else if ( r.getExitCode() == static_cast< int >( Code::TimedOut ) )
+        {
+            cError() << "os-prober timed out.";
+        }
+        else if ( r.getExitCode() < 0 )
+        {
+            cError() << "os-prober crashed.";
+        }
+        else
+        {
+            lines = r.getOutput().split( '\n' );
+            writeOsproberCache( fingerprint, lines );
+        }
+        cDebug() << o << "os-prober took" << timer.elapsed() << "ms";
     }
-    else
+
+    QSet< QString > selectedPaths;
+    for ( const auto& devicePath : devicePaths )
     {
-        osproberOutput.append( QString::fromLocal8Bit( osprober.readAllStandardOutput() ).trimmed() );
+        selectedPaths.insert( canonicalDevicePath( devicePath ) );
     }
 
-    QStringList osproberCleanLines;
     OsproberEntryList osproberEntries;
-    const auto lines = osproberOutput.split( '\n' );
-    for ( const QString& line : lines )
+    for ( const QString& line : std::as_const( lines ) )
     {
         if ( !line.simplified().isEmpty() )
         {
@@ -403,21 +534,39 @@ runOsprober( DeviceModel* dm )
                 path = path.left( index );
             }
 
+            // Don't look inside (that is, mount) file systems we can't install to anyway
+            if ( !selectedPaths.contains( canonicalDevicePath( path ) ) )
+            {
+                cDebug() << o << "Ignoring os-prober entry for" << path << "which is not on a selected device.";
+                continue;
+            }
+            if ( cancelled )
+            {
+                return {};
+            }
+
             FstabEntryList fstabEntries = lookForFstabEntries( path );
             QString homePath = findPartitionPathForMountPoint( fstabEntries, "/home" );
 
-            osproberEntries.append( { prettyName,
-                                      path,
-                                      file,
-                                      QString(),
-                                      canBeResized( dm, path, o ),
-                                      lineColumns,
-                                      fstabEntries,
-                                      homePath } );
-            osproberCleanLines.append( line );
+            osproberEntries.append( { prettyName, path, file, QString(), false, lineColumns, fstabEntries, homePath } );
         }
     }
 
+    return osproberEntries;
+}
+
+void
+updateOsproberEntries( DeviceModel* dm, OsproberEntryList& entries )
+{
+    Logger::Once o;
+
+    QStringList osproberCleanLines;
+    for ( auto& entry : entries )
+    {
+        entry.canBeResized = canBeResized( dm, entry.path, o );
+        osproberCleanLines.append( entry.line.join( ':' ) );
+    }
+
     if ( osproberCleanLines.count() > 0 )
     {
         cDebug() << o << "os-prober lines after cleanup:" << Logger::DebugList( osproberCleanLines );
@@ -428,8 +577,6 @@ runOsprober( DeviceModel* dm )
     }
 
     Calamares::JobQueue::instance()->globalStorage()->insert( "osproberLines", osproberCleanLines );
-
-    return osproberEntries;
 }
 
 bool
@@ -633,4 +780,17 @@ canonicalFilesystemName( const QString& fsName, FileSystem::Type* fsType )
     return QStringLiteral( "ext4" );
 }
 
+qint64
+alignedSector( const Device* device, qint64 sector )
+{
+    const auto topology = Calamares::Partition::topology( device->deviceNode() );
+    const qint64 sectorSize = device->logicalSize();
+    if ( !topology.isValid || sectorSize <= 0 || sector < 0 )
+    {
+        return sector;
+    }
+    const quint64 aligned = topology.alignUp( quint64( sector ) * quint64( sectorSize ) );
+    return qint64( ( aligned + quint64( sectorSize ) - 1 ) / quint64( sectorSize ) );
+}
+
 }  // namespace PartUtils
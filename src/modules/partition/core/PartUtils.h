@@ -22,6 +22,10 @@
 // Qt
 #include <QString>
 
+#include <atomic>
+#include <chrono>
+
+class Device;
 class DeviceModel;
 class Partition;
 namespace Logger
@@ -70,12 +74,37 @@ bool canBeResized( Partition* candidate, const Logger::Once& o );
 bool canBeResized( DeviceModel* dm, const QString& partitionPath, const Logger::Once& o );
 
 /**
- * @brief runOsprober executes os-prober, parses the output and writes relevant
- * data to GlobalStorage.
- * @param dm the DeviceModel instance.
+ * @brief osproberFingerprint identifies the partitions on @p devices
+ *
+ * The fingerprint changes when partitions or file systems on the devices
+ * change, so it is used as key for caching the os-prober output.
+ */
+QString osproberFingerprint( const QList< Device* >& devices );
+
+/**
+ * @brief runOsprober executes os-prober and parses the output.
+ *
+ * This blocks until os-prober is done, so call it from a background thread.
+ * os-prober is stopped when @p timeout has passed, or when @p cancelled
+ * is set. The output is cached by @p fingerprint, so os-prober is not
+ * run again for the same disks.
+ *
+ * Only entries for the paths in @p devicePaths (e.g. the partitions in
+ * the DeviceModel) are returned. Their canBeResized is not set, because
+ * that needs the DeviceModel; see updateOsproberEntries().
  * @return a list of os-prober entries, parsed.
  */
-OsproberEntryList runOsprober( DeviceModel* dm );
+OsproberEntryList runOsprober( const QString& fingerprint,
+                               const QStringList& devicePaths,
+                               std::chrono::seconds timeout,
+                               const std::atomic< bool >& cancelled );
+
+/**
+ * @brief updateOsproberEntries fills in canBeResized for each of @p entries,
+ * and writes the os-prober lines to GlobalStorage.
+ * @param dm the DeviceModel instance.
+ */
+void updateOsproberEntries( DeviceModel* dm, OsproberEntryList& entries );
 
 /**
  * @brief Is this an ARM-based system? Set in the configuration file
@@ -149,6 +178,14 @@ bool isEfiBootable( const Partition* candidate );
  */
 QString canonicalFilesystemName( const QString& fsName, FileSystem::Type* fsType );
 
+/** @brief The first sector at or after @p sector where a partition on @p device should start
+ *
+ * This follows the I/O topology of the device: 1MiB, or a multiple
+ * of it that suits its RAID stripes or flash erase blocks. If sysfs
+ * does not know the device, @p sector is returned as-is.
+ */
+qint64 alignedSector( const Device* device, qint64 sector );
+
 }  // namespace PartUtils
 
 #endif  // PARTUTILS_H
@@ -106,6 +106,8 @@ doAutopartition( PartitionCoreModule* core, Device* dev, Choices::AutoPartitionO
     // the first free sector has number 2048 (and there are 2048 sectors
     // before that one, numbered 0..2047).
     qint64 firstFreeSector = Calamares::bytesToSectors( empty_space_sizeB, dev->logicalSize() );
+    // .. or later, for RAID stripes or flash erase blocks larger than that
+    firstFreeSector = PartUtils::alignedSector( dev, firstFreeSector );
 
     PartitionTable::TableType partType = PartitionTable::nameToTableType( o.defaultPartitionTableType );
     if ( partType == PartitionTable::unknownTableType )
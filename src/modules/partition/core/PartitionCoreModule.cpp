@@ -17,6 +17,7 @@
 #include "core/ColorUtils.h"
 #include "core/DeviceList.h"
 #include "core/DeviceModel.h"
+#include "core/DiskSpeed.h"
 #include "core/KPMHelpers.h"
 #include "core/PartUtils.h"
 #include "core/PartitionInfo.h"
@@ -40,8 +41,11 @@
 #ifdef DEBUG_PARTITION_BAIL_OUT
 #include "JobExample.h"
 #endif
+#include "GlobalStorage.h"
+#include "JobQueue.h"
 #include "partition/PartitionIterator.h"
 #include "partition/PartitionQuery.h"
+#include "partition/Probe.h"
 #include "utils/Logger.h"
 #include "utils/Traits.h"
 #include "utils/Variant.h"
@@ -60,6 +64,7 @@
 // Qt
 #include <QDir>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QStandardItemModel>
 #include <QtConcurrent/QtConcurrent>
 
@@ -139,6 +144,18 @@ struct PartitionCoreModule::DeviceInfo
     void forgetChanges();
     bool isDirty() const;
 
+    /** @brief Keeps a copy of the partition table of the (unchanged) device
+     *
+     * This is done for disks only; LVM volume groups are always rescanned.
+     */
+    void takeSnapshot();
+    /** @brief Puts the partition table from the snapshot back on the device
+     *
+     * Returns @c false if there is no snapshot, or if the disk has changed
+     * since the snapshot was taken; then the device needs to be rescanned.
+     */
+    bool restoreSnapshot();
+
     const Calamares::JobList& jobs() const { return m_jobs; }
 
     /** @brief Take the jobs of the given type that apply to @p partition
@@ -196,6 +213,11 @@ struct PartitionCoreModule::DeviceInfo
 
 private:
     Calamares::JobList m_jobs;
+
+    bool m_hasSnapshot = false;
+    QScopedPointer< PartitionTable > m_snapshot;  ///< May be null, for a disk without partition table
+    quint64 m_snapshotSeqnum = 0;  ///< uevent sequence number when the snapshot was taken
+    QString m_snapshotLayout;  ///< Partitions as the kernel saw them when the snapshot was taken
 };
 
 
@@ -205,10 +227,49 @@ PartitionCoreModule::DeviceInfo::DeviceInfo( Device* _device )
     , immutableDevice( new Device( *_device ) )
     , isAvailable( true )
 {
+    takeSnapshot();
 }
 
 PartitionCoreModule::DeviceInfo::~DeviceInfo() {}
 
+void
+PartitionCoreModule::DeviceInfo::takeSnapshot()
+{
+    m_hasSnapshot = device->type() == Device::Type::Disk_Device;
+    if ( !m_hasSnapshot )
+    {
+        return;
+    }
+    m_snapshot.reset( device->partitionTable() ? new PartitionTable( *device->partitionTable() ) : nullptr );
+    m_snapshotSeqnum = Calamares::Partition::ueventSeqnum();
+    m_snapshotLayout = PartUtils::kernelPartitionLayout( device->deviceNode() );
+}
+
+bool
+PartitionCoreModule::DeviceInfo::restoreSnapshot()
+{
+    if ( !m_hasSnapshot )
+    {
+        return false;
+    }
+    const quint64 seqnum = Calamares::Partition::ueventSeqnum();
+    if ( seqnum != m_snapshotSeqnum )
+    {
+        // Something changed somewhere, but maybe not on this disk
+        if ( PartUtils::kernelPartitionLayout( device->deviceNode() ) != m_snapshotLayout )
+        {
+            return false;
+        }
+        m_snapshotSeqnum = seqnum;
+    }
+
+    // Device takes ownership of its table, but does not destroy the current one
+    PartitionTable* edited = device->partitionTable();
+    device->setPartitionTable( m_snapshot ? new PartitionTable( *m_snapshot ) : nullptr );
+    delete edited;
+    return true;
+}
+
 
 void
 PartitionCoreModule::DeviceInfo::forgetChanges()
@@ -247,6 +308,8 @@ PartitionCoreModule::PartitionCoreModule( QObject* parent )
     , m_deviceModel( new DeviceModel( this ) )
     , m_bootLoaderModel( new BootLoaderModel( this ) )
 {
+    // Created while the module loads, so this is its instance key
+    m_logModule = Logger::currentModule();
     if ( !m_kpmcore )
     {
         qFatal( "Failed to initialize KPMcore backend" );
@@ -257,6 +320,7 @@ PartitionCoreModule::PartitionCoreModule( QObject* parent )
 void
 PartitionCoreModule::init()
 {
+    Logger::ModuleScope scope( m_logModule );
     QMutexLocker locker( &m_revertMutex );
     doInit();
 }
@@ -268,7 +332,9 @@ PartitionCoreModule::doInit()
     FileSystemFactory::init();
 
     using DeviceList = QList< Device* >;
-    DeviceList devices = PartUtils::getDevices( PartUtils::DeviceType::WritableOnly );
+    DeviceList devices = PartUtils::getDevices( PartUtils::DeviceType::WritableOnly,
+                                                [ this ]( int scanned, int total )
+                                                { Q_EMIT scanProgress( scanned, total ); } );
 
     cDebug() << "LIST OF DETECTED DEVICES:";
     cDebug() << Logger::SubEntry << "node\tcapacity\tname\tprettyName";
@@ -291,38 +357,33 @@ PartitionCoreModule::doInit()
     cDebug() << Logger::SubEntry << devices.count() << "devices detected.";
     m_deviceModel->init( devices );
 
-    // The following PartUtils::runOsprober call in turn calls PartUtils::canBeResized,
-    // which relies on a working DeviceModel.
-    m_osproberLines = PartUtils::runOsprober( this->deviceModel() );
-
-    // We perform a best effort of filling out filesystem UUIDs in m_osproberLines
-    // because we will need them later on in PartitionModel if partition paths
-    // change.
-    // It is a known fact that /dev/sda1-style device paths aren't persistent
-    // across reboots (and this doesn't affect us), but partition numbers can also
-    // change at runtime against our will just for shits and giggles.
-    // But why would that ever happen? What system could possibly be so poorly
-    // designed that it requires a partition path rearrangement at runtime?
-    // Logical partitions on an MSDOS disklabel of course.
-    // See DeletePartitionJob::updatePreview.
-    for ( auto deviceInfo : m_deviceInfos )
+    // os-prober mounts every partition it can, which is slow, so it runs in the
+    // background. The partition models get the entries when it is done.
+    m_osproberLines.clear();
+    QStringList devicePaths;
+    for ( Device* device : devices )
     {
-        for ( auto it = PartitionIterator::begin( deviceInfo->device.data() );
-              it != PartitionIterator::end( deviceInfo->device.data() );
-              ++it )
+        devicePaths.append( device->deviceNode() );
+        for ( auto it = PartitionIterator::begin( device ); it != PartitionIterator::end( device ); ++it )
         {
-            Partition* partition = *it;
-            for ( auto jt = m_osproberLines.begin(); jt != m_osproberLines.end(); ++jt )
-            {
-                if ( jt->path == partition->partitionPath()
-                     && partition->fileSystem().supportGetUUID() != FileSystem::cmdSupportNone
-                     && !partition->fileSystem().uuid().isEmpty() )
-                {
-                    jt->uuid = partition->fileSystem().uuid();
-                }
-            }
+            devicePaths.append( ( *it )->partitionPath() );
+        }
+    }
+    const QString fingerprint = PartUtils::osproberFingerprint( devices );
+    // The probes are started, cancelled and resumed on the GUI thread
+    QMetaObject::invokeMethod(
+        this, [ this, fingerprint, devicePaths ] { startOsprober( fingerprint, devicePaths ); }, Qt::QueuedConnection );
+
+    // The speeds are kept in the device model, which belongs to the GUI thread, too
+    QStringList disks;
+    for ( Device* device : devices )
+    {
+        if ( device->type() == Device::Type::Disk_Device )
+        {
+            disks.append( device->deviceNode() );
         }
     }
+    QMetaObject::invokeMethod( this, [ this, disks ] { startDiskSpeedProbe( disks ); }, Qt::QueuedConnection );
 
     for ( auto deviceInfo : m_deviceInfos )
     {
@@ -358,9 +419,218 @@ PartitionCoreModule::doInit()
 
 PartitionCoreModule::~PartitionCoreModule()
 {
+    cancelOsprober();
+    m_osprober.waitForFinished();
+    cancelDiskSpeedProbe();
+    m_diskSpeedProbe.waitForFinished();
     qDeleteAll( m_deviceInfos );
 }
 
+void
+PartitionCoreModule::setOsproberPolicy( bool enabled, std::chrono::seconds timeout )
+{
+    m_osproberEnabled = enabled;
+    m_osproberTimeout = timeout;
+}
+
+void
+PartitionCoreModule::cancelOsprober()
+{
+    if ( m_osproberCancelled )
+    {
+        *m_osproberCancelled = true;
+    }
+}
+
+void
+PartitionCoreModule::startOsprober( const QString& fingerprint, const QStringList& devicePaths )
+{
+    // A previous run (before a revert) is for devices that no longer exist
+    cancelOsprober();
+    m_osprober.waitForFinished();
+    m_osproberCancelled.reset();
+    m_osproberFingerprint = fingerprint;
+    m_osproberDevicePaths = devicePaths;
+
+    Calamares::JobQueue::instance()->globalStorage()->insert( "osproberLines", QStringList() );
+    if ( !m_osproberEnabled )
+    {
+        cDebug() << "os-prober is disabled.";
+        return;
+    }
+
+    const auto timeout = m_osproberTimeout;
+    auto cancelled = std::make_shared< std::atomic< bool > >( false );
+    m_osproberCancelled = cancelled;
+    m_osprober = QtConcurrent::run(
+        [ this, fingerprint, devicePaths, timeout, cancelled, module = m_logModule ]
+        {
+            Logger::ModuleScope scope( module );
+            const auto entries = PartUtils::runOsprober( fingerprint, devicePaths, timeout, *cancelled );
+            QMetaObject::invokeMethod(
+                this,
+                [ this, cancelled, entries ] { applyOsproberEntries( cancelled, entries ); },
+                Qt::QueuedConnection );
+        } );
+}
+
+void
+PartitionCoreModule::resumeProbes()
+{
+    // os-prober that finished has dropped its token, and disks with a speed are not measured again
+    if ( m_osproberCancelled && *m_osproberCancelled )
+    {
+        cDebug() << "Running os-prober again, it was stopped before it finished.";
+        startOsprober( m_osproberFingerprint, m_osproberDevicePaths );
+    }
+    if ( m_diskSpeedProbeCancelled && *m_diskSpeedProbeCancelled )
+    {
+        startDiskSpeedProbe( m_diskSpeedProbeDisks );
+    }
+}
+
+void
+PartitionCoreModule::setDiskSpeedPolicy( bool enabled, qint64 bytes, qint64 slowThreshold )
+{
+    m_diskSpeedProbeEnabled = enabled;
+    m_diskSpeedProbeSize = bytes;
+    m_deviceModel->setSlowDiskThreshold( slowThreshold );
+}
+
+void
+PartitionCoreModule::cancelDiskSpeedProbe()
+{
+    if ( m_diskSpeedProbeCancelled )
+    {
+        *m_diskSpeedProbeCancelled = true;
+    }
+}
+
+void
+PartitionCoreModule::startDiskSpeedProbe( const QStringList& disks )
+{
+    if ( !m_diskSpeedProbeEnabled )
+    {
+        return;
+    }
+    // After a revert, a disk that is still being measured is measured again
+    cancelDiskSpeedProbe();
+    m_diskSpeedProbe.waitForFinished();
+    m_diskSpeedProbeDisks = disks;
+
+    QStringList deviceNodes;
+    for ( const QString& disk : disks )
+    {
+        // Speeds are kept, and the disks did not get faster
+        if ( !m_deviceModel->diskSpeed( disk ).isValid() )
+        {
+            deviceNodes.append( disk );
+        }
+    }
+    if ( deviceNodes.isEmpty() )
+    {
+        return;
+    }
+
+    const qint64 bytes = m_diskSpeedProbeSize;
+    auto cancelled = std::make_shared< std::atomic< bool > >( false );
+    m_diskSpeedProbeCancelled = cancelled;
+    m_diskSpeedProbe = QtConcurrent::run(
+        [ this, deviceNodes, bytes, cancelled, module = m_logModule ]
+        {
+            Logger::ModuleScope scope( module );
+            for ( const QString& deviceNode : deviceNodes )
+            {
+                if ( *cancelled )
+                {
+                    return;
+                }
+                const auto speed = PartUtils::probeDiskSpeed( deviceNode, bytes, *cancelled );
+                if ( speed.isValid() )
+                {
+                    QMetaObject::invokeMethod(
+                        this,
+                        [ this, deviceNode, speed ] { m_deviceModel->setDiskSpeed( deviceNode, speed ); },
+                        Qt::QueuedConnection );
+                }
+            }
+            QMetaObject::invokeMethod(
+                this,
+                [ this, cancelled ]
+                {
+                    if ( !*cancelled )
+                    {
+                        Q_EMIT diskSpeedsProbed();
+                    }
+                },
+                Qt::QueuedConnection );
+        } );
+}
+
+void
+PartitionCoreModule::applyOsproberEntries( const std::shared_ptr< std::atomic< bool > >& cancelled,
+                                           OsproberEntryList entries )
+{
+    {
+        QMutexLocker locker( &m_revertMutex );
+        if ( cancelled != m_osproberCancelled || *cancelled )
+        {
+            // Results for devices that have been reverted, or no longer wanted
+            return;
+        }
+
+        PartUtils::updateOsproberEntries( m_deviceModel, entries );
+        m_osproberLines = entries;
+        fillOsproberUuids();
+        for ( auto deviceInfo : m_deviceInfos )
+        {
+            deviceInfo->partitionModel->init( deviceInfo->device.data(), m_osproberLines );
+        }
+        // Done, so there is nothing to cancel or resume
+        m_osproberCancelled.reset();
+    }
+    Q_EMIT osproberEntriesChanged();
+}
+
+void
+PartitionCoreModule::fillOsproberUuids()
+{
+    // We perform a best effort of filling out filesystem UUIDs in m_osproberLines
+    // because we will need them later on in PartitionModel if partition paths
+    // change.
+    // It is a known fact that /dev/sda1-style device paths aren't persistent
+    // across reboots (and this doesn't affect us), but partition numbers can also
+    // change at runtime against our will just for shits and giggles.
+    // But why would that ever happen? What system could possibly be so poorly
+    // designed that it requires a partition path rearrangement at runtime?
+    // Logical partitions on an MSDOS disklabel of course.
+    // See DeletePartitionJob::updatePreview.
+    QHash< QString, QList< OsproberEntry* > > entriesByPath;
+    for ( auto& entry : m_osproberLines )
+    {
+        entriesByPath[ entry.path ].append( &entry );
+    }
+    // os-prober saw the disks as they were scanned, not as they have been edited since
+    for ( auto deviceInfo : m_deviceInfos )
+    {
+        for ( auto it = PartitionIterator::begin( deviceInfo->immutableDevice.data() );
+              it != PartitionIterator::end( deviceInfo->immutableDevice.data() );
+              ++it )
+        {
+            Partition* partition = *it;
+            const auto entries = entriesByPath.value( partition->partitionPath() );
+            if ( !entries.isEmpty() && partition->fileSystem().supportGetUUID() != FileSystem::cmdSupportNone
+                 && !partition->fileSystem().uuid().isEmpty() )
+            {
+                for ( OsproberEntry* entry : entries )
+                {
+                    entry->uuid = partition->fileSystem().uuid();
+                }
+            }
+        }
+    }
+}
+
 DeviceModel*
 PartitionCoreModule::deviceModel() const
 {
@@ -428,22 +698,32 @@ PartitionCoreModule::createPartition( Device* device, Partition* partition, Part
 }
 
 void
-PartitionCoreModule::previewCreatePartition( Device* device, Partition* partition )
+PartitionCoreModule::previewPartitionTable( Device* device,
+                                            const PartitionTable& table,
+                                            const QHash< qint64, QString >& mountPoints )
 {
-    if ( !device || !partition || !device->partitionTable() )
+    auto* deviceInfo = infoForDevice( device );
+    if ( !deviceInfo )
     {
         return;
     }
+    deviceInfo->forgetChanges();
 
-    if ( !partition->parent() )
+    PartitionModel::ResetHelper helper( deviceInfo->partitionModel.data() );
+    // Device takes ownership of its table, but does not destroy the current one
+    PartitionTable* previous = device->partitionTable();
+    device->setPartitionTable( new PartitionTable( table ) );
+    delete previous;
+
+    for ( auto it = PartitionIterator::begin( device ); it != PartitionIterator::end( device ); ++it )
     {
-        cWarning() << "previewCreatePartition called with partition lacking parent()";
-        return;
+        const auto mountPoint = mountPoints.constFind( ( *it )->firstSector() );
+        if ( mountPoint != mountPoints.constEnd() && isPartitionNew( *it ) )
+        {
+            PartitionInfo::setFormat( *it, true );
+            PartitionInfo::setMountPoint( *it, mountPoint.value() );
+        }
     }
-
-    device->partitionTable()->removeUnallocated();
-    partition->parent()->insert( partition );
-    device->partitionTable()->updateUnallocated( *device );
 }
 
 void
@@ -1065,6 +1345,7 @@ PartitionCoreModule::layoutApply( Device* dev,
 void
 PartitionCoreModule::revert()
 {
+    Logger::ModuleScope scope( m_logModule );
     QMutexLocker locker( &m_revertMutex );
     qDeleteAll( m_deviceInfos );
     m_deviceInfos.clear();
@@ -1114,6 +1395,7 @@ PartitionCoreModule::revertAllDevices()
 void
 PartitionCoreModule::revertDevice( Device* dev, bool individualRevert )
 {
+    Logger::ModuleScope scope( m_logModule );
     QMutexLocker locker( &m_revertMutex );
     DeviceInfo* devInfo = infoForDevice( dev );
 
@@ -1122,23 +1404,34 @@ PartitionCoreModule::revertDevice( Device* dev, bool individualRevert )
         return;
     }
     devInfo->forgetChanges();
-    CoreBackend* backend = CoreBackendManager::self()->backend();
-    Device* newDev = backend->scanDevice( devInfo->device->deviceNode() );
-    devInfo->device.reset( newDev );
-    devInfo->partitionModel->init( newDev, m_osproberLines );
+    Device* newDev = dev;
+    if ( devInfo->restoreSnapshot() )
+    {
+        // Still the same Device, so only its partitions need a refresh
+        devInfo->partitionModel->init( dev, m_osproberLines );
+    }
+    else
+    {
+        cDebug() << "Rescanning" << dev->deviceNode() << "to revert it.";
+        CoreBackend* backend = CoreBackendManager::self()->backend();
+        newDev = backend->scanDevice( devInfo->device->deviceNode() );
+        devInfo->device.reset( newDev );
+        devInfo->takeSnapshot();
+        devInfo->partitionModel->init( newDev, m_osproberLines );
 
-    m_deviceModel->swapDevice( dev, newDev );
+        m_deviceModel->swapDevice( dev, newDev );
 
-    QList< Device* > devices;
-    for ( DeviceInfo* const info : m_deviceInfos )
-    {
-        if ( info && !info->device.isNull() && info->device->type() == Device::Type::Disk_Device )
+        QList< Device* > devices;
+        for ( DeviceInfo* const info : m_deviceInfos )
         {
-            devices.append( info->device.data() );
+            if ( info && !info->device.isNull() && info->device->type() == Device::Type::Disk_Device )
+            {
+                devices.append( info->device.data() );
+            }
         }
-    }
 
-    m_bootLoaderModel->init( devices );
+        m_bootLoaderModel->init( devices );
+    }
 
     if ( individualRevert )
     {
@@ -27,11 +27,16 @@
 #include <kpmcore/core/partitiontable.h>
 
 // Qt
+#include <QFuture>
+#include <QHash>
 #include <QList>
 #include <QMutex>
 #include <QObject>
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
 
 class BootLoaderModel;
 class Config;
@@ -158,10 +163,17 @@ public:
     void setPartitionFlags( Device* device, Partition* partition, PartitionTable::Flags flags );
 
     /**
-     * @brief Preview-only insertion of a new partition into the in-memory model without
+     * @brief Preview-only replacement of the partition table of @p device, without
      * creating any jobs.
+     *
+     * The device gets a copy of @p table; earlier changes to the device are
+     * dropped. New partitions get the mount point from @p mountPoints, by
+     * their first sector, and are marked for formatting. The partition model
+     * is reset once.
     **/
-    void previewCreatePartition( Device* device, Partition* partition );
+    void previewPartitionTable( Device* device,
+                                const PartitionTable& table,
+                                const QHash< qint64, QString >& mountPoints );
 
     /// @brief Retrieve the path where the bootloader will be installed
     QString bootLoaderInstallPath() const { return m_bootLoaderInstallPath; }
@@ -249,18 +261,53 @@ public:
 
     const OsproberEntryList osproberEntries() const;  // os-prober data structure, cached
 
+    /** @brief Configures os-prober, which looks for other operating systems
+     *
+     * os-prober runs in the background after init() and revert(), and is
+     * stopped after @p timeout. If @p enabled is false, it does not run
+     * at all and there are no os-prober entries. Call this before init().
+     */
+    void setOsproberPolicy( bool enabled, std::chrono::seconds timeout );
+    /// @brief Stops os-prober if it is still running; its results are dropped, see resumeProbes()
+    void cancelOsprober();
+
+    /** @brief Configures the disk speed probe
+     *
+     * If @p enabled, init() starts reading up to @p bytes from each disk in
+     * the background (one disk at a time, so they do not slow each other down),
+     * and the deviceModel() shows how fast they are. Disks slower than
+     * @p slowThreshold bytes per second are flagged. Call this before init().
+     */
+    void setDiskSpeedPolicy( bool enabled, qint64 bytes, qint64 slowThreshold );
+    /// @brief Stops the disk speed probe; disks measured so far keep their speed
+    void cancelDiskSpeedProbe();
+    /// @brief Runs os-prober and the disk speed probe again, if they were stopped before they finished
+    void resumeProbes();
+
     void dumpQueue() const;  // debug output
 
 Q_SIGNALS:
+    /// @brief Emitted (from the init thread) as disks are scanned during init()
+    void scanProgress( int scanned, int total );
     void hasRootMountPointChanged( bool value );
     void isDirtyChanged( bool value );
     void reverted();
     void deviceReverted( Device* device );
+    /// @brief Emitted when os-prober is done, and the osproberEntries() are filled in
+    void osproberEntriesChanged();
+    /// @brief Emitted when the disk speed probe is done, and the deviceModel() has the speeds
+    void diskSpeedsProbed();
 
 private:
     void refreshAfterModelChange();
 
     void doInit();
+    /// @brief Runs os-prober over @p devicePaths in the background; call it on the GUI thread
+    void startOsprober( const QString& fingerprint, const QStringList& devicePaths );
+    void applyOsproberEntries( const std::shared_ptr< std::atomic< bool > >& cancelled, OsproberEntryList entries );
+    void fillOsproberUuids();
+    /// @brief Measures those of @p disks that have no speed yet; call it on the GUI thread
+    void startDiskSpeedProbe( const QStringList& disks );
     void updateHasRootMountPoint();
     void updateIsDirty();
     void scanForEfiSystemPartitions();
@@ -283,8 +330,21 @@ private:
     DirFSRestrictLayout m_dirFSRestrictLayout;
 
     OsproberEntryList m_osproberLines;
+    bool m_osproberEnabled = true;
+    std::chrono::seconds m_osproberTimeout { 60 };
+    QFuture< void > m_osprober;
+    std::shared_ptr< std::atomic< bool > > m_osproberCancelled;  ///< Set to stop the current os-prober run
+    QString m_osproberFingerprint;  ///< Of the current run, to resume it
+    QStringList m_osproberDevicePaths;
+
+    bool m_diskSpeedProbeEnabled = false;
+    qint64 m_diskSpeedProbeSize = 0;
+    QFuture< void > m_diskSpeedProbe;
+    std::shared_ptr< std::atomic< bool > > m_diskSpeedProbeCancelled;
+    QStringList m_diskSpeedProbeDisks;  ///< Of the current probe, to resume it
 
     QMutex m_revertMutex;
+    QString m_logModule;  ///< Instance key of the module, for the log of the threads this uses
 };
 
 #endif /* PARTITIONCOREMODULE_H */
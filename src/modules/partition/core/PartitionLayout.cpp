@@ -288,6 +288,11 @@ PartitionLayout::createPartitions( Device* dev,
     availableSectors = totalSectors;
     for ( const auto& entry : std::as_const( m_partLayout ) )
     {
+        // Start where the device prefers, which may leave a small gap
+        const qint64 alignedSector = std::min( PartUtils::alignedSector( dev, currentSector ), lastSector + 1 );
+        availableSectors -= alignedSector - currentSector;
+        currentSector = alignedSector;
+
         // Adjust partition size based on available space.
         qint64 sectors = partSectorsMap.value( &entry );
         sectors = std::min( sectors, availableSectors );
@@ -50,6 +50,7 @@
 #include "compat/CheckBox.h"
 #include "partition/PartitionIterator.h"
 #include "partition/PartitionQuery.h"
+#include "partition/Topology.h"
 #include "utils/Gui.h"
 #include "utils/Logger.h"
 #include "utils/Retranslator.h"
@@ -146,6 +147,9 @@ ChoicePage::showEvent( QShowEvent* event )
     // Refresh preview each time the page becomes visible (user may have navigated back).
     if ( m_core )
     {
+        // The image may have changed, and with it the time to write it
+        m_core->deviceModel()->setImageSize(
+            Calamares::JobQueue::instance()->globalStorage()->value( "imageselection.mappedSize" ).toLongLong() );
         updateActionChoicePreview( m_config->installChoice() );
     }
 }
@@ -199,10 +203,42 @@ ChoicePage::init( PartitionCoreModule* core )
              this,
              [ = ]
              {
+                 m_imageLayoutPreviews.clear();
                  setModelToComboBox( m_drivesCombo, core->deviceModel() );
                  m_drivesCombo->setCurrentIndex( m_lastSelectedDeviceIndex );
              } );
     setModelToComboBox( m_drivesCombo, core->deviceModel() );
+    // os-prober runs in the background, and may find something after the page is shown
+    connect( core,
+             &PartitionCoreModule::osproberEntriesChanged,
+             this,
+             [ this ]
+             {
+                 if ( selectedDevice() )
+                 {
+                     setupActions();
+                 }
+             } );
+
+    if ( m_config->preselectFastestDisk() )
+    {
+        connect( core,
+                 &PartitionCoreModule::diskSpeedsProbed,
+                 this,
+                 [ this ]
+                 {
+                     const int fastest = m_core->deviceModel()->fastestDeviceRow();
+                     if ( !m_devicePickedByUser && fastest >= 0 && fastest != m_drivesCombo->currentIndex() )
+                     {
+                         cDebug() << "Selecting the fastest disk, row" << fastest;
+                         m_drivesCombo->setCurrentIndex( fastest );
+                     }
+                 } );
+        connect( m_drivesCombo,
+                 qOverload< int >( &QComboBox::activated ),
+                 this,
+                 [ this ] { m_devicePickedByUser = true; } );
+    }
 
     connect( m_drivesCombo, qOverload< int >( &QComboBox::currentIndexChanged ), this, &ChoicePage::applyDeviceChoice );
     connect(
@@ -815,20 +851,86 @@ ChoicePage::doReplaceSelectedPartition( const QModelIndex& current )
         this );
 }
 
-/**
- * From src/modules/partition/tests/PartitionJobTests.cpp
- */
-static ::Partition*
-firstFreePartition( PartitionNode* parent )
+const ChoicePage::ImageLayoutPreview&
+ChoicePage::imageLayoutPreview( Device* device, const QVariantList& gptPartitions )
 {
-    for ( auto child : parent->children() )
+    // The sector size of the image, which need not be that of the device
+    const qint64 imageSectorSize = Calamares::JobQueue::instance()
+                                       ->globalStorage()
+                                       ->value( QStringLiteral( "imageselection.gptSectorSize" ) )
+                                       .toLongLong();
+    QString key = device->deviceNode() + QStringLiteral( "|%1" ).arg( imageSectorSize );
+    for ( const auto& partition : gptPartitions )
+    {
+        const auto partitionMap = partition.toMap();
+        key += QStringLiteral( "|%1:%2:%3" )
+                   .arg( partitionMap.value( "name" ).toString() )
+                   .arg( partitionMap.value( "first_lba" ).toLongLong() )
+                   .arg( partitionMap.value( "last_lba" ).toLongLong() );
+    }
+    auto it = m_imageLayoutPreviews.find( key );
+    if ( it != m_imageLayoutPreviews.end() )
+    {
+        return it.value();
+    }
+
+    // Start from the disk as it was scanned, without any of its partitions
+    const Device* original = m_core->immutableDeviceCopy( device );
+    const PartitionTable* originalTable = original && original->partitionTable() ? original->partitionTable()
+                                                                                   : device->partitionTable();
+    ImageLayoutPreview preview;
+    preview.table.reset( new PartitionTable( *originalTable ) );
+    PartitionTable* table = preview.table.data();
+    table->removeUnallocated();
+    const auto children = table->children();
+    for ( Partition* p : children )
+    {
+        table->remove( p );
+        delete p;
+    }
+
+    const qint64 logicalSize = 2048;  // SEAPATH default logical sector size
+    const PartitionRole role( PartitionRole::Primary );
+    const auto topology = Calamares::Partition::topology( device->deviceNode() );
+    preview.alignment = topology.granularity();
+    for ( const auto& partition : gptPartitions )
     {
-        if ( Calamares::Partition::isPartitionFreeSpace( child ) )
+        const auto partitionMap = partition.toMap();
+        const auto firstLBA = partitionMap.value( "first_lba" ).toLongLong();
+        const auto lastLBA = partitionMap.value( "last_lba" ).toLongLong();
+        const quint64 offset = quint64( firstLBA ) * quint64( imageSectorSize > 0 ? imageSectorSize : 512 );
+        // Not alignment(): the 1MiB of that is a convention, it costs the device nothing
+        if ( topology.isValid && !topology.isOnGranularity( offset ) )
         {
-            return child;
+            preview.misaligned.append( partitionMap.value( "name" ).toString() );
         }
+
+        // Default to ext4, currently no support for FS preview
+        FileSystem* fs = FileSystemFactory::create( FileSystem::Ext4, firstLBA, lastLBA, logicalSize );
+        table->insert( new Partition( table,
+                                      *device,
+                                      role,
+                                      fs,
+                                      firstLBA,
+                                      lastLBA,
+                                      QString(),
+                                      KPM_PARTITION_FLAG( None ),
+                                      QString(),
+                                      false,
+                                      KPM_PARTITION_FLAG( None ),
+                                      KPM_PARTITION_STATE( New ) ) );
+        preview.mountPoints.insert( firstLBA, partitionMap.value( "name" ).toString() );
+    }
+    table->updateUnallocated( *device );
+
+    cDebug() << "Built image layout preview for" << device->deviceNode() << "with" << gptPartitions.count()
+             << "partitions.";
+    if ( !preview.misaligned.isEmpty() )
+    {
+        cWarning() << "Image partitions" << preview.misaligned << "are not aligned to" << preview.alignment
+                   << "bytes on" << device->deviceNode();
     }
-    return nullptr;
+    return m_imageLayoutPreviews.insert( key, preview ).value();
 }
 
 /**
@@ -921,6 +1023,16 @@ ChoicePage::updateActionChoicePreview( InstallChoice choice )
     QMutexLocker locker( &m_previewsMutex );
 
     cDebug() << "Updating partitioning preview widgets.";
+    // The views of the image layout are kept for next time, only their model changes
+    for ( QWidget* view : { static_cast< QWidget* >( m_afterPartitionBarsView ),
+                            static_cast< QWidget* >( m_afterPartitionLabelsView ) } )
+    {
+        if ( view )
+        {
+            view->hide();
+            view->setParent( this );
+        }
+    }
     qDeleteAll( m_previewAfterFrame->children() );
 
     auto oldlayout = m_previewAfterFrame->layout();
@@ -995,23 +1107,10 @@ ChoicePage::updateActionChoicePreview( InstallChoice choice )
     {
         Device* targetDevice = selectedDevice();
 
-        qint64 logicalSize = 2048; // SEAPATH default logical sector size
-        const PartitionRole role( PartitionRole::Primary );
-
         Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
-        auto gptPartitions = gs->value( "imageselection.gptPartitions" );
-
-        // Prevent accumulation of preview partitions if user switches
-        // back and forth between choices.
-        if ( m_core->isDirty() )
-        {
-            cDebug() << "Device is dirty, reverting to clean state before adding preview partitions";
-            m_core->revertDevice( targetDevice );
-            targetDevice = selectedDevice();  // Refresh the targetDevice reference
-        }
+        const auto gptPartitions = gs->value( "imageselection.gptPartitions" ).toList();
 
-        PartitionTable* pt = targetDevice ? targetDevice->partitionTable() : nullptr;
-        if ( !pt )
+        if ( !targetDevice || !targetDevice->partitionTable() )
         {
             cDebug() << "No partition table found on device";
             m_messageLabel->setText( tr( "This storage device has no partition table. "
@@ -1020,88 +1119,51 @@ ChoicePage::updateActionChoicePreview( InstallChoice choice )
             break;
         }
 
-        // Remove directly the partition table without creating jobs (preview only)
-        cDebug() << "Removing all existing partitions from preview (no jobs created)";
-        QList< Partition* > partitionsToDelete;
-        for ( auto* child : targetDevice->partitionTable()->children() )
+        // Replaces whatever was previewed before, so switching back and forth
+        // between choices does not accumulate preview partitions.
+        const auto& preview = imageLayoutPreview( targetDevice, gptPartitions );
         {
-            Partition* p = dynamic_cast< Partition* >( child );
-            if ( p && !isPartitionFreeSpace( p ) )
-            {
-                partitionsToDelete.append( p );
-            }
+            QMutexLocker coreLocker( &m_coreMutex );
+            m_core->previewPartitionTable( targetDevice, *preview.table, preview.mountPoints );
         }
 
-        // Directly manipulate the partition table for preview (mimics previewCreatePartition)
-        targetDevice->partitionTable()->removeUnallocated();
-        for ( auto* p : partitionsToDelete )
+        m_previewBeforeLabel->setText( tr( "Current:", "@label" ) );
+        if ( !m_afterPartitionBarsView )
         {
-            cDebug() << "Removing existing partition" << p->partitionPath() << "from preview";
-            p->parent()->remove( p );
-            delete p;
+            m_afterPartitionBarsView = new PartitionBarsView( m_previewAfterFrame );
+            m_afterPartitionBarsView->setSelectionMode( QAbstractItemView::NoSelection );
         }
-        targetDevice->partitionTable()->updateUnallocated( *targetDevice );
-
-        for (const auto& partition : gptPartitions.toList())
+        if ( !m_afterPartitionLabelsView )
         {
-            auto partitionMap = partition.toMap();
-            auto partitionName = partitionMap.value("name").toString();
-            auto partitionFirstLBA = partitionMap.value("first_lba").toInt();
-            auto partitionLastLBA = partitionMap.value("last_lba").toInt();
-            auto partitionSize = partitionMap.value("size_sectors").toInt();
-
-            // For preview purposes, we need a parent node to attach the partition to
-            // First try to find free space, otherwise use the partition table itself
-            Partition* freePartition = firstFreePartition( targetDevice->partitionTable() );
-            PartitionNode* parentNode = freePartition ? static_cast<PartitionNode*>( freePartition->parent() )
-                                                      : static_cast<PartitionNode*>( targetDevice->partitionTable() );
-
-            if ( !parentNode )
-            {
-                cError() << "No parent node (partition table) found for preview partition" << partitionName;
-                exit( EXIT_FAILURE );
-            }
-
-            // Default to ext4, currently no support for FS preview
-            FileSystem* fs = FileSystemFactory::create( FileSystem::Ext4, partitionFirstLBA, partitionLastLBA, logicalSize );
-            Partition* previewPartition = new Partition( parentNode,
-                                                            *targetDevice,
-                                                            role,
-                                                            fs,
-                                                            partitionFirstLBA,
-                                                            partitionLastLBA,
-                                                            QString(),
-                                                            KPM_PARTITION_FLAG( None ),
-                                                            QString(),
-                                                            false,
-                                                            KPM_PARTITION_FLAG( None ),
-                                                            KPM_PARTITION_STATE( New ) );
-
-            cDebug() << "Created preview partition object for" << partitionName;
-            PartitionInfo::setFormat( previewPartition, true );
-            PartitionInfo::setMountPoint( previewPartition,  partitionName );
-            // Insert into preview without creating jobs
-            m_core->previewCreatePartition( targetDevice, previewPartition );
+            m_afterPartitionLabelsView = new PartitionLabelsView( m_previewAfterFrame );
+            m_afterPartitionLabelsView->setCustomNewRootLabel(
+                Calamares::Branding::instance()->string( Calamares::Branding::BootloaderEntryName ) );
+            m_afterPartitionLabelsView->setSelectionMode( QAbstractItemView::NoSelection );
         }
-        m_previewBeforeLabel->setText( tr( "Current:", "@label" ) );
-        m_afterPartitionBarsView = new PartitionBarsView( m_previewAfterFrame );
         m_afterPartitionBarsView->setNestedPartitionsMode( mode );
-        m_afterPartitionLabelsView = new PartitionLabelsView( m_previewAfterFrame );
         m_afterPartitionLabelsView->setExtendedPartitionHidden( mode == PartitionBarsView::NoNestedPartitions );
-        m_afterPartitionLabelsView->setCustomNewRootLabel(
-            Calamares::Branding::instance()->string( Calamares::Branding::BootloaderEntryName ) );
 
         PartitionModel* model = m_core->partitionModelForDevice( selectedDevice() );
-
-        // The QObject parents tree is meaningful for memory management here,
-        // see qDeleteAll above.
         m_afterPartitionBarsView->setModel( model );
         m_afterPartitionLabelsView->setModel( model );
-        m_afterPartitionBarsView->setSelectionMode( QAbstractItemView::NoSelection );
-        m_afterPartitionLabelsView->setSelectionMode( QAbstractItemView::NoSelection );
 
         layout->addWidget( m_afterPartitionBarsView );
         layout->addWidget( m_afterPartitionLabelsView );
+        m_afterPartitionBarsView->show();
+        m_afterPartitionLabelsView->show();
+
+        if ( !preview.misaligned.isEmpty() )
+        {
+            QLabel* alignmentLabel = new QLabel( m_previewAfterFrame );
+            alignmentLabel->setWordWrap( true );
+            alignmentLabel->setText(
+                tr( "The partitions %1 of the image do not start on a multiple of %2 bytes, "
+                    "as this storage device prefers. They will be slower, and may wear flash storage faster.",
+                    "@info" )
+                    .arg( preview.misaligned.join( QStringLiteral( ", " ) ) )
+                    .arg( preview.alignment ) );
+            layout->addWidget( alignmentLabel );
+        }
 
         if ( !m_isEfi )
         {
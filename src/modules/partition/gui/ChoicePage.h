@@ -19,9 +19,11 @@
 #include "Config.h"
 #include "core/OsproberEntry.h"
 
+#include <QHash>
 #include <QMutex>
 #include <QPointer>
 #include <QSet>
+#include <QSharedPointer>
 #include <QWidget>
 
 class QBoxLayout;
@@ -45,6 +47,7 @@ class PartitionLabelsView;
 class PartitionCoreModule;
 
 class Device;
+class PartitionTable;
 
 using SwapChoiceSet = Config::SwapChoiceSet;
 using Calamares::Units::operator""_MiB;
@@ -125,6 +128,21 @@ private:
 
     void updateDeviceStatePreview();
     void updateActionChoicePreview( Config::InstallChoice choice );
+
+    /// @brief What installing the image does to a disk
+    struct ImageLayoutPreview
+    {
+        QSharedPointer< PartitionTable > table;
+        QHash< qint64, QString > mountPoints;  ///< Partition names, by first sector
+        QStringList misaligned;  ///< Names of the partitions that don't start on the granularity of the device
+        quint64 alignment = 0;  ///< Preferred by the device, in bytes
+    };
+    /** @brief The partitions of the image @p gptPartitions, on @p device
+     *
+     * This is built once for each device and image, so switching between
+     * disks and choices only copies the partition table.
+     */
+    const ImageLayoutPreview& imageLayoutPreview( Device* device, const QVariantList& gptPartitions );
     void setupActions();
     OsproberEntryList getOsproberEntriesForDevice( Device* device ) const;
     void doAlongsideApply();
@@ -139,6 +157,7 @@ private:
     PartitionCoreModule* m_core;
 
     QMutex m_previewsMutex;
+    QHash< QString, ImageLayoutPreview > m_imageLayoutPreviews;  ///< By device node and image layout
 
     bool m_isEfi;
     QComboBox* m_drivesCombo;
@@ -161,6 +180,7 @@ private:
     QPointer< QComboBox > m_efiComboBox;
 
     int m_lastSelectedDeviceIndex = -1;
+    bool m_devicePickedByUser = false;  ///< Then the fastest disk is not selected instead
     int m_osproberEntriesCount = -1;
     QString m_osproberOneEntryName;
 
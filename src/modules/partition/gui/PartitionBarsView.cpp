@@ -20,6 +20,7 @@
 #include <QDebug>
 #include <QGuiApplication>
 #include <QMouseEvent>
+#include <QPaintEvent>
 #include <QPainter>
 
 static const int VIEW_HEIGHT = qMax( Calamares::defaultFontHeight() + 8,  // wins out with big fonts
@@ -64,7 +65,66 @@ void
 PartitionBarsView::setNestedPartitionsMode( PartitionBarsView::NestedPartitionsMode mode )
 {
     m_nestedPartitionsMode = mode;
-    viewport()->repaint();
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::setModel( QAbstractItemModel* model )
+{
+    QAbstractItemView::setModel( model );
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::reset()
+{
+    QAbstractItemView::reset();
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::dataChanged( const QModelIndex& topLeft,
+                                const QModelIndex& bottomRight,
+                                const QVector< int >& roles )
+{
+    QAbstractItemView::dataChanged( topLeft, bottomRight, roles );
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::rowsInserted( const QModelIndex& parent, int start, int end )
+{
+    QAbstractItemView::rowsInserted( parent, start, end );
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::rowsAboutToBeRemoved( const QModelIndex& parent, int start, int end )
+{
+    QAbstractItemView::rowsAboutToBeRemoved( parent, start, end );
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::invalidateLayout()
+{
+    m_layoutValid = false;
+    viewport()->update();
+}
+
+void
+PartitionBarsView::ensureLayout() const
+{
+    if ( m_layoutValid )
+    {
+        return;
+    }
+
+    m_sections.clear();
+    QRect partitionsRect = rect();
+    partitionsRect.setHeight( VIEW_HEIGHT );
+    layoutSections( partitionsRect, QModelIndex() );
+    m_layoutValid = true;
 }
 
 QSize
@@ -82,26 +142,40 @@ PartitionBarsView::sizeHint() const
 void
 PartitionBarsView::paintEvent( QPaintEvent* event )
 {
+    ensureLayout();
+
     QPainter painter( viewport() );
-    painter.fillRect( rect(), palette().window() );
+    painter.fillRect( event->rect(), palette().window() );
     painter.setRenderHint( QPainter::Antialiasing );
 
-    QRect partitionsRect = rect();
-    partitionsRect.setHeight( VIEW_HEIGHT );
+    QModelIndex selectedIndex;
+    if ( selectionMode() != QAbstractItemView::NoSelection && selectionModel()
+         && !selectionModel()->selectedIndexes().isEmpty() )
+    {
+        selectedIndex = selectionModel()->selectedIndexes().first();
+    }
 
     painter.save();
-    drawPartitions( &painter, partitionsRect, QModelIndex() );
+    for ( const auto& section : std::as_const( m_sections ) )
+    {
+        if ( section.rect.intersects( event->rect() ) )
+        {
+            drawSection( &painter, section, selectedIndex );
+        }
+    }
     painter.restore();
 }
 
 void
-PartitionBarsView::drawSection( QPainter* painter, const QRect& rect_, int x, int width, const QModelIndex& index )
+PartitionBarsView::drawSection( QPainter* painter, const Section& section, const QModelIndex& selectedIndex )
 {
-    QColor color
-        = index.isValid() ? index.data( Qt::DecorationRole ).value< QColor >() : ColorUtils::unknownDisklabelColor();
-    bool isFreeSpace = index.isValid() ? index.data( PartitionModel::IsFreeSpaceRole ).toBool() : true;
+    const QModelIndex& index = section.index;
+    const QColor& color = section.color;
+    const bool isFreeSpace = section.isFreeSpace;
+    const int x = section.rect.x();
+    const int width = section.rect.width();
 
-    QRect rect = rect_;
+    QRect rect = section.rowRect;
     const int y = rect.y();
     const int height = rect.height();
     const int radius = qMax( 1, CORNER_RADIUS - ( VIEW_HEIGHT - height ) / 2 );
@@ -150,8 +224,7 @@ PartitionBarsView::drawSection( QPainter* painter, const QRect& rect_, int x, in
     painter->setBrush( gradient );
     painter->drawRoundedRect( rect, radius, radius );
 
-    if ( selectionMode() != QAbstractItemView::NoSelection && index.isValid() && selectionModel()
-         && !selectionModel()->selectedIndexes().isEmpty() && selectionModel()->selectedIndexes().first() == index )
+    if ( index.isValid() && index == selectedIndex )
     {
         painter->setPen( QPen( borderColor, 1 ) );
         QColor highlightColor = QPalette().highlight().color();
@@ -182,7 +255,7 @@ PartitionBarsView::drawSection( QPainter* painter, const QRect& rect_, int x, in
 }
 
 void
-PartitionBarsView::drawPartitions( QPainter* painter, const QRect& rect, const QModelIndex& parent )
+PartitionBarsView::layoutSections( const QRect& rect, const QModelIndex& parent ) const
 {
     PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
     if ( !modl )
@@ -209,7 +282,11 @@ PartitionBarsView::drawPartitions( QPainter* painter, const QRect& rect, const Q
             width = rect.right() - x + 1;
         }
 
-        drawSection( painter, rect, x, width, item.index );
+        m_sections.append( { item.index,
+                             QRect( x, rect.y(), width, rect.height() ),
+                             rect,
+                             item.index.data( Qt::DecorationRole ).value< QColor >(),
+                             item.index.data( PartitionModel::IsFreeSpaceRole ).toBool() } );
 
         if ( m_nestedPartitionsMode == DrawNestedPartitions && modl->hasChildren( item.index ) )
         {
@@ -217,144 +294,63 @@ PartitionBarsView::drawPartitions( QPainter* painter, const QRect& rect, const Q
                            rect.y() + EXTENDED_PARTITION_MARGIN,
                            width - 2 * EXTENDED_PARTITION_MARGIN,
                            rect.height() - 2 * EXTENDED_PARTITION_MARGIN );
-            drawPartitions( painter, subRect, item.index );
+            layoutSections( subRect, item.index );
         }
         x += width;
     }
 
     if ( !items.count() && !modl->device()->partitionTable() )  // No disklabel or unknown
     {
-        int width = rect.right() - rect.x() + 1;
-        drawSection( painter, rect, rect.x(), width, QModelIndex() );
+        m_sections.append( { QModelIndex(), rect, rect, ColorUtils::unknownDisklabelColor(), true } );
     }
 }
 
 QModelIndex
 PartitionBarsView::indexAt( const QPoint& point ) const
 {
-    return indexAt( point, rect(), QModelIndex() );
-}
-
-QModelIndex
-PartitionBarsView::indexAt( const QPoint& point, const QRect& rect, const QModelIndex& parent ) const
-{
-    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
-    if ( !modl )
-    {
-        return QModelIndex();
-    }
-    const int totalWidth = rect.width();
+    ensureLayout();
 
-    auto pair = computeItemsVector( parent );
-    QVector< PartitionBarsView::Item >& items = pair.first;
-    qreal& total = pair.second;
-    int x = rect.x();
-    for ( int row = 0; row < items.count(); ++row )
+    // Nested sections come after, and lie within, their parent; the innermost one wins
+    for ( auto it = m_sections.crbegin(); it != m_sections.crend(); ++it )
     {
-        const auto& item = items[ row ];
-        int width;
-        if ( row < items.count() - 1 )
+        if ( it->rect.contains( point ) )
         {
-            width = totalWidth * ( item.size / total );
+            return it->index;
         }
-        else
-        // Make sure we fill the last pixel column
-        {
-            width = rect.right() - x + 1;
-        }
-
-        QRect thisItemRect( x, rect.y(), width, rect.height() );
-        if ( thisItemRect.contains( point ) )
-        {
-            if ( m_nestedPartitionsMode == DrawNestedPartitions && modl->hasChildren( item.index ) )
-            {
-                QRect subRect( x + EXTENDED_PARTITION_MARGIN,
-                               rect.y() + EXTENDED_PARTITION_MARGIN,
-                               width - 2 * EXTENDED_PARTITION_MARGIN,
-                               rect.height() - 2 * EXTENDED_PARTITION_MARGIN );
-
-                if ( subRect.contains( point ) )
-                {
-                    return indexAt( point, subRect, item.index );
-                }
-                return item.index;
-            }
-            else  // contains but no children, we win
-            {
-                return item.index;
-            }
-        }
-        x += width;
     }
-
     return QModelIndex();
 }
 
 QRect
 PartitionBarsView::visualRect( const QModelIndex& index ) const
 {
-    return visualRect( index, rect(), QModelIndex() );
-}
-
-QRect
-PartitionBarsView::visualRect( const QModelIndex& index, const QRect& rect, const QModelIndex& parent ) const
-{
-    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
-    if ( !modl )
+    if ( !index.isValid() )
     {
         return QRect();
     }
-    const int totalWidth = rect.width();
+    ensureLayout();
 
-    auto pair = computeItemsVector( parent );
-    QVector< PartitionBarsView::Item >& items = pair.first;
-    qreal& total = pair.second;
-    int x = rect.x();
-    for ( int row = 0; row < items.count(); ++row )
+    // The selection model also has the other columns of the selected row
+    const QModelIndex first = index.sibling( index.row(), 0 );
+    for ( const auto& section : std::as_const( m_sections ) )
     {
-        const auto& item = items[ row ];
-        int width;
-        if ( row < items.count() - 1 )
-        {
-            width = totalWidth * ( item.size / total );
-        }
-        else
-        // Make sure we fill the last pixel column
+        if ( section.index == first )
         {
-            width = rect.right() - x + 1;
-        }
-
-        QRect thisItemRect( x, rect.y(), width, rect.height() );
-        if ( item.index == index )
-        {
-            return thisItemRect;
+            return section.rect;
         }
-
-        if ( m_nestedPartitionsMode == DrawNestedPartitions && modl->hasChildren( item.index )
-             && index.parent() == item.index )
-        {
-            QRect subRect( x + EXTENDED_PARTITION_MARGIN,
-                           rect.y() + EXTENDED_PARTITION_MARGIN,
-                           width - 2 * EXTENDED_PARTITION_MARGIN,
-                           rect.height() - 2 * EXTENDED_PARTITION_MARGIN );
-
-            QRect candidateVisualRect = visualRect( index, subRect, item.index );
-            if ( !candidateVisualRect.isNull() )
-            {
-                return candidateVisualRect;
-            }
-        }
-
-        x += width;
     }
-
     return QRect();
 }
 
 QRegion
 PartitionBarsView::visualRegionForSelection( const QItemSelection& selection ) const
 {
-    return QRegion();
+    QRegion region;
+    for ( const auto& index : selection.indexes() )
+    {
+        region += visualRect( index );
+    }
+    return region;
 }
 
 int
@@ -376,13 +372,6 @@ PartitionBarsView::scrollTo( const QModelIndex& index, ScrollHint hint )
     Q_UNUSED( hint )
 }
 
-void
-PartitionBarsView::setSelectionModel( QItemSelectionModel* selectionModel )
-{
-    QAbstractItemView::setSelectionModel( selectionModel );
-    connect( selectionModel, &QItemSelectionModel::selectionChanged, this, [ = ] { viewport()->repaint(); } );
-}
-
 void
 PartitionBarsView::setSelectionFilter( std::function< bool( const QModelIndex& ) > canBeSelected )
 {
@@ -426,8 +415,6 @@ PartitionBarsView::setSelection( const QRect& rect, QItemSelectionModel::Selecti
     {
         selectionModel()->select( eventIndex, flags );
     }
-
-    viewport()->repaint();
 }
 
 void
@@ -456,7 +443,7 @@ PartitionBarsView::mouseMoveEvent( QMouseEvent* event )
             QGuiApplication::restoreOverrideCursor();
         }
 
-        viewport()->repaint();
+        updateIndexes( oldHoveredIndex, m_hoveredIndex );
     }
 }
 
@@ -466,8 +453,9 @@ PartitionBarsView::leaveEvent( QEvent* )
     QGuiApplication::restoreOverrideCursor();
     if ( m_hoveredIndex.isValid() )
     {
+        const QModelIndex oldHoveredIndex = m_hoveredIndex;
         m_hoveredIndex = QModelIndex();
-        viewport()->repaint();
+        updateIndexes( oldHoveredIndex, QModelIndex() );
     }
 }
 
@@ -485,6 +473,21 @@ PartitionBarsView::mousePressEvent( QMouseEvent* event )
     }
 }
 
+void
+PartitionBarsView::resizeEvent( QResizeEvent* event )
+{
+    QAbstractItemView::resizeEvent( event );
+    invalidateLayout();
+}
+
+void
+PartitionBarsView::updateIndexes( const QModelIndex& a, const QModelIndex& b )
+{
+    QRegion region( visualRect( a ) );
+    region += visualRect( b );
+    viewport()->update( region );
+}
+
 void
 PartitionBarsView::updateGeometries()
 {
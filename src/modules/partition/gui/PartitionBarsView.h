@@ -14,7 +14,8 @@
 #include "PartitionViewSelectionFilter.h"
 
 #include <QAbstractItemView>
-
+#include <QColor>
+#include <QVector>
 
 /**
  * A Qt model view which displays the partitions inside a device as a colored bar.
@@ -22,6 +23,10 @@
  * It has been created to be used with a PartitionModel instance, but does not
  * call any PartitionModel-specific methods: it should be usable with other
  * models as long as they provide the same roles PartitionModel provides.
+ *
+ * The geometry and colour of the sections are computed when the model or
+ * the size of the view changes, not on every repaint; hovering and selecting
+ * only repaint the sections involved.
  */
 class PartitionBarsView : public QAbstractItemView
 {
@@ -38,6 +43,8 @@ public:
 
     void setNestedPartitionsMode( NestedPartitionsMode mode );
 
+    void setModel( QAbstractItemModel* model ) override;
+
     QSize minimumSizeHint() const override;
 
     QSize sizeHint() const override;
@@ -49,10 +56,11 @@ public:
     QRect visualRect( const QModelIndex& index ) const override;
     void scrollTo( const QModelIndex& index, ScrollHint hint = EnsureVisible ) override;
 
-    void setSelectionModel( QItemSelectionModel* selectionModel ) override;
-
     void setSelectionFilter( SelectionFilter canBeSelected );
 
+public slots:
+    void reset() override;
+
 protected:
     // QAbstractItemView API
     QRegion visualRegionForSelection( const QItemSelection& selection ) const override;
@@ -65,15 +73,35 @@ protected:
     void mouseMoveEvent( QMouseEvent* event ) override;
     void leaveEvent( QEvent* event ) override;
     void mousePressEvent( QMouseEvent* event ) override;
+    void resizeEvent( QResizeEvent* event ) override;
 
 protected slots:
     void updateGeometries() override;
+    void dataChanged( const QModelIndex& topLeft,
+                      const QModelIndex& bottomRight,
+                      const QVector< int >& roles = QVector< int >() ) override;
+    void rowsInserted( const QModelIndex& parent, int start, int end ) override;
+    void rowsAboutToBeRemoved( const QModelIndex& parent, int start, int end ) override;
 
 private:
-    void drawPartitions( QPainter* painter, const QRect& rect, const QModelIndex& parent );
-    void drawSection( QPainter* painter, const QRect& rect_, int x, int width, const QModelIndex& index );
-    QModelIndex indexAt( const QPoint& point, const QRect& rect, const QModelIndex& parent ) const;
-    QRect visualRect( const QModelIndex& index, const QRect& rect, const QModelIndex& parent ) const;
+    /// @brief One colored section of the bar, as laid out for the current model and size
+    struct Section
+    {
+        QModelIndex index;  ///< Invalid for an unknown (or no) disklabel
+        QRect rect;  ///< The area of this section
+        QRect rowRect;  ///< The row of sections this one is part of, for the rounded ends
+        QColor color;
+        bool isFreeSpace;
+    };
+
+    /// @brief Forgets the layout; it is computed again when next needed
+    void invalidateLayout();
+    /// @brief Computes the layout, if it is not up-to-date
+    void ensureLayout() const;
+    void layoutSections( const QRect& rect, const QModelIndex& parent ) const;
+    void drawSection( QPainter* painter, const Section& section, const QModelIndex& selectedIndex );
+    /// @brief Repaints the sections of @p a and @p b
+    void updateIndexes( const QModelIndex& a, const QModelIndex& b );
 
     NestedPartitionsMode m_nestedPartitionsMode;
 
@@ -86,6 +114,10 @@ private:
     };
     inline QPair< QVector< Item >, qreal > computeItemsVector( const QModelIndex& parent ) const;
     QPersistentModelIndex m_hoveredIndex;
+
+    // Parents come before their children, so they are drawn below them
+    mutable QVector< Section > m_sections;
+    mutable bool m_layoutValid = false;
 };
 
 #endif /* PARTITIONPREVIEW_H */
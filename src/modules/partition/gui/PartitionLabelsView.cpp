@@ -26,6 +26,7 @@
 // Qt
 #include <QGuiApplication>
 #include <QMouseEvent>
+#include <QPaintEvent>
 #include <QPainter>
 
 using namespace Calamares::Units;
@@ -43,6 +44,21 @@ buildUnknownDisklabelTexts( Device* dev )
     return texts;
 }
 
+/// @brief Text that is laid out once, for drawing many times
+static QVector< QStaticText >
+prepareLines( const QStringList& texts, const QFont& font )
+{
+    QVector< QStaticText > lines;
+    for ( const QString& text : texts )
+    {
+        QStaticText line( text );
+        line.setTextFormat( Qt::PlainText );
+        line.prepare( QTransform(), font );
+        lines.append( line );
+    }
+    return lines;
+}
+
 static uint
 getPartitionModelIndexFlags( const QModelIndex& index )
 {
@@ -76,7 +92,8 @@ PartitionLabelsView::sizeHint() const
     QAbstractItemModel* modl = model();
     if ( modl )
     {
-        return QSize( -1, LAYOUT_MARGIN + sizeForAllLabels( rect().width() ).height() );
+        ensureLayout();
+        return QSize( -1, LAYOUT_MARGIN + m_labelsHeight );
     }
     return QSize();
 }
@@ -84,15 +101,48 @@ PartitionLabelsView::sizeHint() const
 void
 PartitionLabelsView::paintEvent( QPaintEvent* event )
 {
-    Q_UNUSED( event )
+    ensureLayout();
 
     QPainter painter( viewport() );
-    painter.fillRect( rect(), palette().window() );
+    painter.fillRect( event->rect(), palette().window() );
     painter.setRenderHint( QPainter::Antialiasing );
 
-    QRect lRect = labelsRect();
+    QModelIndex selectedIndex;
+    if ( selectionMode() != QAbstractItemView::NoSelection && selectionModel()
+         && !selectionModel()->selectedIndexes().isEmpty() )
+    {
+        selectedIndex = selectionModel()->selectedIndexes().first();
+    }
+
+    const int lineHeight = fontMetrics().height();
+    for ( const Label& label : std::as_const( m_labels ) )
+    {
+        // The text reaches a little outside of the label's rect
+        if ( !label.rect.adjusted( 0, -lineHeight, 0, lineHeight ).intersects( event->rect() ) )
+        {
+            continue;
+        }
+
+        // Draw hover
+        if ( selectionMode() != QAbstractItemView::NoSelection &&  // no hover without selection
+             m_hoveredIndex.isValid() && label.index == m_hoveredIndex )
+        {
+            painter.save();
+            QRect labelRect( label.pos, label.rect.size() );
+            labelRect.adjust( 0, -LAYOUT_MARGIN, 0, -2 * LAYOUT_MARGIN );
+            painter.translate( 0.5, 0.5 );
+            QRect hoverRect = labelRect.adjusted( 0, 0, -1, -1 );
+            painter.setBrush( QPalette().window().color().lighter( 102 ) );
+            painter.setPen( Qt::NoPen );
+            painter.drawRoundedRect( hoverRect, CORNER_RADIUS, CORNER_RADIUS );
 
-    drawLabels( &painter, lRect, QModelIndex() );
+            painter.translate( -0.5, -0.5 );
+            painter.restore();
+        }
+
+        // Is this element the selected one?
+        drawLabel( &painter, label, label.index.isValid() && label.index == selectedIndex );
+    }
 }
 
 QRect
@@ -101,6 +151,74 @@ PartitionLabelsView::labelsRect() const
     return rect().adjusted( 0, LAYOUT_MARGIN, 0, 0 );
 }
 
+void
+PartitionLabelsView::invalidateLayout()
+{
+    m_layoutValid = false;
+    updateGeometry();  // the labels may need more, or fewer, lines
+    viewport()->update();
+}
+
+void
+PartitionLabelsView::ensureLayout() const
+{
+    if ( m_layoutValid )
+    {
+        return;
+    }
+
+    m_labels.clear();
+    m_labelsHeight = 0;
+    m_layoutValid = true;
+
+    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
+    if ( !modl )
+    {
+        return;
+    }
+
+    const QModelIndexList indexesToDraw = getIndexesToDraw( QModelIndex() );
+
+    const QRect rect = labelsRect();
+    int label_x = rect.x();
+    int label_y = rect.y();
+    for ( const QModelIndex& index : indexesToDraw )
+    {
+        const QStringList texts = buildTexts( index );
+
+        const QSize labelSize = sizeForLabel( texts );
+
+        if ( label_x + labelSize.width() > rect.width() )  //wrap to new line if overflow
+        {
+            label_x = rect.x();
+            label_y += labelSize.height() + labelSize.height() / 4;
+        }
+
+        const QPoint pos( label_x, label_y );
+        // The mouse area is LAYOUT_MARGIN higher than the drawing position, which is where the labels appear to be
+        m_labels.append( { index,
+                           pos,
+                           QRect( pos - QPoint( 0, LAYOUT_MARGIN ), labelSize ),
+                           index.data( Qt::DecorationRole ).value< QColor >(),
+                           prepareLines( texts, font() ) } );
+        m_labelsHeight = qMax( m_labelsHeight, label_y + labelSize.height() - rect.y() );
+
+        label_x += labelSize.width() + LABELS_MARGIN;
+    }
+
+    if ( !modl->rowCount() && !modl->device()->partitionTable() )  // No disklabel or unknown
+    {
+        const QStringList texts = buildUnknownDisklabelTexts( modl->device() );
+        const QSize labelSize = sizeForLabel( texts );
+        m_labels.append( { QModelIndex(),
+                           rect.topLeft(),
+                           QRect( rect.topLeft() - QPoint( 0, LAYOUT_MARGIN ), labelSize ),
+                           ColorUtils::unknownDisklabelColor(),
+                           prepareLines( texts, font() ) } );
+        m_labelsHeight = labelSize.height();
+    }
+}
+
 static void
 drawPartitionSquare( QPainter* painter, const QRect& rect, const QBrush& brush )
 {
@@ -246,110 +364,6 @@ PartitionLabelsView::buildTexts( const QModelIndex& index ) const
     return { firstLine, secondLine };
 }
 
-void
-PartitionLabelsView::drawLabels( QPainter* painter, const QRect& rect, const QModelIndex& parent )
-{
-    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
-    if ( !modl )
-    {
-        return;
-    }
-
-    const QModelIndexList indexesToDraw = getIndexesToDraw( parent );
-
-    int label_x = rect.x();
-    int label_y = rect.y();
-    for ( const QModelIndex& index : indexesToDraw )
-    {
-        QStringList texts = buildTexts( index );
-
-        QSize labelSize = sizeForLabel( texts );
-
-        QColor labelColor = index.data( Qt::DecorationRole ).value< QColor >();
-
-        if ( label_x + labelSize.width() > rect.width() )  //wrap to new line if overflow
-        {
-            label_x = rect.x();
-            label_y += labelSize.height() + labelSize.height() / 4;
-        }
-
-        // Draw hover
-        if ( selectionMode() != QAbstractItemView::NoSelection &&  // no hover without selection
-             m_hoveredIndex.isValid() && index == m_hoveredIndex )
-        {
-            painter->save();
-            QRect labelRect( QPoint( label_x, label_y ), labelSize );
-            labelRect.adjust( 0, -LAYOUT_MARGIN, 0, -2 * LAYOUT_MARGIN );
-            painter->translate( 0.5, 0.5 );
-            QRect hoverRect = labelRect.adjusted( 0, 0, -1, -1 );
-            painter->setBrush( QPalette().window().color().lighter( 102 ) );
-            painter->setPen( Qt::NoPen );
-            painter->drawRoundedRect( hoverRect, CORNER_RADIUS, CORNER_RADIUS );
-
-            painter->translate( -0.5, -0.5 );
-            painter->restore();
-        }
-
-        // Is this element the selected one?
-        bool sel = selectionMode() != QAbstractItemView::NoSelection && index.isValid() && selectionModel()
-            && !selectionModel()->selectedIndexes().isEmpty() && selectionModel()->selectedIndexes().first() == index;
-
-        drawLabel( painter, texts, labelColor, QPoint( label_x, label_y ), sel );
-
-        label_x += labelSize.width() + LABELS_MARGIN;
-    }
-
-    if ( !modl->rowCount() && !modl->device()->partitionTable() )  // No disklabel or unknown
-    {
-        QStringList texts = buildUnknownDisklabelTexts( modl->device() );
-        QColor labelColor = ColorUtils::unknownDisklabelColor();
-        drawLabel( painter, texts, labelColor, QPoint( rect.x(), rect.y() ), false /*can't be selected*/ );
-    }
-}
-
-QSize
-PartitionLabelsView::sizeForAllLabels( int maxLineWidth ) const
-{
-    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
-    if ( !modl )
-    {
-        return QSize();
-    }
-
-    const QModelIndexList indexesToDraw = getIndexesToDraw( QModelIndex() );
-
-    int lineLength = 0;
-    int numLines = 1;
-    int singleLabelHeight = 0;
-    for ( const QModelIndex& index : indexesToDraw )
-    {
-        QStringList texts = buildTexts( index );
-
-        QSize labelSize = sizeForLabel( texts );
-
-        if ( lineLength + labelSize.width() > maxLineWidth )
-        {
-            numLines++;
-            lineLength = labelSize.width();
-        }
-        else
-        {
-            lineLength += LABELS_MARGIN + labelSize.width();
-        }
-
-        singleLabelHeight = qMax( singleLabelHeight, labelSize.height() );
-    }
-
-    if ( !modl->rowCount() && !modl->device()->partitionTable() )  // Unknown or no disklabel
-    {
-        singleLabelHeight = sizeForLabel( buildUnknownDisklabelTexts( modl->device() ) ).height();
-    }
-
-    int totalHeight = numLines * singleLabelHeight + ( numLines - 1 ) * singleLabelHeight / 4;  //spacings
-
-    return QSize( maxLineWidth, totalHeight );
-}
-
 QSize
 PartitionLabelsView::sizeForLabel( const QStringList& text ) const
 {
@@ -367,23 +381,21 @@ PartitionLabelsView::sizeForLabel( const QStringList& text ) const
 }
 
 void
-PartitionLabelsView::drawLabel( QPainter* painter,
-                                const QStringList& text,
-                                const QColor& color,
-                                const QPoint& pos,
-                                bool selected )
+PartitionLabelsView::drawLabel( QPainter* painter, const Label& label, bool selected )
 {
+    const QPoint& pos = label.pos;
+    const QColor& color = label.color;
+    const int lineHeight = painter->fontMetrics().height();
+    // Static text is drawn from its top, not from the baseline
+    const int top = lineHeight / 2 - painter->fontMetrics().ascent();
+
     painter->setPen( Qt::black );
     int vertOffset = 0;
-    int width = 0;
-    for ( const QString& textLine : text )
+    for ( const QStaticText& line : label.lines )
     {
-        QSize textSize = painter->fontMetrics().size( Qt::TextSingleLine, textLine );
-        painter->drawText(
-            pos.x() + LABEL_PARTITION_SQUARE_MARGIN, pos.y() + vertOffset + textSize.height() / 2, textLine );
-        vertOffset += textSize.height();
+        painter->drawStaticText( pos.x() + LABEL_PARTITION_SQUARE_MARGIN, pos.y() + vertOffset + top, line );
+        vertOffset += lineHeight;
         painter->setPen( Qt::gray );
-        width = qMax( width, textSize.width() );
     }
 
     QRect partitionSquareRect(
@@ -401,84 +413,47 @@ PartitionLabelsView::drawLabel( QPainter* painter,
 QModelIndex
 PartitionLabelsView::indexAt( const QPoint& point ) const
 {
-    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
-    if ( !modl )
-    {
-        return QModelIndex();
-    }
-
-    const QModelIndexList indexesToDraw = getIndexesToDraw( QModelIndex() );
-
-    QRect rect = this->rect();
-    int label_x = rect.x();
-    int label_y = rect.y();
-    for ( const QModelIndex& index : indexesToDraw )
+    ensureLayout();
+    for ( const Label& label : std::as_const( m_labels ) )
     {
-        QStringList texts = buildTexts( index );
-
-        QSize labelSize = sizeForLabel( texts );
-
-        if ( label_x + labelSize.width() > rect.width() )  //wrap to new line if overflow
+        if ( label.rect.contains( point ) )
         {
-            label_x = rect.x();
-            label_y += labelSize.height() + labelSize.height() / 4;
-        }
-
-        QRect labelRect( QPoint( label_x, label_y ), labelSize );
-        if ( labelRect.contains( point ) )
-        {
-            return index;
+            return label.index;
         }
-
-        label_x += labelSize.width() + LABELS_MARGIN;
     }
-
     return QModelIndex();
 }
 
 QRect
 PartitionLabelsView::visualRect( const QModelIndex& idx ) const
 {
-    PartitionModel* modl = qobject_cast< PartitionModel* >( model() );
-    if ( !modl )
+    if ( !idx.isValid() )
     {
         return QRect();
     }
+    ensureLayout();
 
-    const QModelIndexList indexesToDraw = getIndexesToDraw( QModelIndex() );
-
-    QRect rect = this->rect();
-    int label_x = rect.x();
-    int label_y = rect.y();
-    for ( const QModelIndex& index : indexesToDraw )
+    // The selection model also has the other columns of the selected row
+    const QModelIndex first = idx.sibling( idx.row(), 0 );
+    for ( const Label& label : std::as_const( m_labels ) )
     {
-        QStringList texts = buildTexts( index );
-
-        QSize labelSize = sizeForLabel( texts );
-
-        if ( label_x + labelSize.width() > rect.width() )  //wrap to new line if overflow
-        {
-            label_x = rect.x();
-            label_y += labelSize.height() + labelSize.height() / 4;
-        }
-
-        if ( idx.isValid() && idx == index )
+        if ( label.index == first )
         {
-            return QRect( QPoint( label_x, label_y ), labelSize );
+            return label.rect;
         }
-
-        label_x += labelSize.width() + LABELS_MARGIN;
     }
-
     return QRect();
 }
 
 QRegion
 PartitionLabelsView::visualRegionForSelection( const QItemSelection& selection ) const
 {
-    Q_UNUSED( selection )
-
-    return QRegion();
+    QRegion region;
+    for ( const auto& index : selection.indexes() )
+    {
+        region += visualRect( index );
+    }
+    return region;
 }
 
 int
@@ -504,14 +479,44 @@ void
 PartitionLabelsView::setCustomNewRootLabel( const QString& text )
 {
     m_customNewRootLabel = text;
-    viewport()->repaint();
+    invalidateLayout();
+}
+
+void
+PartitionLabelsView::setModel( QAbstractItemModel* model )
+{
+    QAbstractItemView::setModel( model );
+    invalidateLayout();
 }
 
 void
-PartitionLabelsView::setSelectionModel( QItemSelectionModel* selectionModel )
+PartitionLabelsView::reset()
 {
-    QAbstractItemView::setSelectionModel( selectionModel );
-    connect( selectionModel, &QItemSelectionModel::selectionChanged, this, [ = ] { viewport()->repaint(); } );
+    QAbstractItemView::reset();
+    invalidateLayout();
+}
+
+void
+PartitionLabelsView::dataChanged( const QModelIndex& topLeft,
+                                  const QModelIndex& bottomRight,
+                                  const QVector< int >& roles )
+{
+    QAbstractItemView::dataChanged( topLeft, bottomRight, roles );
+    invalidateLayout();
+}
+
+void
+PartitionLabelsView::rowsInserted( const QModelIndex& parent, int start, int end )
+{
+    QAbstractItemView::rowsInserted( parent, start, end );
+    invalidateLayout();
+}
+
+void
+PartitionLabelsView::rowsAboutToBeRemoved( const QModelIndex& parent, int start, int end )
+{
+    QAbstractItemView::rowsAboutToBeRemoved( parent, start, end );
+    invalidateLayout();
 }
 
 void
@@ -524,6 +529,7 @@ void
 PartitionLabelsView::setExtendedPartitionHidden( bool hidden )
 {
     m_extendedPartitionHidden = hidden;
+    invalidateLayout();
 }
 
 QModelIndex
@@ -579,7 +585,7 @@ PartitionLabelsView::mouseMoveEvent( QMouseEvent* event )
             QGuiApplication::restoreOverrideCursor();
         }
 
-        viewport()->repaint();
+        updateIndexes( oldHoveredIndex, m_hoveredIndex );
     }
 }
 
@@ -591,8 +597,9 @@ PartitionLabelsView::leaveEvent( QEvent* event )
     QGuiApplication::restoreOverrideCursor();
     if ( m_hoveredIndex.isValid() )
     {
+        const QModelIndex oldHoveredIndex = m_hoveredIndex;
         m_hoveredIndex = QModelIndex();
-        viewport()->repaint();
+        updateIndexes( oldHoveredIndex, QModelIndex() );
     }
 }
 
@@ -610,6 +617,32 @@ PartitionLabelsView::mousePressEvent( QMouseEvent* event )
     }
 }
 
+void
+PartitionLabelsView::resizeEvent( QResizeEvent* event )
+{
+    QAbstractItemView::resizeEvent( event );
+    invalidateLayout();
+}
+
+void
+PartitionLabelsView::changeEvent( QEvent* event )
+{
+    QAbstractItemView::changeEvent( event );
+    // The cached labels are measured in the font, and some of their text is translated
+    if ( event->type() == QEvent::FontChange || event->type() == QEvent::LanguageChange )
+    {
+        invalidateLayout();
+    }
+}
+
+void
+PartitionLabelsView::updateIndexes( const QModelIndex& a, const QModelIndex& b )
+{
+    QRegion region( visualRect( a ) );
+    region += visualRect( b );
+    viewport()->update( region );
+}
+
 void
 PartitionLabelsView::updateGeometries()
 {
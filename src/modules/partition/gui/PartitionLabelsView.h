@@ -15,6 +15,9 @@
 #include "PartitionViewSelectionFilter.h"
 
 #include <QAbstractItemView>
+#include <QColor>
+#include <QStaticText>
+#include <QVector>
 
 /**
  * A Qt model view which displays colored labels for partitions.
@@ -22,6 +25,9 @@
  * It has been created to be used with a PartitionModel instance, but does not
  * call any PartitionModel-specific methods: it should be usable with other
  * models as long as they provide the same roles PartitionModel provides.
+ *
+ * Like PartitionBarsView, the labels are laid out (and their text prepared)
+ * when the model or the size of the view changes, not on every repaint.
  */
 class PartitionLabelsView : public QAbstractItemView
 {
@@ -43,12 +49,15 @@ public:
 
     void setCustomNewRootLabel( const QString& text );
 
-    void setSelectionModel( QItemSelectionModel* selectionModel ) override;
+    void setModel( QAbstractItemModel* model ) override;
 
     void setSelectionFilter( SelectionFilter canBeSelected );
 
     void setExtendedPartitionHidden( bool hidden );
 
+public slots:
+    void reset() override;
+
 protected:
     // QAbstractItemView API
     QRegion visualRegionForSelection( const QItemSelection& selection ) const override;
@@ -61,24 +70,49 @@ protected:
     void mouseMoveEvent( QMouseEvent* event ) override;
     void leaveEvent( QEvent* event ) override;
     void mousePressEvent( QMouseEvent* event ) override;
+    void resizeEvent( QResizeEvent* event ) override;
+    void changeEvent( QEvent* event ) override;
 
 protected slots:
     void updateGeometries() override;
+    void dataChanged( const QModelIndex& topLeft,
+                      const QModelIndex& bottomRight,
+                      const QVector< int >& roles = QVector< int >() ) override;
+    void rowsInserted( const QModelIndex& parent, int start, int end ) override;
+    void rowsAboutToBeRemoved( const QModelIndex& parent, int start, int end ) override;
 
 private:
+    /// @brief One label, as laid out for the current model and size
+    struct Label
+    {
+        QModelIndex index;  ///< Invalid for an unknown (or no) disklabel
+        QPoint pos;  ///< Where the label is drawn
+        QRect rect;  ///< The area that responds to the mouse
+        QColor color;
+        QVector< QStaticText > lines;
+    };
+
     QRect labelsRect() const;
-    void drawLabels( QPainter* painter, const QRect& rect, const QModelIndex& parent );
-    QSize sizeForAllLabels( int maxLineWidth ) const;
+    /// @brief Forgets the layout; it is computed again when next needed
+    void invalidateLayout();
+    /// @brief Computes the layout, if it is not up-to-date
+    void ensureLayout() const;
     QSize sizeForLabel( const QStringList& text ) const;
-    void drawLabel( QPainter* painter, const QStringList& text, const QColor& color, const QPoint& pos, bool selected );
+    void drawLabel( QPainter* painter, const Label& label, bool selected );
     QModelIndexList getIndexesToDraw( const QModelIndex& parent ) const;
     QStringList buildTexts( const QModelIndex& index ) const;
+    /// @brief Repaints the labels of @p a and @p b
+    void updateIndexes( const QModelIndex& a, const QModelIndex& b );
 
     SelectionFilter m_canBeSelected;
     bool m_extendedPartitionHidden;
 
     QString m_customNewRootLabel;
     QPersistentModelIndex m_hoveredIndex;
+
+    mutable QVector< Label > m_labels;
+    mutable int m_labelsHeight = 0;
+    mutable bool m_layoutValid = false;
 };
 
 #endif  // PARTITIONLABELSVIEW_H
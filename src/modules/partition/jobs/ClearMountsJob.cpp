@@ -15,6 +15,7 @@
 
 #include "partition/PartitionIterator.h"
 #include "partition/Sync.h"
+#include "partition/Teardown.h"
 #include "utils/Logger.h"
 #include "utils/String.h"
 
@@ -25,8 +26,23 @@
 
 #include <QCoreApplication>
 #include <QDir>
-#include <QProcess>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
 #include <QStringList>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/swap.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
 
 using Calamares::Partition::PartitionIterator;
 
@@ -73,37 +89,6 @@ getPartitionsForDevice( const QString& deviceName )
     return partitions;
 }
 
-STATICTEST QStringList
-getSwapsForDevice( const QString& deviceName )
-{
-    QProcess process;
-
-    // Build a list of partitions of type 82 (Linux swap / Solaris).
-    // We then need to clear them just in case they contain something resumable from a
-    // previous suspend-to-disk.
-    QStringList swapPartitions;
-    process.start( "sfdisk", { "-d", deviceName } );
-    process.waitForFinished();
-    // Sample output:
-    //    % sudo sfdisk -d /dev/sda
-    //    label: dos
-    //    label-id: 0x000ced89
-    //    device: /dev/sda
-    //    unit: sectors
-
-    //    /dev/sda1 : start=          63, size=    29329345, type=83, bootable
-    //    /dev/sda2 : start=    29331456, size=     2125824, type=82
-
-    swapPartitions = QString::fromLocal8Bit( process.readAllStandardOutput() ).split( '\n' );
-    swapPartitions = swapPartitions.filter( "type=82" );
-    for ( QStringList::iterator it = swapPartitions.begin(); it != swapPartitions.end(); ++it )
-    {
-        *it = ( *it ).simplified().split( ' ' ).first();
-    }
-
-    return swapPartitions;
-}
-
 static inline bool
 isSpecial( const QString& baseName )
 {
@@ -140,91 +125,303 @@ matchesExceptions( const QStringList& mapperExceptions, const QString& basename
     return false;
 }
 
-/** @brief Returns a list of unneeded crypto devices
+/** @brief Undoes the octal escapes (e.g. \040 for space) of /proc/self/mountinfo and /proc/swaps
+ */
+STATICTEST QString
+unescapeProcField( const QByteArray& field )
+{
+    QByteArray r;
+    r.reserve( field.size() );
+    for ( int i = 0; i < field.size(); ++i )
+    {
+        if ( field[ i ] == '\\' && i + 3 < field.size() && field[ i + 1 ] >= '0' && field[ i + 1 ] <= '3' )
+        {
+            bool ok = false;
+            const int c = field.mid( i + 1, 3 ).toInt( &ok, 8 );
+            if ( ok )
+            {
+                r.append( char( c ) );
+                i += 3;
+                continue;
+            }
+        }
+        r.append( field[ i ] );
+    }
+    return QString::fromLocal8Bit( r );
+}
+
+/** @brief Returns the (unescaped) file names of the active swaps in @p procSwaps
  *
- * These are the crypto devices to unmount and close; some are "needed"
- * for system operation: on Fedora, the live- mappers are special.
- * Some other devices are special, too, so those do not end up in
- * the list.
+ * The format of /proc/swaps is, e.g.
+ *      Filename                Type            Size    Used    Priority
+ *      /dev/sda2               partition       2097148 0       -2
  */
 STATICTEST QStringList
-getCryptoDevices( const QStringList& mapperExceptions )
+parseSwaps( const QByteArray& procSwaps )
 {
-    QDir mapperDir( "/dev/mapper" );
-    const QFileInfoList fiList = mapperDir.entryInfoList( QDir::Files );
-    QStringList list;
-    for ( const QFileInfo& fi : fiList )
+    QStringList swaps;
+    const auto lines = procSwaps.split( '\n' );
+    for ( int i = 1; i < lines.count(); ++i )  // Skip the header line
     {
-        QString baseName = fi.baseName();
-        if ( isSpecial( baseName ) || matchesExceptions( mapperExceptions, baseName ) )
+        const auto columns = lines[ i ].simplified().split( ' ' );
+        if ( columns.count() >= 2 && !columns[ 0 ].isEmpty() )
         {
-            continue;
+            swaps.append( unescapeProcField( columns[ 0 ] ) );
         }
-        list.append( fi.absoluteFilePath() );
     }
-    return list;
+    return swaps;
 }
 
+/** @brief What is mounted below any of @p mountPoints, deepest first
+ *
+ * Those must be unmounted before the mount points themselves, or that
+ * fails with EBUSY. @p allMountPoints is in mount order, as in
+ * /proc/self/mountinfo, so at the same depth the later mount goes first.
+ * Nothing is below "/", which is the root of the running system.
+ */
 STATICTEST QStringList
-getLVMVolumes()
+findSubmounts( const QStringList& mountPoints, const QStringList& allMountPoints )
 {
-    QProcess process;
-
-    // First we umount all LVM logical volumes we can find
-    process.start( "lvscan", { "-a" } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )  //means LVM2 tools are installed
-    {
-        QStringList lvscanLines = QString::fromLocal8Bit( process.readAllStandardOutput() ).split( '\n' );
-        // Get the second column (`value(1)`) sinec that is the device name,
-        // remove quoting.
-        std::transform( lvscanLines.begin(),
-                        lvscanLines.end(),
-                        lvscanLines.begin(),
-                        []( const QString& lvscanLine )
-                        { return lvscanLine.simplified().split( ' ' ).value( 1 ).replace( '\'', "" ); } );
-        return lvscanLines;
+    QStringList submounts;
+    for ( const auto& mountPoint : mountPoints )
+    {
+        if ( mountPoint == QStringLiteral( "/" ) )
+        {
+            continue;
+        }
+        const QString prefix = mountPoint + '/';
+        for ( auto it = allMountPoints.crbegin(); it != allMountPoints.crend(); ++it )
+        {
+            if ( it->startsWith( prefix ) && !submounts.contains( *it ) )
+            {
+                submounts.append( *it );
+            }
+        }
     }
-    else
+    std::stable_sort( submounts.begin(),
+                      submounts.end(),
+                      []( const QString& a, const QString& b ) { return a.count( '/' ) > b.count( '/' ); } );
+    return submounts;
+}
+
+/** @brief A block device in the stack built on the target disk
+ *
+ * The stack is found by following holders in sysfs: a partition is
+ * held by the LUKS mapper opened on it, which is held by the LVM
+ * logical volumes in it, etc. Tearing down goes from the top (level 0,
+ * nothing holds it) to the disk.
+ */
+struct BlockNode
+{
+    QString name;  ///< Kernel name, e.g. "sda1" or "dm-0"
+    QString path;  ///< Device node, e.g. /dev/sda1 or /dev/mapper/luks-...
+    QString mapperName;  ///< Device-mapper name, for dm devices
+    dev_t dev = 0;
+    QStringList holders;  ///< Kernel names of the devices stacked on this one
+    QStringList mountPoints;  ///< In mount order
+    QStringList submounts;  ///< Mounted below mountPoints, whatever the device, deepest first
+    QString swap;  ///< Name in /proc/swaps, if this is active swap
+    bool isPartition = false;  ///< Of the target disk
+    bool stacked = false;  ///< Built on the disk, like a mapper or RAID device
+    bool keep = false;  ///< A mapper exception, or something one depends on
+    int level = 0;
+};
+
+using BlockStack = QMap< QString, BlockNode >;
+
+static QByteArray
+readFile( const QString& path )
+{
+    QFile f( path );
+    return f.open( QIODevice::ReadOnly ) ? f.readAll() : QByteArray();
+}
+
+static QString
+readSysfs( const QString& name, const char* attribute )
+{
+    const QString path = QStringLiteral( "/sys/class/block/%1/%2" ).arg( name, QString::fromLatin1( attribute ) );
+    return QString::fromLatin1( readFile( path ) ).trimmed();
+}
+
+static dev_t
+deviceNumber( const QString& path )
+{
+    struct stat st;
+    return ( stat( path.toLocal8Bit().constData(), &st ) == 0 && S_ISBLK( st.st_mode ) ) ? st.st_rdev : 0;
+}
+
+/// @brief Adds @p name and (recursively) its holders to @p stack
+static void
+addBlockNode( BlockStack& stack, const QString& name, bool stacked )
+{
+    if ( stack.contains( name ) )
     {
-        cWarning() << "this system does not seem to have LVM2 tools.";
+        return;
+    }
+
+    BlockNode node;
+    node.name = name;
+    node.stacked = stacked;
+    const auto majorMinor = readSysfs( name, "dev" ).split( ':' );
+    node.dev = makedev( majorMinor.value( 0 ).toUInt(), majorMinor.value( 1 ).toUInt() );
+    node.mapperName = readSysfs( name, "dm/name" );
+    node.path = node.mapperName.isEmpty() ? QStringLiteral( "/dev/" ) + name
+                                          : QStringLiteral( "/dev/mapper/" ) + node.mapperName;
+    node.holders = QDir( QStringLiteral( "/sys/class/block/%1/holders" ).arg( name ) )
+                       .entryList( QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System );
+    stack.insert( name, node );
+
+    for ( const auto& holder : std::as_const( node.holders ) )
+    {
+        addBlockNode( stack, holder, true );
     }
-    return QStringList();
 }
-STATICTEST QStringList
-getPVGroups( const QString& deviceName )
+
+/// @brief Sets the level of @p name and its holders in @p levels; returns the level
+static int
+computeLevel( const QHash< QString, QStringList >& holders, const QString& name, QHash< QString, int >& levels )
 {
-    QProcess process;
-    // Then we go looking for volume groups that use this device for physical volumes
-    process.start( "pvdisplay", { "-C", "--noheadings" } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )  //means LVM2 tools are installed
-    {
-        QString pvdisplayOutput = process.readAllStandardOutput();
-        if ( !pvdisplayOutput.simplified().isEmpty() )  //means there is at least one LVM PV
+    const auto known = levels.constFind( name );
+    if ( known != levels.constEnd() )
+    {
+        return *known;
+    }
+    int level = 0;
+    for ( const auto& holder : holders.value( name ) )
+    {
+        level = std::max( level, computeLevel( holders, holder, levels ) + 1 );
+    }
+    levels.insert( name, level );
+    return level;
+}
+
+/** @brief The teardown level of each device in @p holders
+ *
+ * @p holders maps each device to the devices that hold it. A device
+ * is on a higher level than everything that holds it, so tearing down
+ * level by level frees holders before what they hold. Every device is
+ * a starting point: partitions are not holders of their disk.
+ */
+STATICTEST QHash< QString, int >
+computeLevels( const QHash< QString, QStringList >& holders )
+{
+    QHash< QString, int > levels;
+    for ( auto it = holders.constBegin(); it != holders.constEnd(); ++it )
+    {
+        computeLevel( holders, it.key(), levels );
+    }
+    return levels;
+}
+
+/** @brief Finds everything that uses disk @p deviceName
+ *
+ * This reads sysfs, /proc/self/mountinfo and /proc/swaps once,
+ * instead of running tools for each partition or volume.
+ */
+STATICTEST BlockStack
+scanBlockStack( const QString& deviceName, const QStringList& mapperExceptions )
+{
+    BlockStack stack;
+    if ( !QFileInfo::exists( QStringLiteral( "/sys/class/block/" ) + deviceName ) )
+    {
+        cWarning() << "No block device" << deviceName << "in sysfs.";
+        return stack;
+    }
+    addBlockNode( stack, deviceName, false );
+    const QStringList partitions = getPartitionsForDevice( deviceName );
+    for ( const auto& partition : partitions )
+    {
+        const QString name = partition.mid( 5 );  // Strip /dev/
+        // getPartitionsForDevice() is by prefix, so "sda" also finds "sdaa1"
+        if ( QFileInfo::exists( QStringLiteral( "/sys/block/%1/%2" ).arg( deviceName, name ) ) )
         {
-            QSet< QString > vgSet;
+            addBlockNode( stack, name, false );
+            stack[ name ].isPartition = true;
+        }
+    }
 
-            const QStringList pvdisplayLines = pvdisplayOutput.split( '\n' );
-            for ( const QString& pvdisplayLine : pvdisplayLines )
-            {
-                QString pvPath = pvdisplayLine.simplified().split( ' ' ).value( 0 );
-                QString vgName = pvdisplayLine.simplified().split( ' ' ).value( 1 );
-                if ( !pvPath.contains( deviceName ) )
-                {
-                    continue;
-                }
-
-                vgSet.insert( vgName );
-            }
-            return QStringList { vgSet.cbegin(), vgSet.cend() };
+    QHash< dev_t, QString > byDevice;
+    for ( const auto& node : std::as_const( stack ) )
+    {
+        byDevice.insert( node.dev, node.name );
+    }
+
+    // Format: id parent major:minor root mount-point options [optional...] - fstype source super-options
+    const auto mountInfo = readFile( QStringLiteral( "/proc/self/mountinfo" ) ).split( '\n' );
+    QStringList allMountPoints;  // In mount order
+    for ( const auto& line : mountInfo )
+    {
+        const auto fields = line.split( ' ' );
+        const int separator = fields.indexOf( "-" );
+        if ( fields.count() < 5 || separator < 0 || separator + 2 >= fields.count() )
+        {
+            continue;
+        }
+        allMountPoints.append( unescapeProcField( fields[ 4 ] ) );
+        const auto majorMinor = fields[ 2 ].split( ':' );
+        dev_t dev = makedev( majorMinor.value( 0 ).toUInt(), majorMinor.value( 1 ).toUInt() );
+        if ( major( dev ) == 0 && fields[ separator + 2 ].startsWith( '/' ) )
+        {
+            // E.g. btrfs reports an anonymous device; look at the source instead
+            dev = deviceNumber( unescapeProcField( fields[ separator + 2 ] ) );
+        }
+        const auto it = byDevice.constFind( dev );
+        if ( it != byDevice.constEnd() )
+        {
+            stack[ *it ].mountPoints.append( unescapeProcField( fields[ 4 ] ) );
         }
     }
-    else
+
+    for ( auto& node : stack )
+    {
+        node.submounts = findSubmounts( node.mountPoints, allMountPoints );
+    }
+
+    const QStringList swaps = parseSwaps( readFile( QStringLiteral( "/proc/swaps" ) ) );
+    for ( const auto& swap : swaps )
+    {
+        const auto it = byDevice.constFind( deviceNumber( swap ) );
+        if ( it != byDevice.constEnd() )
+        {
+            stack[ *it ].swap = swap;
+        }
+    }
+
+    // The disk goes after its partitions, as if they held it
+    QHash< QString, QStringList > holders;
+    for ( const auto& node : std::as_const( stack ) )
+    {
+        holders[ node.name ].append( node.holders );
+        if ( node.isPartition )
+        {
+            holders[ deviceName ].append( node.name );
+        }
+    }
+    const auto levels = computeLevels( holders );
+
+    // Holders come before what they hold, so keeping propagates downwards
+    QList< BlockNode* > nodes;
+    for ( auto& node : stack )
     {
-        cWarning() << "this system does not seem to have LVM2 tools.";
+        node.level = levels.value( node.name );
+        nodes.append( &node );
     }
-    return QStringList();
+    std::stable_sort( nodes.begin(),
+                      nodes.end(),
+                      []( const BlockNode* a, const BlockNode* b ) { return a->level < b->level; } );
+    for ( auto* node : std::as_const( nodes ) )
+    {
+        if ( !node->mapperName.isEmpty()
+             && ( isSpecial( node->mapperName ) || matchesExceptions( mapperExceptions, node->mapperName ) ) )
+        {
+            node->keep = true;
+        }
+        for ( const auto& holder : std::as_const( node->holders ) )
+        {
+            node->keep = node->keep || stack[ holder ].keep;
+        }
+    }
+    return stack;
 }
 
 /*
@@ -276,92 +473,146 @@ operator<<( QDebug& s, const MessageAndPath& m )
 }
 
 
-///@brief Returns a debug-string if @p partPath could be unmounted
+///@brief Returns a debug-string if @p mountPoint could be unmounted
 STATICTEST MessageAndPath
-tryUmount( const QString& partPath )
+tryUmount( const QString& mountPoint )
 {
-    QProcess process;
-    process.start( "umount", { partPath } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )
+    if ( umount2( mountPoint.toLocal8Bit().constData(), 0 ) == 0 )
     {
-        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully unmounted %1." ), partPath };
+        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully unmounted %1." ), mountPoint };
     }
-
-    process.start( "swapoff", { partPath } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )
+    // Not mounted (any more): a submount may be unmounted by the teardown of its own device, too
+    if ( errno != EINVAL )
     {
-        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully disabled swap %1." ), partPath };
+        cWarning() << "Could not unmount" << mountPoint << strerror( errno );
     }
+    return {};
+}
 
+///@brief Returns a debug-string if @p swap could be disabled
+STATICTEST MessageAndPath
+trySwapOff( const QString& swap )
+{
+    if ( swapoff( swap.toLocal8Bit().constData() ) == 0 )
+    {
+        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully disabled swap %1." ), swap };
+    }
+    cWarning() << "Could not disable swap" << swap << strerror( errno );
     return {};
 }
 
-///@brief Returns a debug-string if @p partPath was swap and could be cleared
+/** @brief Returns a debug-string if @p partPath was hibernated-to swap and could be cleared
+ *
+ * A hibernation image replaces the swap signature at the end of the
+ * first page by its own, and saves the original just before it. Putting
+ * the original back is what the kernel does when resuming is skipped.
+ * The page size is that of the system that hibernated, so try them all.
+ */
 STATICTEST MessageAndPath
 tryClearSwap( const QString& partPath )
 {
-    QProcess process;
-    process.start( "blkid", { "-s", "UUID", "-o", "value", partPath } );
-    process.waitForFinished();
-    QString swapPartUuid = QString::fromLocal8Bit( process.readAllStandardOutput() ).simplified();
-    if ( process.exitCode() != 0 || swapPartUuid.isEmpty() )
+    const QByteArray path = partPath.toLocal8Bit();
+    const int fd = open( path.constData(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
     {
         return {};
     }
-
-    process.start( "mkswap", { "-U", swapPartUuid, partPath } );
-    process.waitForFinished();
-    if ( process.exitCode() != 0 )
+    char signatures[ 20 ];  // orig_sig[10], sig[10] of the kernel's swsusp_header
+    off_t offset = -1;
+    for ( const off_t pageSize : { 4096, 8192, 16384, 65536 } )
+    {
+        const off_t at = pageSize - off_t( sizeof( signatures ) );
+        if ( pread( fd, signatures, sizeof( signatures ), at ) == ssize_t( sizeof( signatures ) )
+             && std::memcmp( signatures, "SWAPSPACE2", 10 ) == 0 )
+        {
+            offset = at;
+            break;
+        }
+    }
+    close( fd );
+    // The signature itself is SWAPSPACE2 unless there is an image
+    if ( offset < 0 || std::memcmp( signatures + 10, "SWAPSPACE2", 10 ) == 0 )
     {
         return {};
     }
 
+    const int wfd = open( path.constData(), O_WRONLY | O_CLOEXEC );
+    const bool ok = wfd >= 0 && pwrite( wfd, signatures, 10, offset + 10 ) == 10 && fsync( wfd ) == 0;
+    if ( wfd >= 0 )
+    {
+        close( wfd );
+    }
+    if ( !ok )
+    {
+        cWarning() << "Could not clear hibernation image from" << partPath;
+        return {};
+    }
     return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully cleared swap %1." ), partPath };
 }
 
-///@brief Returns a debug-string if @p mapperPath could be closed
+///@brief Returns a debug-string if device-mapper device @p mapperName could be removed
 STATICTEST MessageAndPath
-tryCryptoClose( const QString& mapperPath )
+tryMapperRemove( const QString& mapperName )
 {
-    /* ignored */ tryUmount( mapperPath );
-
-    QProcess process;
-    process.start( "cryptsetup", { "close", mapperPath } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )
+    const QString error = Calamares::Partition::removeMapperDevice( mapperName );
+    if ( error.isEmpty() )
     {
-        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully closed mapper device %1." ), mapperPath };
+        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully closed mapper device %1." ), mapperName };
     }
-
+    cWarning() << "Could not close mapper device" << error;
     return {};
 }
 
+///@brief Returns a debug-string if software RAID @p mdPath could be stopped
 STATICTEST MessageAndPath
-tryVGDisable( const QString& vgName )
+tryRaidStop( const QString& mdPath )
 {
-    QProcess vgProcess;
-    vgProcess.start( "vgchange", { "-an", vgName } );
-    vgProcess.waitForFinished();
-    return ( vgProcess.exitCode() == 0 )
-        ? MessageAndPath { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully disabled volume group %1." ), vgName }
-        : MessageAndPath {};
+    const QString error = Calamares::Partition::stopRaidArray( mdPath );
+    if ( error.isEmpty() )
+    {
+        return { QT_TRANSLATE_NOOP( "ClearMountsJob", "Successfully stopped RAID array %1." ), mdPath };
+    }
+    cWarning() << "Could not stop RAID array" << error;
+    return {};
 }
 
-///@brief Apply @p f to all the @p paths, appending successes to @p news
-template < typename F >
-void
-apply( const QStringList& paths, F f, QList< MessageAndPath >& news )
+/** @brief Frees @p node: unmounts it, disables swap, and closes it if it is stacked
+ *
+ * The holders of @p node must have been torn down already.
+ */
+static QList< MessageAndPath >
+tearDown( const BlockNode& node )
 {
-    for ( const QString& p : std::as_const( paths ) )
+    QList< MessageAndPath > news;
+    auto add = [ &news ]( MessageAndPath&& m )
     {
-        auto n = f( p );
-        if ( !n.isEmpty() )
+        if ( !m.isEmpty() )
         {
-            news.append( n );
+            news.append( m );
         }
+    };
+
+    for ( const auto& submount : node.submounts )
+    {
+        add( tryUmount( submount ) );
+    }
+    for ( auto it = node.mountPoints.crbegin(); it != node.mountPoints.crend(); ++it )
+    {
+        add( tryUmount( *it ) );
     }
+    if ( !node.swap.isEmpty() )
+    {
+        add( trySwapOff( node.swap ) );
+    }
+    if ( !node.mapperName.isEmpty() )
+    {
+        add( tryMapperRemove( node.mapperName ) );
+    }
+    else if ( node.stacked && node.name.startsWith( QStringLiteral( "md" ) ) )
+    {
+        add( tryRaidStop( node.path ) );
+    }
+    return news;
 }
 
 STATICTEST QStringList
@@ -396,17 +647,51 @@ ClearMountsJob::prettyStatusMessage() const
 Calamares::JobResult
 ClearMountsJob::exec()
 {
-    const QString deviceName = m_deviceNode.split( '/' ).last();
+    // The device node may be a symlink, e.g. in /dev/disk/by-id/
+    const QString canonicalNode = QFileInfo( m_deviceNode ).canonicalFilePath();
+    const QString deviceName = ( canonicalNode.isEmpty() ? m_deviceNode : canonicalNode ).split( '/' ).last();
     Calamares::Partition::Syncer s;
     QList< MessageAndPath > goodNews;
 
-    apply( getCryptoDevices( m_mapperExceptions ), tryCryptoClose, goodNews );
-    apply( getLVMVolumes(), tryUmount, goodNews );
-    apply( getPVGroups( deviceName ), tryVGDisable, goodNews );
-
-    apply( getCryptoDevices( m_mapperExceptions ), tryCryptoClose, goodNews );
-    apply( getPartitionsForDevice( deviceName ), tryUmount, goodNews );
-    apply( getSwapsForDevice( m_deviceNode ), tryClearSwap, goodNews );
+    const BlockStack stack = scanBlockStack( deviceName, m_mapperExceptions );
+    int maxLevel = -1;
+    for ( const auto& node : stack )
+    {
+        maxLevel = std::max( maxLevel, node.level );
+    }
+    // Everything on one level is independent, so tear it down in parallel
+    for ( int level = 0; level <= maxLevel; ++level )
+    {
+        QList< QFuture< QList< MessageAndPath > > > futures;
+        for ( const auto& node : stack )
+        {
+            if ( node.level != level )
+            {
+                continue;
+            }
+            if ( node.keep )
+            {
+                cDebug() << Logger::SubEntry << "Keeping" << node.path;
+                continue;
+            }
+            futures.append( QtConcurrent::run( tearDown, node ) );
+        }
+        for ( auto& f : futures )
+        {
+            goodNews.append( f.result() );
+        }
+    }
+    for ( const auto& node : stack )
+    {
+        if ( node.isPartition && !node.keep )
+        {
+            auto n = tryClearSwap( node.path );
+            if ( !n.isEmpty() )
+            {
+                goodNews.append( n );
+            }
+        }
+    }
 
     Calamares::JobResult ok = Calamares::JobResult::ok();
     ok.setMessage( tr( "Cleared all mounts for %1" ).arg( m_deviceNode ) );
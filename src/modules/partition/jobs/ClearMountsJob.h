@@ -18,20 +18,23 @@ class Device;
  * This job tries to free all mounts for the given device, so partitioning
  * operations can proceed.
  *
- * - partitions on the device are unmounted
- * - swap on the device is disabled and cleared
- * - physical volumes for LVM on the device are disabled
+ * The stack of block devices built on the device is found from sysfs:
+ * partitions, the LUKS mappers opened on them, LVM logical volumes
+ * and software RAID arrays using those, and so on. It is then torn
+ * down from the top, devices that don't depend on each other in parallel:
+ * - file systems on them are unmounted
+ * - swap on them is disabled
+ * - mapper devices (crypto / LUKS, LVM) and RAID arrays are closed
+ * Finally, swap partitions holding a hibernation image are cleared.
  *
- * In addition, regardless of device:
- * - almost all(*) /dev/mapper entries (crypto / LUKS, also LVM) are closed
- * - all logical volumes for LVM are unmounted
- * Exceptions to "all /dev/mapper" may be configured through
+ * Exceptions to closing mapper devices may be configured through
  * the setMapperExceptions() method. Pass in names of mapper
- * files that should not be closed (e.g. "myvg-mylv").
+ * files that should not be closed (e.g. "myvg-mylv"). The devices
+ * those are built on are left alone, too.
  *
- * (*) Some exceptions always exist: /dev/mapper/control is never
- *     closed. /dev/mapper/live-* is never closed. /dev/mapper/ventoy
- *     is never closed.
+ * Some exceptions always exist: /dev/mapper/control is never
+ * closed. /dev/mapper/live-* is never closed. /dev/mapper/ventoy
+ * is never closed.
  *
  */
 class ClearMountsJob : public Calamares::Job
@@ -18,6 +18,10 @@ QTEST_GUILESS_MAIN( ClearMountsJobTests )
 
 /* Not exactly public API */
 QStringList getPartitionsForDevice( const QString& deviceName );
+QString unescapeProcField( const QByteArray& field );
+QStringList parseSwaps( const QByteArray& procSwaps );
+QStringList findSubmounts( const QStringList& mountPoints, const QStringList& allMountPoints );
+QHash< QString, int > computeLevels( const QHash< QString, QStringList >& holders );
 
 /* At one point, the partitions-list was read from /proc/partitions by
  * running awk and grep, as below. Check that the current implementation
@@ -66,3 +70,59 @@ ClearMountsJobTests::testFindPartitions()
 
     QCOMPARE( partitions, other_part );
 }
+
+void
+ClearMountsJobTests::testProcParsing()
+{
+    QCOMPARE( unescapeProcField( "/dev/sda1" ), QStringLiteral( "/dev/sda1" ) );
+    QCOMPARE( unescapeProcField( "/mnt/my\\040disk" ), QStringLiteral( "/mnt/my disk" ) );
+    QCOMPARE( unescapeProcField( "/mnt/tab\\011and\\134" ), QStringLiteral( "/mnt/tab\tand\\" ) );
+    QCOMPARE( unescapeProcField( "/mnt/short\\04" ), QStringLiteral( "/mnt/short\\04" ) );
+
+    const QByteArray swaps( "Filename\t\t\t\tType\t\tSize\t\tUsed\t\tPriority\n"
+                            "/dev/sda2                               partition\t2097148\t\t0\t\t-2\n"
+                            "/swap\\040file                          file\t\t1048572\t\t0\t\t-3\n" );
+    QCOMPARE( parseSwaps( swaps ), QStringList( { "/dev/sda2", "/swap file" } ) );
+    QCOMPARE( parseSwaps( QByteArray( "Filename\tType\tSize\tUsed\tPriority\n" ) ), QStringList() );
+
+    const QStringList mounts { "/", "/proc", "/tmp/calamares-root", "/tmp/calamares-root/boot",
+                               "/tmp/calamares-root/proc", "/tmp/calamares-root/boot/efi",
+                               "/tmp/calamares-rootfs", "/tmp/calamares-root/dev" };
+    QCOMPARE( findSubmounts( { "/tmp/calamares-root" }, mounts ),
+              QStringList( { "/tmp/calamares-root/boot/efi",
+                             "/tmp/calamares-root/dev",
+                             "/tmp/calamares-root/proc",
+                             "/tmp/calamares-root/boot" } ) );
+    QCOMPARE( findSubmounts( { "/tmp/calamares-root/boot/efi" }, mounts ), QStringList() );
+    QCOMPARE( findSubmounts( { "/" }, mounts ), QStringList() );
+}
+
+void
+ClearMountsJobTests::testTeardownLevels()
+{
+    // sda1 is LUKS (dm-0) with LVM in it (dm-1, dm-2); sda2 is plain.
+    // The partitions are listed with the disk, as scanBlockStack() does.
+    const QHash< QString, QStringList > holders { { "sda", { "sda1", "sda2" } },
+                                                  { "sda1", { "dm-0" } },
+                                                  { "sda2", {} },
+                                                  { "dm-0", { "dm-1", "dm-2" } },
+                                                  { "dm-1", {} },
+                                                  { "dm-2", {} } };
+    const auto levels = computeLevels( holders );
+    QCOMPARE( levels.count(), 6 );
+    QCOMPARE( levels.value( "dm-1" ), 0 );
+    QCOMPARE( levels.value( "dm-2" ), 0 );
+    QCOMPARE( levels.value( "sda2" ), 0 );
+    QCOMPARE( levels.value( "dm-0" ), 1 );
+    QCOMPARE( levels.value( "sda1" ), 2 );
+    QCOMPARE( levels.value( "sda" ), 3 );
+
+    // Each device is torn down after everything that holds it
+    for ( auto it = holders.constBegin(); it != holders.constEnd(); ++it )
+    {
+        for ( const auto& holder : it.value() )
+        {
+            QVERIFY( levels.value( holder ) < levels.value( it.key() ) );
+        }
+    }
+}
@@ -20,6 +20,8 @@ public:
 
 private Q_SLOTS:
     void testFindPartitions();
+    void testProcParsing();
+    void testTeardownLevels();
 };
 
 #endif
@@ -50,48 +50,31 @@ def check_disk_sanity(target_device):
     before extending the persistent partition.
     """
 
-    try: sgdisk_output = subprocess.run(
-        ["/usr/sbin/sgdisk", "-v", target_device],
-        capture_output=True,
-        text=True,
-    )
-
-    except subprocess.CalledProcessError:
+    gpt = libcalamares.utils.gpt_read(target_device)
+    if gpt is None:
         libcalamares.utils.error(f"Failed to check disk sanity on: {target_device}")
-        raise
+        raise RuntimeError(f"No GPT found on {target_device}")
 
-    if "Identified" in sgdisk_output.stdout:
+    if gpt["needs_repair"]:
         libcalamares.utils.debug(f"Disk {target_device} has GPT errors that need to be fixed.")
         fix_disk(target_device)
 
 def fix_disk(target_device):
     """
-    Fix GPT errors on the target device using sgdisk.
+    Fix GPT errors on the target device, and move the backup GPT
+    to the end of the device.
     """
 
-    try:
-        subprocess.run(
-            ["/usr/sbin/sgdisk", "-e", target_device],
-            check=True,
-        )
-    except subprocess.CalledProcessError:
+    if not libcalamares.utils.gpt_repair(target_device):
         libcalamares.utils.error(f"Failed to fix disk GPT on: {target_device}")
-        raise
+        raise RuntimeError(f"Cannot repair the GPT of {target_device}")
 
 
-def wait_for_device(target_device, data_partition):
+def wait_for_device(data_partition):
     """
-    Wait for the kernel to update the target device with the new partitions.
+    Wait for udev to create the node of a partition the kernel knows about.
     """
     TIMEOUT=60
-    try:
-        subprocess.run(
-            ["/usr/sbin/partprobe", target_device]
-        )
-    except subprocess.CalledProcessError:
-        libcalamares.utils.error(f"Fail to inform kernel of partition table changes")
-        raise
-
     try:
         subprocess.run(
             ["/usr/bin/udevadm", "settle"]
@@ -116,23 +99,17 @@ def extend_persistent_partition(target_device):
 
     check_disk_sanity(target_device)
 
-    try:
-        subprocess.run(
-            ["/usr/sbin/parted", target_device, "resizepart", "6", "100%"],
-            check=True,
-        )
-    except subprocess.CalledProcessError:
+    # This also tells the kernel about the new size of the partition
+    if not libcalamares.utils.gpt_grow_partition(target_device, 6):
         libcalamares.utils.error(f"Failed to extend persistent partition on: {target_device}")
-        raise
+        raise RuntimeError(f"Cannot extend partition 6 of {target_device}")
 
-    if target_device.startswith("/dev/nvme"):
-        # NVME devices use 'p' before the partition number
-        persistent_partition_name = f"{target_device}p6"
-    else:
-        persistent_partition_name = f"{target_device}6"
+    persistent_partition_name = libcalamares.utils.partition_device(target_device, 6)
+    if not persistent_partition_name:
+        libcalamares.utils.error(f"The kernel does not know partition 6 of: {target_device}")
+        raise RuntimeError(f"No partition 6 on {target_device}")
 
-
-    wait_for_device(target_device, persistent_partition_name)
+    wait_for_device(persistent_partition_name)
 
     try:
         subprocess.run(
@@ -164,39 +141,22 @@ def check_fs(target_partition_name):
             raise
 
 
-def remove_volume_group(mount_point):
-
-    try:
-        vg = subprocess.run(
-            ["vgs", "--noheadings", "-o", "vg_name"], check=True, capture_output=True, text=True
-        )
-    except subprocess.CalledProcessError:
-        # Volume group does not exist; nothing to do
-        libcalamares.utils.error("Failed to list volume groups")
-        raise
-
-    for element in vg.stdout.split('\n'):
-        vg_name=element.strip()
-        if vg_name == "":
-            continue
-
-        try:
-            pv_name = subprocess.run(
-                ["vgs", "--noheadings", "-o", "pv_name", vg_name], check=True, capture_output=True, text=True
-            )
-        except subprocess.CalledProcessError:
-            libcalamares.utils.error("Failed to list physical volume names")
-            raise
+def reset_target_device(target_device):
+    """
+    Removes the LVM volumes, dm-crypt mappings and RAID arrays on the
+    target device and wipes its old contents, so that nothing of them
+    is found again once the image is written.
 
-        # Check if volume group concerns the targeted disk
-        if mount_point in pv_name.stdout.strip():
-            try:
-                subprocess.run(
-                    ["/usr/sbin/vgremove", "-y", vg_name], check=True
-                )
-            except subprocess.CalledProcessError:
-                libcalamares.utils.error(f"Failed to disable volume group on: {mount_point}")
-                raise
+    Returns None, or an error message.
+    """
+    result = libcalamares.utils.reset_device(target_device)
+    libcalamares.utils.debug(
+        f"Reset {target_device} in {result['elapsed_ms']}ms: {', '.join(result['steps'])}"
+    )
+    if not result["ok"]:
+        libcalamares.utils.warning(result["message"])
+        return result["message"]
+    return None
 
 
 def run():
@@ -233,8 +193,24 @@ def run():
                     f"Could not parse progression from line: {line}"
                 )
 
-    libcalamares.utils.debug("Removing LVM volume groups on target device")
-    remove_volume_group(target_device)
+    # The image is checked in the background once it is selected;
+    # don't wipe the target device for an image known to be broken.
+    # If the check is not done yet, stop it: bmaptool reads the image anyway.
+    verified = libcalamares.utils.prepared_result("imageselection.verify", wait=False)
+    if verified is not None and not verified["ok"]:
+        libcalamares.utils.warning(verified["message"])
+        return (
+            "SEAPATH installation failed",
+            f"The selected image is not usable: {verified['message']}",
+        )
+
+    libcalamares.utils.debug("Resetting the target device")
+    reset_error = reset_target_device(target_device)
+    if reset_error:
+        return (
+            "SEAPATH installation failed",
+            f"Cannot prepare the selected device: {reset_error}",
+        )
 
     try:
         # Run the script on the host; switch to target_env_process_output(),
@@ -204,3 +204,68 @@ script:
     // "`id -u`" is a valid username.
     QVERIFY( !bool( CommandList( userScript, false, 10s ).run() ) );
 }
+
+void
+ShellProcessTests::testParallelGroups()
+{
+    YAML::Node doc = YAML::Load( R"(---
+script:
+    - "true"
+    - parallel:
+        - "sleep 0.4"
+        - command: "sleep 0.4"
+          timeout: 5
+        - "sleep 0.4"
+    - parallel:
+        limit: 1
+        commands:
+            - "sleep 0.2"
+            - "sleep 0.2"
+            - parallel: [ "nested" ]
+    - "true"
+)" );
+    CommandList cl( Calamares::YAML::mapToVariant( doc ).value( "script" ), false, 10s );
+    QCOMPARE( cl.count(), 7 );  // The nested parallel group is ignored
+    QCOMPARE( cl.at( 0 ).parallelGroup(), 0 );
+    QCOMPARE( cl.at( 1 ).parallelGroup(), 1 );
+    QCOMPARE( cl.at( 2 ).parallelGroup(), 1 );
+    QCOMPARE( cl.at( 2 ).timeout(), 5s );
+    QCOMPARE( cl.at( 3 ).parallelGroup(), 1 );
+    QCOMPARE( cl.at( 4 ).parallelGroup(), 2 );
+    QCOMPARE( cl.at( 4 ).parallelLimit(), 1 );
+    QCOMPARE( cl.at( 5 ).parallelGroup(), 2 );
+    QCOMPARE( cl.at( 6 ).parallelGroup(), 0 );
+
+    if ( !Calamares::JobQueue::instance() )
+    {
+        (void)new Calamares::JobQueue( nullptr );
+    }
+    if ( !Calamares::Settings::instance() )
+    {
+        (void)Calamares::Settings::init( QString() );
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY( bool( cl.run() ) );
+    // 0.4 for the first group (concurrent), 0.4 for the second (one at a time)
+    QVERIFY( timer.elapsed() >= 800 );
+    QVERIFY( timer.elapsed() < 1200 );
+
+    // The first failure in list order is reported, even if a later one fails sooner;
+    // the last command is not started after the failure.
+    doc = YAML::Load( R"(---
+script:
+    - parallel:
+        limit: 2
+        commands:
+            - "sleep 0.3; exit 3"
+            - "exit 4"
+            - "touch /tmp/calamares-parallel-not-run"
+)" );
+    QFile::remove( QStringLiteral( "/tmp/calamares-parallel-not-run" ) );
+    const auto r = CommandList( Calamares::YAML::mapToVariant( doc ).value( "script" ), false, 10s ).run();
+    QVERIFY( !bool( r ) );
+    QVERIFY( r.details().contains( QStringLiteral( "exit code 3" ) ) );
+    QVERIFY( !QFile::exists( QStringLiteral( "/tmp/calamares-parallel-not-run" ) ) );
+}
@@ -33,6 +33,8 @@ private Q_SLOTS:
     void testProcessListFromObject();
     // Check variable substitution
     void testRootSubstitution();
+    // Parallel groups: parsing, running and failure reporting
+    void testParallelGroups();
 };
 
 #endif
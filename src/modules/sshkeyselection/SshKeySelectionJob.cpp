@@ -10,11 +10,17 @@
 #include <QFile>
 
 SshKeySelectionJob::SshKeySelectionJob(bool skipIfNoRoot )
-    : Calamares::Job()
+    : Calamares::CppJob()
     , m_skipIfNoRoot( skipIfNoRoot )
 {
 }
 
+SshKeySelectionJob::SshKeySelectionJob( QObject* parent )
+    : Calamares::CppJob( parent )
+    , m_skipIfNoRoot( true )
+{
+}
+
 Calamares::JobResult
 SshKeySelectionJob::exec()
 {
@@ -2,14 +2,22 @@
 //   SPDX-License-Identifier: GPL-3.0-or-later
 #ifndef SSHKEYSELECTIONJOB_H
 #define SSHKEYSELECTIONJOB_H
-#include "Job.h"
+#include "CppJob.h"
 #include "utils/Logger.h"
 
-class SshKeySelectionJob : public Calamares::Job
+/** @brief Copies the selected SSH public keys into the target
+ *
+ * The job reads everything it needs from Global Storage, so it
+ * is also registered as the headless job of the sshkeyselection
+ * plugin and runs unchanged in an unattended install.
+ */
+class SshKeySelectionJob : public Calamares::CppJob
 {
     Q_OBJECT
 public:
     SshKeySelectionJob( bool skipIfNoRoot );
+    /// @brief Constructor for the plugin factory (skips if there is no root)
+    explicit SshKeySelectionJob( QObject* parent = nullptr );
 
     Calamares::JobResult exec() override;
     QString prettyName() const override;
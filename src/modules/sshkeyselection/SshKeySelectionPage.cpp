@@ -41,7 +41,7 @@ SshKeySelectionPage::SshKeySelectionPage( Config* config, QWidget* parent )
 #else
     ui->treeWidget->header()->setResizeMode(0, QHeaderView::ResizeToContents);
 #endif
-    scanAvailableKeys();
+    // The keys are listed by setKeys(), once findKeys() is done
 
     connect( ui->treeWidget, &QTreeWidget::itemChanged, this, [this]( QTreeWidgetItem* changed, int column )
     {
@@ -78,10 +78,11 @@ bool SshKeySelectionPage::hasSelection() const
     return false;
 }
 
-void
-SshKeySelectionPage::scanAvailableKeys()
+QVector< SshKeyInfo >
+SshKeySelectionPage::findKeys()
 {
     QDir dir("/seapath/ssh");
+    QVector< SshKeyInfo > keys;
 
     QStringList pub_files = dir.entryList(QStringList() << "*.pub", QDir::Files);
     cDebug() << "sshkeyselection: scanning" << dir.path() << "found" << pub_files.size() << "key file(s)";
@@ -93,8 +94,6 @@ SshKeySelectionPage::scanAvailableKeys()
             cDebug() << "sshkeyselection: cannot open" << f.fileName();
             continue;
         }
-        QFileInfo sshKeyFileInfo(f.fileName());
-        QString sshFileName(sshKeyFileInfo.fileName());
         // Optionally, get the comment from the public key line
         QString keyLine = QString::fromUtf8(f.readLine()).trimmed();
         f.close();
@@ -106,14 +105,24 @@ SshKeySelectionPage::scanAvailableKeys()
 
         cDebug() << "sshkeyselection: found key" << keyLabel;
 
-        m_availableImages << keyLabel;
+        keys.append( { dir.absoluteFilePath( fn ), keyLabel } );
+    }
+    return keys;
+}
+
+void
+SshKeySelectionPage::setKeys( const QVector< SshKeyInfo >& keys )
+{
+    for ( const auto& key : keys )
+    {
+        m_availableImages << key.label;
 
         auto* item = new QTreeWidgetItem(ui->treeWidget);
-        item->setText(0, sshFileName);
+        item->setText(0, QFileInfo( key.path ).fileName());
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
         item->setCheckState(0, Qt::Unchecked);
 
-        item->setData(0, Qt::UserRole, dir.absoluteFilePath(fn)); // Store the file path
+        item->setData(0, Qt::UserRole, key.path); // Store the file path
     }
 }
 
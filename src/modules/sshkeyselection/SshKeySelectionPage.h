@@ -12,6 +12,7 @@
 #define SSHKEYSELECTION_H
 
 
+#include <QVector>
 #include <QWidget>
 
 #include <optional>
@@ -25,6 +26,13 @@ class SshKeySelectionPage;
 
 struct ImageRow { const char* name; const char* version; const char* desc; };
 
+/// @brief A public key file, and the comment in it
+struct SshKeyInfo
+{
+    QString path;
+    QString label;  ///< The comment of the key, or else the file name
+};
+
 class SshKeySelectionPage : public QWidget
 {
     Q_OBJECT
@@ -32,6 +40,14 @@ public:
     explicit SshKeySelectionPage( Config* config, QWidget* parent = nullptr );
     bool hasSelection() const;
 
+    /** @brief Finds the public keys in /seapath/ssh
+     *
+     * This does not touch the page, so it can run in another thread.
+     */
+    static QVector< SshKeyInfo > findKeys();
+    /// @brief Lists @p keys on the page
+    void setKeys( const QVector< SshKeyInfo >& keys );
+
 
 public slots:
     void onInstallationFailed( const QString& message, const QString& details );
@@ -39,7 +55,6 @@ public slots:
 
 protected:
     void focusInEvent( QFocusEvent* e ) override;  //choose the child widget to focus
-    void scanAvailableKeys();
 
 
 private:
@@ -12,9 +12,11 @@
 #include "SshKeySelectionViewStep.h"
 
 #include "Config.h"
+#include "SshKeySelectionJob.h"
 #include "SshKeySelectionPage.h"
 
 #include "JobQueue.h"
+#include "widgets/LoadingPage.h"
 
 #include <QApplication>
 
@@ -22,7 +24,11 @@ SshKeySelectionViewStep::SshKeySelectionViewStep( QObject* parent )
     : Calamares::ViewStep( parent )
     , m_config( new Config( this ) )
     , m_widget( new SshKeySelectionPage( m_config ) )
+    , m_loadingPage( new Calamares::Widgets::LoadingPage( m_widget, tr( "Looking for SSH keys…", "@status" ) ) )
 {
+    m_loadingPage->load( &SshKeySelectionPage::findKeys,
+                         [ this ]( const QVector< SshKeyInfo >& keys ) { m_widget->setKeys( keys ); } );
+
     auto jq = Calamares::JobQueue::instance();
 
     emit nextStatusChanged( true );
@@ -33,9 +39,9 @@ SshKeySelectionViewStep::SshKeySelectionViewStep( QObject* parent )
 
 SshKeySelectionViewStep::~SshKeySelectionViewStep()
 {
-    if ( m_widget && m_widget->parent() == nullptr )
+    if ( m_loadingPage && m_loadingPage->parent() == nullptr )
     {
-        m_widget->deleteLater();
+        m_loadingPage->deleteLater();
     }
 }
 
@@ -50,7 +56,7 @@ SshKeySelectionViewStep::prettyName() const
 QWidget*
 SshKeySelectionViewStep::widget()
 {
-    return m_widget;
+    return m_loadingPage;
 }
 
 
@@ -88,4 +94,6 @@ SshKeySelectionViewStep::jobs() const
 }
 
 
-CALAMARES_PLUGIN_FACTORY_DEFINITION( SshKeySelectionViewStepFactory, registerPlugin< SshKeySelectionViewStep >(); )
+CALAMARES_PLUGIN_FACTORY_DEFINITION( SshKeySelectionViewStepFactory,
+                                     registerPlugin< SshKeySelectionViewStep >();
+                                     registerHeadlessJob< SshKeySelectionJob >(); )
@@ -18,6 +18,14 @@
 class Config;
 class SshKeySelectionPage;
 
+namespace Calamares
+{
+namespace Widgets
+{
+class LoadingPage;
+}  // namespace Widgets
+}  // namespace Calamares
+
 class PLUGINDLLEXPORT SshKeySelectionViewStep : public Calamares::ViewStep
 {
     Q_OBJECT
@@ -43,6 +51,7 @@ public:
 private:
     Config* m_config;
     SshKeySelectionPage* m_widget;
+    Calamares::Widgets::LoadingPage* m_loadingPage;  ///< Shows m_widget once the keys are found
 };
 
 CALAMARES_PLUGIN_FACTORY_DECLARATION( SshKeySelectionViewStepFactory )
@@ -15,6 +15,7 @@
 #include "UmountJob.h"
 
 #include "partition/Mount.h"
+#include "utils/ChrootHelper.h"
 #include "utils/Logger.h"
 #include "utils/System.h"
 #include "utils/Variant.h"
@@ -146,6 +147,9 @@ UmountJob::exec()
             "UMount", tr( "GlobalStorage is not available." ), Calamares::JobResult::InvalidConfiguration );
     }
 
+    // The chroot helper has its root in the target, which keeps it busy
+    Calamares::Utils::ChrootHelper::stop();
+
     // Factorized list of mount point keys to process in order.
     const QList<QString> mountKeys { "rootMountPoint", "persistentMountPoint", "homeMountPoint", "etcMountPoint" };
     for ( const auto& key : mountKeys )